@@ -0,0 +1,76 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# ---------- 檢查參數 ----------
+# Usage: ./bench.sh snapshot|run <FILE>.sd [RUNS]
+#   snapshot : full re-parse + analysis vs. loading <FILE>.sdsnap
+#   run      : ./parser --run vs. the JVM (class file already built, and
+#              parser + java end to end); stdin is <FILE>.in when it exists
+if (( $# < 2 )); then
+    echo "Usage: $0 snapshot|run <FILE>.sd [RUNS]"
+    exit 1
+fi
+
+MODE="$1"
+SRC="$2"
+RUNS="${3:-10}"
+
+if [[ ! -f "$SRC" ]]; then
+    echo "Error: '$SRC' not found."
+    exit 1
+fi
+
+BASE="$(basename "$SRC" .sd)"
+
+# 取 --time 輸出中指定 phase 的毫秒數，跑 RUNS 次後取平均
+average() {    # average <phase> <command...>
+    local phase="$1"; shift
+    for (( i = 0; i < RUNS; i++ )); do
+        "$@" 2>&1 >/dev/null
+    done | awk -v p="[time] $phase:" -v n="$RUNS" \
+        'index($0, p) == 1 { sum += $(NF-1) } END { printf "%.3f", sum / n }'
+}
+
+# 跑 RUNS 次指令（含啟動時間），回傳平均牆鐘毫秒數
+wall() {    # wall <command...>
+    local TIMEFORMAT=%R total=0 t
+    for (( i = 0; i < RUNS; i++ )); do
+        t="$( { time "$@" < "$INPUT" > /dev/null 2>&1; } 2>&1 )"
+        total="$(awk -v a="$total" -v b="$t" 'BEGIN { print a + b }')"
+    done
+    awk -v s="$total" -v n="$RUNS" 'BEGIN { printf "%.1f", s * 1000 / n }'
+}
+
+case "$MODE" in
+    snapshot)
+        ./parser --emit-snapshot "$SRC" > /dev/null
+        PARSE="$(average parse ./parser --time "$SRC")"
+        SEMA="$(average "semantic analysis" ./parser --time "$SRC")"
+        LOAD="$(average "snapshot load" ./parser --time "${BASE}.sdsnap")"
+        echo "runs:              $RUNS"
+        echo "parse:             $PARSE ms"
+        echo "semantic analysis: $SEMA ms"
+        echo "snapshot load:     $LOAD ms"
+        ;;
+    run)
+        INPUT="${SRC%.sd}.in"
+        [[ -f "$INPUT" ]] || INPUT=/dev/null
+        ./parser --emit=class "$SRC" > /dev/null
+        # 兩條路徑的輸出必須一致，否則比較沒有意義
+        if ! cmp -s <(./parser --run "$SRC" < "$INPUT") <(java -cp . "$BASE" < "$INPUT"); then
+            echo "Error: --run and java print different output"
+            exit 1
+        fi
+        VM="$(wall ./parser --run "$SRC")"
+        JVM="$(wall java -cp . "$BASE")"
+        BOTH="$(wall sh -c './parser --emit=class "$1" > /dev/null && java -cp . "$2"' sh "$SRC" "$BASE")"
+        echo "runs:                 $RUNS"
+        echo "parser --run:         $VM ms"
+        echo "java (class built):   $JVM ms"
+        echo "parser + java:        $BOTH ms"
+        ;;
+    *)
+        echo "Error: unknown mode '$MODE'"
+        exit 1
+        ;;
+esac
@@ -48,6 +48,9 @@ struct IfStmt;
 struct WhileStmt;
 struct ForStmt;
 struct ForEachStmt;
+struct SwitchStmt;
+struct BreakStmt;
+struct ContinueStmt;
 struct ReturnStmt;
 struct ExprStmt;
 struct EmptyStmt;
@@ -84,6 +87,9 @@ struct Visitor {
     virtual void visit(WhileStmt&) = 0;
     virtual void visit(ForStmt&) = 0;
     virtual void visit(ForEachStmt&) = 0;
+    virtual void visit(SwitchStmt&) = 0;
+    virtual void visit(BreakStmt&) = 0;
+    virtual void visit(ContinueStmt&) = 0;
     virtual void visit(ReturnStmt&) = 0;
     virtual void visit(ExprStmt&) = 0;
     virtual void visit(EmptyStmt&) = 0;
@@ -283,6 +289,36 @@ struct ForEachStmt : Stmt {
     void accept(Visitor& v) override { v.visit(*this); }
 };
 
+// One arm of a switch: its labels, then the statements up to the next
+// arm. An arm does not fall into the next one.
+struct SwitchCase {
+    std::vector<std::unique_ptr<Expr>> labels;
+    bool isDefault{false};
+    std::vector<int> values;        // of the labels, filled by semantic analysis
+    std::unique_ptr<Stmt> body;     // a Block
+    int line{0};
+};
+
+struct SwitchStmt : Stmt {
+    std::unique_ptr<Expr> cond;
+    std::vector<SwitchCase> cases;
+    bool hasBreak{false};           // some arm breaks out of it, filled by semantic analysis
+    SwitchStmt(std::unique_ptr<Expr> c, std::vector<SwitchCase> cs, int line = 0)
+        : Stmt(line), cond(std::move(c)), cases(std::move(cs)) {}
+    void accept(Visitor& v) override { v.visit(*this); }
+};
+
+// leaves / restarts the innermost enclosing loop (break: or switch)
+struct BreakStmt : Stmt {
+    BreakStmt(int line = 0) : Stmt(line) {}
+    void accept(Visitor& v) override { v.visit(*this); }
+};
+
+struct ContinueStmt : Stmt {
+    ContinueStmt(int line = 0) : Stmt(line) {}
+    void accept(Visitor& v) override { v.visit(*this); }
+};
+
 struct ReturnStmt : Stmt {
     std::unique_ptr<Expr> expr;  // may be nullptr
     ReturnStmt(std::unique_ptr<Expr> e = {}, int line = 0)
@@ -320,6 +356,7 @@ struct FuncDecl : Decl {
     std::vector<std::unique_ptr<VarDecl>> params;
     std::unique_ptr<Stmt> body;
     SymEntry sym;
+    int localSlots = 0;   // JVM local slots used by parameters and variables (set by semantic analysis)
     FuncDecl(Type r, std::string n, std::vector<std::unique_ptr<VarDecl>> p, std::unique_ptr<Stmt> b, int line = 0)
         : Decl(line), returnType(r), name(std::move(n)), params(std::move(p)), body(std::move(b)) {}
     void accept(Visitor& v) override { v.visit(*this); }
@@ -0,0 +1,123 @@
+// =============================================================
+// Bytecode.hpp  —  register bytecode run by the built-in VM (--run)
+// -------------------------------------------------------------
+//  • every function works on a window of registers: its locals by
+//    symbol slot first, temporaries above them. A call passes its
+//    arguments in consecutive registers of the caller, which become
+//    the callee's first registers, so nothing is copied
+//  • instructions are typed: int arithmetic wraps like the JVM, Eq /
+//    Ne of strings compare references, prints pick int / bool /
+//    string up front
+//  • operands: a is the destination register (or the jump target,
+//    an index into Module::code), b and c are sources; Imm forms
+//    carry a constant in c
+//  • superinstructions: Jump<cmp> is a comparison fused with its
+//    branch, IncJump<cmp> an AddImm fused with the loop test after
+//    it (b += c; if (b cmp d) goto a)
+//  Built by BytecodeCompiler, executed by VirtualMachine.
+// =============================================================
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bc {
+
+// Each comparison family lists Eq, Ne, Lt, Ge, Gt, Le in this order
+// (see Cmp); IncJump has no Eq / Ne forms
+#define SD_BYTECODE_OPS(X)                                                   \
+    X(Move)       /* a = b */                                                \
+    X(Int)        /* a = b (constant) */                                     \
+    X(Str)        /* a = string constant b */                                \
+    X(GetGlobal)  /* a = global b */                                         \
+    X(PutGlobal)  /* global a = b */                                         \
+    X(Add) X(Sub) X(Mul) X(Div) X(Rem) X(Xor)   /* a = b op c */             \
+    X(AddImm)     /* a = b + c (constant) */                                 \
+    X(Neg)        /* a = -b */                                               \
+    X(Not)        /* a = b ^ 1 */                                            \
+    X(Eq) X(Ne) X(Lt) X(Ge) X(Gt) X(Le)         /* a = b cmp c, 0 / 1 */     \
+    X(Concat)     /* a = b + b+1 + … (c string registers) */                 \
+    X(Jump)       /* goto a */                                               \
+    X(JumpTrue) X(JumpFalse)                    /* if (b) / (!b) goto a */   \
+    X(JumpEq) X(JumpNe) X(JumpLt) X(JumpGe) X(JumpGt) X(JumpLe)             \
+    X(JumpEqImm) X(JumpNeImm) X(JumpLtImm) X(JumpGeImm) X(JumpGtImm) X(JumpLeImm) \
+    X(IncJumpLt) X(IncJumpGe) X(IncJumpGt) X(IncJumpLe)                      \
+    X(IncJumpLtImm) X(IncJumpGeImm) X(IncJumpGtImm) X(IncJumpLeImm)          \
+    X(Switch)     /* goto Module::switches[a] at b */                        \
+    X(Call)       /* a = functions[b](registers c…) */                       \
+    X(Return)     /* return a */                                             \
+    X(ReturnVoid)                                                            \
+    X(PrintInt) X(PrintBool) X(PrintStr)        /* print a, b: newline */    \
+    X(PrintConst) /* print string constant a, b: newline */                  \
+    X(ReadInt) X(ReadBool) X(ReadChar) X(ReadStr)   /* a = next input */
+
+enum class Op : uint8_t {
+#define SD_BYTECODE_ENUM(name) name,
+    SD_BYTECODE_OPS(SD_BYTECODE_ENUM)
+#undef SD_BYTECODE_ENUM
+};
+
+enum class Cmp : uint8_t { Eq, Ne, Lt, Ge, Gt, Le };
+
+inline Cmp negate(Cmp c) { return Cmp(uint8_t(c) ^ 1); }   // !(x < y) is x >= y
+inline Cmp mirror(Cmp c) {                                  // x < y is y > x
+    switch (c) {
+        case Cmp::Lt: return Cmp::Gt;
+        case Cmp::Gt: return Cmp::Lt;
+        case Cmp::Ge: return Cmp::Le;
+        case Cmp::Le: return Cmp::Ge;
+        default:      return c;
+    }
+}
+inline Op compare(Cmp c)   { return Op(uint8_t(Op::Eq) + uint8_t(c)); }
+inline Op jump(Cmp c)      { return Op(uint8_t(Op::JumpEq) + uint8_t(c)); }
+inline Op jumpImm(Cmp c)   { return Op(uint8_t(Op::JumpEqImm) + uint8_t(c)); }
+// the IncJump form of a Jump<cmp> / Jump<cmp>Imm; Move when there is none
+inline Op incJump(Op j) {
+    if (j >= Op::JumpLt && j <= Op::JumpLe) return Op(uint8_t(Op::IncJumpLt) + uint8_t(j) - uint8_t(Op::JumpLt));
+    if (j >= Op::JumpLtImm && j <= Op::JumpLeImm)
+        return Op(uint8_t(Op::IncJumpLtImm) + uint8_t(j) - uint8_t(Op::JumpLtImm));
+    return Op::Move;
+}
+
+struct Insn {
+    Op op = Op::Move;
+    int32_t a = 0, b = 0, c = 0, d = 0;
+};
+
+struct Function {
+    std::string name;
+    int params = 0;         // registers 0 … params-1 receive the arguments
+    int locals = 0;         // registers params … locals-1 start out 0 / null
+    int registers = 0;      // locals and temporaries
+    int32_t entry = 0;      // first instruction in Module::code
+};
+
+// case values are sorted; `dense` tables index targets by value - low
+struct SwitchTable {
+    bool dense = false;
+    int low = 0;
+    std::vector<int32_t> targets;                       // dense: one per value, the default for gaps
+    std::vector<std::pair<int, int32_t>> cases;         // sparse: (value, target)
+    int32_t dflt = 0;
+};
+
+struct Global {
+    bool string = false;
+    int value = 0;          // int / bool / char start value
+    int text = -1;          // string literal it starts as; -1: null
+};
+
+struct Module {
+    std::vector<Insn> code;             // all functions, one after another
+    std::vector<Function> functions;
+    std::vector<std::string> strings;   // identical literals share an entry
+    std::vector<SwitchTable> switches;
+    std::vector<Global> globals;
+    int init = -1;                      // global initializers, before main; -1: none
+    int main = -1;
+};
+
+} // namespace bc
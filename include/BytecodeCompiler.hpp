@@ -0,0 +1,132 @@
+// =============================================================
+// BytecodeCompiler.hpp  —  analysed AST → register bytecode (--run)
+// -------------------------------------------------------------
+//  • locals live in the register of their symbol slot; temporaries
+//    are stacked above them and released at the end of each
+//    expression, so a call's arguments always sit at the top
+//  • an expression is computed straight into the register that
+//    wants it (x = y + 1 is one AddImm x, y, 1)
+//  • conditions become compare-and-branch instructions, with the
+//    constant as an immediate when one side is a literal; && / ||
+//    short-circuit the way CodeGenVisitor::genCond does
+//  • while / for are rotated (test at the bottom, a copy guards the
+//    entry); foreach walks a .. b inclusive in either direction
+//  • return f(...) inside f reassigns the parameters and jumps back
+//    to the top of the body (unless --disable=tail-rec), as the JVM
+//    code generator does, so accumulator recursion needs no frames
+//  • a peephole pass then fuses an AddImm with the loop test right
+//    after it into IncJump<cmp>, and jumps are resolved last
+//  Covers what the JVM code generator covers: int / bool / char /
+//  string scalars, calls, every statement and read. Arrays and reals
+//  are not compiled; compile() fails and error() says where.
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+#include "Bytecode.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct CompilerOptions;
+
+class BytecodeCompiler : private ast::Visitor {
+public:
+    explicit BytecodeCompiler(const CompilerOptions* opts = nullptr) : options(opts) {}
+
+    // false, with error() set, when the program uses arrays or reals
+    bool compile(ast::Program& program, bc::Module& out);
+    const std::string& error() const { return problem; }
+
+private:
+    const CompilerOptions* options;
+    bc::Module* m = nullptr;
+    std::string problem;
+
+    std::unordered_map<std::string, int> functions;     // by name → Module::functions
+    std::unordered_map<std::string, int> globals;       // by name → Module::globals
+    std::unordered_map<std::string, int> strings;       // literal → Module::strings
+
+    // -------- function being compiled --------
+    std::vector<bc::Insn> code;
+    std::vector<int32_t> labelAt;           // label → instruction index
+    std::vector<char> labelUsed;            // some jump goes there
+    struct PendingSwitch {
+        size_t table;                                   // in Module::switches
+        std::vector<std::pair<int, int>> cases;         // (value, label)
+        int dflt;
+    };
+    std::vector<PendingSwitch> switches;    // filled in once the labels are placed
+    int top = 0;                            // next free register
+    int high = 0;                           // most registers in use
+    int want = -1;                          // register the expression being visited should land in
+    int result = -1;                        // register holding the value just visited
+    const ast::FuncDecl* current = nullptr; // null for <clinit>
+    int entry = -1;                         // label at the top of the body; -1: no self tail calls
+    struct Exits { int brk, cont; };
+    std::vector<Exits> exits;               // innermost last; cont -1 for a switch outside loops
+
+    using Inits = std::vector<std::pair<ast::VarDecl*, ast::Expr*>>;
+    void function(int index, ast::Stmt* body, const Inits* inits);
+    void fuse();
+    void resolve();
+
+    void emit(bc::Op op, int a = 0, int b = 0, int c = 0, int d = 0) { code.push_back({op, a, b, c, d}); }
+    int newLabel();
+    void place(int label);
+    void jumpTo(bc::Op op, int label, int b = 0, int c = 0);
+    int temp();
+    int dest();                             // `want`, or a new temporary
+
+    int value(ast::Expr& e, int into = -1);
+    int string(const std::string& s);
+    int global(const SymEntry& sym, int line);
+    int load(ast::Var& v, int into = -1);
+    void store(const SymEntry& sym, int line, int reg);
+    bool scalar(const ast::Type& t, int line);       // false (and unsupported) for arrays / reals
+    void unsupported(int line, const std::string& what);
+
+    void cond(ast::Expr& e, int Ltrue, int Lfalse);  // -1: that outcome falls through (never both)
+    void compareJump(bc::Cmp c, ast::Expr& lhs, ast::Expr& rhs, int Ltrue, int Lfalse);
+    int comparison(bc::Cmp c, ast::Expr& lhs, ast::Expr& rhs);  // 0 / 1 into a register
+    void boolean(ast::Expr& e);             // 0 / 1 through cond, where a value is needed
+    void step(ast::Var& v, int delta);      // v += delta, no value
+    void loop(ast::Expr* c, ast::Stmt* body, ast::Stmt* stepStmt);
+    bool tailCall(ast::ReturnStmt& s);      // `return f(...)` in f → move the arguments, jump to entry
+    void concat(ast::Binary& b);            // a string + chain as one Concat
+    void print(ast::Expr& e, bool newline);
+
+    void visit(ast::IntLit& n) override;
+    void visit(ast::RealLit& n) override;
+    void visit(ast::StringLit& n) override;
+    void visit(ast::BoolLit& n) override;
+    void visit(ast::CharLit& n) override;
+    void visit(ast::Var& v) override;
+    void visit(ast::Unary& u) override;
+    void visit(ast::Binary& b) override;
+    void visit(ast::Postfix& p) override;
+    void visit(ast::Call& c) override;
+    void visit(ast::Assign& a) override;
+    void visit(ast::RangeExpr& r) override;
+    void visit(ast::Print& p) override;
+    void visit(ast::Println& p) override;
+    void visit(ast::Read& r) override;
+    void visit(ast::Block& b) override;
+    void visit(ast::IfStmt& s) override;
+    void visit(ast::WhileStmt& s) override;
+    void visit(ast::ForStmt& s) override;
+    void visit(ast::ForEachStmt& s) override;
+    void visit(ast::SwitchStmt& s) override;
+    void visit(ast::BreakStmt& s) override;
+    void visit(ast::ContinueStmt& s) override;
+    void visit(ast::ReturnStmt& s) override;
+    void visit(ast::ExprStmt& s) override;
+    void visit(ast::EmptyStmt& s) override;
+    void visit(ast::DeclList& dl) override;
+    void visit(ast::VarDecl& d) override;
+    void visit(ast::VarDeclList& dl) override;
+    void visit(ast::ConstDecl& d) override;
+    void visit(ast::FuncDecl& f) override;
+    void visit(ast::Program& p) override;
+};
@@ -0,0 +1,105 @@
+// =============================================================
+// ClassWriter.hpp  —  binary .class output (--emit=class)
+// -------------------------------------------------------------
+//  • takes the same pieces the text backend prints: fields with their
+//    Jasmin-style types, method signatures and the finished MethodCode
+//    of every method, and writes a class file javaa would assemble
+//    from the .jasm
+//  • operands stay in Jasmin form ("int cls.f(int, int)",
+//    "java.io.PrintStream java.lang.System.out") and are turned into
+//    descriptors and constant-pool entries here; the pool is
+//    deduplicated, every entry is written once
+//  • branches get 16-bit offsets; a method large enough to need more
+//    has the far ones widened to goto_w (a conditional one becomes the
+//    inverted test over a goto_w), repeated until the layout settles
+//  • unreachable instructions are dropped before layout, so every
+//    instruction after a goto / return / switch is a jump target
+//  • StackMapTable frames (StackMap.hpp) at every jump target;
+//    class file version 50 (Java 6), no SourceFile attribute
+//  Methods are kept as instruction copies until write(), so worker
+//  threads can collect theirs in their own writer and adopt() them in
+//  source order.
+// =============================================================
+#pragma once
+
+#include "MethodCode.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace classfile {
+
+// "int" → "I", "java.lang.String[]" → "[Ljava/lang/String;"
+std::string descriptor(std::string_view jasmType);
+// "(int, java.lang.String)" + "void" → "(ILjava/lang/String;)V"
+std::string methodDescriptor(std::string_view params, std::string_view returnType);
+
+// field / method operand: "type owner.name" or "ret owner.name(params)"
+struct MemberRef {
+    std::string owner;          // internal form, "java/lang/System"
+    std::string name;
+    std::string descriptor;
+};
+bool parseMember(std::string_view text, MemberRef& out);
+
+} // namespace classfile
+
+class ClassWriter {
+public:
+    using Constant = std::variant<std::monostate, int, std::string>;
+
+    explicit ClassWriter(std::string className) : className(std::move(className)) {}
+
+    // `type` in Jasmin form; `value` becomes a ConstantValue attribute
+    void field(std::string_view type, std::string_view name, Constant value = {});
+    // `signature` as in the text header after "method ": "public static int f(int, int)"
+    void method(std::string_view signature, int maxStack, int maxLocals, const MethodCode& code);
+    // appends `other`'s fields and methods after this writer's
+    void adopt(ClassWriter&& other);
+
+    // false (with `err` set) when a method cannot be encoded
+    bool write(std::ostream& out, std::string& err);
+
+    // instructions of the methods added so far (for --time)
+    size_t instructions() const { return instrCount; }
+
+private:
+    struct Field {
+        std::string name, descriptor;
+        Constant    value;
+    };
+    struct Method {
+        uint16_t    flags = 0;
+        std::string name, descriptor;
+        int         maxStack = 0, maxLocals = 0;
+        std::vector<Instr>       code;
+        std::vector<SwitchTable> tables;
+        std::deque<std::string>  texts;     // the operands `code` points to
+    };
+
+    std::string className;
+    std::vector<Field>  fields;
+    std::deque<Method>  methods;        // a deque: `texts` must not move
+    size_t              instrCount = 0;
+
+    // ---- constant pool ----
+    std::vector<uint8_t> pool;
+    uint32_t poolCount = 1;                              // next index; checked against 65535 by write()
+    std::unordered_map<std::string, uint16_t> entries;   // tag + payload → index
+    uint16_t entry(uint8_t tag, const std::vector<uint8_t>& payload);
+    uint16_t utf8(std::string_view s);
+    uint16_t classRef(std::string_view internalName);
+    uint16_t string(std::string_view s);
+    uint16_t integer(int v);
+    uint16_t doubleConst(double v);
+    uint16_t nameAndType(std::string_view name, std::string_view descriptor);
+    uint16_t member(uint8_t tag, std::string_view jasmRef, std::string& err);
+
+    bool encode(const Method& m, std::vector<uint8_t>& out, std::string& err);
+};
@@ -1,51 +1,134 @@
 // ============================================================================
-// CodeEmitter.hpp   —   lightweight helper for emitting JVM Jasmin code
+// CodeEmitter.hpp   —   buffered emitter for JVM Jasmin code
 // ----------------------------------------------------------------------------
+//  • 所有輸出先 append 到一塊連續 buffer，flush() 時只做一次 write()
+//  • emit(Opcode, parts...) 直接把 mnemonic / 整數 / label / 字串片段接上去，
+//    不產生暫時的 std::string
 //  • Handles indentation uniformly (4 spaces by default)
-//  • Automatically adds newline for emit() so visitor 只需關心指令內容
 //  • push()/pop() controls indentation depth
 //  • emitRaw() lets you寫 header 或註解而不自動換行
 // ============================================================================
 #pragma once
 
+#include "Opcode.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <istream>
 #include <ostream>
 #include <string>
-#include <algorithm>
+#include <string_view>
 
 class CodeEmitter {
 public:
+    // 寫到 output；沒有 output 的 emitter 只收集 buffer (給平行 worker 用)
     explicit CodeEmitter(std::ostream& output, int indentSpaces = 4)
-        : out(output), indentSize(indentSpaces) {}
+        : out(&output), indentSize(indentSpaces) { buf.reserve(kInitialCapacity); }
+    explicit CodeEmitter(int indentSpaces = 4)
+        : indentSize(indentSpaces) { buf.reserve(kInitialCapacity); }
 
-    // 禁 copy, 也禁 move (因为 out 是引用类型，不能重新绑定)
+    ~CodeEmitter() { flush(); }
+
+    // 禁 copy, 也禁 move (buffer 屬於單一輸出)
     CodeEmitter(const CodeEmitter&) = delete;
     CodeEmitter& operator=(const CodeEmitter&) = delete;
-    CodeEmitter(CodeEmitter&&) = default;
-    CodeEmitter& operator=(CodeEmitter&&) = delete;
 
-    // 產生一行指令 (自動縮排 + 換行)
-    void emit(const std::string& line) {
+    // 產生一行 directive (自動縮排 + 換行)
+    void emit(std::string_view line) {
+        writeIndent();
+        buf.append(line);
+        buf.push_back('\n');
+    }
+
+    // 產生一行指令: mnemonic 後接各 operand 片段 (string / int / char / Label)
+    template <typename... Parts>
+    void emit(Opcode op, const Parts&... parts) {
+        writeIndent();
+        buf.append(opcodeName(op));
+        if constexpr (sizeof...(parts) > 0) {
+            buf.push_back(' ');
+            (append(parts), ...);
+        }
+        buf.push_back('\n');
+        ++instructions;
+    }
+
+    // 以多個片段組成的一行 directive (method header, field ...)
+    template <typename... Parts>
+    void line(const Parts&... parts) {
         writeIndent();
-        out << line << '\n';
+        (append(parts), ...);
+        buf.push_back('\n');
+    }
+
+    void label(Label l) {
+        writeIndent();
+        append(l);
+        buf.append(":\n");
     }
 
     // 不換行、不自動縮排 (用於 .class header 或自行排版)
-    void emitRaw(const std::string& text) { out << text; }
+    // 接上其他 emitter 的 buffer 時一併帶入它的指令數
+    void emitRaw(std::string_view text, size_t instructionsInText = 0) {
+        buf.append(text);
+        instructions += instructionsInText;
+    }
+
+    // 先送出目前 buffer，再原樣複製另一個 stream 的內容 (streaming 模式暫存的 method)
+    void emitStream(std::istream& in) {
+        flush();
+        if (out && in.peek() != std::istream::traits_type::eof()) *out << in.rdbuf();
+    }
 
     // 只插入縮排後的換行 (搭配 emitRaw 使用)
-    void newline() { out << '\n'; }
+    void newline() { buf.push_back('\n'); }
 
     void push() { ++indentLevel; }
     void pop()  { indentLevel = std::max(0, indentLevel - 1); }
 
     int currentIndent() const { return indentLevel; }
 
+    // 一次 write() 送出整個 buffer
+    void flush() {
+        if (!out || buf.empty()) return;
+        out->write(buf.data(), std::streamsize(buf.size()));
+        buf.clear();
+    }
+
+    std::string_view buffer() const { return buf; }
+    size_t instructionCount() const { return instructions; }
+
+    // 各種 operand 片段
+    void append(std::string_view s) { buf.append(s); }
+    void append(const std::string& s) { buf.append(s); }
+    void append(const char* s) { buf.append(s); }
+    void append(char c) { buf.push_back(c); }
+    void append(int v) {
+        char tmp[16];
+        auto res = std::to_chars(tmp, tmp + sizeof tmp, v);
+        buf.append(tmp, size_t(res.ptr - tmp));
+    }
+    void append(Label l) {
+        buf.push_back('L');
+        append(l.id);
+    }
+
 private:
-    std::ostream& out;
+    static constexpr size_t kInitialCapacity = 1 << 16;
+    static constexpr std::string_view kSpaces = "                                                                ";
+
+    std::ostream* out = nullptr;
+    std::string buf;
+    size_t instructions = 0;
     int indentLevel = 0;
     int indentSize  = 4;
 
     void writeIndent() {
-        for (int i = 0; i < indentLevel * indentSize; ++i) out.put(' ');
+        size_t n = size_t(indentLevel * indentSize);
+        while (n > kSpaces.size()) {
+            buf.append(kSpaces);
+            n -= kSpaces.size();
+        }
+        buf.append(kSpaces.substr(0, n));
     }
 };
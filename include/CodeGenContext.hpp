@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Opcode.hpp"
+
 #include <string>
 #include <stack>
 
@@ -11,7 +13,10 @@ struct CodeGenContext {
     std::string className = "example";   // 由檔名或 Program node 決定
 
     // ---------------- label helpers -------------
-    std::string newLabel() { return "L" + std::to_string(nextLabel++); }
+    // labels are method-local, so numbering restarts in every method;
+    // output then does not depend on the order methods are generated in
+    Label newLabel()   { return Label{nextLabel++}; }
+    void resetLabels()     { nextLabel = 0; }
 
     // ---------------- local slot helpers --------
     int allocLocal()        { return nextLocal++; }
@@ -19,7 +24,7 @@ struct CodeGenContext {
     int currentLocal() const{ return nextLocal; }
 
     // ---------------- loop stacks (break/continue)
-    void pushLoop(const std::string& beginLbl, const std::string& exitLbl) {
+    void pushLoop(Label beginLbl, Label exitLbl) {
         loopBegin.push(beginLbl);
         loopExit.push(exitLbl);
     }
@@ -27,13 +32,13 @@ struct CodeGenContext {
         loopBegin.pop();
         loopExit.pop();
     }
-    std::string topLoopBegin() const { return loopBegin.top(); }
-    std::string topLoopExit()  const { return loopExit.top();  }
+    Label topLoopBegin() const { return loopBegin.top(); }
+    Label topLoopExit()  const { return loopExit.top();  }
 
 private:
-    int nextLabel = 0;          // global label counter L0, L1, ...
+    int nextLabel = 0;          // per‑method label counter L0, L1, ...
     int nextLocal = 0;          // per‑method local slot counter
 
-    std::stack<std::string> loopBegin;
-    std::stack<std::string> loopExit;
+    std::stack<Label> loopBegin;
+    std::stack<Label> loopExit;
 };
\ No newline at end of file
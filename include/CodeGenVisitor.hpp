@@ -7,17 +7,61 @@
 #include "SymbolTable.hpp"    // resolved symbols with slot / global info
 #include "CodeEmitter.hpp"    // pretty printer for assembly lines
 #include "CodeGenContext.hpp" // label + slot counters
+#include "ConstFolder.hpp"
+#include "DeadCode.hpp"
+#include "IRBuilder.hpp"
+#include "IRLowering.hpp"
+#include "LoopInvariants.hpp"
+#include "MethodCode.hpp"     // instruction list of the current method
+#include "OptReport.hpp"
+#include "Peephole.hpp"
+#include "SlotAllocator.hpp"
+#include "Simplifier.hpp"
+#include "SwitchLowering.hpp"
+#include "ValueNumbering.hpp"
+
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ClassWriter;
+class Inliner;
+class WorkStealingPool;
+struct CompilerOptions;
 
 // -------------------------------------------------------------
 // CodeGenVisitor — traverses AST and emits javaa assembly lines
 // -------------------------------------------------------------
 class CodeGenVisitor : public ast::Visitor {
 public:
-    CodeGenVisitor(CodeEmitter& emitter, CodeGenContext& context, SymbolTable& sym)
-        : em(emitter), ctx(context), symtab(sym) {}
+    // `opts` selects optimizations (all on when null); `report` collects their statistics
+    CodeGenVisitor(CodeEmitter& emitter, CodeGenContext& context, SymbolTable& sym,
+                   const CompilerOptions* opts = nullptr, OptReport* report = nullptr)
+        : em(emitter), ctx(context), symtab(sym), options(opts), report(report), folder(report), simplifier(report), peephole(opts),
+          lowering([this](const SymEntry& s) -> std::string_view { return fieldRef(s); },
+                   [this](const SymEntry& s) -> std::string_view { return methodRef(s); }) {}
 
     // top‑level entry helper
     void generate(ast::Program& root);
+    // byte-identical to generate(); each method is generated on `pool`
+    // into its own buffer and the buffers are written in source order
+    void generateParallel(ast::Program& root, WorkStealingPool& pool);
+    // streaming: `root` holds only the global declarations and `methods`
+    // the already generated method bodies, in source order; `reads` tells
+    // whether any of them has a read statement
+    void generateStreamed(ast::Program& root, std::istream& methods, bool reads);
+
+    // a method generated so far has a read statement
+    bool readsInput() const { return input; }
+
+    // calls `inliner` picks are expanded in place (it must outlive generation)
+    void setInliner(const Inliner* in) { inliner = in; }
+
+    // --emit=class: fields and finished methods go to `w` instead of the
+    // emitter (not with generateStreamed, whose methods are text already)
+    void setClassWriter(ClassWriter* w) { classFile = w; }
 
     // --------------- ASTVisitor overrides ---------------
     void visit(ast::Program&     n) override;
@@ -50,6 +94,9 @@ public:
     // stmt / decl still missing
     void visit(ast::Read&       ) override;
     void visit(ast::ForEachStmt&) override;
+    void visit(ast::SwitchStmt& ) override;
+    void visit(ast::BreakStmt&  ) override;
+    void visit(ast::ContinueStmt&) override;
     void visit(ast::ExprStmt&   ) override;
     void visit(ast::EmptyStmt&  ) override;
     void visit(ast::DeclList&   ) override;
@@ -61,10 +108,109 @@ private:
     CodeEmitter&  em;
     CodeGenContext& ctx;
     SymbolTable&  symtab;
+    const CompilerOptions* options;
+    OptReport*    report;
+
+    MethodCode    code;       // body of the method being generated
+    ConstFolder   folder;     // runs unless --disable=const-fold
+    Simplifier    simplifier; // runs unless --disable=simplify
+    Peephole      peephole;
+    DeadCode      deadCode;   // runs unless --disable=dead-code
+    SlotAllocator slots;      // runs unless --disable=slot-reuse
+    SwitchLowering switches;  // dispatch of a switch statement
+
+    // -------- inlining (unless --disable=inline) --------
+    const Inliner*     inliner = nullptr;   // null: every call is an invokestatic
+    int                slotBase = 0;        // added to local slots of the body being expanded
+    int                loopDepth = 0;       // loops around the current statement
+    std::vector<Label> inlineExits;         // where `return` jumps in each expansion
+    void expand(const ast::FuncDecl& fn);   // inline body of a call whose arguments are pushed
+
+    // -------- self tail calls (unless --disable=tail-rec) --------
+    const ast::FuncDecl* function = nullptr; // method being generated
+    Label              entry;               // top of its body; invalid when not converting
+    bool tailCall(ast::ReturnStmt& r);      // `return f(...)` in f → reassign params, goto entry
+
+    // -------- common subexpressions (unless --disable=cse) --------
+    struct Temp { int slot; bool first; };
+    ValueNumbering numbering;
+    std::unordered_map<const ast::Expr*, Temp> shared;   // of the straight-line run being generated
+    bool reused(const ast::Expr& e);        // iload the temp instead of evaluating `e`
+    void keep(const ast::Expr& e);          // first evaluation: dup; istore temp
+
+    // -------- loops (unless --disable=licm / loop-rotate / strength-reduce) --------
+    struct Induction { int slot; int temp; int factor; };   // temp holds slot · factor
+    struct LoopTemps {
+        std::vector<ast::Expr*> loaded;                      // entries in `shared` and `hoisted`
+        std::vector<LoopInvariants::Product> products;
+        size_t inductions = 0;                               // size of `inductions` outside the loop
+    };
+    LoopInvariants invariants;
+    std::unordered_set<const ast::Expr*> hoisted;        // loaded from a temp (entries in `shared`)
+    std::vector<Induction> inductions;                   // counters of the loops being generated
+    LoopTemps hoist(std::initializer_list<ast::Node*> parts, const ast::Var* index = nullptr);
+    void reduce(LoopTemps& t);              // products into temps, once the counters hold their start
+    void unhoist(const LoopTemps& t);
+    void stepped(int slot, int delta);      // a counter moved by delta: move its products along
+    void loop(ast::Expr* cond, ast::Stmt* body, ast::Stmt* step);   // while / for after init
+    bool shifted(ast::Binary& b);           // * / % by a power of two as shifts
+
+    // -------- string concatenation --------
+    void concat(ast::Binary& b);            // a + b + ... of strings through one StringBuilder
+
+    // -------- SSA IR backend (--ir) --------
+    IRBuilder  irBuilder;
+    IRLowering lowering;
+    bool throughIR(ast::FuncDecl& fn);      // false, with nothing emitted, when the IR cannot express fn
 
     // -------- helper functions --------
-    void emitLoad(const SymEntry entry);   // iload / getstatic
-    void emitStore(const SymEntry entry);  // istore / putstatic
+    ClassWriter* classFile = nullptr;      // --emit=class; null: Jasmin text through `em`
+    std::string  signature;                // of the method being generated, after "method "
+    void openClass();                      // class header, then `{`
+    void closeClass();
+    void emitGlobals(ast::Program& n);     // fields + <clinit>
+    void beginMethod(std::string_view sig); // reset labels and `code`, write the method header
+    void endMethod(int minLocals);         // optimize `code`, size the frame, print the method body
+    static std::vector<ast::FuncDecl*> functionsOf(ast::Program& n);
+    void emitLoad(const SymEntry& entry);   // iload / getstatic
+    void emitStore(const SymEntry& entry);  // istore / putstatic
+    void emitInt(int value);                // iconst / bipush / ldc
+    bool folding() const;                   // const-fold enabled
+    bool sharing() const;                   // cse enabled
+    bool hoisting() const;                  // licm enabled
+    bool rotating() const;                  // loop-rotate enabled
+    bool simplifying() const;               // simplify enabled
+    bool reducing() const;                  // strength-reduce enabled
+    bool buffering() const;                 // --buffered-output
     void emitBinaryOp(ast::Op op, ast::Type t); // iadd / isub / imul …
     bool endsWithReturn(ast::Stmt* stmt);   // check if statement ends with return
+
+    // -------- conditions --------
+    // Jump to Ltrue when `e` holds, to Lfalse when it does not; an
+    // invalid label means that outcome falls through (never both).
+    // && / || / ! short-circuit, comparisons become if_icmp<c>.
+    void genCond(ast::Expr& e, Label Ltrue, Label Lfalse);
+    void branch(Opcode op, Label Ltrue, Label Lfalse);   // op jumps when true
+    void genBool(ast::Expr& e);             // 0 / 1 on the stack, only where a value is needed
+
+    // -------- output (--buffered-output: a PrintStream over a BufferedOutputStream in _out) --------
+    std::string outRef;                     // "java.io.PrintStream cls._out"
+    std::string_view printStream();         // getstatic operand of print / println
+    void initOutput();                      // <clinit>: _out = new PrintStream(new BufferedOutputStream(System.out))
+    void flushAtReturns();                  // main: flush _out before every return
+
+    // -------- input (read: a byte buffer over System.in, parsed by emitted helpers) --------
+    enum class In { Buffer, Pos, Len, Byte, Int, Token };
+    std::string inRefs[6];                  // field / method references, built on first use
+    bool input = false;                     // the class carries the input fields and helpers
+    std::string_view inputRef(In which);
+    void emitRead(const ast::Type& t);      // the next token as a value of type t
+    void emitInputMethods();                // _read, _readInt, _readToken
+
+    // descriptors are built once per symbol and reused by every access
+    std::unordered_map<std::string, std::string> fieldRefs;   // "int cls.g"
+    std::unordered_map<std::string, std::string> methodRefs;  // "int cls.f(int, int)"
+    static std::string paramList(const SymEntry& fn);          // "(int, int)"
+    const std::string& fieldRef(const SymEntry& var);
+    const std::string& methodRef(const SymEntry& fn);
 };
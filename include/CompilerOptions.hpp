@@ -0,0 +1,35 @@
+// =============================================================
+// CompilerOptions.hpp  —  command line switches for ./parser
+// =============================================================
+#pragma once
+
+#include <set>
+#include <string>
+#include <string_view>
+
+struct CompilerOptions {
+    std::string inputFile;          // .sd source or .sdsnap snapshot
+
+    bool emitSnapshot = false;      // --emit-snapshot : also write <name>.sdsnap after analysis
+    bool timePhases   = false;      // --time          : report wall time per phase on stderr
+    unsigned jobs     = 0;          // --jobs N        : analyse/generate functions on N threads (0 = serial)
+    bool stream       = false;      // --stream        : analyse/generate each function as soon as it is parsed
+
+    int  optLevel     = 1;          // -O0 / -O1       : 0 turns every optimization off
+    bool optReport    = false;      // --opt-report    : print what each optimization changed
+    std::set<std::string, std::less<>> disabled;  // --disable=a,b : optimizations switched off by name
+
+    bool viaIR        = false;      // --ir            : generate methods through the SSA IR where it can
+    bool dumpIR       = false;      // --dump-ir       : print every function's optimized IR to stdout
+
+    bool bufferedOutput = false;    // --buffered-output : print through one buffered stream, flushed when main returns
+    bool emitClass    = false;      // --emit=class : write <name>.class directly instead of <name>.jasm
+    bool run          = false;      // --run       : execute on the built-in bytecode VM, write no output file
+
+    bool enabled(std::string_view pass) const {
+        return optLevel > 0 && disabled.find(pass) == disabled.end();
+    }
+};
+
+// Fills `opts` from argv. Prints usage and returns false on bad input.
+bool parseOptions(int argc, char* argv[], CompilerOptions& opts);
@@ -0,0 +1,83 @@
+// =============================================================
+// ConstFolder.hpp  —  constant folding over the analysed AST
+// -------------------------------------------------------------
+//  • int / bool Unary and Binary nodes whose operands are known
+//    collapse into a literal (Java int semantics, see foldBinary)
+//  • references to const variables are replaced by their value
+//  • if / while / for with a constant condition lose the dead branch,
+//    a switch on a constant keeps only the arm it selects
+//  • a run of prints of literals, of which only the last may be a
+//    println, becomes a single print of the joined text
+//  • works bottom-up, so every node is evaluated once
+//  • with a ConstInterpreter, calls to pure functions whose arguments
+//    fold to constants become their result, and global initializers
+//    are evaluated in declaration order (fold(Program&))
+//  Runs right before code generation; switched off with
+//  --disable=const-fold (calls also with --disable=const-eval).
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+
+#include <memory>
+#include <optional>
+
+class ConstInterpreter;
+class OptReport;
+
+class ConstFolder : private ast::Visitor {
+public:
+    explicit ConstFolder(OptReport* report = nullptr, ConstInterpreter* interpreter = nullptr)
+        : report(report), interpreter(interpreter) {}
+
+    void fold(ast::Program& program);   // globals in order, then every function
+    void fold(std::unique_ptr<ast::Stmt>& s);
+    void fold(std::unique_ptr<ast::Expr>& e);
+
+private:
+    OptReport* report;
+    ConstInterpreter* interpreter;
+
+    // what visiting the last node found out
+    std::optional<ConstValue>  value;      // expression value, if constant
+    bool                       isLiteral = false;
+    bool                       called = false;   // counted as const-eval
+    std::unique_ptr<ast::Stmt> replacement;
+
+    void foldIndices(ast::Var& v);
+    void pruned(std::unique_ptr<ast::Stmt> kept, int line);
+    void mergePrints(std::vector<std::unique_ptr<ast::Stmt>>& stmts);
+
+    void visit(ast::IntLit& n) override;
+    void visit(ast::RealLit& n) override;
+    void visit(ast::StringLit& n) override;
+    void visit(ast::BoolLit& n) override;
+    void visit(ast::CharLit& n) override;
+    void visit(ast::Var& v) override;
+    void visit(ast::Unary& u) override;
+    void visit(ast::Binary& b) override;
+    void visit(ast::Postfix& p) override;
+    void visit(ast::Call& c) override;
+    void visit(ast::Assign& a) override;
+    void visit(ast::RangeExpr& r) override;
+    void visit(ast::Print& p) override;
+    void visit(ast::Println& p) override;
+    void visit(ast::Read& r) override;
+    void visit(ast::Block& b) override;
+    void visit(ast::IfStmt& s) override;
+    void visit(ast::WhileStmt& s) override;
+    void visit(ast::ForStmt& s) override;
+    void visit(ast::ForEachStmt& s) override;
+    void visit(ast::SwitchStmt& s) override;
+    void visit(ast::BreakStmt& s) override;
+    void visit(ast::ContinueStmt& s) override;
+    void visit(ast::ReturnStmt& s) override;
+    void visit(ast::ExprStmt& s) override;
+    void visit(ast::EmptyStmt& s) override;
+    void visit(ast::DeclList& dl) override;
+    void visit(ast::VarDecl& d) override;
+    void visit(ast::VarDeclList& dl) override;
+    void visit(ast::ConstDecl& d) override;
+    void visit(ast::FuncDecl& f) override;
+    void visit(ast::Program& p) override;
+};
@@ -0,0 +1,95 @@
+// =============================================================
+// ConstInterpreter.hpp  —  compile-time evaluation of pure calls
+// -------------------------------------------------------------
+//  • a function is pure when it prints / reads nothing, touches no
+//    array and no mutable global, and only calls pure functions
+//  • call() runs a pure function on constant arguments: ints, bools,
+//    strings, locals, if / while / for / foreach / switch and calls
+//  • every run is bounded by kMaxSteps statements and kMaxDepth
+//    nested calls; hitting a limit (or a division by zero) just
+//    leaves the call for run time
+//  • results are memoised per (function, arguments); so are failures
+//    of a call() that started from nothing, since that run would fail
+//    the same way at every call site
+//  • evalInit() evaluates a global initializer the way <clinit>
+//    would, given the globals already known at that point
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+#include "SymbolTable.hpp"
+
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ConstInterpreter : private ast::Visitor {
+public:
+    static constexpr long kMaxSteps = 1000000;
+    static constexpr int  kMaxDepth = 200;
+
+    explicit ConstInterpreter(ast::Program& program);
+
+    bool isPure(const std::string& function) const { return pure.count(function) != 0; }
+
+    std::optional<ConstValue> call(const std::string& function, const std::vector<ConstValue>& args);
+    std::optional<ConstValue> evalInit(ast::Expr& init, const std::unordered_map<std::string, ConstValue>& globals);
+
+private:
+    enum class Flow { Normal, Return, Break, Continue, Fail };
+
+    std::unordered_map<std::string, ast::FuncDecl*> functions;
+    std::unordered_set<std::string> pure;
+    std::map<std::pair<std::string, std::vector<ConstValue>>, std::optional<ConstValue>> memo;   // nullopt: fails
+
+    // state of the run in progress
+    const std::unordered_map<std::string, ConstValue>* globals = nullptr;
+    std::vector<std::vector<std::optional<ConstValue>>> frames;   // locals by slot
+    long steps = 0;
+    std::optional<ConstValue> value;   // last expression
+    Flow flow = Flow::Normal;          // last statement
+    ConstValue result;                 // set by return
+
+    std::optional<ConstValue> invoke(const std::string& function, const std::vector<ConstValue>& args);
+    std::optional<ConstValue> eval(ast::Expr* e);
+    Flow exec(ast::Stmt* s);
+    bool test(ast::Expr* cond, bool& out);
+    std::optional<ConstValue>& local(int slot);
+    std::optional<int> localInt(int slot);
+
+    void visit(ast::IntLit& n) override;
+    void visit(ast::RealLit& n) override;
+    void visit(ast::StringLit& n) override;
+    void visit(ast::BoolLit& n) override;
+    void visit(ast::CharLit& n) override;
+    void visit(ast::Var& v) override;
+    void visit(ast::Unary& u) override;
+    void visit(ast::Binary& b) override;
+    void visit(ast::Postfix& p) override;
+    void visit(ast::Call& c) override;
+    void visit(ast::Assign& a) override;
+    void visit(ast::RangeExpr& r) override;
+    void visit(ast::Print& p) override;
+    void visit(ast::Println& p) override;
+    void visit(ast::Read& r) override;
+    void visit(ast::Block& b) override;
+    void visit(ast::IfStmt& s) override;
+    void visit(ast::WhileStmt& s) override;
+    void visit(ast::ForStmt& s) override;
+    void visit(ast::ForEachStmt& s) override;
+    void visit(ast::SwitchStmt& s) override;
+    void visit(ast::BreakStmt& s) override;
+    void visit(ast::ContinueStmt& s) override;
+    void visit(ast::ReturnStmt& s) override;
+    void visit(ast::ExprStmt& s) override;
+    void visit(ast::EmptyStmt& s) override;
+    void visit(ast::DeclList& dl) override;
+    void visit(ast::VarDecl& d) override;
+    void visit(ast::VarDeclList& dl) override;
+    void visit(ast::ConstDecl& d) override;
+    void visit(ast::FuncDecl& f) override;
+    void visit(ast::Program& p) override;
+};
@@ -0,0 +1,36 @@
+// =============================================================
+// DeadCode.hpp  —  unreachable code and dead stores in a method
+// -------------------------------------------------------------
+//  • blocks no path from the method entry reaches are dropped,
+//    labels included (code after return, after a tail-call or
+//    inlined-return goto, the else of a pruned branch …)
+//  • a store to a local that is not live afterwards becomes pop,
+//    a dead iinc disappears; loads, constants and arithmetic
+//    that only fed a pop are unwound with it
+//  • runs after the peephole pass and before slot reuse, so the
+//    freed slots get packed
+//  Switched off with --disable=dead-code.
+// =============================================================
+#pragma once
+
+#include "Liveness.hpp"
+#include "MethodCode.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class OptReport;
+
+class DeadCode {
+public:
+    // true when anything was removed
+    bool run(MethodCode& code, OptReport* report);
+
+private:
+    // scratch, reused between methods
+    Liveness live;
+    std::vector<char> reached, gone;
+    std::vector<int> work;
+    std::vector<uint64_t> alive;
+    std::vector<Instr> kept;
+};
@@ -0,0 +1,116 @@
+// =============================================================
+// IR.hpp  —  typed SSA mid-level IR between the AST and Jasmin
+// -------------------------------------------------------------
+//  • a Function is a control-flow graph of Blocks; block 0 is the
+//    entry. A block holds its phis, then straight-line instructions
+//    and ends in exactly one terminator (jump / branch / return)
+//  • every instruction lives in Function::values and is named by
+//    its index (%n); operands refer to other instructions, never to
+//    variables — locals exist only as SSA values and phis
+//  • globals stay memory: load / store of the static field
+//  • a phi's operands are parallel to its block's `preds`
+//  • passes mark instructions and blocks `dead` and take them out
+//    of the block lists, so ids stay stable; compact() renumbers
+//  Built by IRBuilder, optimized by PassManager, turned back into
+//  stack code by IRLowering; --dump-ir prints it.
+// =============================================================
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SymEntry;
+
+namespace ir {
+
+using ValueId = int;
+using BlockId = int;
+constexpr int None = -1;
+
+enum class Type : uint8_t { Void, Int, Bool, String };
+
+enum class Op : uint8_t {
+    // values
+    Const,      // imm (int, or 0 / 1 for bool)
+    Str,        // text
+    Undef,      // read of a local nothing has written yet
+    Param,      // imm = parameter index
+    Phi,
+    Load,       // getstatic sym
+    Add, Sub, Mul, Div, Rem, Neg,
+    Or, Xor,
+    Not,        // bool negation
+    Eq, Ne, Lt, Le, Gt, Ge,     // bool result; Eq / Ne on strings compare references
+    Call,       // invokestatic sym; Void when the callee returns nothing
+    // effects
+    Store,      // putstatic sym
+    Print, Println,
+    // terminators
+    Jump,       // target[0]
+    Branch,     // args[0] ? target[0] : target[1]
+    Return,     // args empty for void
+};
+
+struct Inst {
+    Op op = Op::Const;
+    Type type = Type::Void;             // of the result; Void for effects and terminators
+    BlockId block = None;
+    std::vector<ValueId> args;
+    int imm = 0;
+    const SymEntry* sym = nullptr;      // Load / Store field, Call callee (AST owned)
+    std::string_view text;              // Str payload (AST owned)
+    BlockId target[2] = {None, None};
+    bool dead = false;
+};
+
+struct Block {
+    std::vector<ValueId> phis;
+    std::vector<ValueId> insts;         // terminator last
+    std::vector<BlockId> preds;         // one entry per incoming edge
+    bool dead = false;
+};
+
+// Instructions with no side effect that cannot throw: dropping or
+// sharing them changes nothing (Div / Rem may throw, Load may see a
+// store in between)
+bool pure(Op op);
+bool isTerminator(Op op);
+bool isCompare(Op op);
+const char* name(Op op);
+
+struct Function {
+    std::string name;
+    Type returnType = Type::Void;
+    std::vector<Type> params;
+    bool isMain = false;
+    std::vector<Inst> values;
+    std::vector<Block> blocks;
+
+    BlockId newBlock();
+    ValueId add(BlockId b, Inst i);          // appended to b's instructions
+    ValueId addPhi(BlockId b, Type t);       // operands filled in by the caller
+    // Up to two successors, read off the terminator
+    int succs(BlockId b, BlockId out[2]) const;
+    ValueId terminator(BlockId b) const;
+    bool terminated(BlockId b) const;
+
+    // Edge bookkeeping shared by the passes. removeEdge drops one
+    // from→to edge from `to`'s preds and phis (the terminator is the
+    // caller's); splitEdge puts a new block holding only a jump on it
+    void removeEdge(BlockId from, BlockId to);
+    BlockId splitEdge(BlockId from, BlockId to);
+    // Marks blocks the entry cannot reach dead, with their edges;
+    // returns how many
+    int removeUnreachable();
+    // Every operand v becomes map[v] (map[v] == v for the unchanged)
+    void rename(const std::vector<ValueId>& map);
+    // Drops dead blocks and instructions and renumbers what is left
+    void compact();
+
+    void print(std::ostream& os) const;
+};
+
+} // namespace ir
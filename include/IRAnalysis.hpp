@@ -0,0 +1,65 @@
+// =============================================================
+// IRAnalysis.hpp  —  dominators and liveness over the SSA IR
+// -------------------------------------------------------------
+//  • DominatorTree: Cooper, Harvey & Kennedy's iterative algorithm
+//    over reverse postorder; blocks the entry cannot reach get no
+//    idom and dominate nothing. dominates() is O(1) through the
+//    pre / post numbers of a walk over the tree
+//  • Liveness: live-in / live-out bit sets per block for the values
+//    a caller asks about. A phi's operand is live out of the
+//    matching predecessor only, the phi itself is defined at the top
+//    of its block
+//  Both are computed once and stay valid until the CFG or the
+//  instructions change.
+// =============================================================
+#pragma once
+
+#include "IR.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ir {
+
+class DominatorTree {
+public:
+    explicit DominatorTree(const Function& f);
+
+    const std::vector<BlockId>& rpo() const { return order; }       // reachable blocks
+    const std::vector<BlockId>& children(BlockId b) const { return kids[size_t(b)]; }
+    BlockId idom(BlockId b) const { return parent[size_t(b)]; }
+    bool reachable(BlockId b) const { return rank[size_t(b)] >= 0; }
+    bool dominates(BlockId a, BlockId b) const;
+
+private:
+    std::vector<BlockId> order;
+    std::vector<int> rank;                  // position in `order`, -1 unreachable
+    std::vector<BlockId> parent;
+    std::vector<std::vector<BlockId>> kids;
+    std::vector<int> pre, post;
+};
+
+class Liveness {
+public:
+    // `tracked[v]` selects the values to follow (the rest are never live)
+    Liveness(const Function& f, const DominatorTree& dom, const std::vector<char>& tracked);
+
+    bool liveIn(BlockId b, ValueId v) const { return test(in, b, v); }
+    bool liveOut(BlockId b, ValueId v) const { return test(out, b, v); }
+    template <class F> void forEachLiveIn(BlockId b, F&& fn) const { each(in, b, fn); }
+
+private:
+    size_t words;
+    std::vector<uint64_t> in, out;          // blocks × words
+
+    bool test(const std::vector<uint64_t>& set, BlockId b, ValueId v) const {
+        return set[size_t(b) * words + size_t(v) / 64] >> (size_t(v) % 64) & 1;
+    }
+    template <class F> void each(const std::vector<uint64_t>& set, BlockId b, F& fn) const {
+        for (size_t w = 0; w < words; ++w)
+            for (uint64_t bits = set[size_t(b) * words + w]; bits; bits &= bits - 1)
+                fn(ValueId(w * 64 + size_t(__builtin_ctzll(bits))));
+    }
+};
+
+} // namespace ir
@@ -0,0 +1,113 @@
+// =============================================================
+// IRBuilder.hpp  —  analysed AST function → SSA IR
+// -------------------------------------------------------------
+//  • SSA is built on the fly while walking the body (Braun et al.,
+//    "Simple and Efficient Construction of SSA Form"): every block
+//    remembers the value each local slot last received; a read in a
+//    block that has none asks the predecessors, with a phi where
+//    they meet
+//  • loop headers stay unsealed until the back edge exists; reads
+//    there get placeholder phis that are completed on sealing
+//  • phis that turn out to merge a single value are removed at the
+//    end
+//  • && / || become control flow: jumps in conditions, a bool phi
+//    where a value is needed
+//  • globals are loads and stores of the field, they are memory
+//  • a switch is a chain of eq tests (no multi-way branch in the IR)
+//  • break / continue jump to the exit / latch of the innermost loop
+//    (break: or switch); those blocks are sealed after the body
+//  • with selfTailCalls, `return f(...)` inside f assigns the
+//    parameters and jumps to a block right after the entry, which is
+//    sealed like a loop header once the body is done
+//  The IR covers int / bool / string scalars, calls and all the
+//  statements; a body with arrays, reals or chars is not built and
+//  build() says so.
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+#include "IR.hpp"
+
+#include <utility>
+#include <vector>
+
+class IRBuilder : private ast::Visitor {
+public:
+    // false when the body uses something the IR does not model
+    bool build(ast::FuncDecl& fn, ir::Function& out, bool selfTailCalls = false);
+    int tailCalls() const { return converted; }     // turned into jumps by the last build
+
+private:
+    ir::Function* f = nullptr;
+    ir::BlockId cur = ir::None;
+    ir::ValueId last = ir::None;            // value of the expression just visited
+    bool ok = true;
+
+    std::vector<ir::Type> slotType;
+    std::vector<std::vector<ir::ValueId>> defs;                    // [block][slot]
+    std::vector<char> sealed;
+    std::vector<std::vector<std::pair<int, ir::ValueId>>> incomplete;  // [block] (slot, phi)
+    std::vector<ir::ValueId> undefs;        // per slot, in the entry block
+
+    const ast::FuncDecl* self = nullptr;    // set while self tail calls are converted
+    ir::BlockId bodyTop = ir::None;         // where they jump
+    int converted = 0;
+
+    struct Exits { ir::BlockId brk, cont; };
+    std::vector<Exits> exits;               // innermost last; cont is None for a switch outside loops
+
+    ir::BlockId block();
+    void seal(ir::BlockId b);
+    void write(int slot, ir::BlockId b, ir::ValueId v);
+    ir::ValueId read(int slot, ir::BlockId b);
+    ir::ValueId readFromPreds(int slot, ir::BlockId b);
+    void fill(int slot, ir::ValueId phi);
+    void removeTrivialPhis();
+
+    ir::ValueId value(ast::Expr& e);
+    ir::ValueId emit(ir::Op op, ir::Type t, std::vector<ir::ValueId> args = {});
+    ir::ValueId constant(ir::Type t, int v);
+    ir::Type type(const ast::Type& t);
+    ir::ValueId load(const ast::Var& v);
+    void store(const ast::Var& v, ir::ValueId value);
+    void jump(ir::BlockId to);
+    void branch(ir::ValueId c, ir::BlockId t, ir::BlockId e);
+    void cond(ast::Expr& e, ir::BlockId t, ir::BlockId e2);
+    void loop(ast::Expr* c, ast::Stmt* body, ast::Stmt* step);
+    void unsupported() { ok = false; }
+    void leave(ir::BlockId to);             // jump, then continue in an unreachable block
+    bool tailCall(ast::ReturnStmt& s);
+
+    void visit(ast::IntLit& n) override;
+    void visit(ast::RealLit& n) override;
+    void visit(ast::StringLit& n) override;
+    void visit(ast::BoolLit& n) override;
+    void visit(ast::CharLit& n) override;
+    void visit(ast::Var& v) override;
+    void visit(ast::Unary& u) override;
+    void visit(ast::Binary& b) override;
+    void visit(ast::Postfix& p) override;
+    void visit(ast::Call& c) override;
+    void visit(ast::Assign& a) override;
+    void visit(ast::RangeExpr& r) override;
+    void visit(ast::Print& p) override;
+    void visit(ast::Println& p) override;
+    void visit(ast::Read& r) override;
+    void visit(ast::Block& b) override;
+    void visit(ast::IfStmt& s) override;
+    void visit(ast::WhileStmt& s) override;
+    void visit(ast::ForStmt& s) override;
+    void visit(ast::ForEachStmt& s) override;
+    void visit(ast::SwitchStmt& s) override;
+    void visit(ast::BreakStmt& s) override;
+    void visit(ast::ContinueStmt& s) override;
+    void visit(ast::ReturnStmt& s) override;
+    void visit(ast::ExprStmt& s) override;
+    void visit(ast::EmptyStmt& s) override;
+    void visit(ast::DeclList& dl) override;
+    void visit(ast::VarDecl& d) override;
+    void visit(ast::VarDeclList& dl) override;
+    void visit(ast::ConstDecl& d) override;
+    void visit(ast::FuncDecl& f) override;
+    void visit(ast::Program& p) override;
+};
@@ -0,0 +1,84 @@
+// =============================================================
+// IRLowering.hpp  —  SSA IR → stack code in a MethodCode
+// -------------------------------------------------------------
+//  • stack scheduling: a value used once, by an instruction right
+//    after its own expression tree in the same block, never touches
+//    a local — it stays on the operand stack for its user. Other
+//    operands (locals, constants) are pushed just where that user
+//    needs them, in front of the trees of later operands
+//  • constants are pushed again at every use instead of being kept
+//  • a compare that feeds a branch becomes if_icmp<c> / if<c> (a
+//    compare with 0); elsewhere it materializes 0 / 1
+//  • out of SSA: critical edges into blocks with phis are split, and
+//    each predecessor ends in a parallel copy through the stack (all
+//    sources pushed, then stored in reverse)
+//  • locals: parameters keep their slots; every other value gets the
+//    lowest slot free at its definition, walking the dominator tree
+//    with the liveness sets (values live at the same point never
+//    share a slot); copies between equal slots vanish
+//  • blocks are laid out in reverse postorder; a jump or branch to
+//    the next block falls through
+//  Only runs on functions IRBuilder could build (--ir).
+// =============================================================
+#pragma once
+
+#include "CodeGenContext.hpp"
+#include "IR.hpp"
+#include "MethodCode.hpp"
+
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct SymEntry;
+namespace ir { class DominatorTree; }
+
+class IRLowering {
+public:
+    using RefFn = std::function<std::string_view(const SymEntry&)>;
+
+    // `field` / `method` give the descriptors of globals and callees
+    IRLowering(RefFn field, RefFn method) : fieldRef(std::move(field)), methodRef(std::move(method)) {}
+
+    // Appends the body of `f` (which it prepares in place) to `code`
+    void run(ir::Function& f, MethodCode& code, CodeGenContext& ctx);
+
+    // getstatic operand of the stream print / println write to
+    void setPrintStream(std::string_view ref) { printStream = ref; }
+
+private:
+    struct Push {
+        int priority;               // position of the consumer; outer consumers go first
+        ir::ValueId value;          // ir::None: the print stream for a print
+    };
+
+    RefFn fieldRef, methodRef;
+    std::string_view printStream = "java.io.PrintStream java.lang.System.out";
+    ir::Function* f = nullptr;
+    MethodCode* code = nullptr;
+    CodeGenContext* ctx = nullptr;
+
+    std::vector<int> uses, pos, treeStart, slot, zeroArg;
+    std::vector<ir::ValueId> into;                   // consumer a stacked value is left for
+    std::vector<std::vector<Push>> before;           // pushes ahead of an instruction
+    std::vector<char> needsSlot, onStack;
+    std::vector<int> pushAt, lastUse, stamp;
+    std::vector<Label> labels;
+
+    void prepare();
+    void schedule();
+    void allocate(const ir::DominatorTree& dom);
+    void emitInst(ir::ValueId v, ir::BlockId next);
+    void copies(ir::BlockId from, ir::BlockId to);
+    void push(ir::ValueId v);
+    void load(ir::ValueId v);
+    void store(ir::ValueId v);
+    void branch(Opcode op, ir::BlockId t, ir::BlockId e, ir::BlockId next);
+
+    bool remat(ir::ValueId v) const;
+    bool silent(ir::ValueId v) const;       // emits no code where it is defined
+    bool stacked(ir::ValueId v) const { return into[size_t(v)] != ir::None; }
+    bool fused(ir::ValueId v) const;
+    Opcode compare(ir::ValueId cmp) const;
+};
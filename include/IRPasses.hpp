@@ -0,0 +1,35 @@
+// =============================================================
+// IRPasses.hpp  —  the optimization passes over the SSA IR
+// -------------------------------------------------------------
+//  • ir.const-prop  sparse conditional constant propagation (Wegman
+//                   & Zadeck): values are constant until shown
+//                   otherwise and only edges found executable count,
+//                   so constants flow through phis and loops and
+//                   branches on them are folded. Java int semantics:
+//                   wrapping, / and % by zero left to throw
+//  • ir.cfg         unreachable blocks go, blocks holding only a
+//                   jump are bypassed, a block is merged into its
+//                   only predecessor when that one jumps straight
+//                   to it
+//  • ir.gvn         dominator-based value numbering: a pure
+//                   instruction equal to one in a dominating block
+//                   (same op, same operands, commutative operands in
+//                   either order) is replaced by it
+//  • ir.dce         instructions nothing needs: pure ones, loads,
+//                   / and % by a non-zero constant
+//  Each pass is switched off with --disable=<name>.
+// =============================================================
+#pragma once
+
+#include "PassManager.hpp"
+
+#include <memory>
+
+namespace ir {
+
+std::unique_ptr<IRPass> constPropagation();
+std::unique_ptr<IRPass> cfgSimplification();
+std::unique_ptr<IRPass> valueNumbering();
+std::unique_ptr<IRPass> deadCode();
+
+} // namespace ir
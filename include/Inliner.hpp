@@ -0,0 +1,40 @@
+// =============================================================
+// Inliner.hpp  —  which calls CodeGenVisitor expands in place
+// -------------------------------------------------------------
+//  • built once per program, before code generation; read-only
+//    afterwards, so parallel workers share one instance
+//  • a function qualifies when it is not main, never calls itself,
+//    takes and declares no arrays, and a non-void one ends in return
+//  • size = AST nodes in the (already folded) body; small bodies are
+//    inlined everywhere, medium ones only inside loops where the
+//    saved invokestatic pays for the larger code
+//  • CodeGenVisitor stores the arguments into fresh slots above the
+//    caller's, shifts the callee's slots there and turns `return`
+//    into a jump to the end of the expansion (see visit(Call&))
+//  Switched off with --disable=inline.
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+
+#include <string>
+#include <unordered_map>
+
+class Inliner {
+public:
+    static constexpr int kSmallSize = 12;   // inlined at every call site
+    static constexpr int kLoopSize  = 40;   // inlined inside loops
+    static constexpr int kMaxDepth  = 3;    // inlined calls inside inlined bodies
+
+    explicit Inliner(ast::Program& program);
+
+    // the function to expand at a call to `callee`, or null
+    const ast::FuncDecl* candidate(const std::string& callee, bool inLoop, int depth) const;
+
+private:
+    struct Info {
+        const ast::FuncDecl* fn;
+        int size;
+    };
+    std::unordered_map<std::string, Info> functions;   // qualifying functions only
+};
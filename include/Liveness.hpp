@@ -0,0 +1,57 @@
+// =============================================================
+// Liveness.hpp  —  basic blocks and live local slots of a method
+// -------------------------------------------------------------
+//  • a block starts at a run of labels or after a jump / return
+//  • liveIn / liveOut are bit sets over slots, solved backwards to
+//    a fixed point; successors are fall-through, branch and switch
+//    targets
+//  • shared by SlotAllocator and DeadCode; all scratch is reused
+//    between methods
+// =============================================================
+#pragma once
+
+#include "MethodCode.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class Liveness {
+public:
+    // blocks of `m` and liveness of slots [0, slots)
+    void run(const MethodCode& m, int slots);
+
+    int  blocks() const { return int(starts.size()); }
+    int  blockOf(size_t instr) const { return owner[instr]; }
+    int  start(int b) const { return starts[size_t(b)]; }
+    int  end(int b) const { return (b + 1 < blocks() ? starts[size_t(b + 1)] : size) - 1; }   // inclusive
+
+    // fall-through successor of block `b` (-1 when absent)
+    int  fallThrough(int b) const;
+    // every successor of block `b`: fall-through, branch or switch targets
+    template <typename F>
+    void forEachSucc(int b, F&& f) const {
+        if (int s = fallThrough(b); s >= 0) f(s);
+        method->forEachTarget((*code)[size_t(end(b))], [&](Label l) {
+            if (size_t(l.id) < labelBlock.size() && labelBlock[size_t(l.id)] >= 0) f(labelBlock[size_t(l.id)]);
+        });
+    }
+
+    bool liveIn(int b, int slot) const  { return test(&in[size_t(b) * words], slot); }
+    bool liveOut(int b, int slot) const { return test(&out[size_t(b) * words], slot); }
+    const uint64_t* liveOutSet(int b) const { return &out[size_t(b) * words]; }
+    size_t setWords() const { return words; }
+
+    static bool reads(const Instr& i)  { return i.op == Opcode::iload || i.op == Opcode::aload || i.op == Opcode::iinc; }
+    static bool writes(const Instr& i) { return i.op == Opcode::istore || i.op == Opcode::astore || i.op == Opcode::iinc; }
+    static bool test(const uint64_t* set, int bit) { return (set[bit / 64] >> (bit % 64)) & 1; }
+    static void put(uint64_t* set, int bit)        { set[bit / 64] |= uint64_t(1) << (bit % 64); }
+    static void drop(uint64_t* set, int bit)       { set[bit / 64] &= ~(uint64_t(1) << (bit % 64)); }
+
+private:
+    const MethodCode* method = nullptr;
+    const std::vector<Instr>* code = nullptr;
+    int    size = 0;
+    size_t words = 0;
+    std::vector<int> owner, starts, labelBlock;
+    std::vector<uint64_t> in, out, use, def;
+};
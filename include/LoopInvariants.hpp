@@ -0,0 +1,54 @@
+// =============================================================
+// LoopInvariants.hpp  —  expressions a loop computes the same every trip
+// -------------------------------------------------------------
+//  • first collects what the loop may change: local slots it stores,
+//    declares, ++/--es or counts with, globals it writes, and whether
+//    it calls anything (a call may write any global)
+//  • then finds the largest int expressions (arithmetic, unary minus)
+//    and int / bool global reads whose operands all stay unchanged
+//  • division and remainder only by a non-zero constant: hoisted code
+//    also runs when the loop body does not, it must not throw
+//  • expressions already hoisted by an enclosing loop are left alone
+//  • products `i * k` (k a literal) of a counter the loop changes only
+//    by constant steps (i++, i--, i = i ± c) are reported separately:
+//    a temp can follow i * k by adding k·c wherever i steps
+//  Used by CodeGenVisitor for while / for / foreach; --disable=licm
+//  and --disable=strength-reduce turn the two parts off.
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class LoopInvariants {
+public:
+    struct Product {
+        ast::Expr* expr;    // i * k
+        int slot;           // of i
+        int factor;         // k
+    };
+
+    // `parts` are the pieces evaluated on every trip (condition, body,
+    // step), `index` the variable a foreach counts with
+    void run(std::initializer_list<ast::Node*> parts, const ast::Var* index,
+             const std::unordered_set<const ast::Expr*>& hoisted);
+
+    const std::vector<ast::Expr*>& invariants() const { return found; }
+    const std::vector<Product>& products() const { return stepped; }
+
+    // c when `a` is `v = v + c`, `v = c + v` or `v = v - c` (as -c)
+    static std::optional<int> step(const ast::Assign& a);
+
+private:
+    std::vector<ast::Expr*> found;
+    std::vector<Product> stepped;
+
+    // scratch, reused between loops
+    std::vector<char> localWritten;
+    std::unordered_set<std::string> globalWritten;
+};
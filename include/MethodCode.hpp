@@ -0,0 +1,132 @@
+// =============================================================
+// MethodCode.hpp  —  instruction list of the method being generated
+// -------------------------------------------------------------
+//  • CodeGenVisitor appends instructions and label definitions here
+//    instead of printing them, so whole-method passes (peephole,
+//    stack depth) can run before anything is written
+//  • symbolic operands are string_views into stable storage (AST
+//    nodes, descriptor caches); text made up by a pass goes
+//    through own()
+//  • tableswitch / lookupswitch keep their jump tables next to the
+//    list (switches()); forEachTarget() covers both kinds of jump
+//  • print() writes the list through a CodeEmitter
+// =============================================================
+#pragma once
+
+#include "CodeEmitter.hpp"
+#include "Opcode.hpp"
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class OperandKind : uint8_t {
+    None,      // iadd, dup, return ...
+    Int,       // bipush/sipush/ldc value, iload/istore slot
+    Target,    // branch label
+    Ref,       // field / method reference, printed as is
+    String,    // ldc string constant, printed quoted
+    Iinc,      // iinc slot, delta
+    Switch,    // tableswitch / lookupswitch, `a` indexes MethodCode::switches()
+};
+
+// Jump table of a tableswitch (targets of low, low+1, ...) or a
+// lookupswitch (targets of the ascending keys)
+struct SwitchTable {
+    Label dflt;
+    int low = 0;
+    std::vector<int> keys;      // lookupswitch only
+    std::vector<Label> targets;
+};
+
+struct Instr {
+    Opcode      op     = Opcode::nop;
+    OperandKind kind   = OperandKind::None;
+    bool        isLabel = false;   // label definition; `a` is the label id
+    int         a = 0;             // Int value, slot or label id
+    int         b = 0;             // iinc delta
+    std::string_view text;         // Ref / String payload
+
+    Label target() const { return Label{a}; }
+    bool  isBranch() const { return !isLabel && kind == OperandKind::Target; }
+};
+
+// goto, the switches, the returns and athrow never fall through to the next instruction
+inline bool endsFlow(Opcode op) {
+    return op == Opcode::goto_ || op == Opcode::tableswitch || op == Opcode::lookupswitch ||
+           op == Opcode::return_ || op == Opcode::ireturn || op == Opcode::areturn || op == Opcode::athrow;
+}
+
+// Local variable slot operand, if the instruction has one
+inline bool localSlot(const Instr& i, int& slot) {
+    if (i.isLabel) return false;
+    switch (i.op) {
+        case Opcode::iload: case Opcode::aload: case Opcode::istore: case Opcode::astore: case Opcode::iinc:
+            slot = i.a;
+            return true;
+        default:
+            return false;
+    }
+}
+
+class MethodCode {
+public:
+    void emit(Opcode op)                        { push({op, OperandKind::None}); }
+    void emit(Opcode op, int value)             { push({op, OperandKind::Int, false, value}); }
+    void emit(Opcode op, Label target)          { push({op, OperandKind::Target, false, target.id}); }
+    void emitRef(Opcode op, std::string_view r) { push({op, OperandKind::Ref, false, 0, 0, r}); }
+    void emitString(Opcode op, std::string_view s) { push({op, OperandKind::String, false, 0, 0, s}); }
+    void emitIinc(int slot, int delta)          { push({Opcode::iinc, OperandKind::Iinc, false, slot, delta}); }
+    void label(Label l)                         { push({Opcode::nop, OperandKind::None, true, l.id}); }
+    void emitSwitch(Opcode op, SwitchTable t) {
+        push({op, OperandKind::Switch, false, int(tables.size())});
+        tables.push_back(std::move(t));
+    }
+
+    const std::vector<SwitchTable>& switches() const { return tables; }
+
+    // every label `i` may jump to: its branch target or its whole table
+    template <typename F>
+    void forEachTarget(const Instr& i, F&& f) const {
+        if (i.isBranch()) {
+            f(i.target());
+        } else if (!i.isLabel && i.kind == OperandKind::Switch) {
+            const SwitchTable& t = tables[size_t(i.a)];
+            f(t.dflt);
+            for (Label l : t.targets) f(l);
+        }
+    }
+
+    // keeps text created during generation alive until clear()
+    std::string_view own(std::string text) { return owned.emplace_back(std::move(text)); }
+
+    std::vector<Instr>&       instrs()       { return code; }
+    const std::vector<Instr>& instrs() const { return code; }
+
+    // capacity is kept, so steady-state generation does not allocate
+    void clear() {
+        code.clear();
+        owned.clear();
+        tables.clear();
+    }
+
+    void print(CodeEmitter& em) const;
+
+    // Deepest operand stack over all reachable paths; depths are
+    // propagated along fall-through and branch edges and joined at labels
+    int maxStack() const;
+    // Highest local slot referenced + 1, but at least `minimum`
+    int maxLocals(int minimum) const;
+
+private:
+    std::vector<Instr> code;
+    std::deque<std::string> owned;
+    std::vector<SwitchTable> tables;
+
+    // scratch for maxStack(), kept between methods
+    mutable std::vector<int> labelAt, depthAt, work;
+
+    void push(const Instr& i) { code.push_back(i); }
+    void printSwitch(CodeEmitter& em, const Instr& i) const;
+};
@@ -0,0 +1,196 @@
+// =============================================================
+// Opcode.hpp  —  JVM opcodes and labels used by the code generator
+// -------------------------------------------------------------
+//  • enumerator values are the real JVM opcode bytes
+//  • opcodeName() gives the Jasmin mnemonic without allocating
+//  • negateBranch() flips a conditional jump
+//  • Label is a per-method label number, printed as L<n>
+// =============================================================
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+enum class Opcode : uint8_t {
+    nop           = 0x00,
+    aconst_null   = 0x01,
+    iconst_m1     = 0x02,
+    iconst_0      = 0x03,
+    iconst_1      = 0x04,
+    iconst_2      = 0x05,
+    iconst_3      = 0x06,
+    iconst_4      = 0x07,
+    iconst_5      = 0x08,
+    bipush        = 0x10,
+    sipush        = 0x11,
+    ldc           = 0x12,
+    ldc2_w        = 0x14,
+    iload         = 0x15,
+    aload         = 0x19,
+    iaload        = 0x2e,
+    aaload        = 0x32,
+    baload        = 0x33,
+    istore        = 0x36,
+    astore        = 0x3a,
+    iastore       = 0x4f,
+    aastore       = 0x53,
+    bastore       = 0x54,
+    castore       = 0x55,
+    pop           = 0x57,
+    dup           = 0x59,
+    dup_x1        = 0x5a,
+    dup2          = 0x5c,
+    swap          = 0x5f,
+    iadd          = 0x60,
+    isub          = 0x64,
+    imul          = 0x68,
+    idiv          = 0x6c,
+    irem          = 0x70,
+    ineg          = 0x74,
+    ishl          = 0x78,
+    ishr          = 0x7a,
+    iushr         = 0x7c,
+    iand          = 0x7e,
+    ior           = 0x80,
+    ixor          = 0x82,
+    iinc          = 0x84,
+    i2c           = 0x92,
+    ifeq          = 0x99,
+    ifne          = 0x9a,
+    iflt          = 0x9b,
+    ifge          = 0x9c,
+    ifgt          = 0x9d,
+    ifle          = 0x9e,
+    if_icmpeq     = 0x9f,
+    if_icmpne     = 0xa0,
+    if_icmplt     = 0xa1,
+    if_icmpge     = 0xa2,
+    if_icmpgt     = 0xa3,
+    if_icmple     = 0xa4,
+    if_acmpeq     = 0xa5,
+    if_acmpne     = 0xa6,
+    goto_         = 0xa7,
+    tableswitch   = 0xaa,
+    lookupswitch  = 0xab,
+    ireturn       = 0xac,
+    areturn       = 0xb0,
+    return_       = 0xb1,
+    getstatic     = 0xb2,
+    putstatic     = 0xb3,
+    invokevirtual = 0xb6,
+    invokespecial = 0xb7,
+    invokestatic  = 0xb8,
+    new_          = 0xbb,
+    newarray      = 0xbc,
+    anewarray     = 0xbd,
+    arraylength   = 0xbe,
+    athrow        = 0xbf,
+};
+
+constexpr std::string_view opcodeName(Opcode op) {
+    switch (op) {
+        case Opcode::nop:           return "nop";
+        case Opcode::aconst_null:   return "aconst_null";
+        case Opcode::iconst_m1:     return "iconst_m1";
+        case Opcode::iconst_0:      return "iconst_0";
+        case Opcode::iconst_1:      return "iconst_1";
+        case Opcode::iconst_2:      return "iconst_2";
+        case Opcode::iconst_3:      return "iconst_3";
+        case Opcode::iconst_4:      return "iconst_4";
+        case Opcode::iconst_5:      return "iconst_5";
+        case Opcode::bipush:        return "bipush";
+        case Opcode::sipush:        return "sipush";
+        case Opcode::ldc:           return "ldc";
+        case Opcode::ldc2_w:        return "ldc2_w";
+        case Opcode::iload:         return "iload";
+        case Opcode::aload:         return "aload";
+        case Opcode::iaload:        return "iaload";
+        case Opcode::aaload:        return "aaload";
+        case Opcode::baload:        return "baload";
+        case Opcode::istore:        return "istore";
+        case Opcode::astore:        return "astore";
+        case Opcode::iastore:       return "iastore";
+        case Opcode::aastore:       return "aastore";
+        case Opcode::bastore:       return "bastore";
+        case Opcode::castore:       return "castore";
+        case Opcode::pop:           return "pop";
+        case Opcode::dup:           return "dup";
+        case Opcode::dup_x1:        return "dup_x1";
+        case Opcode::dup2:          return "dup2";
+        case Opcode::swap:          return "swap";
+        case Opcode::iadd:          return "iadd";
+        case Opcode::isub:          return "isub";
+        case Opcode::imul:          return "imul";
+        case Opcode::idiv:          return "idiv";
+        case Opcode::irem:          return "irem";
+        case Opcode::ineg:          return "ineg";
+        case Opcode::ishl:          return "ishl";
+        case Opcode::ishr:          return "ishr";
+        case Opcode::iushr:         return "iushr";
+        case Opcode::iand:          return "iand";
+        case Opcode::ior:           return "ior";
+        case Opcode::ixor:          return "ixor";
+        case Opcode::iinc:          return "iinc";
+        case Opcode::i2c:           return "i2c";
+        case Opcode::ifeq:          return "ifeq";
+        case Opcode::ifne:          return "ifne";
+        case Opcode::iflt:          return "iflt";
+        case Opcode::ifge:          return "ifge";
+        case Opcode::ifgt:          return "ifgt";
+        case Opcode::ifle:          return "ifle";
+        case Opcode::if_icmpeq:     return "if_icmpeq";
+        case Opcode::if_icmpne:     return "if_icmpne";
+        case Opcode::if_icmplt:     return "if_icmplt";
+        case Opcode::if_icmpge:     return "if_icmpge";
+        case Opcode::if_icmpgt:     return "if_icmpgt";
+        case Opcode::if_icmple:     return "if_icmple";
+        case Opcode::if_acmpeq:     return "if_acmpeq";
+        case Opcode::if_acmpne:     return "if_acmpne";
+        case Opcode::goto_:         return "goto";
+        case Opcode::tableswitch:   return "tableswitch";
+        case Opcode::lookupswitch:  return "lookupswitch";
+        case Opcode::ireturn:       return "ireturn";
+        case Opcode::areturn:       return "areturn";
+        case Opcode::return_:       return "return";
+        case Opcode::getstatic:     return "getstatic";
+        case Opcode::putstatic:     return "putstatic";
+        case Opcode::invokevirtual: return "invokevirtual";
+        case Opcode::invokespecial: return "invokespecial";
+        case Opcode::invokestatic:  return "invokestatic";
+        case Opcode::new_:          return "new";
+        case Opcode::newarray:      return "newarray";
+        case Opcode::anewarray:     return "anewarray";
+        case Opcode::arraylength:   return "arraylength";
+        case Opcode::athrow:        return "athrow";
+    }
+    return "nop";
+}
+
+// ifeq ↔ ifne, iflt ↔ ifge, ifgt ↔ ifle (and the if_icmp / if_acmp forms)
+constexpr Opcode negateBranch(Opcode op) {
+    switch (op) {
+        case Opcode::ifeq:      return Opcode::ifne;
+        case Opcode::ifne:      return Opcode::ifeq;
+        case Opcode::iflt:      return Opcode::ifge;
+        case Opcode::ifge:      return Opcode::iflt;
+        case Opcode::ifgt:      return Opcode::ifle;
+        case Opcode::ifle:      return Opcode::ifgt;
+        case Opcode::if_icmpeq: return Opcode::if_icmpne;
+        case Opcode::if_icmpne: return Opcode::if_icmpeq;
+        case Opcode::if_icmplt: return Opcode::if_icmpge;
+        case Opcode::if_icmpge: return Opcode::if_icmplt;
+        case Opcode::if_icmpgt: return Opcode::if_icmple;
+        case Opcode::if_icmple: return Opcode::if_icmpgt;
+        case Opcode::if_acmpeq: return Opcode::if_acmpne;
+        case Opcode::if_acmpne: return Opcode::if_acmpeq;
+        default:                return op;
+    }
+}
+
+// Method-local jump target; CodeGenContext::newLabel() hands them out
+struct Label {
+    int id = -1;
+    bool valid() const { return id >= 0; }
+    bool operator==(Label o) const { return id == o.id; }
+    bool operator!=(Label o) const { return id != o.id; }
+};
@@ -0,0 +1,57 @@
+// =============================================================
+// OptReport.hpp  —  per-optimization statistics (--opt-report)
+// -------------------------------------------------------------
+//  • counters are keyed by (pass, metric), e.g. ("peephole.iinc", "removed")
+//  • parallel workers fill their own report; merge() adds them up
+// =============================================================
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+class OptReport {
+public:
+    void add(std::string_view pass, std::string_view metric, long n = 1) {
+        if (n == 0) return;
+        auto p = passes.find(pass);
+        if (p == passes.end()) p = passes.emplace(std::string(pass), Metrics{}).first;
+        auto m = p->second.find(metric);
+        if (m == p->second.end()) m = p->second.emplace(std::string(metric), 0).first;
+        m->second += n;
+    }
+
+    void merge(const OptReport& other) {
+        for (const auto& [pass, metrics] : other.passes)
+            for (const auto& [metric, n] : metrics) add(pass, metric, n);
+    }
+
+    long get(std::string_view pass, std::string_view metric) const {
+        auto p = passes.find(pass);
+        if (p == passes.end()) return 0;
+        auto m = p->second.find(metric);
+        return m == p->second.end() ? 0 : m->second;
+    }
+
+    // "[opt] peephole.iinc: 12 hits, 36 removed"
+    void print(std::ostream& os) const {
+        if (passes.empty()) {
+            os << "[opt] nothing changed\n";
+            return;
+        }
+        for (const auto& [pass, metrics] : passes) {
+            os << "[opt] " << pass << ':';
+            const char* sep = " ";
+            for (const auto& [metric, n] : metrics) {
+                os << sep << n << ' ' << metric;
+                sep = ", ";
+            }
+            os << '\n';
+        }
+    }
+
+private:
+    using Metrics = std::map<std::string, long, std::less<>>;
+    std::map<std::string, Metrics, std::less<>> passes;
+};
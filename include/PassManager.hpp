@@ -0,0 +1,45 @@
+// =============================================================
+// PassManager.hpp  —  runs optimization passes over the SSA IR
+// -------------------------------------------------------------
+//  • a pass is named ("ir.const-prop"); --disable=<name> leaves it
+//    out and its --opt-report lines are keyed by the name
+//  • the pipeline runs in order and starts over while a pass still
+//    changes something, a few rounds at most: const-prop folds
+//    branches that cfg then merges, which gives gvn more to share
+//  • standard() is the pipeline IR methods get; see IRPasses.hpp
+// =============================================================
+#pragma once
+
+#include "IR.hpp"
+
+#include <memory>
+#include <vector>
+
+struct CompilerOptions;
+class OptReport;
+
+class IRPass {
+public:
+    virtual ~IRPass() = default;
+    virtual const char* name() const = 0;
+    // true when `f` changed
+    virtual bool run(ir::Function& f, OptReport* report) = 0;
+};
+
+class PassManager {
+public:
+    // every pass is on when `opts` is null
+    PassManager(const CompilerOptions* opts, OptReport* report) : options(opts), report(report) {}
+
+    static PassManager standard(const CompilerOptions* opts, OptReport* report);
+
+    void add(std::unique_ptr<IRPass> pass);
+    void run(ir::Function& f);
+
+private:
+    static constexpr int kRounds = 4;
+
+    const CompilerOptions* options;
+    OptReport* report;
+    std::vector<std::unique_ptr<IRPass>> passes;
+};
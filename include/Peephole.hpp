@@ -0,0 +1,50 @@
+// =============================================================
+// Peephole.hpp  —  local rewrites over a method's instruction list
+// -------------------------------------------------------------
+//  Patterns (names are what --disable= and --opt-report use):
+//   peephole.bool-branch  if<c> Lt; iconst_0; goto Le; Lt: iconst_1;
+//                         Le: ifeq/ifne L           → if<!c>/if<c> L
+//   peephole.label-nop    nop that is not the last reachable instruction
+//   peephole.goto-next    goto L directly followed by L:
+//   peephole.branch-goto  if<c> La; goto Lb; La:      → if<!c> Lb
+//   peephole.dup-pop      dup; <k>; iadd/isub; store; pop → drop dup, pop
+//   peephole.iinc         iload n; <k>; iadd/isub; istore n → iinc n ±k
+//   peephole.sipush       ldc k with k in short range     → sipush k
+//  Labels that lose their last reference are dropped. Rewrites repeat
+//  until nothing matches. "peephole" disables all of them.
+// =============================================================
+#pragma once
+
+#include "MethodCode.hpp"
+
+#include <vector>
+
+struct CompilerOptions;
+class OptReport;
+
+class Peephole {
+public:
+    enum Pattern { BoolBranch, LabelNop, GotoNext, DupPop, Iinc, Sipush, BranchOverGoto, kPatterns };
+
+    static const char* name(Pattern p);
+
+    // every pattern is on when `opts` is null
+    explicit Peephole(const CompilerOptions* opts = nullptr);
+
+    bool any() const;
+    void run(MethodCode& code, OptReport* report);
+
+private:
+    bool enabled[kPatterns];
+    long hits[kPatterns];
+    long removed[kPatterns];
+
+    std::vector<Instr> scratch;   // reused between passes and methods
+    std::vector<int>   uses;      // references per label id
+
+    bool rewrite(const MethodCode& code, std::vector<Instr>& in, std::vector<Instr>& out);
+    void hit(Pattern p, long instructionsRemoved) {
+        ++hits[p];
+        removed[p] += instructionsRemoved;
+    }
+};
@@ -0,0 +1,54 @@
+// =============================================================
+// PhaseTimer.hpp  —  wall-clock timing of compiler phases (--time)
+// =============================================================
+#pragma once
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class PhaseTimer {
+public:
+    explicit PhaseTimer(bool enabled = false) : enabled(enabled) {}
+
+    void start(const std::string& phase) {
+        if (!enabled) return;
+        current = phase;
+        begin = Clock::now();
+    }
+
+    // Closes the running phase and returns its duration in milliseconds.
+    double stop() {
+        if (!enabled) return 0.0;
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        phases.emplace_back(current, ms);
+        return ms;
+    }
+
+    void report(std::ostream& os) const {
+        if (!enabled) return;
+        double total = 0.0;
+        for (const auto& [name, ms] : phases) {
+            os << "[time] " << name << ": " << ms << " ms\n";
+            total += ms;
+        }
+        os << "[time] total: " << total << " ms\n";
+
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            os << "[mem] peak rss: " << usage.ru_maxrss << " KB\n";
+    }
+
+    bool isEnabled() const { return enabled; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool enabled;
+    std::string current;
+    Clock::time_point begin;
+    std::vector<std::pair<std::string, double>> phases;
+};
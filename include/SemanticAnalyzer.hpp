@@ -3,14 +3,28 @@
 #include "AST.hpp"
 #include "SymbolTable.hpp"
 
+class WorkStealingPool;
+
 // Constant folding evaluator prototype
 std::optional<ConstValue> evalConstExpr(ast::Expr* e);
+// One operator applied to known values, with Java int semantics;
+// nullopt when the result is not a compile-time constant
+std::optional<ConstValue> foldUnary(ast::Op op, const ConstValue& v);
+std::optional<ConstValue> foldBinary(ast::Op op, const ConstValue& lhs, const ConstValue& rhs);
 
 // SemanticAnalyzer performs semantic checks and type resolution
 class SemanticAnalyzer : public ast::Visitor {
    public:
     SemanticAnalyzer(SymbolTable& st) : symtab(st) {};
     void analyze(ast::Program& prog);
+    // Global declarations are entered serially, then function bodies are
+    // analysed on `pool`, each against a frozen view of the globals
+    void analyzeParallel(ast::Program& prog, WorkStealingPool& pool);
+    // Streaming: analyse one top-level item as soon as it is parsed;
+    // call report() after the last one
+    void analyzeItem(ast::Stmt& item) { item.accept(*this); }
+    bool hasErrors() const { return !errors.empty(); }
+    void report();  // print diagnostics; exits on errors
 
     // Visitor overrides
     void visit(ast::Program& p) override;
@@ -24,6 +38,9 @@ class SemanticAnalyzer : public ast::Visitor {
     void visit(ast::WhileStmt& s) override;
     void visit(ast::ForStmt& s) override;
     void visit(ast::ForEachStmt& s) override;
+    void visit(ast::SwitchStmt& s) override;
+    void visit(ast::BreakStmt& s) override;
+    void visit(ast::ContinueStmt& s) override;
     void visit(ast::ReturnStmt& s) override;
     void visit(ast::Var& v) override;
     void visit(ast::IntLit& e) override;
@@ -55,8 +72,15 @@ class SemanticAnalyzer : public ast::Visitor {
 
     void error(int line, const std::string& msg);
     void warning(int line, const std::string& msg);
+    SymEntry* declareFunction(ast::FuncDecl& fd);
+    void analyzeFunctionBody(ast::FuncDecl& fd);
 
     int skipBlockScopeOnce{0};  // Skip block scope once
+
+    // what `break` leaves, innermost last: a loop (nullptr) or a switch
+    std::vector<ast::SwitchStmt*> breakTargets;
+    int loopDepth{0};           // loops around the current statement
+    void loopBody(ast::Stmt& body);
 };
 
 #endif
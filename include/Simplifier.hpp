@@ -0,0 +1,72 @@
+// =============================================================
+// Simplifier.hpp  —  algebraic identities on int arithmetic
+// -------------------------------------------------------------
+//  • constants move to the right of + and *, so the rules below
+//    only look there
+//  • x + 0, x - 0, x * 1, x / 1 → x;  x * -1, x / -1, 0 - x → -x;
+//    -(-x) → x
+//  • x * 0, x % ±1, x - x → 0 when x has no side effects and
+//    cannot throw
+//  • constant chains are reassociated: (a + 1) + 2 → a + 3,
+//    (a - 1) + 5 → a + 4, (a * 3) * 4 → a * 12
+//  • every rule holds in Java's wrapping int arithmetic, overflow
+//    included
+//  Runs on the folded AST before the inliner sizes bodies, and on
+//  every method at code generation; switched off with
+//  --disable=simplify.
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+
+#include <memory>
+
+class OptReport;
+
+class Simplifier : private ast::Visitor {
+public:
+    explicit Simplifier(OptReport* report = nullptr) : report(report) {}
+
+    void run(ast::Program& program);    // global initializers and every function
+    void run(std::unique_ptr<ast::Stmt>& s);
+    void run(std::unique_ptr<ast::Expr>& e);
+
+private:
+    OptReport* report;
+    std::unique_ptr<ast::Expr> replacement;   // what the last expression visited becomes
+
+    void simplified(std::unique_ptr<ast::Expr> e);
+
+    void visit(ast::IntLit& n) override;
+    void visit(ast::RealLit& n) override;
+    void visit(ast::StringLit& n) override;
+    void visit(ast::BoolLit& n) override;
+    void visit(ast::CharLit& n) override;
+    void visit(ast::Var& v) override;
+    void visit(ast::Unary& u) override;
+    void visit(ast::Binary& b) override;
+    void visit(ast::Postfix& p) override;
+    void visit(ast::Call& c) override;
+    void visit(ast::Assign& a) override;
+    void visit(ast::RangeExpr& r) override;
+    void visit(ast::Print& p) override;
+    void visit(ast::Println& p) override;
+    void visit(ast::Read& r) override;
+    void visit(ast::Block& b) override;
+    void visit(ast::IfStmt& s) override;
+    void visit(ast::WhileStmt& s) override;
+    void visit(ast::ForStmt& s) override;
+    void visit(ast::ForEachStmt& s) override;
+    void visit(ast::SwitchStmt& s) override;
+    void visit(ast::BreakStmt& s) override;
+    void visit(ast::ContinueStmt& s) override;
+    void visit(ast::ReturnStmt& s) override;
+    void visit(ast::ExprStmt& s) override;
+    void visit(ast::EmptyStmt& s) override;
+    void visit(ast::DeclList& dl) override;
+    void visit(ast::VarDecl& d) override;
+    void visit(ast::VarDeclList& dl) override;
+    void visit(ast::ConstDecl& d) override;
+    void visit(ast::FuncDecl& f) override;
+    void visit(ast::Program& p) override;
+};
@@ -0,0 +1,35 @@
+// =============================================================
+// SlotAllocator.hpp  —  liveness-based reuse of JVM local slots
+// -------------------------------------------------------------
+//  • treats every slot the generator used as a virtual register
+//  • block-level liveness (Liveness) gives each one a live interval
+//    [first, last] over the instruction list
+//  • linear scan then packs the intervals into as few slots as
+//    possible; live argument slots keep their index
+//  • runs after the peephole pass, before the frame is sized
+//  Switched off with --disable=slot-reuse.
+// =============================================================
+#pragma once
+
+#include "Liveness.hpp"
+#include "MethodCode.hpp"
+
+#include <vector>
+
+class OptReport;
+
+class SlotAllocator {
+public:
+    void run(MethodCode& code, int argSlots, OptReport* report);
+
+private:
+    struct Interval {
+        int slot;          // slot the generator used
+        int start, end;    // instruction indices, inclusive
+    };
+
+    // scratch, reused between methods
+    Liveness live;
+    std::vector<Interval> intervals;
+    std::vector<int> slotEnd, remap;
+};
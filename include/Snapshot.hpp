@@ -0,0 +1,106 @@
+/**
+ * @file Snapshot.hpp
+ * @brief Binary snapshots of fully analysed programs (.sdsnap)
+ *
+ * A snapshot stores an ast::Program after semantic analysis: node kinds,
+ * expression types, resolved SymEntry data (slots, globals, constant values)
+ * and a global symbol section. CodeGenVisitor can run on a decoded snapshot
+ * without scanning, parsing or semantic analysis.
+ *
+ * Layout (all integers little-endian, all references are offsets relative to
+ * the start of their section, so the file is position independent):
+ *
+ *   header        magic "SDSNAP\0\0", version, section table, function count, root node
+ *   strings       deduplicated string bytes, referenced as (offset, length)
+ *   nodes         one record per node, children written before parents
+ *   symbols       interned SymEntry records; nodes refer to them by index
+ *   symbol index  record offset of every symbol
+ *   globals       symbol indices of global variables, constants and functions
+ *   functions     (name, node offset) pairs for lazy per-function decoding
+ *
+ * The reader memory-maps the file and decodes directly from the mapping.
+ * SymEntry::arrayValues is analysis-time element tracking and is not stored.
+ */
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AST.hpp"
+#include "SymbolTable.hpp"
+
+constexpr uint32_t kSnapshotVersion = 4;   // 2: FuncDecl records carry localSlots, 3: SwitchStmt records, 4: break / continue
+
+/**
+ * @brief Serializes an analysed program into a snapshot file
+ */
+class SnapshotWriter {
+public:
+    /**
+     * @brief Writes `prog` to `path`
+     * @return false (with `err` set) if the file cannot be written
+     */
+    static bool write(ast::Program& prog, const std::string& path, std::string& err);
+};
+
+/**
+ * @brief Memory-mapped snapshot reader with lazy per-function decoding
+ */
+class SnapshotReader {
+public:
+    enum Section { Strings, Nodes, Symbols, SymbolIndex, Globals, Functions, kSections };
+
+    struct Span {
+        const uint8_t* data = nullptr;
+        size_t         size = 0;
+    };
+
+    SnapshotReader() = default;
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    /**
+     * @brief Maps `path` and validates the header and section bounds
+     * @return false (with `err` set) if the file is missing, truncated or of another version
+     */
+    bool open(const std::string& path, std::string& err);
+
+    /**
+     * @brief Decodes the whole program tree; nullptr if the node section is corrupt
+     */
+    std::unique_ptr<ast::Program> program();
+
+    /**
+     * @brief Function index access (no node decoding involved)
+     */
+    size_t      functionCount() const { return funcCount; }
+    std::string functionName(size_t i) const;
+
+    /**
+     * @brief Decodes only the i-th function; nullptr if out of range or corrupt
+     */
+    std::unique_ptr<ast::FuncDecl> function(size_t i);
+
+    /**
+     * @brief Global symbols recorded at snapshot time
+     */
+    std::vector<SymEntry> globals();
+
+private:
+    const uint8_t* data = nullptr;   // start of the mapping
+    size_t         size = 0;
+
+    Span     sections[kSections];
+    uint32_t funcCount = 0;
+    uint32_t rootNode = 0;
+
+    void unmap();
+};
+
+#endif // SNAPSHOT_HPP
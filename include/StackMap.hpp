@@ -0,0 +1,65 @@
+// =============================================================
+// StackMap.hpp  —  verification types for StackMapTable frames
+// -------------------------------------------------------------
+//  • runs a method's instructions over JVM verification types:
+//    Integer for int / boolean / char, Object with its class for
+//    references, Uninitialized from a `new` until its <init>
+//  • at a label the incoming states are joined: equal types stay, two
+//    different classes become java/lang/Object (null takes the other
+//    side), anything else becomes Top; stack depths must agree
+//  • labels are instructions here too, so the state at a label is the
+//    frame ClassWriter writes for the code that follows it
+//  • a local read while it is still Top is an error, like it is for
+//    the JVM's verifier
+// =============================================================
+#pragma once
+
+#include "MethodCode.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+struct VType {
+    enum Tag : uint8_t { Top, Integer, Float, Double, Long, Null, UninitializedThis, Object, Uninitialized };
+
+    Tag              tag = Top;
+    std::string_view name;      // Object: internal class name, or an array descriptor
+    int              at = -1;   // Uninitialized: index of the `new` in the code
+
+    bool operator==(const VType& o) const { return tag == o.tag && name == o.name && at == o.at; }
+    bool operator!=(const VType& o) const { return !(*this == o); }
+};
+
+struct Frame {
+    std::vector<VType> locals;  // one per slot
+    std::vector<VType> stack;
+};
+
+class StackMap {
+public:
+    // `descriptor` gives the static method's parameters, the first locals
+    bool run(const std::vector<Instr>& code, const std::vector<SwitchTable>& tables,
+             std::string_view descriptor, int maxLocals, std::string& err);
+
+    // entry state of code[i]; null when no path reaches it
+    const Frame* at(size_t i) const { return reached[i] ? &frames[i] : nullptr; }
+    const Frame& initial() const { return start; }
+
+    // field or method descriptor type at `d`, advancing `d` past it
+    VType parseType(std::string_view& d);
+
+private:
+    Frame start;
+    std::vector<Frame> frames;
+    std::vector<char>  reached;
+    std::vector<int>   labelAt;     // label id → index of its definition
+    std::vector<size_t> work;
+    std::unordered_set<std::string> names;      // interned class names
+
+    VType object(std::string_view internalName);
+    VType join(const VType& a, const VType& b);
+    bool  flow(size_t to, const Frame& f, std::string& err);
+    bool  step(const Instr& in, size_t i, Frame& f, std::string& err);
+};
@@ -0,0 +1,63 @@
+// =============================================================
+// StreamingCompiler.hpp  —  function-at-a-time pipeline (--stream)
+// -------------------------------------------------------------
+//  • the parser hands over every top-level item as soon as it is
+//    reduced; it is analysed at once and, if it is a function,
+//    generated and freed before the next item is parsed
+//  • method bodies are spooled to <name>.jasm.tmp; fields and
+//    <clinit> are written in front of them by finish(), in the
+//    layout of a whole-program run
+//  • the passes that need the whole program do not run: no
+//    compile-time evaluation of calls or global initializers, no
+//    inlining, no tree shaking. Per-function optimizations do
+//  • only global declarations stay alive (they feed <clinit>),
+//    so peak memory follows the largest function, not the file
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+#include "CodeEmitter.hpp"
+#include "CodeGenContext.hpp"
+#include "CodeGenVisitor.hpp"
+#include "SemanticAnalyzer.hpp"
+#include "SymbolTable.hpp"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class StreamingCompiler {
+public:
+    StreamingCompiler(const std::string& className, const std::string& outputFile,
+                      const CompilerOptions* opts = nullptr, OptReport* report = nullptr);
+
+    StreamingCompiler(const StreamingCompiler&) = delete;
+    StreamingCompiler& operator=(const StreamingCompiler&) = delete;
+
+    // false if the spool file could not be created
+    bool isOpen() const { return spool.is_open(); }
+
+    // Called from the grammar actions, in source order
+    void topLevel(ast::Decl* item);
+
+    // Reports diagnostics (exits on errors), then writes the class to `out`
+    void finish(std::ostream& out);
+
+    size_t functionCount() const { return functions; }
+
+private:
+    std::string spoolPath;
+    std::fstream spool;             // generated method bodies
+    CodeEmitter spoolEmitter;
+
+    SymbolTable symtab;
+    SemanticAnalyzer analyzer;
+    CodeGenContext ctx;
+    const CompilerOptions* options;
+    OptReport* report;
+    CodeGenVisitor codegen;         // reused for every function
+
+    std::vector<std::unique_ptr<ast::Decl>> globals;  // kept for fields and <clinit>
+    size_t functions = 0;
+};
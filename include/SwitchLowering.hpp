@@ -0,0 +1,57 @@
+// =============================================================
+// SwitchLowering.hpp  —  dispatch code of a switch statement
+// -------------------------------------------------------------
+//  • the case values are sorted and cut into segments: clusters
+//    dense enough for a jump table, and runs of sparse values between
+//    them. A cluster is as long as javac's cost model still prefers a
+//    tableswitch to a lookupswitch over its values:
+//        4 + range + 3·3  ≤  3 + 2·n + 3·n
+//  • one segment: a tableswitch for a cluster; a lookupswitch for
+//    sparse values, or if_icmpeq tests when there are no more than
+//    kMaxCompares of them
+//  • several segments: a binary search over them (if_icmplt on the
+//    first value of the middle segment), each leaf dispatched as above
+//  The selector is on the stack when run() starts. Tests and search
+//  trees read it more than once, so it then goes to a fresh local.
+// =============================================================
+#pragma once
+
+#include "CodeGenContext.hpp"
+#include "MethodCode.hpp"
+
+#include <vector>
+
+class OptReport;
+
+class SwitchLowering {
+public:
+    static constexpr int kMaxCompares = 3;
+
+    struct Case {
+        int   value;
+        Label target;
+    };
+
+    // Jumps to the target of the selector's value, or to `dflt`;
+    // `cases` may come in any order, values are distinct
+    void run(std::vector<Case> cases, Label dflt, MethodCode& code, CodeGenContext& ctx, OptReport* report);
+
+private:
+    struct Segment {
+        size_t first, last;     // indices into `cases`, inclusive
+        bool   table;
+    };
+
+    std::vector<Case> cases;
+    std::vector<Segment> segments;
+    Label dflt;
+    int selector = -1;          // local holding the selector, -1 while it is on the stack
+    MethodCode* code = nullptr;
+    CodeGenContext* ctx = nullptr;
+    OptReport* report = nullptr;
+
+    void split();
+    void search(size_t from, size_t to);    // segments [from, to)
+    void leaf(const Segment& s);
+    void load();                            // the selector onto the stack
+};
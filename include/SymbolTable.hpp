@@ -13,6 +13,7 @@
 #include <vector>
 #include <optional>
 #include <stack>
+#include <utility>
 
 #include "Type.hpp"
 
@@ -69,6 +70,15 @@ public:
      */
     SymbolTable();
 
+    /**
+     * @brief Worker table over a frozen global scope
+     *
+     * Sees only the first `visibleGlobals` global symbols of `frozen`, in
+     * insertion order. Mutable lookups of a global copy it into this table,
+     * so `frozen` is never written and may be shared between threads.
+     */
+    SymbolTable(const SymbolTable& frozen, size_t visibleGlobals);
+
     /**
      * @brief Scope management methods
      */
@@ -87,19 +97,28 @@ public:
      */
     int  allocateSlot();        // Allocates and returns the next available slot
     int  currentLocal() const;  // Returns current slot counter value
+    int  localHighWater() const { return highWater; }  // Most slots in use at once in the current function
     void resetLocal(int base = 0);  // Resets slot counter to specified base
 
     /**
      * @brief Helper methods
      */
     bool atGlobalScope() const { return scopes.size() == 1; }  // Checks if we're in global scope
+    size_t globalCount() const { return globalSeq.size(); }     // Number of global symbols inserted so far
 
 private:
     using Scope = std::unordered_map<std::string, SymEntry>;
     std::vector<Scope> scopes;   // Stack of scopes (scopes[0] is global)
 
     int nextLocal = 0;                 // Next available slot in current function
-    std::stack<int> savedNextLocal;    // Saved slot counters for outer function scopes
+    int highWater = 0;                 // Largest nextLocal seen in current function
+    std::stack<std::pair<size_t, int>> savedNextLocal;  // (scope depth, saved slot counter) per open function scope
+
+    std::unordered_map<std::string, size_t> globalSeq;  // Insertion order of global symbols
+    const SymbolTable* frozen = nullptr;                // Shared read-only globals (worker tables)
+    size_t visibleGlobals = 0;                          // How many of frozen's globals are in scope
+
+    const SymEntry* lookupFrozen(const std::string& name) const;
 };
 
 #endif // SYMBOL_TABLE_HPP
\ No newline at end of file
@@ -0,0 +1,38 @@
+// =============================================================
+// TreeShaker.hpp  —  drop functions and globals main never uses
+// -------------------------------------------------------------
+//  • functions: reachable from main over the call graph; a call the
+//    inliner always expands is no edge, its body is walked instead
+//    (as deep as code generation expands it), so helpers that only
+//    survive inlined disappear too
+//  • globals: kept when a reachable function (or a kept global's
+//    initializer) touches them, or when their initializer has side
+//    effects — <clinit> must still run it
+//  • programs without main are libraries and are left alone
+//  Runs on the folded AST right before code generation; switched
+//  off with --disable=tree-shake.
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+
+#include <memory>
+#include <vector>
+
+class Inliner;
+class OptReport;
+
+class TreeShaker {
+public:
+    // `inliner` is the one code generation will consult (null: no inlining);
+    // the shaker must outlive code generation, it owns dropped bodies
+    explicit TreeShaker(const Inliner* inliner = nullptr, OptReport* report = nullptr)
+        : inliner(inliner), report(report) {}
+
+    void run(ast::Program& program);
+
+private:
+    const Inliner* inliner;
+    OptReport*     report;
+    std::vector<std::unique_ptr<ast::Node>> removed;   // dropped functions, kept for the inliner
+};
@@ -0,0 +1,122 @@
+// =============================================================
+// ValueNumbering.hpp  —  common subexpressions in straight-line code
+// -------------------------------------------------------------
+//  • numbers the expressions of a run of simple statements (expression
+//    statements, declarations, print, return) in evaluation order;
+//    a control statement ends the run
+//  • a value number stands for (operator, operand numbers); a local
+//    or global read keeps its number until a store, ++/-- or — for
+//    globals — any call gives it a fresh one, so equal numbers always
+//    mean equal values
+//  • int arithmetic and int / bool global reads that are evaluated a
+//    second time are shared: the first evaluation is kept in a temp
+//    (dup; istore), the later ones load it; operands of a shared
+//    value are not evaluated again, so they do not count
+//  • the right side of && / || may not run: it can use shared values
+//    but never provides one
+//  • expressions a loop hoisted are already loaded from a temp; they
+//    count as plain reads and their operands are not looked at
+//  Used by CodeGenVisitor::visit(Block&); --disable=cse turns it off.
+// =============================================================
+#pragma once
+
+#include "AST.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ValueNumbering : private ast::Visitor {
+public:
+    struct Share {
+        const ast::Expr* expr;
+        int temp;       // 0 .. temps()-1
+        bool first;     // computes and keeps the value; otherwise loads it
+    };
+
+    // Numbers stmts[begin, …) up to the first control statement and
+    // returns where the run ends; shares() then lists what to keep
+    size_t run(std::vector<std::unique_ptr<ast::Stmt>>& stmts, size_t begin,
+               const std::unordered_set<const ast::Expr*>& hoisted);
+
+    const std::vector<Share>& shares() const { return out; }
+    int temps() const { return nTemps; }
+
+private:
+    using Key = std::tuple<int, int, long, long>;
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            size_t h = size_t(std::get<0>(k)) * 31 + size_t(std::get<1>(k));
+            h = h * 1000003 ^ size_t(std::get<2>(k));
+            return h * 1000003 ^ size_t(std::get<3>(k));
+        }
+    };
+    struct Use {
+        ast::Expr* expr;
+        int vn;
+    };
+
+    std::unordered_map<Key, int, KeyHash> numbers;
+    std::vector<Use> uses;                         // evaluated, in order
+    std::vector<char> seen;                        // per value number
+    struct Global {
+        int value = -1;                            // current number, -1 once written
+        int epoch = 0;                             // callEpoch it was read in
+    };
+    std::vector<int> localValue;                   // per slot, -1 once written
+    std::unordered_map<std::string, Global> globals;
+    int callEpoch = 0;
+    bool conditional = false;                      // inside the rhs of && / ||
+    bool simple = false;                           // last statement visited could be numbered
+    const std::unordered_set<const ast::Expr*>* hoisted = nullptr;
+
+    std::optional<int> vn;                         // result of the last expression
+    std::vector<Share> out;
+    int nTemps = 0;
+    std::vector<int> count, temp;                  // scratch for run()
+
+    std::optional<int> number(ast::Expr* e);
+    int  valueOf(const Key& key);
+    int  fresh();                                  // a value equal to nothing seen before
+    int& local(int slot);
+    bool loaded(const ast::Expr& e);               // hoisted out of a loop
+    void wrote(const ast::Var& v);
+    void clear();
+
+    void visit(ast::IntLit& n) override;
+    void visit(ast::RealLit& n) override;
+    void visit(ast::StringLit& n) override;
+    void visit(ast::BoolLit& n) override;
+    void visit(ast::CharLit& n) override;
+    void visit(ast::Var& v) override;
+    void visit(ast::Unary& u) override;
+    void visit(ast::Binary& b) override;
+    void visit(ast::Postfix& p) override;
+    void visit(ast::Call& c) override;
+    void visit(ast::Assign& a) override;
+    void visit(ast::RangeExpr& r) override;
+    void visit(ast::Print& p) override;
+    void visit(ast::Println& p) override;
+    void visit(ast::Read& r) override;
+    void visit(ast::Block& b) override;
+    void visit(ast::IfStmt& s) override;
+    void visit(ast::WhileStmt& s) override;
+    void visit(ast::ForStmt& s) override;
+    void visit(ast::ForEachStmt& s) override;
+    void visit(ast::SwitchStmt& s) override;
+    void visit(ast::BreakStmt& s) override;
+    void visit(ast::ContinueStmt& s) override;
+    void visit(ast::ReturnStmt& s) override;
+    void visit(ast::ExprStmt& s) override;
+    void visit(ast::EmptyStmt& s) override;
+    void visit(ast::DeclList& dl) override;
+    void visit(ast::VarDecl& d) override;
+    void visit(ast::VarDeclList& dl) override;
+    void visit(ast::ConstDecl& d) override;
+    void visit(ast::FuncDecl& f) override;
+    void visit(ast::Program& p) override;
+};
@@ -0,0 +1,106 @@
+// =============================================================
+// VirtualMachine.hpp  —  interpreter of the register bytecode (--run)
+// -------------------------------------------------------------
+//  • threaded dispatch: every instruction carries the address of its
+//    handler (GCC / Clang computed goto), so each handler ends in
+//    its own indirect jump; other compilers get a switch loop
+//  • one register stack and one frame stack, both allocated up front;
+//    a call is a window shift, never an allocation. Running out of
+//    either is a StackOverflowError
+//  • values are 8 bytes: a sign-extended int / bool / char, or a
+//    string pointer (null prints as "null")
+//  • strings are immutable; literals are made once, so equal
+//    literals are the same reference as on the JVM. Concat and read
+//    allocate; a mark-sweep pass frees the unreachable ones when the
+//    heap doubles, with the globals and the live part of the
+//    register stack as roots (checked against the object list, so
+//    an int in a register never keeps anything alive by mistake)
+//  • runtime errors end the run with the line the JVM would print
+//    to stderr and status 1
+//  • output is buffered and flushed when full, before a read has to
+//    wait for input, and at the end; input is read in 64 KiB chunks
+// =============================================================
+#pragma once
+
+#include "Bytecode.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class VirtualMachine {
+public:
+    static constexpr size_t kRegisters = size_t(1) << 22;   // 32 MiB of register stack
+    static constexpr size_t kFrames    = size_t(1) << 16;   // nested calls
+    static constexpr size_t kMinHeap   = size_t(8) << 20;   // bytes of strings before the first collection
+
+    explicit VirtualMachine(const bc::Module& module);
+    ~VirtualMachine();
+    VirtualMachine(const VirtualMachine&) = delete;
+    VirtualMachine& operator=(const VirtualMachine&) = delete;
+
+    // global initializers, then main; the exit status (1 after an
+    // uncaught exception)
+    int run(std::FILE* input, std::FILE* output);
+
+private:
+    struct Str {
+        size_t length;
+        bool   marked;
+        char* text() { return reinterpret_cast<char*>(this + 1); }
+    };
+    union Value {
+        int64_t i;
+        Str*    s;
+    };
+    struct Slot {                   // bc::Insn with its handler resolved
+        const void* handler;
+        bc::Op op;
+        int32_t a, b, c, d;
+    };
+    struct Frame {                  // the caller's state during a call
+        const Slot* ret;
+        Value* base;
+        Value* top;
+        int32_t dest;
+    };
+    struct Callee {
+        const Slot* entry;
+        int params, locals, registers;
+    };
+
+    const bc::Module& module;
+    std::vector<Slot> program;
+    std::vector<Callee> callees;
+    std::vector<Value> globals;
+    Value* stack = nullptr;
+    Frame* frames = nullptr;
+
+    // -------- strings --------
+    std::vector<Str*> literals;     // per Module::strings, never collected
+    Str* empty = nullptr;           // the "" literal: a read at the end of the input
+    std::vector<Str*> objects;      // everything allocated at run time
+    size_t allocated = 0;           // bytes in `objects`
+    size_t threshold = kMinHeap;
+    static Str* make(const std::string& s);
+    Str* allocate(size_t length, const Value* top);   // may collect; roots end at `top`
+    void collect(const Value* top);
+    Str* concat(const Value* parts, int n, const Value* top);
+
+    // -------- input / output --------
+    std::FILE* in = nullptr;
+    std::FILE* out = nullptr;
+    std::vector<char> outBuf, inBuf;
+    size_t outLen = 0, inPos = 0, inLen = 0;
+    std::string token;
+    void write(const char* s, size_t n);
+    void flush();
+    void printInt(int32_t v);
+    int readByte();                 // 0 … 255, -1 at the end of the input
+    int32_t readInt();
+    void readToken();               // into `token`
+
+    void thread(const void* const* handlers);   // handlers: null for the switch loop
+    const char* execute(int function);          // null, or the uncaught exception
+};
@@ -0,0 +1,124 @@
+// =============================================================
+// WorkStealingPool.hpp  —  fixed thread pool for per-function jobs
+// -------------------------------------------------------------
+//  • parallelFor(n, task) runs task(0..n-1) and blocks until all finish
+//  • every worker owns a deque seeded with a contiguous block of
+//    indices; it pops from its own back and steals from the front of
+//    the other workers' deques when it runs dry
+//  • the calling thread takes part as worker 0
+// =============================================================
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned workers) {
+        if (workers == 0) workers = 1;
+        for (unsigned i = 0; i < workers; ++i) queues.push_back(std::make_unique<Queue>());
+        for (unsigned i = 1; i < workers; ++i) threads.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned size() const { return unsigned(queues.size()); }
+
+    void parallelFor(size_t count, std::function<void(size_t)> task) {
+        if (count == 0) return;
+        job = std::move(task);
+        pending.store(count);
+
+        const size_t k = queues.size();
+        for (size_t w = 0; w < k; ++w) {
+            std::lock_guard<std::mutex> lock(queues[w]->m);
+            for (size_t i = w * count / k; i < (w + 1) * count / k; ++i) queues[w]->items.push_back(i);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m);
+            ++generation;
+        }
+        wake.notify_all();
+
+        drain(0);
+        std::unique_lock<std::mutex> lock(m);
+        done.wait(lock, [this] { return pending.load() == 0; });
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<size_t> items;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;   // [0] belongs to the calling thread
+    std::vector<std::thread> threads;
+
+    std::function<void(size_t)> job;
+    std::atomic<size_t> pending{0};
+
+    std::mutex m;
+    std::condition_variable wake, done;
+    size_t generation = 0;
+    bool stopping = false;
+
+    bool popLocal(size_t w, size_t& item) {
+        std::lock_guard<std::mutex> lock(queues[w]->m);
+        if (queues[w]->items.empty()) return false;
+        item = queues[w]->items.back();
+        queues[w]->items.pop_back();
+        return true;
+    }
+
+    bool steal(size_t w, size_t& item) {
+        for (size_t d = 1; d < queues.size(); ++d) {
+            Queue& victim = *queues[(w + d) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.m);
+            if (victim.items.empty()) continue;
+            item = victim.items.front();
+            victim.items.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void drain(size_t w) {
+        size_t item;
+        while (popLocal(w, item) || steal(w, item)) {
+            job(item);
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m);
+                done.notify_all();
+            }
+        }
+    }
+
+    void workerLoop(size_t w) {
+        size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            drain(w);
+        }
+    }
+};
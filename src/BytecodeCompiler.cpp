@@ -0,0 +1,869 @@
+#include "BytecodeCompiler.hpp"
+#include "CompilerOptions.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+using namespace ast;
+using bc::Cmp;
+using BcOp = bc::Op;
+
+namespace {
+
+// the value of an int / char / bool literal
+std::optional<int> constant(const Expr& e) {
+    if (auto* i = dynamic_cast<const IntLit*>(&e)) return i->value;
+    if (auto* c = dynamic_cast<const CharLit*>(&e)) return int(static_cast<unsigned char>(c->value));
+    if (auto* b = dynamic_cast<const BoolLit*>(&e)) return b->value ? 1 : 0;
+    return std::nullopt;
+}
+
+bool isComparison(Op op) {
+    return op == Op::Less || op == Op::LessEq || op == Op::Greater || op == Op::GreaterEq || op == Op::Equal ||
+           op == Op::NotEqual;
+}
+
+// strings compare references, and only for (in)equality, as in if_acmp<c>
+Cmp comparisonOf(const Binary& b) {
+    if (b.lhs->ty.kind == BasicType::String) return b.op == Op::NotEqual ? Cmp::Ne : Cmp::Eq;
+    switch (b.op) {
+        case Op::Less:      return Cmp::Lt;
+        case Op::LessEq:    return Cmp::Le;
+        case Op::Greater:   return Cmp::Gt;
+        case Op::GreaterEq: return Cmp::Ge;
+        case Op::NotEqual:  return Cmp::Ne;
+        default:            return Cmp::Eq;
+    }
+}
+
+// `e` changes a local while it is evaluated (x++), so an operand read
+// before it must be copied first
+bool hasPostfix(const Expr& e) {
+    if (dynamic_cast<const Postfix*>(&e)) return true;
+    if (auto* b = dynamic_cast<const Binary*>(&e)) return hasPostfix(*b->lhs) || hasPostfix(*b->rhs);
+    if (auto* u = dynamic_cast<const Unary*>(&e)) return hasPostfix(*u->rhs);
+    if (auto* c = dynamic_cast<const Call*>(&e))
+        return std::any_of(c->args.begin(), c->args.end(), [](const auto& a) { return hasPostfix(*a); });
+    return false;
+}
+
+// The operands of a chain a + b + c of strings, in evaluation order
+void concatOperands(Expr& e, std::vector<Expr*>& out) {
+    auto* b = dynamic_cast<Binary*>(&e);
+    if (b && b->op == Op::Plus && b->ty.kind == BasicType::String) {
+        concatOperands(*b->lhs, out);
+        concatOperands(*b->rhs, out);
+    } else {
+        out.push_back(&e);
+    }
+}
+
+bool isJump(BcOp op) { return op >= BcOp::Jump && op <= BcOp::IncJumpLeImm; }
+
+} // namespace
+
+bool BytecodeCompiler::compile(Program& program, bc::Module& out) {
+    m = &out;
+    problem.clear();
+    program.accept(*this);
+    if (problem.empty() && m->main < 0) problem = "no main function";
+    m = nullptr;
+    return problem.empty();
+}
+
+void BytecodeCompiler::unsupported(int line, const std::string& what) {
+    if (problem.empty()) problem = "line " + std::to_string(line) + ": " + what + " are not supported by --run";
+}
+
+bool BytecodeCompiler::scalar(const Type& t, int line) {
+    if (!t.dims.empty()) {
+        unsupported(line, "arrays");
+        return false;
+    }
+    if (t.kind == BasicType::Float || t.kind == BasicType::Double) {
+        unsupported(line, "reals");
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------
+// Program: functions are numbered first (calls may go forward), then
+// the globals get their start values; initializers that are not
+// literals run in a <clinit> function before main, in source order
+//---------------------------------------------------------------
+void BytecodeCompiler::visit(Program& p) {
+    std::vector<FuncDecl*> funcs;
+    for (auto& d : p.globals)
+        if (auto* f = dynamic_cast<FuncDecl*>(d.get())) funcs.push_back(f);
+    for (auto& s : p.stmts)
+        if (auto* f = dynamic_cast<FuncDecl*>(s.get())) funcs.push_back(f);
+    for (auto* f : funcs) {
+        functions.emplace(f->name, int(m->functions.size()));
+        m->functions.push_back(bc::Function{f->name});
+    }
+
+    Inits inits;
+    auto declare = [&](VarDecl* vd) {
+        const Type& t = vd->varType;
+        if (!t.dims.empty() || t.kind == BasicType::Float || t.kind == BasicType::Double) return;   // unsupported where used
+        bc::Global g;
+        g.string = t.kind == BasicType::String;
+        if (!vd->init) {
+        } else if (auto k = constant(*vd->init)) {
+            g.value = *k;
+        } else if (auto* s = dynamic_cast<StringLit*>(vd->init.get())) {
+            g.text = string(s->value);
+        } else {
+            inits.emplace_back(vd, vd->init.get());
+        }
+        globals.emplace(vd->name, int(m->globals.size()));
+        m->globals.push_back(g);
+    };
+    for (auto& d : p.globals) {
+        if (auto* vdl = dynamic_cast<VarDeclList*>(d.get())) {
+            for (auto& inner : vdl->decls) declare(inner.get());
+        } else if (auto* vd = dynamic_cast<VarDecl*>(d.get())) {
+            declare(vd);
+        }
+    }
+
+    if (!inits.empty()) {
+        m->init = int(m->functions.size());
+        m->functions.push_back(bc::Function{"<clinit>"});
+        function(m->init, nullptr, &inits);
+    }
+    for (auto* f : funcs) f->accept(*this);
+    auto main = functions.find("main");
+    m->main = main == functions.end() ? -1 : main->second;
+}
+
+void BytecodeCompiler::visit(FuncDecl& f) {
+    int index = functions.at(f.name);
+    bc::Function& fn = m->functions[size_t(index)];
+    fn.params = int(f.params.size());
+    fn.locals = std::max({f.localSlots, fn.params, f.name == "main" ? 1 : 0});
+    scalar(f.returnType, f.line);
+    for (auto& p : f.params) scalar(p->varType, p->line);
+    current = &f;
+    function(index, f.body.get(), nullptr);
+    current = nullptr;
+}
+
+// One body (and / or the global initializers) into `code`, then fused
+// and appended to the module with its jumps resolved
+void BytecodeCompiler::function(int index, Stmt* body, const Inits* inits) {
+    bc::Function& fn = m->functions[size_t(index)];
+    code.clear();
+    labelAt.clear();
+    labelUsed.clear();
+    switches.clear();
+    exits.clear();
+    top = high = fn.locals;
+    want = -1;
+    entry = -1;
+    if (current && current->name != "main" && (!options || options->enabled("tail-rec"))) {
+        entry = newLabel();
+        place(entry);
+    }
+
+    if (inits)
+        for (const auto& [vd, e] : *inits) {
+            store(vd->sym, vd->line, value(*e));
+            top = fn.locals;
+        }
+    if (body) body->accept(*this);
+    emit(BcOp::ReturnVoid);
+
+    if (!options || options->enabled("run.fuse")) fuse();
+    fn.registers = high;
+    fn.entry = int32_t(m->code.size());
+    resolve();
+}
+
+// AddImm r, r, k right before a Jump<cmp> on r that nothing else jumps
+// to → IncJump<cmp>: the latch of a counted loop is one dispatch
+void BytecodeCompiler::fuse() {
+    std::vector<char> target(code.size() + 1, 0);
+    for (size_t l = 0; l < labelAt.size(); ++l)
+        if (labelUsed[l] && labelAt[l] >= 0) target[size_t(labelAt[l])] = 1;
+
+    std::vector<int32_t> moved(code.size() + 1);
+    size_t out = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        moved[i] = int32_t(out);
+        bc::Insn in = code[i];
+        if (in.op == BcOp::AddImm && in.a == in.b && i + 1 < code.size() && !target[i + 1]) {
+            const bc::Insn& j = code[i + 1];
+            BcOp fused = bc::incJump(j.op);
+            if (fused != BcOp::Move && j.b == in.a) {
+                code[out++] = bc::Insn{fused, j.a, in.a, in.c, j.c};
+                moved[++i] = int32_t(out - 1);
+                continue;
+            }
+        }
+        code[out++] = in;
+    }
+    moved[code.size()] = int32_t(out);
+    code.resize(out);
+    for (auto& at : labelAt)
+        if (at >= 0) at = moved[size_t(at)];
+}
+
+void BytecodeCompiler::resolve() {
+    int32_t base = int32_t(m->code.size());
+    auto at = [&](int label) { return base + labelAt[size_t(label)]; };
+    for (bc::Insn in : code) {
+        if (isJump(in.op)) in.a = at(in.a);
+        m->code.push_back(in);
+    }
+    for (auto& pending : switches) {
+        bc::SwitchTable& t = m->switches[pending.table];
+        auto& cases = pending.cases;
+        std::sort(cases.begin(), cases.end());
+        t.dflt = at(pending.dflt);
+        if (cases.empty()) continue;
+        long long range = (long long)cases.back().first - cases.front().first + 1;
+        t.dense = range <= 3 * (long long)cases.size();     // a jump table no sparser than 1 in 3
+        t.low = cases.front().first;
+        if (t.dense) {
+            t.targets.assign(size_t(range), t.dflt);
+            for (auto& [v, label] : cases) t.targets[size_t((long long)v - t.low)] = at(label);
+        } else {
+            for (auto& [v, label] : cases) t.cases.emplace_back(v, at(label));
+        }
+    }
+}
+
+int BytecodeCompiler::newLabel() {
+    labelAt.push_back(-1);
+    labelUsed.push_back(0);
+    return int(labelAt.size()) - 1;
+}
+
+void BytecodeCompiler::place(int label) {
+    labelAt[size_t(label)] = int32_t(code.size());
+}
+
+void BytecodeCompiler::jumpTo(BcOp op, int label, int b, int c) {
+    labelUsed[size_t(label)] = 1;
+    emit(op, label, b, c);
+}
+
+int BytecodeCompiler::temp() {
+    high = std::max(high, top + 1);
+    return top++;
+}
+
+int BytecodeCompiler::dest() {
+    return want >= 0 ? want : temp();
+}
+
+// The register holding `e`: `into` when given, else a local's own
+// register or a temporary. Temporaries above the result are free again.
+int BytecodeCompiler::value(Expr& e, int into) {
+    int saved = std::exchange(want, into);
+    result = -1;
+    e.accept(*this);
+    want = saved;
+    int r = result;
+    if (r < 0) {                    // unsupported, already reported
+        r = into >= 0 ? into : temp();
+        emit(BcOp::Int, r, 0);
+    } else if (into >= 0 && r != into) {
+        emit(BcOp::Move, into, r);
+        r = into;
+    }
+    return r;
+}
+
+int BytecodeCompiler::string(const std::string& s) {
+    auto [it, added] = strings.emplace(s, int(m->strings.size()));
+    if (added) m->strings.push_back(s);
+    return it->second;
+}
+
+int BytecodeCompiler::global(const SymEntry& sym, int line) {
+    auto it = globals.find(sym.name);
+    if (it != globals.end()) return it->second;
+    if (scalar(sym.type, line)) unsupported(line, "globals of type " + sym.type.toString());
+    return 0;
+}
+
+int BytecodeCompiler::load(Var& v, int into) {
+    if (!scalar(v.sym.type, v.line)) return -1;
+    if (!v.sym.isGlobal) return v.sym.slot;
+    int r = into >= 0 ? into : temp();
+    emit(BcOp::GetGlobal, r, global(v.sym, v.line));
+    return r;
+}
+
+void BytecodeCompiler::store(const SymEntry& sym, int line, int reg) {
+    if (sym.isGlobal) emit(BcOp::PutGlobal, global(sym, line), reg);
+    else if (reg != sym.slot) emit(BcOp::Move, sym.slot, reg);
+}
+
+//---------------------------------------------------------------
+// Expressions
+//---------------------------------------------------------------
+void BytecodeCompiler::visit(IntLit& n) {
+    result = dest();
+    emit(BcOp::Int, result, n.value);
+}
+
+void BytecodeCompiler::visit(BoolLit& n) {
+    result = dest();
+    emit(BcOp::Int, result, n.value ? 1 : 0);
+}
+
+void BytecodeCompiler::visit(CharLit& n) {
+    result = dest();
+    emit(BcOp::Int, result, static_cast<unsigned char>(n.value));
+}
+
+void BytecodeCompiler::visit(RealLit& n) {
+    unsupported(n.line, "reals");
+}
+
+void BytecodeCompiler::visit(StringLit& n) {
+    result = dest();
+    emit(BcOp::Str, result, string(n.value));
+}
+
+void BytecodeCompiler::visit(Var& v) {
+    result = load(v, want);
+}
+
+void BytecodeCompiler::visit(Unary& u) {
+    int mark = top;
+    if (u.op == Op::Not) {
+        auto* b = dynamic_cast<Binary*>(u.rhs.get());
+        if (b && isComparison(b->op)) {
+            result = comparison(bc::negate(comparisonOf(*b)), *b->lhs, *b->rhs);
+        } else if (b && (b->op == Op::And || b->op == Op::Or)) {
+            boolean(u);
+        } else {
+            int r = value(*u.rhs);
+            top = mark;
+            result = dest();
+            emit(BcOp::Not, result, r);
+        }
+        return;
+    }
+    if (auto k = constant(*u.rhs)) {
+        result = dest();
+        emit(BcOp::Int, result, int(0u - uint32_t(*k)));
+        return;
+    }
+    int r = value(*u.rhs);
+    top = mark;
+    result = dest();
+    emit(BcOp::Neg, result, r);
+}
+
+void BytecodeCompiler::visit(Binary& b) {
+    if (isComparison(b.op)) {
+        result = comparison(comparisonOf(b), *b.lhs, *b.rhs);
+        return;
+    }
+    if (b.op == Op::And || b.op == Op::Or) {
+        boolean(b);
+        return;
+    }
+    if (b.op == Op::Plus && b.ty.kind == BasicType::String) {
+        concat(b);
+        return;
+    }
+
+    int mark = top;
+    if (b.op == Op::Plus || b.op == Op::Minus) {      // x ± k, k + x: one AddImm
+        Expr* x = b.lhs.get();
+        auto k = constant(*b.rhs);
+        if (!k && b.op == Op::Plus && (k = constant(*b.lhs))) x = b.rhs.get();
+        if (k) {
+            int r = value(*x);
+            top = mark;
+            result = dest();
+            emit(BcOp::AddImm, result, r, b.op == Op::Plus ? *k : int(0u - uint32_t(*k)));
+            return;
+        }
+    }
+    int l = value(*b.lhs, hasPostfix(*b.rhs) ? temp() : -1);
+    int r = value(*b.rhs);
+    top = mark;
+    result = dest();
+    BcOp op = BcOp::Add;
+    switch (b.op) {
+        case Op::Minus: op = BcOp::Sub; break;
+        case Op::Mul:   op = BcOp::Mul; break;
+        case Op::Div:   op = BcOp::Div; break;
+        case Op::Mod:   op = BcOp::Rem; break;
+        default:        break;
+    }
+    emit(op, result, l, r);
+}
+
+// a = lhs cmp rhs as 0 / 1
+int BytecodeCompiler::comparison(Cmp c, Expr& lhs, Expr& rhs) {
+    int mark = top;
+    int l = value(lhs, hasPostfix(rhs) ? temp() : -1);
+    int r = value(rhs);
+    top = mark;
+    int d = dest();
+    emit(bc::compare(c), d, l, r);
+    return d;
+}
+
+// The whole chain is one Concat of consecutive registers. With
+// const-fold on, adjacent literals are joined first and a chain of
+// literals only is one interned constant, as CodeGenVisitor::concat
+// does it.
+void BytecodeCompiler::concat(Binary& b) {
+    std::vector<Expr*> operands;
+    concatOperands(b, operands);
+
+    struct Part {
+        Expr*       expr;           // null: `text` is literal
+        std::string text;
+    };
+    std::vector<Part> parts;
+    bool folding = !options || options->enabled("const-fold");
+    for (Expr* e : operands) {
+        auto* lit = dynamic_cast<StringLit*>(e);
+        if (!lit || !folding) parts.push_back({e, {}});
+        else if (lit->value.empty()) continue;
+        else if (!parts.empty() && !parts.back().expr) parts.back().text += lit->value;
+        else parts.push_back({nullptr, lit->value});
+    }
+    if (parts.empty() || (parts.size() == 1 && !parts[0].expr)) {
+        result = dest();
+        emit(BcOp::Str, result, string(parts.empty() ? std::string() : parts[0].text));
+        return;
+    }
+
+    int first = top;
+    for (size_t k = 0; k < parts.size(); ++k) {
+        top = first + int(k);
+        int r = temp();
+        if (parts[k].expr) value(*parts[k].expr, r);
+        else emit(BcOp::Str, r, string(parts[k].text));
+    }
+    top = first;
+    result = dest();
+    emit(BcOp::Concat, result, first, int(parts.size()));
+}
+
+// x++ as a value: the old value, in a register other than x's
+void BytecodeCompiler::visit(Postfix& p) {
+    Var& v = *p.operand;
+    if (!scalar(v.sym.type, v.line)) return;
+    int delta = p.op == Op::Inc ? 1 : -1;
+    if (v.sym.isGlobal) {
+        int g = global(v.sym, v.line);
+        result = dest();
+        int mark = top;
+        int t = temp();
+        emit(BcOp::GetGlobal, result, g);
+        emit(BcOp::AddImm, t, result, delta);
+        emit(BcOp::PutGlobal, g, t);
+        top = mark;
+        return;
+    }
+    int r = v.sym.slot;
+    result = want >= 0 && want != r ? want : temp();
+    emit(BcOp::Move, result, r);
+    emit(BcOp::AddImm, r, r, delta);
+}
+
+// v += delta where the old value is not needed
+void BytecodeCompiler::step(Var& v, int delta) {
+    if (!scalar(v.sym.type, v.line)) return;
+    if (!v.sym.isGlobal) {
+        emit(BcOp::AddImm, v.sym.slot, v.sym.slot, delta);
+        return;
+    }
+    int g = global(v.sym, v.line);
+    int t = temp();
+    emit(BcOp::GetGlobal, t, g);
+    emit(BcOp::AddImm, t, t, delta);
+    emit(BcOp::PutGlobal, g, t);
+}
+
+// The arguments go to consecutive registers at the top; the callee's
+// window starts at the first of them
+void BytecodeCompiler::visit(Call& c) {
+    auto it = functions.find(c.callee);
+    if (it == functions.end()) {
+        unsupported(c.line, "calls of '" + c.callee + "'");
+        return;
+    }
+    int base = top;
+    for (size_t k = 0; k < c.args.size(); ++k) {
+        top = base + int(k);
+        value(*c.args[k], temp());
+    }
+    top = base;
+    result = dest();
+    emit(BcOp::Call, result, it->second, base);
+}
+
+// an assignment is a statement; it leaves no value
+void BytecodeCompiler::visit(Assign& a) {
+    const SymEntry& s = a.lhs->sym;
+    if (!scalar(s.type, a.line)) return;
+    int mark = top;
+    if (s.isGlobal) store(s, a.line, value(*a.rhs));
+    else value(*a.rhs, s.slot);
+    top = mark;
+}
+
+void BytecodeCompiler::visit(RangeExpr& r) {
+    unsupported(r.line, "ranges outside foreach");
+}
+
+//---------------------------------------------------------------
+// Conditions: jump to Ltrue when `e` holds, to Lfalse when it does
+// not; -1 means that outcome falls through
+//---------------------------------------------------------------
+void BytecodeCompiler::cond(Expr& e, int Ltrue, int Lfalse) {
+    if (auto* b = dynamic_cast<Binary*>(&e)) {
+        if (b->op == Op::And) {
+            int Lskip = Lfalse >= 0 ? Lfalse : newLabel();
+            cond(*b->lhs, -1, Lskip);
+            cond(*b->rhs, Ltrue, Lfalse);
+            if (Lfalse < 0) place(Lskip);
+            return;
+        }
+        if (b->op == Op::Or) {
+            int Lskip = Ltrue >= 0 ? Ltrue : newLabel();
+            cond(*b->lhs, Lskip, -1);
+            cond(*b->rhs, Ltrue, Lfalse);
+            if (Ltrue < 0) place(Lskip);
+            return;
+        }
+        if (isComparison(b->op)) {
+            compareJump(comparisonOf(*b), *b->lhs, *b->rhs, Ltrue, Lfalse);
+            return;
+        }
+    }
+    if (auto* u = dynamic_cast<Unary*>(&e); u && u->op == Op::Not) {
+        cond(*u->rhs, Lfalse, Ltrue);
+        return;
+    }
+    if (auto* lit = dynamic_cast<BoolLit*>(&e)) {
+        int to = lit->value ? Ltrue : Lfalse;
+        if (to >= 0) jumpTo(BcOp::Jump, to);
+        return;
+    }
+    int mark = top;
+    int r = value(e);
+    top = mark;
+    if (Ltrue < 0) {
+        jumpTo(BcOp::JumpFalse, Lfalse, r);
+        return;
+    }
+    jumpTo(BcOp::JumpTrue, Ltrue, r);
+    if (Lfalse >= 0) jumpTo(BcOp::Jump, Lfalse);
+}
+
+// Jump<cmp> on two registers, or Jump<cmp>Imm when one side is a
+// literal int / char / bool
+void BytecodeCompiler::compareJump(Cmp c, Expr& lhs, Expr& rhs, int Ltrue, int Lfalse) {
+    int mark = top;
+    bool imm = false;
+    int l = 0, r = 0;
+    if (lhs.ty.kind != BasicType::String) {
+        if (auto k = constant(rhs)) {
+            l = value(lhs);
+            r = *k;
+            imm = true;
+        } else if ((k = constant(lhs))) {
+            l = value(rhs);
+            r = *k;
+            c = bc::mirror(c);
+            imm = true;
+        }
+    }
+    if (!imm) {
+        l = value(lhs, hasPostfix(rhs) ? temp() : -1);
+        r = value(rhs);
+    }
+    top = mark;
+    auto op = [&](Cmp k) { return imm ? bc::jumpImm(k) : bc::jump(k); };
+    if (Ltrue < 0) {
+        jumpTo(op(bc::negate(c)), Lfalse, l, r);
+        return;
+    }
+    jumpTo(op(c), Ltrue, l, r);
+    if (Lfalse >= 0) jumpTo(BcOp::Jump, Lfalse);
+}
+
+// && / || where a value is needed: 0 / 1 after the jumps
+void BytecodeCompiler::boolean(Expr& e) {
+    int d = dest();
+    int Ltrue = newLabel(), Lend = newLabel();
+    cond(e, Ltrue, -1);
+    emit(BcOp::Int, d, 0);
+    jumpTo(BcOp::Jump, Lend);
+    place(Ltrue);
+    emit(BcOp::Int, d, 1);
+    place(Lend);
+    result = d;
+}
+
+//---------------------------------------------------------------
+// Statements
+//---------------------------------------------------------------
+void BytecodeCompiler::print(Expr& e, bool newline) {
+    int mark = top;
+    if (auto* s = dynamic_cast<StringLit*>(&e)) {
+        emit(BcOp::PrintConst, string(s->value), newline);
+        return;
+    }
+    int r = value(e);
+    top = mark;
+    switch (e.ty.kind) {
+        case BasicType::Bool:   emit(BcOp::PrintBool, r, newline); break;
+        case BasicType::String: emit(BcOp::PrintStr, r, newline); break;
+        default:                emit(BcOp::PrintInt, r, newline); break;   // chars print as ints
+    }
+}
+
+void BytecodeCompiler::visit(Print& p) {
+    print(*p.expr, false);
+}
+
+void BytecodeCompiler::visit(Println& p) {
+    print(*p.expr, true);
+}
+
+void BytecodeCompiler::visit(Read& r) {
+    Var& v = *r.var;
+    if (!scalar(v.sym.type, v.line)) return;
+    BcOp op = BcOp::ReadInt;
+    switch (v.ty.kind) {
+        case BasicType::Bool:   op = BcOp::ReadBool; break;
+        case BasicType::Char:   op = BcOp::ReadChar; break;
+        case BasicType::String: op = BcOp::ReadStr; break;
+        default:                break;
+    }
+    int mark = top;
+    int d = v.sym.isGlobal ? temp() : v.sym.slot;
+    emit(op, d);
+    store(v.sym, v.line, d);
+    top = mark;
+}
+
+void BytecodeCompiler::visit(Block& b) {
+    int mark = top;
+    for (auto& s : b.stmts) {
+        s->accept(*this);
+        top = mark;
+    }
+}
+
+void BytecodeCompiler::visit(IfStmt& s) {
+    int Lelse = newLabel();
+    cond(*s.cond, -1, Lelse);
+    s.thenStmt->accept(*this);
+    if (!s.elseStmt) {
+        place(Lelse);
+        return;
+    }
+    int Lend = newLabel();
+    jumpTo(BcOp::Jump, Lend);
+    place(Lelse);
+    s.elseStmt->accept(*this);
+    place(Lend);
+}
+
+void BytecodeCompiler::visit(WhileStmt& s) {
+    loop(s.cond.get(), s.body.get(), nullptr);
+}
+
+void BytecodeCompiler::visit(ForStmt& s) {
+    int mark = top;
+    if (s.init) s.init->accept(*this);
+    top = mark;
+    loop(s.cond.get(), s.body.get(), s.step.get());
+}
+
+// test once to enter, then at the bottom:
+//   if (!c) goto end; body: …; cont: step; if (c) goto body; end:
+void BytecodeCompiler::loop(Expr* c, Stmt* body, Stmt* stepStmt) {
+    int Lbody = newLabel(), Lcont = newLabel(), Lend = newLabel();
+    if (c) cond(*c, -1, Lend);
+    place(Lbody);
+    exits.push_back({Lend, Lcont});
+    if (body) body->accept(*this);
+    exits.pop_back();
+    place(Lcont);
+    if (stepStmt) stepStmt->accept(*this);
+    if (c) cond(*c, Lbody, -1);
+    else jumpTo(BcOp::Jump, Lbody);
+    place(Lend);
+}
+
+// foreach (i : a .. b) walks a→b inclusive, upwards or downwards, with
+// a and b evaluated once. Constant bounds fix the direction here;
+// otherwise it is decided once at run time, as in the JVM code:
+//   flip = a <= b ? 0 : -1, step = flip | 1, bound = b ^ flip,
+//   and the loop goes on while (i ^ flip) <= bound
+void BytecodeCompiler::visit(ForEachStmt& s) {
+    auto* range = dynamic_cast<RangeExpr*>(s.collection.get());
+    if (!range) {
+        unsupported(s.line, "foreach loops over arrays");
+        return;
+    }
+    Var& i = *s.var;
+    if (!scalar(i.sym.type, i.line)) return;
+    int mark = top;
+    int Lbody = newLabel(), Lnext = newLabel(), Lend = newLabel();
+    auto body = [&]() {
+        place(Lbody);
+        exits.push_back({Lend, Lnext});
+        s.body->accept(*this);
+        exits.pop_back();
+        place(Lnext);
+    };
+    // i's register after i += delta (or += register delta when reg)
+    auto advance = [&](int delta, bool reg) {
+        int r = i.sym.isGlobal ? temp() : i.sym.slot;
+        if (i.sym.isGlobal) emit(BcOp::GetGlobal, r, global(i.sym, i.line));
+        emit(reg ? BcOp::Add : BcOp::AddImm, r, r, delta);
+        store(i.sym, i.line, r);
+        return r;
+    };
+
+    auto lo = constant(*range->start), hi = constant(*range->end);
+    if (lo && hi) {
+        bool up = *lo <= *hi;
+        int r = i.sym.isGlobal ? temp() : i.sym.slot;
+        emit(BcOp::Int, r, *lo);
+        store(i.sym, i.line, r);
+        top = mark;
+        body();
+        int at = advance(up ? 1 : -1, false);
+        jumpTo(bc::jumpImm(up ? Cmp::Le : Cmp::Ge), Lbody, at, *hi);
+        place(Lend);
+        top = mark;
+        return;
+    }
+
+    int bound = temp(), flip = temp(), stepReg = temp();
+    store(i.sym, i.line, value(*range->start, i.sym.isGlobal ? -1 : i.sym.slot));
+    value(*range->end, bound);
+    int Lup = newLabel();
+    int at = load(i, temp());
+    emit(BcOp::Int, flip, 0);
+    jumpTo(BcOp::JumpLe, Lup, at, bound);
+    emit(BcOp::Int, flip, -1);
+    place(Lup);
+    emit(BcOp::Add, stepReg, flip, flip);
+    emit(BcOp::AddImm, stepReg, stepReg, 1);
+    emit(BcOp::Xor, bound, bound, flip);
+    top = stepReg + 1;
+    body();
+    at = advance(stepReg, true);
+    int t = temp();
+    emit(BcOp::Xor, t, at, flip);
+    jumpTo(BcOp::JumpLe, Lbody, t, bound);
+    place(Lend);
+    top = mark;
+}
+
+// Switch dispatches through a table; an arm ends with a jump past the
+// others (no fall-through)
+void BytecodeCompiler::visit(SwitchStmt& s) {
+    int mark = top;
+    int r = value(*s.cond);
+    top = mark;
+    int Lend = newLabel();
+    PendingSwitch pending{m->switches.size(), {}, Lend};
+    m->switches.emplace_back();
+    std::vector<int> arms;
+    for (auto& c : s.cases) {
+        arms.push_back(newLabel());
+        labelUsed[size_t(arms.back())] = 1;
+        if (c.isDefault) pending.dflt = arms.back();
+        for (int v : c.values) pending.cases.emplace_back(v, arms.back());
+    }
+    labelUsed[size_t(pending.dflt)] = 1;
+    emit(BcOp::Switch, int(pending.table), r);
+    switches.push_back(std::move(pending));
+
+    exits.push_back({Lend, exits.empty() ? -1 : exits.back().cont});   // break leaves the switch
+    for (size_t k = 0; k < s.cases.size(); ++k) {
+        place(arms[k]);
+        s.cases[k].body->accept(*this);
+        jumpTo(BcOp::Jump, Lend);
+    }
+    exits.pop_back();
+    place(Lend);
+}
+
+void BytecodeCompiler::visit(BreakStmt&) {
+    if (!exits.empty()) jumpTo(BcOp::Jump, exits.back().brk);
+}
+
+void BytecodeCompiler::visit(ContinueStmt&) {
+    if (!exits.empty() && exits.back().cont >= 0) jumpTo(BcOp::Jump, exits.back().cont);
+}
+
+void BytecodeCompiler::visit(ReturnStmt& s) {
+    if (tailCall(s)) return;
+    if (!s.expr) {
+        emit(BcOp::ReturnVoid);
+        return;
+    }
+    emit(BcOp::Return, value(*s.expr));
+}
+
+// `return f(...)` in f: the arguments go to temporaries first, since
+// one may read a parameter another overwrites, then the parameters take
+// them and the body starts over in the same window
+bool BytecodeCompiler::tailCall(ReturnStmt& s) {
+    auto* c = dynamic_cast<Call*>(s.expr.get());
+    if (!c || entry < 0 || c->callee != current->name) return false;
+    int base = top;
+    for (size_t k = 0; k < c->args.size(); ++k) {
+        top = base + int(k);
+        value(*c->args[k], temp());
+    }
+    for (size_t k = 0; k < c->args.size(); ++k) emit(BcOp::Move, current->params[k]->sym.slot, base + int(k));
+    top = base;
+    jumpTo(BcOp::Jump, entry);
+    return true;
+}
+
+void BytecodeCompiler::visit(ExprStmt& s) {
+    if (!s.expr) return;
+    int mark = top;
+    if (auto* p = dynamic_cast<Postfix*>(s.expr.get())) step(*p->operand, p->op == Op::Inc ? 1 : -1);
+    else if (auto* a = dynamic_cast<Assign*>(s.expr.get())) a->accept(*this);
+    else value(*s.expr);
+    top = mark;
+}
+
+void BytecodeCompiler::visit(EmptyStmt&) {}
+
+void BytecodeCompiler::visit(DeclList& dl) {
+    for (auto& d : dl.decls) d->accept(*this);
+}
+
+void BytecodeCompiler::visit(VarDecl& d) {
+    if (!scalar(d.varType, d.line) || !d.init) return;
+    int mark = top;
+    if (d.sym.isGlobal) store(d.sym, d.line, value(*d.init));
+    else value(*d.init, d.sym.slot);
+    top = mark;
+}
+
+void BytecodeCompiler::visit(VarDeclList& dl) {
+    for (auto& d : dl.decls) d->accept(*this);
+}
+
+void BytecodeCompiler::visit(ConstDecl& d) {
+    visit(static_cast<VarDecl&>(d));
+}
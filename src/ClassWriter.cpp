@@ -0,0 +1,656 @@
+#include "ClassWriter.hpp"
+#include "StackMap.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+void u1(std::vector<uint8_t>& o, unsigned v) { o.push_back(uint8_t(v)); }
+void u2(std::vector<uint8_t>& o, unsigned v) {
+    o.push_back(uint8_t(v >> 8));
+    o.push_back(uint8_t(v));
+}
+void u4(std::vector<uint8_t>& o, uint32_t v) {
+    u2(o, v >> 16);
+    u2(o, v & 0xFFFF);
+}
+
+// constant pool tags
+enum : uint8_t { Utf8 = 1, Integer = 3, Double = 6, Class = 7, String = 8, Fieldref = 9, Methodref = 10, NameAndType = 12 };
+
+constexpr uint8_t kGotoW = 0xc8, kLdcW = 0x13, kWide = 0xc4;
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+    while (!s.empty() && s.back() == ' ') s.remove_suffix(1);
+    return s;
+}
+
+// "java.lang.String" → "java/lang/String"
+std::string internalName(std::string_view jasmName) {
+    std::string s(jasmName);
+    std::replace(s.begin(), s.end(), '.', '/');
+    return s;
+}
+
+// a quoted Jasmin operand → the characters it stands for
+std::string unescape(std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 == s.size()) {
+            out += s[i];
+            continue;
+        }
+        switch (char c = s[++i]) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case '0': out += '\0'; break;
+            default:  out += c;    break;      // \" \' \\ and unknown escapes: the character itself
+        }
+    }
+    return out;
+}
+
+// UTF-8 → the class file's modified UTF-8: NUL takes two bytes and a
+// character above U+FFFF becomes its surrogate pair; a byte that does
+// not start a valid sequence stands for itself (Latin-1)
+void modifiedUtf8(std::string_view s, std::vector<uint8_t>& o) {
+    auto put = [&](uint32_t c) {
+        if (c != 0 && c < 0x80) {
+            u1(o, c);
+        } else if (c < 0x800) {
+            u1(o, 0xC0 | (c >> 6));
+            u1(o, 0x80 | (c & 0x3F));
+        } else {
+            u1(o, 0xE0 | (c >> 12));
+            u1(o, 0x80 | ((c >> 6) & 0x3F));
+            u1(o, 0x80 | (c & 0x3F));
+        }
+    };
+    for (size_t i = 0; i < s.size();) {
+        uint8_t b = uint8_t(s[i]);
+        size_t extra = b >= 0xF0 && b < 0xF8 ? 3 : b >= 0xE0 && b < 0xF0 ? 2 : b >= 0xC0 && b < 0xE0 ? 1 : 0;
+        uint32_t c = extra ? b & (0x3Fu >> extra) : b;
+        bool valid = i + extra < s.size();
+        for (size_t k = 1; valid && k <= extra; ++k) {
+            valid = (uint8_t(s[i + k]) & 0xC0) == 0x80;
+            c = c << 6 | (uint8_t(s[i + k]) & 0x3F);
+        }
+        if (!valid) c = b, extra = 0;
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            put(0xD800 + (c >> 10));
+            put(0xDC00 + (c & 0x3FF));
+        } else {
+            put(c);
+        }
+        i += 1 + extra;
+    }
+}
+
+uint16_t accessFlag(std::string_view word) {
+    if (word == "public")  return 0x0001;
+    if (word == "private") return 0x0002;
+    if (word == "static")  return 0x0008;
+    if (word == "final")   return 0x0010;
+    return 0;
+}
+
+// newarray operand → its atype code
+int arrayType(std::string_view elem) {
+    static constexpr std::pair<std::string_view, int> kinds[] = {
+        {"boolean", 4}, {"char", 5}, {"float", 6}, {"double", 7},
+        {"byte", 8}, {"short", 9}, {"int", 10}, {"long", 11}};
+    for (auto& [name, code] : kinds)
+        if (name == elem) return code;
+    return 0;
+}
+
+// iload / aload / istore / astore with slot n ≤ 3 have one-byte forms
+uint8_t shortForm(Opcode op, int slot) {
+    switch (op) {
+        case Opcode::iload:  return uint8_t(0x1a + slot);
+        case Opcode::aload:  return uint8_t(0x2a + slot);
+        case Opcode::istore: return uint8_t(0x3b + slot);
+        default:             return uint8_t(0x4b + slot);   // astore
+    }
+}
+
+} // namespace
+
+//---------------------------------------------------------------
+// Jasmin names → descriptors
+//---------------------------------------------------------------
+std::string classfile::descriptor(std::string_view jasmType) {
+    static constexpr std::pair<std::string_view, char> primitives[] = {
+        {"int", 'I'}, {"boolean", 'Z'}, {"char", 'C'}, {"byte", 'B'}, {"short", 'S'},
+        {"long", 'J'}, {"float", 'F'}, {"double", 'D'}, {"void", 'V'}};
+    std::string_view t = trim(jasmType);
+    std::string d;
+    while (t.size() >= 2 && t.substr(t.size() - 2) == "[]") {
+        d += '[';
+        t = trim(t.substr(0, t.size() - 2));
+    }
+    for (auto& [name, code] : primitives)
+        if (name == t) return d += code;
+    return d.append("L").append(internalName(t)).append(";");
+}
+
+std::string classfile::methodDescriptor(std::string_view params, std::string_view returnType) {
+    params = trim(params);
+    if (!params.empty() && params.front() == '(') params.remove_prefix(1);
+    if (!params.empty() && params.back() == ')') params.remove_suffix(1);
+    std::string d = "(";
+    while (!params.empty()) {
+        size_t comma = params.find(',');
+        std::string_view p = trim(params.substr(0, comma));
+        if (!p.empty()) d += descriptor(p);
+        params = comma == std::string_view::npos ? std::string_view() : params.substr(comma + 1);
+    }
+    return d.append(")").append(descriptor(returnType));
+}
+
+bool classfile::parseMember(std::string_view text, MemberRef& out) {
+    text = trim(text);
+    size_t space = text.find(' ');
+    if (space == std::string_view::npos) return false;
+    std::string_view type = text.substr(0, space), rest = trim(text.substr(space + 1));
+    size_t open = rest.find('(');
+    std::string_view qualified = rest.substr(0, open);
+    size_t dot = qualified.rfind('.');
+    if (dot == std::string_view::npos) return false;
+    out.owner = internalName(qualified.substr(0, dot));
+    out.name = std::string(qualified.substr(dot + 1));
+    out.descriptor = open == std::string_view::npos ? descriptor(type) : methodDescriptor(rest.substr(open), type);
+    return true;
+}
+
+//---------------------------------------------------------------
+// collecting the class
+//---------------------------------------------------------------
+void ClassWriter::field(std::string_view type, std::string_view name, Constant value) {
+    fields.push_back({std::string(name), classfile::descriptor(type), std::move(value)});
+}
+
+void ClassWriter::method(std::string_view signature, int maxStack, int maxLocals, const MethodCode& code) {
+    Method& m = methods.emplace_back();
+    size_t open = signature.find('(');
+    std::string_view head = trim(signature.substr(0, open));
+    // flags..., return type, name
+    size_t last = head.rfind(' ');
+    m.name = std::string(head.substr(last + 1));
+    head = trim(head.substr(0, last == std::string_view::npos ? 0 : last));
+    last = head.rfind(' ');
+    std::string_view returnType = head.substr(last + 1);
+    for (head = head.substr(0, last == std::string_view::npos ? 0 : last); !head.empty();) {
+        size_t space = head.find(' ');
+        m.flags |= accessFlag(head.substr(0, space));
+        head = space == std::string_view::npos ? std::string_view() : trim(head.substr(space));
+    }
+    m.descriptor = classfile::methodDescriptor(open == std::string_view::npos ? "()" : signature.substr(open), returnType);
+    m.maxStack = maxStack;
+    m.maxLocals = maxLocals;
+    m.code = code.instrs();
+    m.tables = code.switches();
+    for (Instr& i : m.code) {
+        if (!i.text.empty()) i.text = m.texts.emplace_back(i.text);
+        if (!i.isLabel) ++instrCount;
+    }
+}
+
+void ClassWriter::adopt(ClassWriter&& other) {
+    for (auto& f : other.fields) fields.push_back(std::move(f));
+    for (auto& m : other.methods) methods.push_back(std::move(m));
+    instrCount += other.instrCount;
+    other.fields.clear();
+    other.methods.clear();
+    other.instrCount = 0;
+}
+
+//---------------------------------------------------------------
+// constant pool
+//---------------------------------------------------------------
+uint16_t ClassWriter::entry(uint8_t tag, const std::vector<uint8_t>& payload) {
+    std::string key(1, char(tag));
+    key.append(payload.begin(), payload.end());
+    auto [it, fresh] = entries.try_emplace(std::move(key), uint16_t(poolCount));
+    if (!fresh) return it->second;
+    pool.push_back(tag);
+    pool.insert(pool.end(), payload.begin(), payload.end());
+    poolCount += tag == Double ? 2 : 1;     // 8-byte constants take two indices
+    return it->second;
+}
+
+uint16_t ClassWriter::utf8(std::string_view s) {
+    std::vector<uint8_t> p{0, 0};
+    modifiedUtf8(s, p);
+    size_t n = p.size() - 2;
+    p[0] = uint8_t(n >> 8);
+    p[1] = uint8_t(n);
+    return entry(Utf8, p);
+}
+
+uint16_t ClassWriter::classRef(std::string_view internal) {
+    std::vector<uint8_t> p;
+    u2(p, utf8(internal));
+    return entry(Class, p);
+}
+
+uint16_t ClassWriter::string(std::string_view s) {
+    std::vector<uint8_t> p;
+    u2(p, utf8(s));
+    return entry(String, p);
+}
+
+uint16_t ClassWriter::integer(int v) {
+    std::vector<uint8_t> p;
+    u4(p, uint32_t(v));
+    return entry(Integer, p);
+}
+
+uint16_t ClassWriter::doubleConst(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    std::vector<uint8_t> p;
+    u4(p, uint32_t(bits >> 32));
+    u4(p, uint32_t(bits));
+    return entry(Double, p);
+}
+
+uint16_t ClassWriter::nameAndType(std::string_view name, std::string_view descriptor) {
+    std::vector<uint8_t> p;
+    u2(p, utf8(name));
+    u2(p, utf8(descriptor));
+    return entry(NameAndType, p);
+}
+
+uint16_t ClassWriter::member(uint8_t tag, std::string_view jasmRef, std::string& err) {
+    classfile::MemberRef ref;
+    if (!classfile::parseMember(jasmRef, ref)) {
+        err = "malformed reference '" + std::string(jasmRef) + "'";
+        return 0;
+    }
+    std::vector<uint8_t> p;
+    u2(p, classRef(ref.owner));
+    u2(p, nameAndType(ref.name, ref.descriptor));
+    return entry(tag, p);
+}
+
+//---------------------------------------------------------------
+// method_info with its Code and StackMapTable attributes
+//---------------------------------------------------------------
+bool ClassWriter::encode(const Method& m, std::vector<uint8_t>& out, std::string& err) {
+    const std::vector<Instr>& code = m.code;
+    auto fail = [&] {
+        err = m.name + m.descriptor + ": " + err;
+        return false;
+    };
+    StackMap map;
+    if (!map.run(code, m.tables, m.descriptor, m.maxLocals, err)) return fail();
+
+    // what survives: labels and reachable instructions, each with its
+    // pool index (or newarray type) resolved up front, because ldc's
+    // size depends on it
+    struct Item {
+        size_t   index;
+        uint16_t cp = 0;
+        bool     far = false;       // branch widened to goto_w
+        uint32_t at = 0;
+    };
+    std::vector<Item> items;
+    items.reserve(code.size());
+    int maxLabel = -1;
+    for (size_t i = 0; i < code.size(); ++i) {
+        const Instr& in = code[i];
+        if (in.isLabel) {
+            maxLabel = std::max(maxLabel, in.a);
+            items.push_back({i});
+            continue;
+        }
+        if (!map.at(i)) continue;
+        Item it{i};
+        switch (in.op) {
+            case Opcode::getstatic: case Opcode::putstatic:
+                it.cp = member(Fieldref, in.text, err);
+                break;
+            case Opcode::invokestatic: case Opcode::invokevirtual: case Opcode::invokespecial:
+                it.cp = member(Methodref, in.text, err);
+                break;
+            case Opcode::new_:
+                it.cp = classRef(internalName(in.text));
+                break;
+            case Opcode::anewarray: {
+                std::string d = classfile::descriptor(in.text);     // "Ljava/lang/String;" or "[I"
+                it.cp = classRef(d[0] == 'L' ? std::string_view(d).substr(1, d.size() - 2) : std::string_view(d));
+                break;
+            }
+            case Opcode::newarray:
+                it.cp = uint16_t(arrayType(in.text));
+                if (!it.cp) err = "newarray of unknown type '" + std::string(in.text) + "'";
+                break;
+            case Opcode::ldc:
+                if (in.kind == OperandKind::String) it.cp = string(unescape(in.text));
+                else if (in.kind == OperandKind::Ref) it.cp = integer(in.text.size() > 1 ? uint8_t(in.text[1]) : 0);   // 'c'
+                else it.cp = integer(in.a);
+                break;
+            case Opcode::ldc2_w:
+                it.cp = doubleConst(std::strtod(std::string(in.text).c_str(), nullptr));
+                break;
+            default:
+                break;
+        }
+        if (!err.empty()) return fail();
+        items.push_back(it);
+    }
+
+    // layout: sizes depend on offsets (switch padding) and offsets on
+    // sizes (far branches), so lay out again until no branch widens
+    std::vector<uint32_t> labelAt(size_t(maxLabel + 1), 0);
+    auto size = [&](const Item& it, uint32_t at) -> uint32_t {
+        const Instr& in = code[it.index];
+        if (in.isLabel) return 0;
+        switch (in.kind) {
+            case OperandKind::Target:
+                return !it.far ? 3 : in.op == Opcode::goto_ ? 5 : 8;
+            case OperandKind::Switch: {
+                uint32_t n = uint32_t(m.tables[size_t(in.a)].targets.size());
+                return 1 + (3 - at % 4) + (in.op == Opcode::tableswitch ? 12 + 4 * n : 8 + 8 * n);
+            }
+            case OperandKind::Iinc:
+                return in.a <= 255 && in.b >= -128 && in.b <= 127 ? 3 : 6;
+            default:
+                break;
+        }
+        switch (in.op) {
+            case Opcode::iload: case Opcode::aload: case Opcode::istore: case Opcode::astore:
+                return in.a <= 3 ? 1 : in.a <= 255 ? 2 : 4;
+            case Opcode::bipush: case Opcode::newarray:
+                return 2;
+            case Opcode::ldc:
+                return it.cp <= 255 ? 2 : 3;
+            case Opcode::sipush: case Opcode::ldc2_w: case Opcode::getstatic: case Opcode::putstatic:
+            case Opcode::invokestatic: case Opcode::invokevirtual: case Opcode::invokespecial:
+            case Opcode::new_: case Opcode::anewarray:
+                return 3;
+            default:
+                return 1;
+        }
+    };
+    uint32_t length = 0;
+    for (bool widened = true; widened;) {
+        length = 0;
+        for (Item& it : items) {
+            it.at = length;
+            if (code[it.index].isLabel) labelAt[size_t(code[it.index].a)] = length;
+            length += size(it, length);
+        }
+        widened = false;
+        for (Item& it : items) {
+            const Instr& in = code[it.index];
+            if (!in.isBranch() || it.far) continue;
+            long d = long(labelAt[size_t(in.a)]) - long(it.at);
+            if (d < -32768 || d > 32767) it.far = widened = true;
+        }
+    }
+    if (length > 65535) {
+        err = "code is " + std::to_string(length) + " bytes, over the 65535 limit";
+        return fail();
+    }
+
+    // bytecode
+    std::vector<uint8_t> bc;
+    bc.reserve(length);
+    std::vector<uint32_t> offsetOf(code.size(), 0);
+    std::vector<uint32_t> frameAt;      // offsets that need a frame
+    for (const Item& it : items) {
+        const Instr& in = code[it.index];
+        if (in.isLabel) continue;
+        offsetOf[it.index] = it.at;
+        auto rel = [&](Label l) { return uint32_t(int32_t(labelAt[size_t(l.id)]) - int32_t(it.at)); };
+        uint8_t op = uint8_t(in.op);
+        switch (in.kind) {
+            case OperandKind::Target:
+                frameAt.push_back(labelAt[size_t(in.a)]);
+                if (!it.far) {
+                    u1(bc, op);
+                    u2(bc, rel(in.target()));
+                } else if (in.op == Opcode::goto_) {
+                    u1(bc, kGotoW);
+                    u4(bc, rel(in.target()));
+                } else {                // inverted test over the goto_w; what follows is a jump target now
+                    u1(bc, uint8_t(negateBranch(in.op)));
+                    u2(bc, 8);
+                    u1(bc, kGotoW);
+                    u4(bc, rel(in.target()) - 3);
+                    frameAt.push_back(it.at + 8);
+                }
+                continue;
+            case OperandKind::Switch: {
+                const SwitchTable& t = m.tables[size_t(in.a)];
+                u1(bc, op);
+                while (bc.size() % 4) u1(bc, 0);
+                u4(bc, rel(t.dflt));
+                frameAt.push_back(labelAt[size_t(t.dflt.id)]);
+                if (in.op == Opcode::tableswitch) {
+                    u4(bc, uint32_t(t.low));
+                    u4(bc, uint32_t(t.low + int(t.targets.size()) - 1));
+                } else {
+                    u4(bc, uint32_t(t.targets.size()));
+                }
+                for (size_t k = 0; k < t.targets.size(); ++k) {
+                    if (in.op == Opcode::lookupswitch) u4(bc, uint32_t(t.keys[k]));
+                    u4(bc, rel(t.targets[k]));
+                    frameAt.push_back(labelAt[size_t(t.targets[k].id)]);
+                }
+                continue;
+            }
+            case OperandKind::Iinc:
+                if (in.a <= 255 && in.b >= -128 && in.b <= 127) {
+                    u1(bc, op);
+                    u1(bc, unsigned(in.a));
+                    u1(bc, uint8_t(int8_t(in.b)));
+                } else {
+                    u1(bc, kWide);
+                    u1(bc, op);
+                    u2(bc, unsigned(in.a));
+                    u2(bc, uint16_t(int16_t(in.b)));
+                }
+                continue;
+            default:
+                break;
+        }
+        switch (in.op) {
+            case Opcode::iload: case Opcode::aload: case Opcode::istore: case Opcode::astore:
+                if (in.a <= 3) {
+                    u1(bc, shortForm(in.op, in.a));
+                } else if (in.a <= 255) {
+                    u1(bc, op);
+                    u1(bc, unsigned(in.a));
+                } else {
+                    u1(bc, kWide);
+                    u1(bc, op);
+                    u2(bc, unsigned(in.a));
+                }
+                break;
+            case Opcode::bipush:
+                u1(bc, op);
+                u1(bc, uint8_t(int8_t(in.a)));
+                break;
+            case Opcode::sipush:
+                u1(bc, op);
+                u2(bc, uint16_t(int16_t(in.a)));
+                break;
+            case Opcode::newarray:
+                u1(bc, op);
+                u1(bc, it.cp);
+                break;
+            case Opcode::ldc:
+                if (it.cp <= 255) {
+                    u1(bc, op);
+                    u1(bc, it.cp);
+                } else {
+                    u1(bc, kLdcW);
+                    u2(bc, it.cp);
+                }
+                break;
+            case Opcode::ldc2_w: case Opcode::getstatic: case Opcode::putstatic:
+            case Opcode::invokestatic: case Opcode::invokevirtual: case Opcode::invokespecial:
+            case Opcode::new_: case Opcode::anewarray:
+                u1(bc, op);
+                u2(bc, it.cp);
+                break;
+            default:
+                u1(bc, op);
+                break;
+        }
+    }
+
+    // StackMapTable: one frame per jump target, each the state on entry
+    // of the instruction there, written relative to the frame before it
+    std::sort(frameAt.begin(), frameAt.end());
+    frameAt.erase(std::unique(frameAt.begin(), frameAt.end()), frameAt.end());
+    auto localsOf = [](const Frame& f) {
+        std::vector<VType> l;
+        for (size_t k = 0; k < f.locals.size(); ++k) {
+            l.push_back(f.locals[k]);
+            if (f.locals[k].tag == VType::Double || f.locals[k].tag == VType::Long) ++k;    // one entry, two slots
+        }
+        while (!l.empty() && l.back().tag == VType::Top) l.pop_back();
+        return l;
+    };
+    auto type = [&](std::vector<uint8_t>& o, const VType& t) {
+        u1(o, t.tag);
+        if (t.tag == VType::Object) u2(o, classRef(t.name));
+        else if (t.tag == VType::Uninitialized) u2(o, offsetOf[size_t(t.at)]);
+    };
+    std::vector<uint8_t> table;
+    std::vector<VType> prev = localsOf(map.initial());
+    long prevAt = -1;
+    size_t frames = 0, next = 0;
+    for (const Item& it : items) {
+        if (code[it.index].isLabel) continue;
+        while (next < frameAt.size() && frameAt[next] < it.at) ++next;
+        if (next == frameAt.size()) break;
+        if (frameAt[next] != it.at) continue;
+        const Frame& f = *map.at(it.index);
+        std::vector<VType> locals = localsOf(f);
+        unsigned delta = unsigned(long(it.at) - prevAt - 1);
+        size_t common = 0;
+        while (common < locals.size() && common < prev.size() && locals[common] == prev[common]) ++common;
+        if (f.stack.empty() && common == locals.size() && common == prev.size()) {
+            if (delta < 64) {
+                u1(table, delta);                               // same_frame
+            } else {
+                u1(table, 251);                                 // same_frame_extended
+                u2(table, delta);
+            }
+        } else if (f.stack.size() == 1 && common == locals.size() && common == prev.size()) {
+            if (delta < 64) {
+                u1(table, 64 + delta);                          // same_locals_1_stack_item
+            } else {
+                u1(table, 247);
+                u2(table, delta);
+            }
+            type(table, f.stack[0]);
+        } else if (f.stack.empty() && common == locals.size() && prev.size() - common <= 3) {
+            u1(table, unsigned(251 - (prev.size() - common)));  // chop_frame
+            u2(table, delta);
+        } else if (f.stack.empty() && common == prev.size() && locals.size() - common <= 3) {
+            u1(table, unsigned(251 + (locals.size() - common)));  // append_frame
+            u2(table, delta);
+            for (size_t k = common; k < locals.size(); ++k) type(table, locals[k]);
+        } else {
+            u1(table, 255);                                     // full_frame
+            u2(table, delta);
+            u2(table, unsigned(locals.size()));
+            for (const VType& t : locals) type(table, t);
+            u2(table, unsigned(f.stack.size()));
+            for (const VType& t : f.stack) type(table, t);
+        }
+        prev = std::move(locals);
+        prevAt = long(it.at);
+        ++frames;
+    }
+
+    std::vector<uint8_t> attr;      // Code
+    u2(attr, unsigned(m.maxStack));
+    u2(attr, unsigned(m.maxLocals));
+    u4(attr, length);
+    attr.insert(attr.end(), bc.begin(), bc.end());
+    u2(attr, 0);                    // no exception handlers
+    u2(attr, frames ? 1 : 0);
+    if (frames) {
+        u2(attr, utf8("StackMapTable"));
+        u4(attr, uint32_t(table.size() + 2));
+        u2(attr, unsigned(frames));
+        attr.insert(attr.end(), table.begin(), table.end());
+    }
+
+    u2(out, m.flags);
+    u2(out, utf8(m.name));
+    u2(out, utf8(m.descriptor));
+    u2(out, 1);
+    u2(out, utf8("Code"));
+    u4(out, uint32_t(attr.size()));
+    out.insert(out.end(), attr.begin(), attr.end());
+    return true;
+}
+
+//---------------------------------------------------------------
+// the class file: the body is encoded first, since encoding fills the
+// pool that precedes it
+//---------------------------------------------------------------
+bool ClassWriter::write(std::ostream& out, std::string& err) {
+    pool.clear();
+    entries.clear();
+    poolCount = 1;
+
+    std::vector<uint8_t> body;
+    u2(body, 0x0021);               // public, super
+    u2(body, classRef(internalName(className)));
+    u2(body, classRef("java/lang/Object"));
+    u2(body, 0);                    // interfaces
+    u2(body, unsigned(fields.size()));
+    for (const Field& f : fields) {
+        u2(body, 0x0008);           // static
+        u2(body, utf8(f.name));
+        u2(body, utf8(f.descriptor));
+        if (std::holds_alternative<std::monostate>(f.value)) {
+            u2(body, 0);
+            continue;
+        }
+        u2(body, 1);
+        u2(body, utf8("ConstantValue"));
+        u4(body, 2);
+        if (auto* i = std::get_if<int>(&f.value)) u2(body, integer(*i));
+        else u2(body, string(unescape(std::get<std::string>(f.value))));
+    }
+    u2(body, unsigned(methods.size()));
+    for (const Method& m : methods)
+        if (!encode(m, body, err)) return false;
+    u2(body, 0);                    // class attributes
+    if (poolCount > 0xFFFF) {
+        err = "constant pool needs " + std::to_string(poolCount - 1) + " entries, over the 65535 limit";
+        return false;
+    }
+
+    std::vector<uint8_t> head;
+    u4(head, 0xCAFEBABE);
+    u2(head, 0);                    // minor
+    u2(head, 50);                   // major: Java 6
+    u2(head, poolCount);
+    out.write(reinterpret_cast<const char*>(head.data()), std::streamsize(head.size()));
+    out.write(reinterpret_cast<const char*>(pool.data()), std::streamsize(pool.size()));
+    out.write(reinterpret_cast<const char*>(body.data()), std::streamsize(body.size()));
+    if (!out) {
+        err = "write failed";
+        return false;
+    }
+    return true;
+}
@@ -1,10 +1,18 @@
 #include "CodeGenVisitor.hpp"
-#include <sstream>
+#include "ClassWriter.hpp"
+#include "CompilerOptions.hpp"
+#include "Inliner.hpp"
+#include "PassManager.hpp"
+#include "SemanticAnalyzer.hpp"
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <utility>
 
 using namespace ast;
 
-static std::string jasmType(const ast::Type& t) {
+static std::string_view jasmType(const ast::Type& t) {
     using BT = ast::BasicType;
     switch (t.kind) {
         case BT::Int:    return "int";
@@ -15,102 +23,283 @@ static std::string jasmType(const ast::Type& t) {
     }
 }
 
+static bool isComparison(Op op) {
+    return op == Op::Less || op == Op::LessEq || op == Op::Greater || op == Op::GreaterEq ||
+           op == Op::Equal || op == Op::NotEqual;
+}
+
+// Expressions genCond() turns into jumps rather than a 0/1 value
+static bool isCondition(const Expr& e) {
+    if (auto* b = dynamic_cast<const Binary*>(&e))
+        return b->op == Op::And || b->op == Op::Or || isComparison(b->op);
+    auto* u = dynamic_cast<const Unary*>(&e);
+    return u && u->op == Op::Not;
+}
+
+// if_icmp<c> taken when `lhs op rhs` holds; strings compare references
+static Opcode compareBranch(Op op, const ast::Type& operand) {
+    if (operand.kind == BasicType::String)
+        return op == Op::NotEqual ? Opcode::if_acmpne : Opcode::if_acmpeq;
+    switch (op) {
+        case Op::Less:      return Opcode::if_icmplt;
+        case Op::LessEq:    return Opcode::if_icmple;
+        case Op::Greater:   return Opcode::if_icmpgt;
+        case Op::GreaterEq: return Opcode::if_icmpge;
+        case Op::NotEqual:  return Opcode::if_icmpne;
+        default:            return Opcode::if_icmpeq;
+    }
+}
+
+// if_icmp<c> → if<c>; both families are laid out eq, ne, lt, ge, gt, le
+static Opcode zeroBranch(Opcode cmp) {
+    return Opcode(int(cmp) - int(Opcode::if_icmpeq) + int(Opcode::ifeq));
+}
+
+// a <c> b  ≡  b <mirror(c)> a
+static Opcode mirror(Opcode cmp) {
+    switch (cmp) {
+        case Opcode::if_icmplt: return Opcode::if_icmpgt;
+        case Opcode::if_icmpgt: return Opcode::if_icmplt;
+        case Opcode::if_icmple: return Opcode::if_icmpge;
+        case Opcode::if_icmpge: return Opcode::if_icmple;
+        default:                return cmp;
+    }
+}
+
+// Compile-time int value (literal, const variable or an expression of them)
+static std::optional<int> constInt(Expr* e) {
+    std::optional<ConstValue> cv = evalConstExpr(e);
+    if (cv)
+        if (auto* i = std::get_if<int>(&*cv)) return *i;
+    return std::nullopt;
+}
+
+// Calls anywhere in `e` (a loop condition is only copied without them)
+static bool hasCall(const Expr& e) {
+    if (dynamic_cast<const Call*>(&e)) return true;
+    if (auto* b = dynamic_cast<const Binary*>(&e)) return hasCall(*b->lhs) || hasCall(*b->rhs);
+    if (auto* u = dynamic_cast<const Unary*>(&e)) return hasCall(*u->rhs);
+    if (auto* a = dynamic_cast<const Assign*>(&e)) return hasCall(*a->rhs);
+    return false;
+}
+
+static bool isZero(const Expr& e) {
+    auto* lit = dynamic_cast<const IntLit*>(&e);
+    return lit && lit->value == 0;
+}
+
+// strings and arrays live in reference slots (aload / astore)
+static bool isReference(const ast::Type& t) {
+    return t.kind == BasicType::String || !t.dims.empty();
+}
+
+// A read anywhere in `s`; reads are statements, never inside expressions
+static bool hasRead(const Stmt* s) {
+    if (!s) return false;
+    if (dynamic_cast<const Read*>(s)) return true;
+    if (auto* b = dynamic_cast<const Block*>(s))
+        return std::any_of(b->stmts.begin(), b->stmts.end(), [](const auto& t) { return hasRead(t.get()); });
+    if (auto* i = dynamic_cast<const IfStmt*>(s)) return hasRead(i->thenStmt.get()) || hasRead(i->elseStmt.get());
+    if (auto* w = dynamic_cast<const WhileStmt*>(s)) return hasRead(w->body.get());
+    if (auto* f = dynamic_cast<const ForStmt*>(s)) return hasRead(f->body.get());
+    if (auto* f = dynamic_cast<const ForEachStmt*>(s)) return hasRead(f->body.get());
+    if (auto* sw = dynamic_cast<const SwitchStmt*>(s))
+        return std::any_of(sw->cases.begin(), sw->cases.end(), [](const auto& c) { return hasRead(c.body.get()); });
+    return false;
+}
+
 void CodeGenVisitor::generate(Program& root) { 
     root.accept(*this); 
 }
 
+void CodeGenVisitor::generateParallel(Program& root, WorkStealingPool& pool) {
+    openClass();
+    emitGlobals(root);
+
+    auto funcs = functionsOf(root);
+    std::vector<std::string> bodies(funcs.size());
+    std::vector<size_t> counts(funcs.size());
+    std::vector<OptReport> reports(report ? funcs.size() : 0);
+    std::vector<ClassWriter> files;         // --emit=class: one per method, adopted in order
+    if (classFile)
+        for (size_t i = 0; i < funcs.size(); ++i) files.emplace_back(ctx.className);
+    pool.parallelFor(funcs.size(), [&](size_t i) {
+        CodeEmitter emitter;
+        for (int d = 0; d < em.currentIndent(); ++d) emitter.push();
+        CodeGenContext context(ctx.className);
+        CodeGenVisitor worker(emitter, context, symtab, options, report ? &reports[i] : nullptr);
+        worker.inliner = inliner;
+        if (classFile) worker.classFile = &files[i];
+        funcs[i]->accept(worker);
+        bodies[i] = emitter.buffer();
+        counts[i] = emitter.instructionCount();
+    });
+    for (size_t i = 0; i < bodies.size(); ++i) em.emitRaw(bodies[i], counts[i]);
+    for (auto& f : files) classFile->adopt(std::move(f));
+    if (report)
+        for (auto& r : reports) report->merge(r);
+    if (input) emitInputMethods();
+
+    closeClass();
+}
+
+void CodeGenVisitor::generateStreamed(Program& root, std::istream& methods, bool reads) {
+    input = reads;
+    openClass();
+    emitGlobals(root);
+    em.emitStream(methods);
+    if (input) emitInputMethods();
+    closeClass();
+}
+
 void CodeGenVisitor::visit(Program& n) {
+    openClass();
+    emitGlobals(n);
+    for (auto* f : functionsOf(n)) f->accept(*this);
+    if (input) emitInputMethods();
+    closeClass();
+}
+
+void CodeGenVisitor::openClass() {
     if (ctx.className.empty()) ctx.className = "example";
-    em.emit("class " + ctx.className);
+    if (classFile) return;
+    em.line("class ", ctx.className);
     em.emit("{");
     em.push();
+}
+
+void CodeGenVisitor::closeClass() {
+    if (classFile) return;
+    em.pop();
+    em.emit("}");
+}
+
+// function decl (from globals + stmts), in source order
+std::vector<FuncDecl*> CodeGenVisitor::functionsOf(Program& n) {
+    std::vector<FuncDecl*> funcs;
+    for (auto& d : n.globals)
+        if (auto* f = dynamic_cast<FuncDecl*>(d.get())) funcs.push_back(f);
+    for (auto& s : n.stmts)
+        if (auto* f = dynamic_cast<FuncDecl*>(s.get())) funcs.push_back(f);
+    return funcs;
+}
 
+void CodeGenVisitor::emitGlobals(Program& n) {
     std::vector<std::pair<ast::VarDecl*, ast::Expr*>> init_with_exprs;
+    auto declare = [&](std::string_view type, std::string_view name) {
+        if (classFile) classFile->field(type, name);
+        else em.line("field static ", type, ' ', name);
+    };
+    auto field = [&](VarDecl* vd) {
+        switch (vd->varType.kind) {
+            case BasicType::Int: case BasicType::Bool: case BasicType::String: break;
+            default: return;
+        }
+        std::string_view type = jasmType(vd->varType);
+        if (folding()) folder.fold(vd->init);    // foldable initializers become inline values
+        if (simplifying()) simplifier.run(vd->init);
+        if (!vd->init) {
+            declare(type, vd->name);
+        // handle literal initializers inline
+        } else if (auto* il = dynamic_cast<ast::IntLit*>(vd->init.get())) {
+            if (classFile) classFile->field(type, vd->name, il->value);
+            else em.line("field static ", type, ' ', vd->name, " = ", il->value);
+        } else if (auto* bl = dynamic_cast<ast::BoolLit*>(vd->init.get())) {
+            if (classFile) classFile->field(type, vd->name, bl->value ? 1 : 0);
+            else em.line("field static ", type, ' ', vd->name, " = ", bl->value ? '1' : '0');
+        } else if (auto* sl = dynamic_cast<ast::StringLit*>(vd->init.get())) {
+            if (classFile) classFile->field(type, vd->name, sl->value);
+            else em.line("field static ", type, ' ', vd->name, " = \"", sl->value, '"');
+        } else {
+            // non-literal initializer: emit separately
+            init_with_exprs.emplace_back(vd, vd->init.get());
+            declare(type, vd->name);
+        }
+    };
+    for (auto* f : functionsOf(n)) input = input || hasRead(f->body.get());
+    if (buffering()) declare("java.io.PrintStream", "_out");
+    if (input) {
+        declare("byte[]", "_in");
+        declare("int", "_inPos");
+        declare("int", "_inLen");
+    }
     for (auto& d : n.globals) {
         if (auto* vdl = dynamic_cast<VarDeclList*>(d.get())) {
-            for (auto& inner : vdl->decls) {
-                auto* vd = inner.get();
-                std::string type;
-                switch (vd->varType.kind) {
-                    case BasicType::Int:    type = "int"; break;
-                    case BasicType::Bool:   type = "boolean"; break;
-                    case BasicType::String: type = "java.lang.String"; break;
-                    default: continue;
-                }
-                std::string instruction = "field static " + type + " " + vd->name;
-                if (vd->init) {
-                    // handle literal initializers inline
-                    if (auto* il = dynamic_cast<ast::IntLit*>(vd->init.get())) {
-                        instruction += " = " + std::to_string(il->value);
-                    } else if (auto* bl = dynamic_cast<ast::BoolLit*>(vd->init.get())) {
-                        instruction += " = " + std::string(bl->value ? "1" : "0");
-                    } else if (auto* sl = dynamic_cast<ast::StringLit*>(vd->init.get())) {
-                        instruction += " = \"" + sl->value + "\"";
-                    } else {
-                        // non-literal initializer: emit separately
-                        //vd->init->accept(*this);
-                        init_with_exprs.emplace_back(vd, vd->init.get());
-                        em.emit(instruction);
-                        continue;
-                    }
-                }
-                em.emit(instruction);
-            }
+            for (auto& inner : vdl->decls) field(inner.get());
         } else if (auto* vd = dynamic_cast<VarDecl*>(d.get())) {
-            std::string type;
-            switch (vd->varType.kind) {
-                case BasicType::Int:    type = "int"; break;
-                case BasicType::Bool:   type = "boolean"; break;
-                case BasicType::String: type = "java.lang.String"; break;
-                default: continue;
-            }
-            std::string instruction = "field static " + type + " " + vd->name;
-            if (vd->init) {
-                // handle literal initializers inline
-                if (auto* il = dynamic_cast<ast::IntLit*>(vd->init.get())) {
-                    instruction += " = " + std::to_string(il->value);
-                } else if (auto* bl = dynamic_cast<ast::BoolLit*>(vd->init.get())) {
-                    instruction += " = " + std::string(bl->value ? "1" : "0");
-                } else if (auto* sl = dynamic_cast<ast::StringLit*>(vd->init.get())) {
-                    instruction += " = \"" + sl->value + "\"";
-                } else {
-                    // non-literal initializer: emit separately
-                    init_with_exprs.emplace_back(vd, vd->init.get());
-                    em.emit(instruction);
-                    //vd->init->accept(*this);
-                    continue;
-                }
-            }
-            em.emit(instruction);
+            field(vd);
         }
     }
 
-    if (!init_with_exprs.empty()){
-            em.emit("method static void <clinit>()");
-            em.emit("max_stack 32");
-            em.emit("max_locals 32");
-            em.emit("{");
-            em.push();
+    if (!init_with_exprs.empty() || buffering() || input){
+            beginMethod("static void <clinit>()");
+            if (buffering()) initOutput();
+            if (input) {
+                code.emit(Opcode::ldc, 1 << 16);
+                code.emitRef(Opcode::newarray, "byte");
+                code.emitRef(Opcode::putstatic, inputRef(In::Buffer));
+            }
             for (const auto& [vd, expr] : init_with_exprs) {
                 expr->accept(*this);
                 emitStore(vd->sym);  // store into the static field
             }
-            em.emit("return");
-            em.pop();
-            em.emit("}");
+            code.emit(Opcode::return_);
+            endMethod(0);
         }
+}
 
-    // function decl (from globals + stmts)
-    auto emitFuncs = [&](auto& vec) {
-        for (auto& n : vec) {
-            if (auto* f = dynamic_cast<FuncDecl*>(n.get())) {
-                f->accept(*this);
-            }
-        }
-    };
-    emitFuncs(n.globals);
-    emitFuncs(n.stmts);
+bool CodeGenVisitor::folding() const {
+    return !options || options->enabled("const-fold");
+}
+
+bool CodeGenVisitor::buffering() const {
+    return options && options->bufferedOutput;
+}
+
+bool CodeGenVisitor::sharing() const {
+    return !options || options->enabled("cse");
+}
+
+bool CodeGenVisitor::hoisting() const {
+    return !options || options->enabled("licm");
+}
+
+bool CodeGenVisitor::rotating() const {
+    return !options || options->enabled("loop-rotate");
+}
 
+bool CodeGenVisitor::simplifying() const {
+    return !options || options->enabled("simplify");
+}
+
+bool CodeGenVisitor::reducing() const {
+    return !options || options->enabled("strength-reduce");
+}
+
+// Every method body is collected in `code`, optimized, then printed
+// (or handed to the class writer)
+void CodeGenVisitor::beginMethod(std::string_view sig) {
+    ctx.resetLabels();
+    code.clear();
+    if (sig.data() != signature.data()) signature.assign(sig);
+    if (!classFile) em.line("method ", signature);
+}
+
+// `minLocals` covers argument slots even when the body never touches them
+void CodeGenVisitor::endMethod(int minLocals) {
+    peephole.run(code, report);
+    if ((!options || options->enabled("dead-code")) && deadCode.run(code, report))
+        peephole.run(code, report);     // gotos and labels around what was removed
+    if (!options || options->enabled("slot-reuse")) slots.run(code, minLocals, report);
+    if (classFile) {
+        classFile->method(signature, code.maxStack(), code.maxLocals(minLocals), code);
+        return;
+    }
+    em.line("max_stack ", code.maxStack());
+    em.line("max_locals ", code.maxLocals(minLocals));
+    em.emit("{");
+    em.push();
+    code.print(em);
     em.pop();
     em.emit("}");
 }
@@ -120,43 +309,89 @@ void CodeGenVisitor::visit(Program& n) {
 //---------------------------------------------------------------
 void CodeGenVisitor::visit(ast::FuncDecl& fn)
 {
-    const SymEntry ent = fn.sym;             
-    std::stringstream sig;
-    sig << jasmType(ent.returnType.value()) << ' ' << fn.name << '(';
-
-    if (fn.name == "main") {                   
-        sig << "java.lang.String[]";
-    } else if (ent.paramTypes) {
-        for (size_t i = 0; i < ent.paramTypes->size(); ++i) {
-            sig << jasmType((*ent.paramTypes)[i]);
-            if (i + 1 < ent.paramTypes->size()) sig << ", ";
-        }
+    const SymEntry& ent = fn.sym;
+    signature.assign("public static ").append(jasmType(ent.returnType.value())).append(" ").append(fn.name);
+    signature.append(fn.name == "main" ? "(java.lang.String[])" : paramList(ent));
+    beginMethod(signature);
+    // codegen temporaries go above the slots the symbol table handed out
+    int argSlots = fn.name == "main" ? 1 : int(ent.paramTypes ? ent.paramTypes->size() : 0);
+    ctx.resetLocal(std::max(fn.localSlots, argSlots));
+
+    if (folding()) folder.fold(fn.body);
+    if (simplifying()) simplifier.run(fn.body);
+    if (options && options->viaIR && throughIR(fn)) {
+        if (fn.name == "main" && buffering()) flushAtReturns();
+        endMethod(argSlots);
+        return;
     }
-    sig << ')';
-
-    em.emit("method public static " + sig.str());
-    em.emit("max_stack 32");
-    em.emit("max_locals 32");
-    em.emit("{");
-    em.push();
-
-    ctx.resetLocal(ent.paramTypes ? ent.paramTypes->size() : 0);
 
+    function = &fn;
+    entry = Label{};
+    if (fn.name != "main" && (!options || options->enabled("tail-rec"))) {
+        entry = ctx.newLabel();
+        code.label(entry);
+    }
     if (fn.body) fn.body->accept(*this);
     if (ent.returnType->kind == ast::BasicType::Void)
-        em.emit("return");
-
-    em.pop();
-    em.emit("}");
+        code.emit(Opcode::return_);
+    if (fn.name == "main" && buffering()) flushAtReturns();
+    endMethod(argSlots);
 }
 
+// The body goes AST → SSA IR → IR passes → stack code. Calls are not
+// inlined on this path and the AST-level loop optimizations do not
+// apply; the IR passes stand in for them. Self tail calls become a
+// loop in the IR.
+bool CodeGenVisitor::throughIR(FuncDecl& fn) {
+    ir::Function f;
+    if (!irBuilder.build(fn, f, !options || options->enabled("tail-rec"))) return false;
+    if (report && irBuilder.tailCalls()) report->add("tail-rec." + fn.name, "calls converted", irBuilder.tailCalls());
+    PassManager::standard(options, report).run(f);
+    lowering.setPrintStream(printStream());
+    lowering.run(f, code, ctx);
+    return true;
+}
 
 //---------------------------------------------------------------
 void CodeGenVisitor::visit(Block& b) {
-    for (auto& s : b.stmts) {
-        s->accept(*this);
+    bool cse = sharing();
+    for (size_t i = 0; i < b.stmts.size();) {
+        size_t end = cse ? numbering.run(b.stmts, i, hoisted) : i;
+        if (end == i || numbering.shares().empty()) {
+            for (end = std::max(end, i + 1); i < end; ++i) b.stmts[i]->accept(*this);
+            continue;
+        }
+        // straight-line run: values computed twice live in temps above the locals
+        std::vector<ValueNumbering::Share> run = numbering.shares();
+        int saved = ctx.currentLocal();
+        long reuses = 0;
+        for (const auto& s : run) {
+            shared[s.expr] = Temp{saved + s.temp, s.first};
+            reuses += !s.first;
+        }
+        ctx.resetLocal(saved + numbering.temps());
+        for (; i < end; ++i) b.stmts[i]->accept(*this);
+        for (const auto& s : run) shared.erase(s.expr);
+        ctx.resetLocal(saved);
+        if (report) report->add("cse", "recomputations removed", reuses);
     }
-}    
+}
+
+bool CodeGenVisitor::reused(const Expr& e) {
+    if (shared.empty()) return false;
+    auto it = shared.find(&e);
+    if (it == shared.end() || it->second.first) return false;
+    code.emit(Opcode::iload, it->second.slot);
+    return true;
+}
+
+void CodeGenVisitor::keep(const Expr& e) {
+    if (shared.empty()) return;
+    auto it = shared.find(&e);
+    if (it == shared.end() || !it->second.first) return;
+    code.emit(Opcode::dup);
+    code.emit(Opcode::istore, it->second.slot);
+}
 
 //---------------------------------------------------------------
 // Variable decl / assign
@@ -172,30 +407,69 @@ void CodeGenVisitor::visit(Assign& a) {
     a.rhs->accept(*this);
     auto e = a.lhs->sym;
     emitStore(a.lhs->sym);
+    if (!inductions.empty() && !a.lhs->sym.isGlobal)
+        if (auto c = LoopInvariants::step(a)) stepped(slotBase + a.lhs->sym.slot, *c);
 }    
 
 //---------------------------------------------------------------
 // Print / Println
 //---------------------------------------------------------------
-static std::string sig(const Type& t) {
+static std::string_view printRef(const Type& t, bool newline) {
     switch (t.kind) {
-        case BasicType::Int:    return "(int)";
-        case BasicType::Bool:   return "(boolean)";
-        case BasicType::String: return "(java.lang.String)";
-        default:                return "(int)";
+        case BasicType::Bool:
+            return newline ? "void java.io.PrintStream.println(boolean)" : "void java.io.PrintStream.print(boolean)";
+        case BasicType::String:
+            return newline ? "void java.io.PrintStream.println(java.lang.String)" : "void java.io.PrintStream.print(java.lang.String)";
+        default:
+            return newline ? "void java.io.PrintStream.println(int)" : "void java.io.PrintStream.print(int)";
     }
 }
 
 void CodeGenVisitor::visit(Print& p) {
-    em.emit("getstatic java.io.PrintStream java.lang.System.out");
+    code.emitRef(Opcode::getstatic, printStream());
     p.expr->accept(*this);
-    em.emit("invokevirtual void java.io.PrintStream.print" + sig(p.expr->ty));
+    code.emitRef(Opcode::invokevirtual, printRef(p.expr->ty, false));
 }
 
 void CodeGenVisitor::visit(Println& p) {
-    em.emit("getstatic java.io.PrintStream java.lang.System.out");
+    code.emitRef(Opcode::getstatic, printStream());
     p.expr->accept(*this);
-    em.emit("invokevirtual void java.io.PrintStream.println" + sig(p.expr->ty));
+    code.emitRef(Opcode::invokevirtual, printRef(p.expr->ty, true));
+}
+
+// Every print is a synchronized call on System.out, which flushes at
+// each newline; _out only writes when its 64 KiB buffer fills up
+std::string_view CodeGenVisitor::printStream() {
+    if (!buffering()) return "java.io.PrintStream java.lang.System.out";
+    if (outRef.empty()) outRef = "java.io.PrintStream " + ctx.className + "._out";
+    return outRef;
+}
+
+void CodeGenVisitor::initOutput() {
+    code.emitRef(Opcode::new_, "java.io.PrintStream");
+    code.emit(Opcode::dup);
+    code.emitRef(Opcode::new_, "java.io.BufferedOutputStream");
+    code.emit(Opcode::dup);
+    code.emitRef(Opcode::getstatic, "java.io.PrintStream java.lang.System.out");
+    code.emit(Opcode::ldc, 1 << 16);
+    code.emitRef(Opcode::invokespecial, "void java.io.BufferedOutputStream.<init>(java.io.OutputStream, int)");
+    code.emit(Opcode::iconst_0);        // no autoflush
+    code.emitRef(Opcode::invokespecial, "void java.io.PrintStream.<init>(java.io.OutputStream, boolean)");
+    code.emitRef(Opcode::putstatic, printStream());
+}
+
+// Inlined returns are gotos by now; only the method's own return_ exit main
+void CodeGenVisitor::flushAtReturns() {
+    std::vector<Instr> out;
+    out.reserve(code.instrs().size() + 2);
+    for (Instr& i : code.instrs()) {
+        if (!i.isLabel && i.op == Opcode::return_) {
+            out.push_back({Opcode::getstatic, OperandKind::Ref, false, 0, 0, printStream()});
+            out.push_back({Opcode::invokevirtual, OperandKind::Ref, false, 0, 0, "void java.io.PrintStream.flush()"});
+        }
+        out.push_back(std::move(i));
+    }
+    code.instrs() = std::move(out);
 }
 
 //---------------------------------------------------------------
@@ -204,195 +478,475 @@ void CodeGenVisitor::visit(Println& p) {
 void CodeGenVisitor::visit(IfStmt& s)
 {
     if (s.elseStmt) {
-        std::string Lelse = ctx.newLabel();  
-        std::string Lend  = ctx.newLabel();  
+        Label Lelse = ctx.newLabel();
+        Label Lend  = ctx.newLabel();
 
-        s.cond->accept(*this);
-        em.emit("ifeq " + Lelse);
+        genCond(*s.cond, Label{}, Lelse);
 
         /* then branch */
         s.thenStmt->accept(*this);
         
         // 只有當 then 分支不以 return 結尾時才生成 goto
         if (!endsWithReturn(s.thenStmt.get())) {
-            em.emit("goto " + Lend);
+            code.emit(Opcode::goto_, Lend);
         }
 
         /* else branch */
-        em.emit(Lelse + ":");
+        code.label(Lelse);
         s.elseStmt->accept(*this);
 
         /* block 結尾 —— 加 nop 防止 label 無指令 */
-        em.emit(Lend + ":");
-        em.emit("nop");          
+        code.label(Lend);
+        code.emit(Opcode::nop);
 
     } else {
-        std::string Lend = ctx.newLabel();
+        Label Lend = ctx.newLabel();
 
-        s.cond->accept(*this);
-        em.emit("ifeq " + Lend);
+        genCond(*s.cond, Label{}, Lend);
 
         /* then branch */
         s.thenStmt->accept(*this);
 
-        em.emit(Lend + ":");
-        em.emit("nop");          
+        code.label(Lend);
+        code.emit(Opcode::nop);
     }
 }
 
 void CodeGenVisitor::visit(WhileStmt& s) {
-    auto L1 = ctx.newLabel(), L2 = ctx.newLabel();
-    em.emit(L1 + ":");
-    s.cond->accept(*this);
-    em.emit("ifeq " + L2);
-    s.body->accept(*this);
-    em.emit("goto " + L1);
-    em.emit(L2 + ":");
+    int saved = ctx.currentLocal();
+    auto temps = hoist({s.cond.get(), s.body.get()});
+    reduce(temps);
+    loop(s.cond.get(), s.body.get(), nullptr);
+    unhoist(temps);
+    ctx.resetLocal(saved);
+}
+
+// Rotated, the test sits at the bottom and the loop is entered through
+// a copy of it, so a trip costs one conditional jump and no goto:
+//       cond → Lend           (guard; `goto Lcond` if cond has calls)
+//   Lbody: body
+//   Lnext: step               (continue)
+//   Lcond: cond → Lbody
+//   Lend:                     (break)
+void CodeGenVisitor::loop(Expr* cond, Stmt* body, Stmt* step) {
+    Label Lbody = ctx.newLabel(), Lnext = ctx.newLabel(), Lend = ctx.newLabel();
+    ++loopDepth;
+    ctx.pushLoop(Lnext, Lend);
+    if (!rotating()) {
+        code.label(Lbody);
+        if (cond) genCond(*cond, Label{}, Lend);
+        if (body) body->accept(*this);
+        code.label(Lnext);
+        if (step) step->accept(*this);
+        code.emit(Opcode::goto_, Lbody);
+    } else {
+        Label Lcond = ctx.newLabel();
+        if (cond && hasCall(*cond)) code.emit(Opcode::goto_, Lcond);   // no second copy of inlined code
+        else if (cond) genCond(*cond, Label{}, Lend);
+        code.label(Lbody);
+        if (body) body->accept(*this);
+        code.label(Lnext);
+        if (step) step->accept(*this);
+        code.label(Lcond);
+        if (cond) genCond(*cond, Lbody, Label{});
+        else code.emit(Opcode::goto_, Lbody);
+        if (report) report->add("loop-rotate", "loops rotated");
+    }
+    code.label(Lend);
+    ctx.popLoop();
+    --loopDepth;
+}
+
+// Loop-invariant expressions are evaluated once, before the loop, into
+// temps above the locals; inside the loop reused() loads them
+CodeGenVisitor::LoopTemps CodeGenVisitor::hoist(std::initializer_list<Node*> parts, const Var* index) {
+    LoopTemps t;
+    t.inductions = inductions.size();
+    if (!hoisting() && !reducing()) return t;
+    invariants.run(parts, index, hoisted);
+    if (reducing()) t.products = invariants.products();
+    if (!hoisting()) return t;
+    for (Expr* e : invariants.invariants()) {
+        int slot = ctx.allocLocal();
+        e->accept(*this);
+        code.emit(Opcode::istore, slot);
+        shared[e] = Temp{slot, false};
+        hoisted.insert(e);
+        t.loaded.push_back(e);
+    }
+    if (report && !t.loaded.empty()) report->add("licm", "expressions hoisted", long(t.loaded.size()));
+    return t;
+}
+
+// A product i * k of a loop counter starts as one multiplication and
+// then moves with i: stepped() adds k·c to it wherever i changes by c
+void CodeGenVisitor::reduce(LoopTemps& t) {
+    for (const auto& p : t.products) {
+        int slot = slotBase + p.slot;
+        auto same = std::find_if(inductions.begin() + long(t.inductions), inductions.end(),
+                                 [&](const Induction& iv) { return iv.slot == slot && iv.factor == p.factor; });
+        if (same == inductions.end()) {
+            int temp = ctx.allocLocal();
+            code.emit(Opcode::iload, slot);
+            emitInt(p.factor);
+            code.emit(Opcode::imul);
+            code.emit(Opcode::istore, temp);
+            same = inductions.insert(inductions.end(), {slot, temp, p.factor});
+        }
+        shared[p.expr] = Temp{same->temp, false};
+        hoisted.insert(p.expr);
+        t.loaded.push_back(p.expr);
+    }
+    if (report && !t.products.empty()) report->add("strength-reduce", "loop products stepped", long(t.products.size()));
+}
+
+void CodeGenVisitor::unhoist(const LoopTemps& t) {
+    for (Expr* e : t.loaded) {
+        shared.erase(e);
+        hoisted.erase(e);
+    }
+    inductions.resize(t.inductions);
+}
+
+// k·c wraps exactly like (i + c)·k - i·k does
+void CodeGenVisitor::stepped(int slot, int delta) {
+    for (const auto& iv : inductions) {
+        if (iv.slot != slot) continue;
+        code.emit(Opcode::iload, iv.temp);
+        emitInt(int(uint32_t(iv.factor) * uint32_t(delta)));
+        code.emit(Opcode::iadd);
+        code.emit(Opcode::istore, iv.temp);
+    }
 }
 
 //---------------------------------------------------------------
 // Literals & Var
 //---------------------------------------------------------------
 void CodeGenVisitor::visit(IntLit& n) { 
-    int v = n.value;
+    emitInt(n.value);
+}
+
+void CodeGenVisitor::emitInt(int v) {
     if (v >= -1 && v <= 5) {
-        switch (v) {
-            case -1: em.emit("iconst_m1"); break;
-            case 0:  em.emit("iconst_0");  break;
-            case 1:  em.emit("iconst_1");  break;
-            case 2:  em.emit("iconst_2");  break;
-            case 3:  em.emit("iconst_3");  break;
-            case 4:  em.emit("iconst_4");  break;
-            case 5:  em.emit("iconst_5");  break;
-        }
+        // iconst_m1 .. iconst_5 are consecutive opcodes
+        code.emit(Opcode(int(Opcode::iconst_0) + v));
     }
     else if (v >= -128 && v <= 127) {
-        em.emit("bipush " + std::to_string(v));
+        code.emit(Opcode::bipush, v);
     }
     else {
-        em.emit("ldc " + std::to_string(v));
+        code.emit(Opcode::ldc, v);
     }
 }
 
 void CodeGenVisitor::visit(BoolLit& n) { 
-    em.emit(std::string("iconst_") + (n.value ? "1" : "0")); 
+    code.emit(n.value ? Opcode::iconst_1 : Opcode::iconst_0);
 }
 
 void CodeGenVisitor::visit(StringLit& n) { 
-    em.emit("ldc \"" + n.value + "\""); 
+    code.emitString(Opcode::ldc, n.value);
 }
 
 void CodeGenVisitor::visit(Var& v) { 
-    auto e = v.sym;
-    emitLoad(e);
+    if (reused(v)) return;
+    emitLoad(v.sym);
+    keep(v);
 }
 
 //---------------------------------------------------------------
 // Unary
 //---------------------------------------------------------------
 void CodeGenVisitor::visit(Unary& u) { 
+    if (u.op == Op::Not && isCondition(*u.rhs)) {
+        genBool(u);
+        return;
+    }
+    if (reused(u)) return;
     u.rhs->accept(*this); 
     if (u.op == Op::Minus) {
-        em.emit("ineg");
+        code.emit(Opcode::ineg);
     } else if (u.op == Op::Not) {
-        auto L = ctx.newLabel(), Lend = ctx.newLabel();
-        em.emit("ifeq " + L);
-        em.emit("iconst_0");
-        em.emit("goto " + Lend);
-        em.emit(L + ":");
-        em.emit("iconst_1");
-        em.emit(Lend + ":");
+        code.emit(Opcode::iconst_1);    // b ^ 1
+        code.emit(Opcode::ixor);
     }
+    keep(u);
 }
 
 //---------------------------------------------------------------
 // Binary (int算術 & bool/logical)
 //---------------------------------------------------------------
 void CodeGenVisitor::visit(Binary& b) { 
+    if (isCondition(b)) {
+        genBool(b);
+        return;
+    }
+    if (b.op == Op::Plus && b.ty.kind == BasicType::String) {
+        concat(b);
+        return;
+    }
+    if (reused(b)) return;
+    if (shifted(b)) {
+        keep(b);
+        return;
+    }
     b.lhs->accept(*this); 
     b.rhs->accept(*this); 
     switch (b.op) {
         case Op::Plus: 
-            em.emit("iadd"); 
+            code.emit(Opcode::iadd); 
             break;
         case Op::Minus: 
-            em.emit("isub"); 
+            code.emit(Opcode::isub); 
             break;
         case Op::Mul: 
-            em.emit("imul"); 
+            code.emit(Opcode::imul); 
             break;
         case Op::Div: 
-            em.emit("idiv"); 
+            code.emit(Opcode::idiv); 
             break;
         case Op::Mod: 
-            em.emit("irem"); 
-            break;
-        case Op::Less: 
-        case Op::LessEq: 
-        case Op::Greater: 
-        case Op::GreaterEq: 
-        case Op::Equal: 
-        case Op::NotEqual: {
-            std::string Ltrue = ctx.newLabel(), Lend = ctx.newLabel();
-            em.emit("isub");
-            switch (b.op) {
-                case Op::Less:       
-                    em.emit("iflt " + Ltrue); 
-                    break;
-                case Op::LessEq:     
-                    em.emit("ifle " + Ltrue); 
-                    break;
-                case Op::Greater:    
-                    em.emit("ifgt " + Ltrue); 
-                    break;
-                case Op::GreaterEq:  
-                    em.emit("ifge " + Ltrue); 
-                    break;
-                case Op::Equal:      
-                    em.emit("ifeq " + Ltrue); 
-                    break;
-                case Op::NotEqual:   
-                    em.emit("ifne " + Ltrue); 
-                    break;
-                default: 
-                    break;
-            }
-            em.emit("iconst_0");
-            em.emit("goto " + Lend);
-            em.emit(Ltrue + ":");
-            em.emit("iconst_1");
-            em.emit(Lend + ":");
-            break; 
-        }
-        case Op::And: {
-            em.emit("iand"); 
-            break;
-        } 
-        case Op::Or: 
-            em.emit("ior"); 
+            code.emit(Opcode::irem); 
             break;
         default: 
             break; 
     }
+    keep(b);
+}
+
+// The operands of a chain a + b + c in evaluation order; a string +
+// on either side belongs to the same chain
+static void concatOperands(Expr& e, std::vector<Expr*>& out) {
+    auto* b = dynamic_cast<Binary*>(&e);
+    if (b && b->op == Op::Plus && b->ty.kind == BasicType::String) {
+        concatOperands(*b->lhs, out);
+        concatOperands(*b->rhs, out);
+    } else {
+        out.push_back(&e);
+    }
+}
+
+// One StringBuilder for the whole chain, one append per operand and one
+// toString(), never a String per +. Adjacent literals are joined first
+// (unless const-fold is off); the builder starts with room for all the
+// literal text, plus the default 16 chars when some operand is only
+// known at run time.
+void CodeGenVisitor::concat(Binary& b) {
+    std::vector<Expr*> operands;
+    concatOperands(b, operands);
+
+    struct Part {
+        Expr*       expr;           // null: `text` is literal
+        std::string text;
+    };
+    std::vector<Part> parts;
+    long joined = 0;
+    for (Expr* e : operands) {
+        auto* lit = dynamic_cast<StringLit*>(e);
+        if (!lit || !folding()) {
+            parts.push_back({e, {}});
+        } else if (lit->value.empty()) {
+            ++joined;
+        } else if (!parts.empty() && !parts.back().expr) {
+            parts.back().text += lit->value;
+            ++joined;
+        } else {
+            parts.push_back({nullptr, lit->value});
+        }
+    }
+    if (report && joined) report->add("concat", "literals joined", joined);
+
+    if (parts.empty() || (parts.size() == 1 && !parts[0].expr)) {
+        code.emitString(Opcode::ldc, code.own(parts.empty() ? std::string() : std::move(parts[0].text)));
+        return;
+    }
+    size_t capacity = 0;
+    bool unknown = false;
+    for (const Part& p : parts) {
+        auto* lit = dynamic_cast<StringLit*>(p.expr);
+        if (!p.expr) capacity += p.text.size();
+        else if (lit) capacity += lit->value.size();
+        else unknown = true;
+    }
+    if (unknown) capacity += 16;
+
+    code.emitRef(Opcode::new_, "java.lang.StringBuilder");
+    code.emit(Opcode::dup);
+    if (capacity == 16) {
+        code.emitRef(Opcode::invokespecial, "void java.lang.StringBuilder.<init>()");
+    } else {
+        emitInt(int(capacity));
+        code.emitRef(Opcode::invokespecial, "void java.lang.StringBuilder.<init>(int)");
+    }
+    for (Part& p : parts) {
+        if (p.expr) p.expr->accept(*this);
+        else code.emitString(Opcode::ldc, code.own(std::move(p.text)));
+        code.emitRef(Opcode::invokevirtual, "java.lang.StringBuilder java.lang.StringBuilder.append(java.lang.String)");
+    }
+    code.emitRef(Opcode::invokevirtual, "java.lang.String java.lang.StringBuilder.toString()");
+    if (report) report->add("concat", "chains built");
+}
+
+// 2^k when `e` is a literal power of two (k ≥ 1)
+static std::optional<int> powerOfTwo(const Expr& e) {
+    auto* lit = dynamic_cast<const IntLit*>(&e);
+    if (!lit) return std::nullopt;
+    uint32_t v = uint32_t(lit->value);
+    if (v < 2 || (v & (v - 1))) return std::nullopt;
+    int k = 0;
+    while (v >>= 1) ++k;
+    return k;
+}
+
+// x * 2^k  → x << k (wraps exactly like imul)
+// x / 2^k  → (x + bias) >> k     bias = 2^k - 1 for negative x, else 0:
+//            (x >> 31) >>> (32 - k), so the quotient rounds toward zero
+// x % 2^k  → x - ((x + bias) & -2^k)
+bool CodeGenVisitor::shifted(Binary& b) {
+    if (!reducing() || b.ty.kind != BasicType::Int) return false;
+    if (b.op == Op::Mul) {
+        Expr* x = b.lhs.get();
+        auto k = powerOfTwo(*b.rhs);
+        if (!k) {
+            k = powerOfTwo(*b.lhs);        // the literal has nothing to evaluate
+            x = b.rhs.get();
+        }
+        if (!k) return false;
+        x->accept(*this);
+        emitInt(*k);
+        code.emit(Opcode::ishl);
+    } else if (b.op == Op::Div || b.op == Op::Mod) {
+        auto k = powerOfTwo(*b.rhs);
+        if (!k || *k == 31) return false;  // 2^31 is negative as an int
+        b.lhs->accept(*this);
+        code.emit(Opcode::dup);
+        if (b.op == Op::Mod) code.emit(Opcode::dup);
+        emitInt(31);
+        if (*k > 1) {
+            code.emit(Opcode::ishr);
+            emitInt(32 - *k);
+        }
+        code.emit(Opcode::iushr);
+        code.emit(Opcode::iadd);
+        if (b.op == Op::Div) {
+            emitInt(*k);
+            code.emit(Opcode::ishr);
+        } else {
+            emitInt(-(1 << *k));
+            code.emit(Opcode::iand);
+            code.emit(Opcode::isub);
+        }
+    } else {
+        return false;
+    }
+    if (report) report->add("strength-reduce", "operations shifted");
+    return true;
+}
+
+//---------------------------------------------------------------
+// Conditions (跳躍式：比較直接分支，&& / || 短路求值)
+//---------------------------------------------------------------
+void CodeGenVisitor::genCond(Expr& e, Label Ltrue, Label Lfalse) {
+    if (auto* b = dynamic_cast<Binary*>(&e)) {
+        if (b->op == Op::And) {
+            // lhs false → whole thing false; rhs decides otherwise
+            Label Lskip = Lfalse.valid() ? Lfalse : ctx.newLabel();
+            genCond(*b->lhs, Label{}, Lskip);
+            genCond(*b->rhs, Ltrue, Lfalse);
+            if (!Lfalse.valid()) code.label(Lskip);
+            return;
+        }
+        if (b->op == Op::Or) {
+            Label Lskip = Ltrue.valid() ? Ltrue : ctx.newLabel();
+            genCond(*b->lhs, Lskip, Label{});
+            genCond(*b->rhs, Ltrue, Lfalse);
+            if (!Ltrue.valid()) code.label(Lskip);
+            return;
+        }
+        if (isComparison(b->op)) {
+            Opcode op = compareBranch(b->op, b->lhs->ty);
+            if (b->lhs->ty.kind != BasicType::String && isZero(*b->rhs)) {
+                b->lhs->accept(*this);              // x < 0  → iflt
+                branch(zeroBranch(op), Ltrue, Lfalse);
+            } else if (b->lhs->ty.kind != BasicType::String && isZero(*b->lhs)) {
+                b->rhs->accept(*this);              // 0 < x  → ifgt
+                branch(zeroBranch(mirror(op)), Ltrue, Lfalse);
+            } else {
+                b->lhs->accept(*this);
+                b->rhs->accept(*this);
+                branch(op, Ltrue, Lfalse);
+            }
+            return;
+        }
+    }
+    if (auto* u = dynamic_cast<Unary*>(&e); u && u->op == Op::Not) {
+        genCond(*u->rhs, Lfalse, Ltrue);
+        return;
+    }
+    if (auto* lit = dynamic_cast<BoolLit*>(&e)) {
+        Label to = lit->value ? Ltrue : Lfalse;
+        if (to.valid()) code.emit(Opcode::goto_, to);
+        return;
+    }
+    e.accept(*this);                                // plain bool value
+    branch(Opcode::ifne, Ltrue, Lfalse);
+}
+
+void CodeGenVisitor::branch(Opcode op, Label Ltrue, Label Lfalse) {
+    if (!Ltrue.valid()) {
+        code.emit(negateBranch(op), Lfalse);
+        return;
+    }
+    code.emit(op, Ltrue);
+    if (Lfalse.valid()) code.emit(Opcode::goto_, Lfalse);
+}
+
+void CodeGenVisitor::genBool(Expr& e) {
+    Label Ltrue = ctx.newLabel(), Lend = ctx.newLabel();
+    genCond(e, Ltrue, Label{});
+    code.emit(Opcode::iconst_0);
+    code.emit(Opcode::goto_, Lend);
+    code.label(Ltrue);
+    code.emit(Opcode::iconst_1);
+    code.label(Lend);
 }
 
 //---------------------------------------------------------------
 // Return (只支援 void / int / bool / string)
 //---------------------------------------------------------------
 void CodeGenVisitor::visit(ReturnStmt& r) { 
+    if (!inlineExits.empty()) {
+        // inside an expansion: leave the value on the stack for the caller
+        if (r.expr) r.expr->accept(*this);
+        code.emit(Opcode::goto_, inlineExits.back());
+        return;
+    }
+    if (tailCall(r)) return;
     if (r.expr) { 
         r.expr->accept(*this); 
         // Check the return type and emit appropriate return instruction
         if (r.expr->ty.kind == BasicType::String) {
-            em.emit("areturn");
+            code.emit(Opcode::areturn);
         } else {
-            em.emit("ireturn"); 
+            code.emit(Opcode::ireturn); 
         }
     } else {
-        em.emit("return"); 
+        code.emit(Opcode::return_); 
     }
 }
 
+// The arguments are all evaluated before any parameter is
+// overwritten, then the body starts over in the same frame
+bool CodeGenVisitor::tailCall(ReturnStmt& r) {
+    auto* c = dynamic_cast<Call*>(r.expr.get());
+    if (!c || !entry.valid() || c->callee != function->name) return false;
+    for (auto& arg : c->args) arg->accept(*this);
+    for (size_t i = function->params.size(); i-- > 0;)
+        emitStore(function->params[i]->sym);
+    code.emit(Opcode::goto_, entry);
+    if (report) report->add("tail-rec." + function->name, "calls converted");
+    return true;
+}
+
 //---------------------------------------------------------------
 // Call (static, same class, void / int / bool / string)
 //---------------------------------------------------------------
@@ -400,41 +954,95 @@ void CodeGenVisitor::visit(ast::Call& c)
 {
     for (auto& arg : c.args) arg->accept(*this);
 
-    const SymEntry fn = c.sym;                     
-    std::stringstream sig;
-    sig << '(';
-    if (fn.paramTypes) {
-        for (size_t i = 0; i < fn.paramTypes->size(); ++i) {
-            sig << jasmType((*fn.paramTypes)[i]);
-            if (i + 1 < fn.paramTypes->size()) sig << ", ";
+    if (inliner)
+        if (auto* fn = inliner->candidate(c.callee, loopDepth > 0, int(inlineExits.size()))) {
+            expand(*fn);
+            return;
         }
+    code.emitRef(Opcode::invokestatic, methodRef(c.sym));
+}
+
+// The pushed arguments go into slots above everything the caller
+// uses; the callee's body then runs with its slots shifted there.
+void CodeGenVisitor::expand(const FuncDecl& fn) {
+    int base = ctx.currentLocal();
+    for (size_t i = fn.params.size(); i-- > 0;) {
+        const SymEntry& p = fn.params[i]->sym;
+        code.emit(isReference(p.type) ? Opcode::astore : Opcode::istore, base + p.slot);
     }
-    sig << ')';
-    em.emit("invokestatic " + jasmType(fn.returnType.value()) + ' ' + ctx.className + '.' + fn.name + sig.str());
+
+    int outerBase = std::exchange(slotBase, base);
+    ctx.resetLocal(base + std::max(fn.localSlots, int(fn.params.size())));
+    Label Lexit = ctx.newLabel();
+    inlineExits.push_back(Lexit);
+    fn.body->accept(*this);
+    inlineExits.pop_back();
+    code.label(Lexit);
+    ctx.resetLocal(base);
+    slotBase = outerBase;
+    if (report) report->add("inline", "calls inlined");
 }
 
 
 // ----------------------------------------------------------------
 // Helper methods for loading/storing variables
 // ----------------------------------------------------------------
-void CodeGenVisitor::emitLoad(const SymEntry entry) {
+void CodeGenVisitor::emitLoad(const SymEntry& entry) {
     if (entry.isGlobal) {
-        std::string desc = (entry.type.kind == BasicType::String ? "java.lang.String" :
-                            (entry.type.kind == BasicType::Bool ? "boolean" : "int"));
-        em.emit("getstatic " + desc + ' ' + ctx.className + "." + entry.name + " ");
+        code.emitRef(Opcode::getstatic, fieldRef(entry));
     } else {
-        em.emit("iload " + std::to_string(entry.slot));
+        code.emit(isReference(entry.type) ? Opcode::aload : Opcode::iload, slotBase + entry.slot);
     }
 }
 
-void CodeGenVisitor::emitStore(const SymEntry entry) {
+void CodeGenVisitor::emitStore(const SymEntry& entry) {
     if (entry.isGlobal) {
-        std::string desc = (entry.type.kind == BasicType::String ? "java.lang.String" :
-                            (entry.type.kind == BasicType::Bool ? "boolean" : "int"));
-        em.emit("putstatic " + desc + ' ' + ctx.className + "." + entry.name + " ");
+        code.emitRef(Opcode::putstatic, fieldRef(entry));
     } else {
-        em.emit("istore " + std::to_string(entry.slot));
+        code.emit(isReference(entry.type) ? Opcode::astore : Opcode::istore, slotBase + entry.slot);
+    }
+}
+
+// ----------------------------------------------------------------
+// Cached descriptors: built once per symbol, then appended as is
+// ----------------------------------------------------------------
+std::string CodeGenVisitor::paramList(const SymEntry& fn) {
+    std::string list = "(";
+    if (fn.paramTypes) {
+        for (size_t i = 0; i < fn.paramTypes->size(); ++i) {
+            list += jasmType((*fn.paramTypes)[i]);
+            if (i + 1 < fn.paramTypes->size()) list += ", ";
+        }
     }
+    list += ')';
+    return list;
+}
+
+const std::string& CodeGenVisitor::fieldRef(const SymEntry& var) {
+    auto it = fieldRefs.find(var.name);
+    if (it == fieldRefs.end()) {
+        std::string ref(jasmType(var.type));
+        ref += ' ';
+        ref += ctx.className;
+        ref += '.';
+        ref += var.name;
+        it = fieldRefs.emplace(var.name, std::move(ref)).first;
+    }
+    return it->second;
+}
+
+const std::string& CodeGenVisitor::methodRef(const SymEntry& fn) {
+    auto it = methodRefs.find(fn.name);
+    if (it == methodRefs.end()) {
+        std::string ref(jasmType(fn.returnType.value()));
+        ref += ' ';
+        ref += ctx.className;
+        ref += '.';
+        ref += fn.name;
+        ref += paramList(fn);
+        it = methodRefs.emplace(fn.name, std::move(ref)).first;
+    }
+    return it->second;
 }
 
 // ----------------------------------------------------------------
@@ -442,86 +1050,145 @@ void CodeGenVisitor::emitStore(const SymEntry entry) {
 // ----------------------------------------------------------------
 void CodeGenVisitor::visit(ast::ForStmt& s) {
     if (s.init) s.init->accept(*this);
-    auto lblStart = ctx.newLabel(), lblEnd = ctx.newLabel();
-    em.emit(lblStart + ":");
-    if (s.cond) { 
-        s.cond->accept(*this); 
-        em.emit("ifeq " + lblEnd); 
-    }
-    if (s.body) s.body->accept(*this);
-    if (s.step) s.step->accept(*this);
-    em.emit("goto " + lblStart);
-    em.emit(lblEnd + ":");
+    int saved = ctx.currentLocal();
+    auto temps = hoist({s.cond.get(), s.body.get(), s.step.get()});
+    reduce(temps);
+    loop(s.cond.get(), s.body.get(), s.step.get());
+    unhoist(temps);
+    ctx.resetLocal(saved);
 }
 
+// foreach (i : a .. b) walks a→b inclusive, upwards or downwards.
+// The body is emitted once. Constant bounds fix the direction at
+// compile time; otherwise the direction is decided once at run time
+// and kept in hidden locals:
+//   step  = +1 / -1
+//   flip  =  0 / -1      (x ^ -1 reverses the int order, no overflow)
+//   bound = b ^ flip     loop while (i ^ flip) <= bound
 void CodeGenVisitor::visit(ast::ForEachStmt& s) {
     auto* range = dynamic_cast<ast::RangeExpr*>(s.collection.get());
     if (!range) return;
 
     const SymEntry& idxSym = s.var->sym;        // Loop variable i
+    Label L_body = ctx.newLabel(), L_cond = ctx.newLabel();
+    Label L_next = ctx.newLabel(), L_end = ctx.newLabel();   // continue / break
+    int outer = ctx.currentLocal();
+    auto temps = hoist({s.body.get()}, s.var.get());
+
+    auto lo = constInt(range->start.get()), hi = constInt(range->end.get());
+    if (lo && hi) {
+        bool up = *lo <= *hi;
+        emitInt(*lo);
+        emitStore(idxSym);
+        reduce(temps);
+        code.emit(Opcode::goto_, L_cond);
 
-    range->start->accept(*this);                // push start
-    emitStore(idxSym);                          // istore idxSlot
-
-    // Determine ascending or descending order
-    range->start->accept(*this);                // push start
-    range->end->accept(*this);                  // push end
-    std::string L_ascCond  = ctx.newLabel();
-    std::string L_descCond = ctx.newLabel();
-    std::string L_end      = ctx.newLabel();
-    em.emit("if_icmple " + L_ascCond);          // start <= end → ascending
-    em.emit("goto " + L_descCond);              // or descending
-
-    // ascending
-    em.emit(L_ascCond + ":");
-    {
-        std::string L_body = ctx.newLabel();
-        em.emit("goto " + L_body + "_cond");
-
-        // body
-        em.emit(L_body + ":");
+        code.label(L_body);
+        ++loopDepth;
+        ctx.pushLoop(L_next, L_end);
         s.body->accept(*this);
-
-        // i = i + 1
-        emitLoad(idxSym);
-        em.emit("iconst_1");
-        em.emit("iadd");
+        ctx.popLoop();
+        --loopDepth;
+        code.label(L_next);
+        emitLoad(idxSym);                       // i = i ± 1
+        code.emit(Opcode::iconst_1);
+        code.emit(up ? Opcode::iadd : Opcode::isub);
         emitStore(idxSym);
+        if (!idxSym.isGlobal) stepped(slotBase + idxSym.slot, up ? 1 : -1);
 
-        // condition
-        em.emit(L_body + "_cond:");
-        emitLoad(idxSym);           // push i
-        range->end->accept(*this);  // push end
-        em.emit("if_icmple " + L_body);   // i <= end → 進下一輪
-        em.emit("goto " + L_end);         // 否則結束
+        code.label(L_cond);
+        emitLoad(idxSym);
+        emitInt(*hi);
+        code.emit(up ? Opcode::if_icmple : Opcode::if_icmpge, L_body);
+        code.label(L_end);
+        unhoist(temps);
+        ctx.resetLocal(outer);
+        return;
     }
 
-    // acending
-    em.emit(L_descCond + ":");
-    {
-        std::string L_body = ctx.newLabel();
-        em.emit("goto " + L_body + "_cond");
-
-        // body
-        em.emit(L_body + ":");
-        s.body->accept(*this);
-
-        // i = i - 1
-        emitLoad(idxSym);
-        em.emit("iconst_1");
-        em.emit("isub");
-        emitStore(idxSym);
+    int step = ctx.allocLocal(), flip = ctx.allocLocal(), bound = ctx.allocLocal();
+    Label L_up = ctx.newLabel(), L_dir = ctx.newLabel();
+
+    range->start->accept(*this);                // i = a, evaluated once
+    emitStore(idxSym);
+    range->end->accept(*this);                  // b, evaluated once
+    code.emit(Opcode::istore, bound);
+
+    emitLoad(idxSym);                           // flip = a <= b ? 0 : -1
+    code.emit(Opcode::iload, bound);
+    code.emit(Opcode::if_icmple, L_up);
+    code.emit(Opcode::iconst_m1);
+    code.emit(Opcode::goto_, L_dir);
+    code.label(L_up);
+    code.emit(Opcode::iconst_0);
+    code.label(L_dir);
+    code.emit(Opcode::dup);
+    code.emit(Opcode::istore, flip);
+    code.emit(Opcode::dup);                     // step = flip | 1
+    code.emit(Opcode::iconst_1);
+    code.emit(Opcode::ior);
+    code.emit(Opcode::istore, step);
+    code.emit(Opcode::iload, bound);            // bound ^= flip
+    code.emit(Opcode::ixor);
+    code.emit(Opcode::istore, bound);
+    auto& products = temps.products;            // i moves by a run-time step here
+    products.erase(std::remove_if(products.begin(), products.end(),
+                                  [&](const auto& p) { return p.slot == idxSym.slot; }),
+                   products.end());
+    reduce(temps);
+    code.emit(Opcode::goto_, L_cond);
+
+    code.label(L_body);
+    ++loopDepth;
+    ctx.pushLoop(L_next, L_end);
+    s.body->accept(*this);
+    ctx.popLoop();
+    --loopDepth;
+    code.label(L_next);
+    emitLoad(idxSym);                           // i += step
+    code.emit(Opcode::iload, step);
+    code.emit(Opcode::iadd);
+    emitStore(idxSym);
+
+    code.label(L_cond);
+    emitLoad(idxSym);
+    code.emit(Opcode::iload, flip);
+    code.emit(Opcode::ixor);
+    code.emit(Opcode::iload, bound);
+    code.emit(Opcode::if_icmple, L_body);
+    code.label(L_end);
+    unhoist(temps);
+    ctx.resetLocal(outer);
+}
 
-        // condiction
-        em.emit(L_body + "_cond:");
-        emitLoad(idxSym);           // push i
-        range->end->accept(*this);  // push end
-        em.emit("if_icmpge " + L_body);   // i >= end → 進下一輪
-        em.emit("goto " + L_end);
+//---------------------------------------------------------------
+// switch: dispatch (SwitchLowering), then the arms in source order;
+// an arm ends with a jump past the others
+//---------------------------------------------------------------
+void CodeGenVisitor::visit(ast::SwitchStmt& s) {
+    Label Lend = ctx.newLabel(), Ldflt = Lend;
+    std::vector<Label> arms;
+    std::vector<SwitchLowering::Case> cases;
+    for (auto& c : s.cases) {
+        arms.push_back(ctx.newLabel());
+        if (c.isDefault) Ldflt = arms.back();
+        for (int v : c.values) cases.push_back({v, arms.back()});
     }
 
-    // Exit loop
-    em.emit(L_end + ":");
+    s.cond->accept(*this);
+    int saved = ctx.currentLocal();
+    switches.run(std::move(cases), Ldflt, code, ctx, report);
+    ctx.resetLocal(saved);
+
+    ctx.pushLoop(loopDepth > 0 ? ctx.topLoopBegin() : Label{}, Lend);   // break leaves the switch
+    for (size_t k = 0; k < s.cases.size(); ++k) {
+        code.label(arms[k]);
+        s.cases[k].body->accept(*this);
+        if (!endsWithReturn(s.cases[k].body.get())) code.emit(Opcode::goto_, Lend);
+    }
+    ctx.popLoop();
+    code.label(Lend);
+    code.emit(Opcode::nop);
 }
 
 void CodeGenVisitor::visit(ast::VarDeclList& dl) {
@@ -544,7 +1211,7 @@ void CodeGenVisitor::visit(ast::ExprStmt& s) {
     if (s.expr) {
         s.expr->accept(*this);      
         if (s.expr->ty.kind != BasicType::Void && s.expr->ty.kind != BasicType::ERROR) {
-            em.emit("pop");
+            code.emit(Opcode::pop);
         }
     }
 }
@@ -553,36 +1220,233 @@ void CodeGenVisitor::visit(ast::EmptyStmt& s) {
     // no-op
 }
 
+// the innermost loop (or switch, for break) pushed its labels on ctx
+void CodeGenVisitor::visit(ast::BreakStmt&) {
+    code.emit(Opcode::goto_, ctx.topLoopExit());
+}
+
+void CodeGenVisitor::visit(ast::ContinueStmt&) {
+    code.emit(Opcode::goto_, ctx.topLoopBegin());
+}
+
+//---------------------------------------------------------------
+// Read: tokens come out of a 64 KiB buffer that _read() refills from
+// System.in with one read(byte[], int, int), so a million ints cost a
+// few dozen system calls and no Scanner / regex work
+//---------------------------------------------------------------
 void CodeGenVisitor::visit(ast::Read& r) {
-    // stub: no code
+    Var& v = *r.var;
+    if (v.ty.kind == BasicType::Float || v.ty.kind == BasicType::Double) return;   // no code generation for reals yet
+    input = true;
+    if (v.indices.empty()) {
+        emitRead(v.ty);
+        emitStore(v.sym);
+        return;
+    }
+    // element: array reference and index first, the value on top
+    emitLoad(v.sym);
+    for (size_t k = 0; k < v.indices.size(); ++k) {
+        if (k) code.emit(Opcode::aaload);
+        v.indices[k]->accept(*this);
+    }
+    emitRead(v.ty);
+    switch (v.ty.kind) {
+        case BasicType::Bool:   code.emit(Opcode::bastore); break;
+        case BasicType::Char:   code.emit(Opcode::castore); break;
+        case BasicType::String: code.emit(Opcode::aastore); break;
+        default:                code.emit(Opcode::iastore); break;
+    }
+}
+
+// ints are parsed straight from the bytes; other types take a token
+// (the next run of bytes above ' ') and convert it
+void CodeGenVisitor::emitRead(const Type& t) {
+    switch (t.kind) {
+        case BasicType::Bool:
+            code.emitRef(Opcode::invokestatic, inputRef(In::Token));
+            code.emitRef(Opcode::invokestatic, "boolean java.lang.Boolean.parseBoolean(java.lang.String)");
+            break;
+        case BasicType::Char:
+            code.emitRef(Opcode::invokestatic, inputRef(In::Token));
+            code.emit(Opcode::iconst_0);
+            code.emitRef(Opcode::invokevirtual, "char java.lang.String.charAt(int)");
+            break;
+        case BasicType::String:
+            code.emitRef(Opcode::invokestatic, inputRef(In::Token));
+            break;
+        default:
+            code.emitRef(Opcode::invokestatic, inputRef(In::Int));
+            break;
+    }
+}
+
+std::string_view CodeGenVisitor::inputRef(In which) {
+    static constexpr std::string_view refs[] = {
+        "byte[] %._in", "int %._inPos", "int %._inLen",
+        "int %._read()", "int %._readInt()", "java.lang.String %._readToken()",
+    };
+    std::string& ref = inRefs[size_t(which)];
+    if (ref.empty()) {
+        std::string_view r = refs[size_t(which)];
+        size_t at = r.find('%');
+        ref.append(r.substr(0, at)).append(ctx.className).append(r.substr(at + 1));
+    }
+    return ref;
+}
+
+void CodeGenVisitor::emitInputMethods() {
+    auto read = [&](int slot) {
+        code.emitRef(Opcode::invokestatic, inputRef(In::Byte));
+        code.emit(Opcode::istore, slot);
+    };
+    // c ≤ ' ' (or end of input): skip to `again`, or to `end` at the end
+    auto skipBlanks = [&](Label again, Label end) {
+        code.label(again);
+        read(0);
+        code.emit(Opcode::iload, 0);
+        code.emit(Opcode::iflt, end);
+        code.emit(Opcode::iload, 0);
+        code.emit(Opcode::bipush, ' ');
+        code.emit(Opcode::if_icmple, again);
+    };
+
+    // int _read(): the next byte (0..255), -1 at the end of the input
+    beginMethod("static int _read()");
+    Label have = ctx.newLabel();
+    code.emitRef(Opcode::getstatic, inputRef(In::Pos));
+    code.emitRef(Opcode::getstatic, inputRef(In::Len));
+    code.emit(Opcode::if_icmplt, have);
+    if (buffering()) {      // whatever was printed shows before the program waits for input
+        code.emitRef(Opcode::getstatic, printStream());
+        code.emitRef(Opcode::invokevirtual, "void java.io.PrintStream.flush()");
+    }
+    code.emitRef(Opcode::getstatic, "java.io.InputStream java.lang.System.in");
+    code.emitRef(Opcode::getstatic, inputRef(In::Buffer));
+    code.emit(Opcode::iconst_0);
+    code.emitRef(Opcode::getstatic, inputRef(In::Buffer));
+    code.emit(Opcode::arraylength);
+    code.emitRef(Opcode::invokevirtual, "int java.io.InputStream.read(byte[], int, int)");
+    code.emit(Opcode::dup);
+    code.emitRef(Opcode::putstatic, inputRef(In::Len));
+    code.emit(Opcode::iconst_0);
+    code.emitRef(Opcode::putstatic, inputRef(In::Pos));
+    code.emit(Opcode::ifgt, have);
+    code.emit(Opcode::iconst_m1);
+    code.emit(Opcode::ireturn);
+    code.label(have);
+    code.emitRef(Opcode::getstatic, inputRef(In::Buffer));
+    code.emitRef(Opcode::getstatic, inputRef(In::Pos));
+    code.emit(Opcode::dup);
+    code.emit(Opcode::iconst_1);
+    code.emit(Opcode::iadd);
+    code.emitRef(Opcode::putstatic, inputRef(In::Pos));
+    code.emit(Opcode::baload);
+    code.emit(Opcode::sipush, 0xff);
+    code.emit(Opcode::iand);
+    code.emit(Opcode::ireturn);
+    endMethod(0);
+
+    // int _readInt(): [-]digits after blanks; 0 at the end of the input
+    // locals: 0 c, 1 negative, 2 n
+    beginMethod("static int _readInt()");
+    Label skip = ctx.newLabel(), eof = ctx.newLabel(), digits = ctx.newLabel();
+    Label next = ctx.newLabel(), test = ctx.newLabel(), positive = ctx.newLabel(), done = ctx.newLabel();
+    skipBlanks(skip, eof);
+    code.emit(Opcode::iconst_0);
+    code.emit(Opcode::istore, 1);
+    code.emit(Opcode::iload, 0);
+    code.emit(Opcode::bipush, '-');
+    code.emit(Opcode::if_icmpne, digits);
+    code.emit(Opcode::iconst_1);
+    code.emit(Opcode::istore, 1);
+    read(0);
+    code.label(digits);
+    code.emit(Opcode::iconst_0);
+    code.emit(Opcode::istore, 2);
+    code.emit(Opcode::goto_, test);
+    code.label(next);                   // n = n * 10 + (c - '0')
+    code.emit(Opcode::iload, 2);
+    code.emit(Opcode::bipush, 10);
+    code.emit(Opcode::imul);
+    code.emit(Opcode::iload, 0);
+    code.emit(Opcode::bipush, '0');
+    code.emit(Opcode::isub);
+    code.emit(Opcode::iadd);
+    code.emit(Opcode::istore, 2);
+    read(0);
+    code.label(test);
+    code.emit(Opcode::iload, 0);
+    code.emit(Opcode::bipush, '0');
+    code.emit(Opcode::if_icmplt, done);
+    code.emit(Opcode::iload, 0);
+    code.emit(Opcode::bipush, '9');
+    code.emit(Opcode::if_icmple, next);
+    code.label(done);
+    code.emit(Opcode::iload, 1);
+    code.emit(Opcode::ifeq, positive);
+    code.emit(Opcode::iload, 2);
+    code.emit(Opcode::ineg);
+    code.emit(Opcode::ireturn);
+    code.label(positive);
+    code.emit(Opcode::iload, 2);
+    code.emit(Opcode::ireturn);
+    code.label(eof);
+    code.emit(Opcode::iconst_0);
+    code.emit(Opcode::ireturn);
+    endMethod(0);
+
+    // String _readToken(): the bytes up to the next blank, "" at the end
+    // of the input; locals: 0 c, 1 the StringBuilder
+    beginMethod("static java.lang.String _readToken()");
+    Label blank = ctx.newLabel(), more = ctx.newLabel(), none = ctx.newLabel();
+    skipBlanks(blank, none);
+    code.emitRef(Opcode::new_, "java.lang.StringBuilder");
+    code.emit(Opcode::dup);
+    code.emitRef(Opcode::invokespecial, "void java.lang.StringBuilder.<init>()");
+    code.emit(Opcode::astore, 1);
+    code.label(more);
+    code.emit(Opcode::aload, 1);
+    code.emit(Opcode::iload, 0);
+    code.emitRef(Opcode::invokevirtual, "java.lang.StringBuilder java.lang.StringBuilder.append(char)");
+    code.emit(Opcode::pop);
+    read(0);
+    code.emit(Opcode::iload, 0);
+    code.emit(Opcode::bipush, ' ');
+    code.emit(Opcode::if_icmpgt, more);
+    code.emit(Opcode::aload, 1);
+    code.emitRef(Opcode::invokevirtual, "java.lang.String java.lang.StringBuilder.toString()");
+    code.emit(Opcode::areturn);
+    code.label(none);
+    code.emitString(Opcode::ldc, "");
+    code.emit(Opcode::areturn);
+    endMethod(0);
 }
 
 void CodeGenVisitor::visit(ast::CharLit& c) {
-    em.emit("ldc '" + std::string(1, c.value) + "'");
+    code.emitRef(Opcode::ldc, code.own(std::string{'\'', c.value, '\''}));
 }
 
 void CodeGenVisitor::visit(ast::RealLit& r) {
-    em.emit("ldc2_w " + std::to_string(r.value));
+    code.emitRef(Opcode::ldc2_w, code.own(std::to_string(r.value)));
 }
 
 void CodeGenVisitor::visit(ast::Postfix& p) {
     const auto& sym = p.operand->sym;
-    std::string desc = jasmType(p.ty);
-    std::string field = ctx.className + "." + sym.name;
 
     if (sym.isGlobal) {
-        em.emit("getstatic " + desc + " " + field);
-        em.emit("dup");            
-        em.emit("iconst_1");       
-        if (p.op == Op::Inc) em.emit("iadd"); else em.emit("isub");
-        em.emit("putstatic " + desc + " " + field);
+        code.emitRef(Opcode::getstatic, fieldRef(sym));
+        code.emit(Opcode::dup);            
+        code.emit(Opcode::iconst_1);       
+        if (p.op == Op::Inc) code.emit(Opcode::iadd); else code.emit(Opcode::isub);
+        code.emitRef(Opcode::putstatic, fieldRef(sym));
     } else {
-        int slot = sym.slot;
-        em.emit("iload " + std::to_string(slot)); 
-        em.emit("dup");                             
-        em.emit("iconst_1");                        
-        if (p.op == Op::Inc) em.emit("iadd"); else em.emit("isub");
-        em.emit("istore " + std::to_string(slot));  
+        int slot = slotBase + sym.slot;
+        if (!inductions.empty()) stepped(slot, p.op == Op::Inc ? 1 : -1);   // before, so the dup / pop stays intact
+        code.emit(Opcode::iload, slot);
+        code.emit(Opcode::dup);                             
+        code.emit(Opcode::iconst_1);                        
+        if (p.op == Op::Inc) code.emit(Opcode::iadd); else code.emit(Opcode::isub);
+        code.emit(Opcode::istore, slot);
     }
 }
 
@@ -618,6 +1482,17 @@ bool CodeGenVisitor::endsWithReturn(ast::Stmt* stmt) {
         }
         return false; // if without else can't guarantee return
     }
-    
+
+    // Switch statement - every arm must return, a default must catch the rest, and no arm may break out
+    if (auto* sw = dynamic_cast<ast::SwitchStmt*>(stmt)) {
+        if (sw->hasBreak) return false;
+        bool dflt = false;
+        for (auto& c : sw->cases) {
+            if (!endsWithReturn(c.body.get())) return false;
+            dflt = dflt || c.isDefault;
+        }
+        return dflt;
+    }
+
     return false;
 }
@@ -0,0 +1,99 @@
+#include "CompilerOptions.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static void usage() {
+    std::cerr << "Usage: parser [options] <FILE_NAME>\n"
+              << "  <FILE_NAME>        .sd source, or .sdsnap snapshot to generate code from\n"
+              << "  --emit-snapshot    write <name>.sdsnap after semantic analysis\n"
+              << "  --time             print per-phase timings to stderr\n"
+              << "  -j, --jobs N       analyse and generate functions on N worker threads\n"
+              << "  --stream           compile function by function while parsing (bounded memory)\n"
+              << "  -O0, -O1           disable / enable optimizations (default -O1)\n"
+              << "  --disable=A,B      switch off the named optimizations\n"
+              << "  --opt-report       print per-optimization statistics to stderr\n"
+              << "  --ir               generate methods through the SSA IR (experimental)\n"
+              << "  --dump-ir          print the SSA IR of every function after its passes\n"
+              << "  --buffered-output  buffer print / println, flush when main returns\n"
+              << "  --emit=jasm|class  write Jasmin text (default) or a verifiable .class file\n"
+              << "  --run              run the program on the built-in bytecode VM instead\n";
+}
+
+bool parseOptions(int argc, char* argv[], CompilerOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--emit-snapshot") {
+            opts.emitSnapshot = true;
+        } else if (arg == "--time") {
+            opts.timePhases = true;
+        } else if (arg == "-O0" || arg == "-O1") {
+            opts.optLevel = arg[2] - '0';
+        } else if (arg == "--opt-report") {
+            opts.optReport = true;
+        } else if (arg.rfind("--disable=", 0) == 0) {
+            std::string list = arg.substr(10);
+            for (size_t pos = 0; pos <= list.size();) {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos) comma = list.size();
+                if (comma > pos) opts.disabled.insert(list.substr(pos, comma - pos));
+                pos = comma + 1;
+            }
+        } else if (arg == "--ir") {
+            opts.viaIR = true;
+        } else if (arg == "--dump-ir") {
+            opts.dumpIR = true;
+        } else if (arg == "--buffered-output") {
+            opts.bufferedOutput = true;
+        } else if (arg == "--emit=class" || arg == "--emit=jasm") {
+            opts.emitClass = arg == "--emit=class";
+        } else if (arg == "--run") {
+            opts.run = true;
+        } else if (arg == "--stream") {
+            opts.stream = true;
+        } else if (arg == "-j" || arg == "--jobs") {
+            if (i + 1 >= argc) {
+                usage();
+                return false;
+            }
+            try {
+                int n = std::stoi(argv[++i]);
+                if (n < 1) throw std::out_of_range("jobs");
+                opts.jobs = unsigned(n);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid job count: " << argv[i] << '\n';
+                return false;
+            }
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << '\n';
+            usage();
+            return false;
+        } else if (opts.inputFile.empty()) {
+            opts.inputFile = arg;
+        } else {
+            usage();
+            return false;
+        }
+    }
+    if (opts.inputFile.empty()) {
+        usage();
+        return false;
+    }
+    // Streaming never holds the whole program, which these modes need
+    if (opts.stream && (opts.emitSnapshot || opts.jobs > 0 || opts.dumpIR)) {
+        std::cerr << "--stream cannot be combined with --emit-snapshot, --jobs or --dump-ir\n";
+        return false;
+    }
+    // Streamed methods are spilled as Jasmin text before the class is assembled
+    if (opts.stream && opts.emitClass) {
+        std::cerr << "--stream cannot be combined with --emit=class\n";
+        return false;
+    }
+    // --run executes the analysed tree in-process; there is no file to write
+    if (opts.run && (opts.stream || opts.emitClass)) {
+        std::cerr << "--run cannot be combined with --stream or --emit=class\n";
+        return false;
+    }
+    return true;
+}
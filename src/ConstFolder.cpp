@@ -0,0 +1,304 @@
+#include "ConstFolder.hpp"
+#include "ConstInterpreter.hpp"
+#include "OptReport.hpp"
+#include "SemanticAnalyzer.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace ast;
+
+namespace {
+
+// Literal node for `value`, typed like the expression it replaces
+std::unique_ptr<Expr> literal(const ConstValue& value, const Expr& was) {
+    std::unique_ptr<Expr> lit;
+    if (auto* i = std::get_if<int>(&value))
+        lit = std::make_unique<IntLit>(*i, was.line);
+    else if (auto* b = std::get_if<bool>(&value))
+        lit = std::make_unique<BoolLit>(*b, was.line);
+    else if (auto* s = std::get_if<std::string>(&value))
+        lit = std::make_unique<StringLit>(*s, was.line);
+    if (lit) lit->ty = was.ty;
+    return lit;
+}
+
+// constant condition → its value
+const BoolLit* constCond(const std::unique_ptr<Expr>& cond) {
+    return cond ? dynamic_cast<const BoolLit*>(cond.get()) : nullptr;
+}
+
+// What a print / println of a literal writes (without the newline)
+std::optional<std::string> printedText(const Stmt& s, bool& newline) {
+    const Expr* e = nullptr;
+    if (auto* p = dynamic_cast<const Print*>(&s)) e = p->expr.get(), newline = false;
+    else if (auto* p = dynamic_cast<const Println*>(&s)) e = p->expr.get(), newline = true;
+    if (auto* str = dynamic_cast<const StringLit*>(e)) return str->value;
+    if (auto* i = dynamic_cast<const IntLit*>(e)) return std::to_string(i->value);
+    if (auto* b = dynamic_cast<const BoolLit*>(e)) return std::string(b->value ? "true" : "false");
+    return std::nullopt;
+}
+
+// Calls, assignments or ++ / -- anywhere in `e`: left for run time, it
+// may change globals
+bool mayWrite(const Expr& e) {
+    if (dynamic_cast<const Call*>(&e) || dynamic_cast<const Assign*>(&e) || dynamic_cast<const Postfix*>(&e))
+        return true;
+    if (auto* b = dynamic_cast<const Binary*>(&e)) return mayWrite(*b->lhs) || mayWrite(*b->rhs);
+    if (auto* u = dynamic_cast<const Unary*>(&e)) return mayWrite(*u->rhs);
+    if (auto* v = dynamic_cast<const Var*>(&e))
+        return std::any_of(v->indices.begin(), v->indices.end(), [](auto& i) { return mayWrite(*i); });
+    return false;
+}
+
+} // namespace
+
+//---------------------------------------------------------------
+// entry points: visit, then swap in what the visit produced
+//---------------------------------------------------------------
+void ConstFolder::fold(std::unique_ptr<Expr>& e) {
+    value.reset();
+    isLiteral = false;
+    called = false;
+    if (!e) return;
+    e->accept(*this);
+    bool evaluated = std::exchange(called, false);
+    if (!value || isLiteral) return;
+    if (auto lit = literal(*value, *e)) {
+        e = std::move(lit);
+        if (report && !evaluated) report->add("const-fold", "expressions folded");
+    } else {
+        value.reset();   // no literal form (real / char)
+    }
+}
+
+void ConstFolder::fold(std::unique_ptr<Stmt>& s) {
+    if (!s) return;
+    replacement.reset();
+    s->accept(*this);
+    if (replacement) s = std::move(replacement);
+}
+
+void ConstFolder::fold(Program& program) {
+    // values the globals hold once <clinit> got this far
+    std::unordered_map<std::string, ConstValue> known;
+    auto global = [&](VarDecl& vd) {
+        fold(vd.init);
+        if (vd.init && !value && interpreter)
+            if (auto v = interpreter->evalInit(*vd.init, known))
+                if (auto lit = literal(*v, *vd.init)) {
+                    vd.init = std::move(lit);
+                    value = std::move(v);
+                    if (report) report->add("const-eval", "initializers evaluated");
+                }
+        if (vd.init && !value && mayWrite(*vd.init)) known.clear();   // nothing before it is certain any more
+        if (!vd.dims.empty()) return;
+        if (vd.init) {
+            if (value) known[vd.name] = *value;
+        } else if (vd.varType.kind == BasicType::Int) {
+            known[vd.name] = 0;
+        } else if (vd.varType.kind == BasicType::Bool) {
+            known[vd.name] = false;
+        }
+    };
+    for (auto& d : program.globals) {
+        if (auto* list = dynamic_cast<VarDeclList*>(d.get())) {
+            for (auto& inner : list->decls) global(*inner);
+        } else if (auto* vd = dynamic_cast<VarDecl*>(d.get())) {
+            global(*vd);
+        } else if (auto* f = dynamic_cast<FuncDecl*>(d.get())) {
+            fold(f->body);
+        }
+    }
+    for (auto& s : program.stmts)
+        if (auto* f = dynamic_cast<FuncDecl*>(s.get())) fold(f->body);
+}
+
+void ConstFolder::foldIndices(Var& v) {
+    for (auto& idx : v.indices) fold(idx);
+}
+
+void ConstFolder::pruned(std::unique_ptr<Stmt> kept, int line) {
+    replacement = kept ? std::move(kept) : std::make_unique<EmptyStmt>(line);
+    if (report) report->add("const-fold", "branches pruned");
+}
+
+//---------------------------------------------------------------
+// expressions: children first, then this node if they are known
+//---------------------------------------------------------------
+void ConstFolder::visit(IntLit& n)    { value = n.value; isLiteral = true; }
+void ConstFolder::visit(RealLit& n)   { value = n.value; isLiteral = true; }
+void ConstFolder::visit(StringLit& n) { value = n.value; isLiteral = true; }
+void ConstFolder::visit(BoolLit& n)   { value = n.value; isLiteral = true; }
+void ConstFolder::visit(CharLit& n)   { value = n.value; isLiteral = true; }
+
+void ConstFolder::visit(Var& v) {
+    foldIndices(v);
+    value.reset();
+    if (v.indices.empty() && v.sym.isConst && !v.sym.isFunc) value = v.sym.value;
+    isLiteral = false;
+}
+
+void ConstFolder::visit(Unary& u) {
+    fold(u.rhs);
+    value = value ? foldUnary(u.op, *value) : std::nullopt;
+    isLiteral = false;
+}
+
+void ConstFolder::visit(Binary& b) {
+    fold(b.lhs);
+    std::optional<ConstValue> lhs = std::move(value);
+    // false && x, true || x: the left side decides
+    if (lhs && (b.op == Op::And || b.op == Op::Or))
+        if (auto* l = std::get_if<bool>(&*lhs); l && *l == (b.op == Op::Or)) {
+            value = *l;
+            isLiteral = false;
+            return;
+        }
+    fold(b.rhs);
+    value = lhs && value ? foldBinary(b.op, *lhs, *value) : std::nullopt;
+    isLiteral = false;
+}
+
+void ConstFolder::visit(Postfix& p) {
+    foldIndices(*p.operand);
+    value.reset();
+    isLiteral = false;
+}
+
+void ConstFolder::visit(Call& c) {
+    std::vector<ConstValue> args;
+    bool known = true;
+    for (auto& arg : c.args) {
+        fold(arg);
+        if (value && known) args.push_back(std::move(*value));
+        else known = false;
+    }
+    value.reset();
+    isLiteral = false;
+    if (!interpreter || !known) return;
+    value = interpreter->call(c.callee, args);
+    called = value.has_value();
+    if (called && report) report->add("const-eval", "calls evaluated");
+}
+
+void ConstFolder::visit(Assign& a) {
+    foldIndices(*a.lhs);
+    fold(a.rhs);
+    value.reset();
+    isLiteral = false;
+}
+
+void ConstFolder::visit(RangeExpr& r) {
+    fold(r.start);
+    fold(r.end);
+    value.reset();
+    isLiteral = false;
+}
+
+//---------------------------------------------------------------
+// statements
+//---------------------------------------------------------------
+void ConstFolder::visit(Print& p)      { fold(p.expr); }
+void ConstFolder::visit(Println& p)    { fold(p.expr); }
+void ConstFolder::visit(Read& r)       { foldIndices(*r.var); }
+void ConstFolder::visit(ExprStmt& s)   { fold(s.expr); }
+void ConstFolder::visit(ReturnStmt& s) { fold(s.expr); }
+void ConstFolder::visit(EmptyStmt&)    {}
+void ConstFolder::visit(BreakStmt&)    {}
+void ConstFolder::visit(ContinueStmt&) {}
+
+void ConstFolder::visit(Block& b) {
+    for (auto& s : b.stmts) fold(s);
+    mergePrints(b.stmts);
+}
+
+// println(x) writes the platform line separator, so it can only end a run
+void ConstFolder::mergePrints(std::vector<std::unique_ptr<Stmt>>& stmts) {
+    size_t kept = 0;
+    for (size_t i = 0; i < stmts.size();) {
+        std::string text;
+        bool newline = false, nl;
+        size_t end = i;
+        for (; end < stmts.size() && !newline; ++end) {
+            auto t = printedText(*stmts[end], nl);
+            if (!t) break;
+            text += *t;
+            newline = nl;
+        }
+        if (end - i >= 2) {
+            auto lit = std::make_unique<StringLit>(std::move(text), stmts[i]->line);
+            lit->ty = BasicType::String;
+            int line = stmts[i]->line;
+            if (newline) stmts[kept++] = std::make_unique<Println>(std::move(lit), line);
+            else stmts[kept++] = std::make_unique<Print>(std::move(lit), line);
+            if (report) report->add("const-fold", "prints merged", long(end - i - 1));
+            i = end;
+        } else {
+            if (kept != i) stmts[kept] = std::move(stmts[i]);
+            ++kept, ++i;
+        }
+    }
+    stmts.resize(kept);
+}
+
+void ConstFolder::visit(IfStmt& s) {
+    fold(s.cond);
+    fold(s.thenStmt);
+    fold(s.elseStmt);
+    if (auto* c = constCond(s.cond)) pruned(std::move(c->value ? s.thenStmt : s.elseStmt), s.line);
+}
+
+void ConstFolder::visit(WhileStmt& s) {
+    fold(s.cond);
+    fold(s.body);
+    if (auto* c = constCond(s.cond); c && !c->value) pruned(nullptr, s.line);
+}
+
+void ConstFolder::visit(ForStmt& s) {
+    fold(s.init);
+    fold(s.cond);
+    fold(s.step);
+    fold(s.body);
+    if (auto* c = constCond(s.cond); c && !c->value) pruned(std::move(s.init), s.line);   // init still runs once
+}
+
+void ConstFolder::visit(ForEachStmt& s) {
+    fold(s.collection);
+    fold(s.body);
+}
+
+void ConstFolder::visit(SwitchStmt& s) {
+    fold(s.cond);
+    for (auto& c : s.cases) fold(c.body);
+    std::optional<int> v;
+    if (auto* i = dynamic_cast<const IntLit*>(s.cond.get())) v = i->value;
+    else if (auto* ch = dynamic_cast<const CharLit*>(s.cond.get())) v = int(ch->value);
+    if (!v || s.hasBreak) return;       // a break in the taken arm still needs the switch
+    SwitchCase* taken = nullptr;
+    for (auto& c : s.cases) {
+        if (std::find(c.values.begin(), c.values.end(), *v) != c.values.end()) {
+            taken = &c;
+            break;
+        }
+        if (c.isDefault) taken = &c;
+    }
+    pruned(taken ? std::move(taken->body) : nullptr, s.line);
+}
+
+void ConstFolder::visit(DeclList& dl) {
+    for (auto& d : dl.decls) d->accept(*this);
+}
+
+void ConstFolder::visit(VarDecl& d)   { fold(d.init); }
+void ConstFolder::visit(ConstDecl& d) { fold(d.init); }
+
+void ConstFolder::visit(VarDeclList& dl) {
+    for (auto& d : dl.decls) fold(d->init);
+}
+
+void ConstFolder::visit(FuncDecl& f) { fold(f.body); }
+void ConstFolder::visit(Program& p)  { fold(p); }
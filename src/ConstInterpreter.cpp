@@ -0,0 +1,411 @@
+#include "ConstInterpreter.hpp"
+#include "SemanticAnalyzer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace ast;
+
+namespace {
+
+bool valueType(const Type& t) {
+    return t.dims.empty() &&
+           (t.kind == BasicType::Int || t.kind == BasicType::Bool || t.kind == BasicType::String);
+}
+
+// A body is pure when it prints / reads nothing, touches no array or
+// mutable global, and only calls functions in `pure`
+struct PurityCheck : Visitor {
+    const std::unordered_set<std::string>& pure;
+    bool ok = true;
+
+    explicit PurityCheck(const std::unordered_set<std::string>& p) : pure(p) {}
+
+    void check(Node* n) { if (n && ok) n->accept(*this); }
+
+    void visit(IntLit&) override {}
+    void visit(StringLit&) override {}
+    void visit(BoolLit&) override {}
+    void visit(RealLit&) override { ok = false; }
+    void visit(CharLit&) override { ok = false; }
+    void visit(Var& v) override { ok = ok && v.indices.empty() && !(v.sym.isGlobal && !v.sym.isConst); }
+    void visit(Unary& u) override { check(u.rhs.get()); }
+    void visit(Binary& b) override { check(b.lhs.get()); check(b.rhs.get()); }
+    void visit(Postfix& p) override { check(p.operand.get()); }
+    void visit(Assign& a) override { check(a.lhs.get()); check(a.rhs.get()); }
+    void visit(RangeExpr& r) override { check(r.start.get()); check(r.end.get()); }
+    void visit(Call& c) override {
+        ok = ok && pure.count(c.callee);
+        for (auto& arg : c.args) check(arg.get());
+    }
+    void visit(Print&) override { ok = false; }
+    void visit(Println&) override { ok = false; }
+    void visit(Read&) override { ok = false; }
+    void visit(Block& b) override { for (auto& s : b.stmts) check(s.get()); }
+    void visit(IfStmt& s) override { check(s.cond.get()); check(s.thenStmt.get()); check(s.elseStmt.get()); }
+    void visit(WhileStmt& s) override { check(s.cond.get()); check(s.body.get()); }
+    void visit(ForStmt& s) override {
+        check(s.init.get()); check(s.cond.get()); check(s.step.get()); check(s.body.get());
+    }
+    void visit(ForEachStmt& s) override { check(s.var.get()); check(s.collection.get()); check(s.body.get()); }
+    void visit(SwitchStmt& s) override {
+        check(s.cond.get());
+        for (auto& c : s.cases) check(c.body.get());
+    }
+    void visit(ReturnStmt& s) override { check(s.expr.get()); }
+    void visit(ExprStmt& s) override { check(s.expr.get()); }
+    void visit(EmptyStmt&) override {}
+    void visit(BreakStmt&) override {}
+    void visit(ContinueStmt&) override {}
+    void visit(DeclList& dl) override { for (auto& d : dl.decls) check(d.get()); }
+    void visit(VarDecl& d) override { ok = ok && d.dims.empty() && valueType(d.varType); check(d.init.get()); }
+    void visit(VarDeclList& dl) override { for (auto& d : dl.decls) check(d.get()); }
+    void visit(ConstDecl& d) override { visit(static_cast<VarDecl&>(d)); }
+    void visit(FuncDecl&) override { ok = false; }
+    void visit(Program&) override { ok = false; }
+};
+
+} // namespace
+
+ConstInterpreter::ConstInterpreter(Program& program) {
+    auto add = [&](Node* n) {
+        if (auto* f = dynamic_cast<FuncDecl*>(n)) functions.emplace(f->name, f);
+    };
+    for (auto& d : program.globals) add(d.get());
+    for (auto& s : program.stmts) add(s.get());
+
+    // optimistic: assume every candidate is pure, drop the ones that are
+    // not until nothing changes (so recursion stays pure)
+    for (auto& [name, f] : functions) {
+        if (name == "main" || !f->body) continue;
+        bool ok = f->returnType.kind == BasicType::Void || valueType(f->returnType);
+        for (auto& p : f->params) ok = ok && valueType(p->varType) && p->dims.empty();
+        if (ok) pure.insert(name);
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto it = pure.begin(); it != pure.end();) {
+            PurityCheck check(pure);
+            check.check(functions[*it]->body.get());
+            if (!check.ok) {
+                it = pure.erase(it);
+                changed = true;
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+std::optional<ConstValue> ConstInterpreter::call(const std::string& function, const std::vector<ConstValue>& args) {
+    if (!isPure(function) || functions[function]->returnType.kind == BasicType::Void) return std::nullopt;
+    globals = nullptr;
+    frames.clear();
+    steps = 0;
+    return invoke(function, args);
+}
+
+std::optional<ConstValue> ConstInterpreter::evalInit(Expr& init, const std::unordered_map<std::string, ConstValue>& known) {
+    globals = &known;
+    frames.assign(1, {});
+    steps = 0;
+    auto v = eval(&init);
+    globals = nullptr;
+    return v;
+}
+
+std::optional<ConstValue> ConstInterpreter::invoke(const std::string& function, const std::vector<ConstValue>& args) {
+    if (!isPure(function) || int(frames.size()) >= kMaxDepth) return std::nullopt;
+    auto key = std::make_pair(function, args);
+    if (auto hit = memo.find(key); hit != memo.end()) return hit->second;
+
+    FuncDecl& f = *functions[function];
+    if (args.size() != f.params.size()) return std::nullopt;
+    bool fresh = steps == 0;    // not inside another run: the outcome depends on nothing else
+    frames.emplace_back(size_t(std::max(f.localSlots, int(args.size()))));
+    for (size_t i = 0; i < args.size(); ++i) local(f.params[i]->sym.slot) = args[i];
+
+    result = 0;                // what a void function "returns"
+    Flow end = exec(f.body.get());
+    frames.pop_back();
+    if (end == Flow::Fail || (end == Flow::Normal && f.returnType.kind != BasicType::Void)) {
+        if (fresh) memo.emplace(std::move(key), std::nullopt);
+        return std::nullopt;
+    }
+    memo.emplace(std::move(key), result);
+    return result;
+}
+
+std::optional<ConstValue> ConstInterpreter::eval(Expr* e) {
+    value.reset();
+    if (e && ++steps <= kMaxSteps) e->accept(*this);
+    std::optional<ConstValue> v = std::move(value);
+    value.reset();      // early exits in the caller's visit leave "unknown"
+    return v;
+}
+
+ConstInterpreter::Flow ConstInterpreter::exec(Stmt* s) {
+    if (!s) return Flow::Normal;
+    if (++steps > kMaxSteps) return Flow::Fail;
+    flow = Flow::Normal;
+    s->accept(*this);
+    return flow;
+}
+
+bool ConstInterpreter::test(Expr* cond, bool& out) {
+    if (!cond) return out = true;
+    auto v = eval(cond);
+    auto* b = v ? std::get_if<bool>(&*v) : nullptr;
+    if (!b) return false;
+    out = *b;
+    return true;
+}
+
+std::optional<ConstValue>& ConstInterpreter::local(int slot) {
+    auto& frame = frames.back();
+    if (slot >= int(frame.size())) frame.resize(size_t(slot) + 1);
+    return frame[size_t(slot)];
+}
+
+std::optional<int> ConstInterpreter::localInt(int slot) {
+    auto& v = local(slot);
+    auto* i = v ? std::get_if<int>(&*v) : nullptr;
+    return i ? std::optional<int>(*i) : std::nullopt;
+}
+
+//---------------------------------------------------------------
+// expressions: leave the result in `value` (nullopt = give up)
+//---------------------------------------------------------------
+void ConstInterpreter::visit(IntLit& n)    { value = n.value; }
+void ConstInterpreter::visit(StringLit& n) { value = n.value; }
+void ConstInterpreter::visit(BoolLit& n)   { value = n.value; }
+void ConstInterpreter::visit(RealLit&)     {}
+void ConstInterpreter::visit(CharLit&)     {}
+void ConstInterpreter::visit(RangeExpr&)   {}
+
+void ConstInterpreter::visit(Var& v) {
+    if (!v.indices.empty()) return;
+    if (v.sym.isConst && v.sym.value) {
+        value = v.sym.value;
+    } else if (v.sym.isGlobal) {
+        if (!globals) return;
+        if (auto it = globals->find(v.name); it != globals->end()) value = it->second;
+    } else {
+        value = local(v.sym.slot);
+    }
+}
+
+void ConstInterpreter::visit(Unary& u) {
+    auto x = eval(u.rhs.get());
+    value = x ? foldUnary(u.op, *x) : std::nullopt;
+}
+
+void ConstInterpreter::visit(Binary& b) {
+    auto x = eval(b.lhs.get());
+    if (!x) return;
+    if (b.op == Op::And || b.op == Op::Or) {
+        auto* l = std::get_if<bool>(&*x);
+        if (!l) return;
+        if (*l == (b.op == Op::Or)) value = *l;
+        else value = eval(b.rhs.get());
+        return;
+    }
+    auto y = eval(b.rhs.get());
+    value = y ? foldBinary(b.op, *x, *y) : std::nullopt;
+}
+
+void ConstInterpreter::visit(Call& c) {
+    std::vector<ConstValue> args;
+    args.reserve(c.args.size());
+    for (auto& a : c.args) {
+        auto v = eval(a.get());
+        if (!v) return;
+        args.push_back(std::move(*v));
+    }
+    value = invoke(c.callee, args);
+}
+
+void ConstInterpreter::visit(Assign& a) {
+    if (a.lhs->sym.isGlobal || !a.lhs->indices.empty()) return;
+    auto v = eval(a.rhs.get());
+    if (v) local(a.lhs->sym.slot) = *v;
+    value = std::move(v);
+}
+
+void ConstInterpreter::visit(Postfix& p) {
+    if (p.operand->sym.isGlobal || !p.operand->indices.empty()) return;
+    auto old = localInt(p.operand->sym.slot);
+    if (!old) return;
+    local(p.operand->sym.slot) = int(uint32_t(*old) + (p.op == Op::Inc ? 1u : uint32_t(-1)));
+    value = *old;
+}
+
+//---------------------------------------------------------------
+// statements: leave how they ended in `flow`
+//---------------------------------------------------------------
+void ConstInterpreter::visit(Print&)   { flow = Flow::Fail; }   // never in a pure function
+void ConstInterpreter::visit(Println&) { flow = Flow::Fail; }
+void ConstInterpreter::visit(Read&)    { flow = Flow::Fail; }
+void ConstInterpreter::visit(EmptyStmt&) {}
+void ConstInterpreter::visit(BreakStmt&)    { flow = Flow::Break; }
+void ConstInterpreter::visit(ContinueStmt&) { flow = Flow::Continue; }
+void ConstInterpreter::visit(FuncDecl&)  { flow = Flow::Fail; }
+void ConstInterpreter::visit(Program&)   { flow = Flow::Fail; }
+
+// a call inside an expression leaves its own `flow` behind, so
+// statements that evaluate expressions always set it afterwards
+void ConstInterpreter::visit(ExprStmt& s) {
+    flow = s.expr && !eval(s.expr.get()) ? Flow::Fail : Flow::Normal;
+}
+
+void ConstInterpreter::visit(ReturnStmt& s) {
+    if (s.expr) {
+        auto v = eval(s.expr.get());
+        if (!v) {
+            flow = Flow::Fail;
+            return;
+        }
+        result = std::move(*v);
+    }
+    flow = Flow::Return;
+}
+
+void ConstInterpreter::visit(Block& b) {
+    for (auto& s : b.stmts)
+        if (Flow f = exec(s.get()); f != Flow::Normal) {
+            flow = f;
+            return;
+        }
+    flow = Flow::Normal;
+}
+
+void ConstInterpreter::visit(DeclList& dl) {
+    for (auto& d : dl.decls)
+        if (Flow f = exec(d.get()); f != Flow::Normal) {
+            flow = f;
+            return;
+        }
+    flow = Flow::Normal;
+}
+
+void ConstInterpreter::visit(VarDeclList& dl) {
+    for (auto& d : dl.decls)
+        if (Flow f = exec(d.get()); f != Flow::Normal) {
+            flow = f;
+            return;
+        }
+    flow = Flow::Normal;
+}
+
+void ConstInterpreter::visit(VarDecl& d) {
+    auto& slot = local(d.sym.slot);
+    slot.reset();                      // reading it before an assignment gives up
+    if (!d.init) return;
+    auto v = eval(d.init.get());
+    flow = v ? Flow::Normal : Flow::Fail;
+    local(d.sym.slot) = std::move(v);
+}
+
+void ConstInterpreter::visit(ConstDecl& d) { visit(static_cast<VarDecl&>(d)); }
+
+void ConstInterpreter::visit(IfStmt& s) {
+    bool c;
+    if (!test(s.cond.get(), c)) {
+        flow = Flow::Fail;
+        return;
+    }
+    flow = exec(c ? s.thenStmt.get() : s.elseStmt.get());
+}
+
+void ConstInterpreter::visit(WhileStmt& s) {
+    for (bool c; test(s.cond.get(), c);) {
+        if (!c) {
+            flow = Flow::Normal;
+            return;
+        }
+        Flow f = exec(s.body.get());
+        if (f == Flow::Break) {
+            flow = Flow::Normal;
+            return;
+        }
+        if (f != Flow::Normal && f != Flow::Continue) {
+            flow = f;
+            return;
+        }
+        if (++steps > kMaxSteps) break;
+    }
+    flow = Flow::Fail;
+}
+
+void ConstInterpreter::visit(ForStmt& s) {
+    if (Flow f = exec(s.init.get()); f != Flow::Normal) {
+        flow = f;
+        return;
+    }
+    for (bool c; test(s.cond.get(), c);) {
+        if (!c) {
+            flow = Flow::Normal;
+            return;
+        }
+        Flow f = exec(s.body.get());
+        if (f == Flow::Break) {
+            flow = Flow::Normal;
+            return;
+        }
+        if (f == Flow::Normal || f == Flow::Continue) f = exec(s.step.get());
+        if (f != Flow::Normal) {
+            flow = f;
+            return;
+        }
+    }
+    flow = Flow::Fail;
+}
+
+// same semantics as the generated loop: bounds evaluated once, inclusive
+void ConstInterpreter::visit(ForEachStmt& s) {
+    flow = Flow::Fail;
+    auto* range = dynamic_cast<RangeExpr*>(s.collection.get());
+    if (!range || s.var->sym.isGlobal) return;
+    auto lo = eval(range->start.get()), hi = eval(range->end.get());
+    auto* a = lo ? std::get_if<int>(&*lo) : nullptr;
+    auto* b = hi ? std::get_if<int>(&*hi) : nullptr;
+    if (!a || !b) return;
+    const bool up = *a <= *b;
+    const int last = *b;
+    const int slot = s.var->sym.slot;
+    local(slot) = *a;
+    for (;;) {
+        auto i = localInt(slot);
+        if (!i) return;
+        if (up ? *i > last : *i < last) break;
+        Flow f = exec(s.body.get());
+        if (f == Flow::Break) break;
+        if (f != Flow::Normal && f != Flow::Continue) {
+            flow = f;
+            return;
+        }
+        auto j = localInt(slot);
+        if (!j) return;
+        local(slot) = int(uint32_t(*j) + (up ? 1u : uint32_t(-1)));
+    }
+    flow = Flow::Normal;
+}
+
+void ConstInterpreter::visit(SwitchStmt& s) {
+    auto v = eval(s.cond.get());
+    auto* k = v ? std::get_if<int>(&*v) : nullptr;
+    if (!k) {
+        flow = Flow::Fail;
+        return;
+    }
+    SwitchCase* taken = nullptr;
+    for (auto& c : s.cases) {
+        if (std::find(c.values.begin(), c.values.end(), *k) != c.values.end()) {
+            taken = &c;
+            break;
+        }
+        if (c.isDefault) taken = &c;
+    }
+    flow = taken ? exec(taken->body.get()) : Flow::Normal;
+    if (flow == Flow::Break) flow = Flow::Normal;
+}
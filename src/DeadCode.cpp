@@ -0,0 +1,120 @@
+#include "DeadCode.hpp"
+#include "OptReport.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// pushes one value and does nothing else
+bool pushOnly(const Instr& i) {
+    if (i.isLabel) return false;
+    if (i.op >= Opcode::iconst_m1 && i.op <= Opcode::iconst_5) return true;
+    switch (i.op) {
+        case Opcode::bipush: case Opcode::sipush: case Opcode::ldc:
+        case Opcode::iload: case Opcode::aload: case Opcode::dup:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// operands consumed by an instruction that cannot throw and only
+// computes a value, or -1
+int pureOperands(const Instr& i) {
+    if (i.isLabel) return -1;
+    switch (i.op) {
+        case Opcode::ineg:
+            return 1;
+        case Opcode::iadd: case Opcode::isub: case Opcode::imul:
+        case Opcode::iand: case Opcode::ior: case Opcode::ixor:
+        case Opcode::ishl: case Opcode::ishr: case Opcode::iushr:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+} // namespace
+
+bool DeadCode::run(MethodCode& code, OptReport* report) {
+    std::vector<Instr>& v = code.instrs();
+    if (v.empty()) return false;
+    live.run(code, code.maxLocals(0));
+    const int B = live.blocks();
+
+    // ---- blocks reachable from the entry
+    reached.assign(size_t(B), 0);
+    reached[0] = 1;
+    work.assign(1, 0);
+    while (!work.empty()) {
+        int b = work.back();
+        work.pop_back();
+        live.forEachSucc(b, [&](int succ) {
+            if (!reached[size_t(succ)]) {
+                reached[size_t(succ)] = 1;
+                work.push_back(succ);
+            }
+        });
+    }
+
+    // ---- each block backwards from its live-out set: stores nobody reads
+    long stores = 0;
+    gone.assign(v.size(), 0);
+    alive.resize(live.setWords());
+    for (int b = 0; b < B; ++b) {
+        if (!reached[size_t(b)]) continue;
+        std::copy_n(live.liveOutSet(b), live.setWords(), alive.begin());
+        for (int i = live.end(b); i >= live.start(b); --i) {
+            Instr& in = v[size_t(i)];
+            int s;
+            if (!localSlot(in, s)) continue;
+            if (Liveness::writes(in) && !Liveness::test(alive.data(), s)) {
+                if (in.op == Opcode::iinc) {
+                    gone[size_t(i)] = 1;
+                } else {
+                    in = Instr{Opcode::pop, OperandKind::None};   // the value still has to go
+                }
+                ++stores;
+                continue;
+            }
+            if (Liveness::writes(in)) Liveness::drop(alive.data(), s);
+            if (Liveness::reads(in)) Liveness::put(alive.data(), s);
+        }
+    }
+
+    // ---- rebuild without unreachable blocks, dead iinc and push/pop pairs
+    long unreachable = 0;
+    kept.clear();
+    for (size_t i = 0; i < v.size(); ++i) {
+        if (!reached[size_t(live.blockOf(i))]) {
+            if (!v[i].isLabel) ++unreachable;
+            continue;
+        }
+        if (gone[i]) continue;
+        if (!v[i].isLabel && v[i].op == Opcode::pop) {
+            // a value nobody uses: unwind the side-effect-free code that made it
+            int pops = 1;
+            while (pops > 0 && !kept.empty()) {
+                if (pushOnly(kept.back())) {
+                    --pops;
+                } else if (int n = pureOperands(kept.back()); n > 0) {
+                    pops += n - 1;
+                } else {
+                    break;
+                }
+                kept.pop_back();
+            }
+            kept.insert(kept.end(), size_t(pops), Instr{Opcode::pop, OperandKind::None});
+            continue;
+        }
+        kept.push_back(v[i]);
+    }
+    if (kept.size() == v.size() && stores == 0) return false;
+    v.swap(kept);
+
+    if (report) {
+        report->add("dead-code", "unreachable instructions", unreachable);
+        report->add("dead-code", "dead stores", stores);
+    }
+    return true;
+}
@@ -0,0 +1,277 @@
+#include "IR.hpp"
+#include "SymbolTable.hpp"
+
+#include <algorithm>
+
+namespace ir {
+
+bool pure(Op op) {
+    switch (op) {
+        case Op::Const: case Op::Str: case Op::Undef: case Op::Param: case Op::Phi:
+        case Op::Add: case Op::Sub: case Op::Mul: case Op::Neg: case Op::Or: case Op::Xor: case Op::Not:
+        case Op::Eq: case Op::Ne: case Op::Lt: case Op::Le: case Op::Gt: case Op::Ge:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isTerminator(Op op) { return op == Op::Jump || op == Op::Branch || op == Op::Return; }
+
+bool isCompare(Op op) { return op >= Op::Eq && op <= Op::Ge; }
+
+const char* name(Op op) {
+    switch (op) {
+        case Op::Const:   return "const";
+        case Op::Str:     return "str";
+        case Op::Undef:   return "undef";
+        case Op::Param:   return "param";
+        case Op::Phi:     return "phi";
+        case Op::Load:    return "load";
+        case Op::Add:     return "add";
+        case Op::Sub:     return "sub";
+        case Op::Mul:     return "mul";
+        case Op::Div:     return "div";
+        case Op::Rem:     return "rem";
+        case Op::Neg:     return "neg";
+        case Op::Or:      return "or";
+        case Op::Xor:     return "xor";
+        case Op::Not:     return "not";
+        case Op::Eq:      return "eq";
+        case Op::Ne:      return "ne";
+        case Op::Lt:      return "lt";
+        case Op::Le:      return "le";
+        case Op::Gt:      return "gt";
+        case Op::Ge:      return "ge";
+        case Op::Call:    return "call";
+        case Op::Store:   return "store";
+        case Op::Print:   return "print";
+        case Op::Println: return "println";
+        case Op::Jump:    return "jump";
+        case Op::Branch:  return "branch";
+        case Op::Return:  return "return";
+    }
+    return "?";
+}
+
+//---------------------------------------------------------------
+// building
+//---------------------------------------------------------------
+BlockId Function::newBlock() {
+    blocks.emplace_back();
+    return BlockId(blocks.size() - 1);
+}
+
+ValueId Function::add(BlockId b, Inst i) {
+    i.block = b;
+    values.push_back(std::move(i));
+    ValueId id = ValueId(values.size() - 1);
+    blocks[size_t(b)].insts.push_back(id);
+    return id;
+}
+
+ValueId Function::addPhi(BlockId b, Type t) {
+    Inst i;
+    i.op = Op::Phi;
+    i.type = t;
+    i.block = b;
+    values.push_back(std::move(i));
+    ValueId id = ValueId(values.size() - 1);
+    blocks[size_t(b)].phis.push_back(id);
+    return id;
+}
+
+ValueId Function::terminator(BlockId b) const {
+    const auto& insts = blocks[size_t(b)].insts;
+    return insts.empty() ? None : insts.back();
+}
+
+bool Function::terminated(BlockId b) const {
+    ValueId t = terminator(b);
+    return t != None && isTerminator(values[size_t(t)].op);
+}
+
+int Function::succs(BlockId b, BlockId out[2]) const {
+    ValueId t = terminator(b);
+    if (t == None) return 0;
+    const Inst& i = values[size_t(t)];
+    switch (i.op) {
+        case Op::Jump:   out[0] = i.target[0]; return 1;
+        case Op::Branch: out[0] = i.target[0]; out[1] = i.target[1]; return 2;
+        default:         return 0;
+    }
+}
+
+//---------------------------------------------------------------
+// edges
+//---------------------------------------------------------------
+void Function::removeEdge(BlockId from, BlockId to) {
+    Block& b = blocks[size_t(to)];
+    auto it = std::find(b.preds.begin(), b.preds.end(), from);
+    if (it == b.preds.end()) return;
+    size_t k = size_t(it - b.preds.begin());
+    b.preds.erase(it);
+    for (ValueId phi : b.phis) {
+        auto& args = values[size_t(phi)].args;
+        args.erase(args.begin() + std::ptrdiff_t(k));
+    }
+}
+
+BlockId Function::splitEdge(BlockId from, BlockId to) {
+    BlockId mid = newBlock();
+    Inst jump;
+    jump.op = Op::Jump;
+    jump.target[0] = to;
+    add(mid, std::move(jump));
+    blocks[size_t(mid)].preds.push_back(from);
+
+    Inst& term = values[size_t(terminator(from))];
+    for (BlockId& t : term.target)
+        if (t == to) {
+            t = mid;
+            break;
+        }
+    auto& preds = blocks[size_t(to)].preds;
+    *std::find(preds.begin(), preds.end(), from) = mid;
+    return mid;
+}
+
+int Function::removeUnreachable() {
+    std::vector<char> seen(blocks.size(), 0);
+    std::vector<BlockId> work{0};
+    seen[0] = 1;
+    while (!work.empty()) {
+        BlockId b = work.back();
+        work.pop_back();
+        BlockId s[2];
+        for (int k = succs(b, s); k-- > 0;)
+            if (!seen[size_t(s[k])]) {
+                seen[size_t(s[k])] = 1;
+                work.push_back(s[k]);
+            }
+    }
+    int removed = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (seen[b] || blocks[b].dead) continue;
+        BlockId s[2];
+        for (int k = succs(BlockId(b), s); k-- > 0;)
+            if (seen[size_t(s[k])]) removeEdge(BlockId(b), s[k]);
+        for (auto* list : {&blocks[b].phis, &blocks[b].insts}) {
+            for (ValueId v : *list) values[size_t(v)].dead = true;
+            list->clear();
+        }
+        blocks[b].preds.clear();
+        blocks[b].dead = true;
+        ++removed;
+    }
+    return removed;
+}
+
+void Function::rename(const std::vector<ValueId>& map) {
+    for (auto& i : values)
+        if (!i.dead)
+            for (ValueId& a : i.args) a = map[size_t(a)];
+}
+
+void Function::compact() {
+    std::vector<BlockId> blockId(blocks.size(), None);
+    std::vector<ValueId> valueId(values.size(), None);
+    BlockId nb = 0;
+    ValueId nv = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (blocks[b].dead) continue;
+        blockId[b] = nb++;
+        for (auto* list : {&blocks[b].phis, &blocks[b].insts})
+            for (ValueId v : *list)
+                if (!values[size_t(v)].dead) valueId[size_t(v)] = nv++;
+    }
+
+    std::vector<Inst> newValues(static_cast<size_t>(nv));
+    std::vector<Block> newBlocks(static_cast<size_t>(nb));
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (blocks[b].dead) continue;
+        Block& to = newBlocks[size_t(blockId[b])];
+        for (BlockId p : blocks[b].preds) to.preds.push_back(blockId[size_t(p)]);
+        auto move = [&](const std::vector<ValueId>& from, std::vector<ValueId>& into) {
+            for (ValueId v : from) {
+                Inst& i = values[size_t(v)];
+                if (i.dead) continue;
+                i.block = blockId[b];
+                for (ValueId& a : i.args) a = valueId[size_t(a)];
+                for (BlockId& t : i.target)
+                    if (t != None) t = blockId[size_t(t)];
+                into.push_back(valueId[size_t(v)]);
+                newValues[size_t(valueId[size_t(v)])] = std::move(i);
+            }
+        };
+        move(blocks[b].phis, to.phis);
+        move(blocks[b].insts, to.insts);
+    }
+    values = std::move(newValues);
+    blocks = std::move(newBlocks);
+}
+
+//---------------------------------------------------------------
+// printing
+//---------------------------------------------------------------
+static const char* typeName(Type t) {
+    switch (t) {
+        case Type::Int:    return "int";
+        case Type::Bool:   return "bool";
+        case Type::String: return "string";
+        default:           return "void";
+    }
+}
+
+void Function::print(std::ostream& os) const {
+    os << "function " << name << '(';
+    for (size_t i = 0; i < params.size(); ++i) os << (i ? ", " : "") << typeName(params[i]);
+    os << ") -> " << typeName(returnType) << '\n';
+
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const Block& blk = blocks[b];
+        if (blk.dead) continue;
+        os << 'b' << b << ':';
+        if (!blk.preds.empty()) {
+            os << "\t\t; preds";
+            for (BlockId p : blk.preds) os << " b" << p;
+        }
+        os << '\n';
+        for (auto* list : {&blk.phis, &blk.insts})
+            for (ValueId v : *list) {
+                const Inst& i = values[size_t(v)];
+                if (i.dead) continue;
+                os << "    ";
+                if (i.type != Type::Void) os << '%' << v << ": " << typeName(i.type) << " = ";
+                os << ir::name(i.op);
+                switch (i.op) {
+                    case Op::Const:
+                        if (i.type == Type::Bool) os << (i.imm ? " true" : " false");
+                        else os << ' ' << i.imm;
+                        break;
+                    case Op::Str:
+                        os << " \"" << i.text << '"';
+                        break;
+                    case Op::Param:
+                        os << ' ' << i.imm;
+                        break;
+                    case Op::Load:
+                    case Op::Store:
+                    case Op::Call:
+                        os << ' ' << i.sym->name;
+                        break;
+                    default:
+                        break;
+                }
+                for (size_t k = 0; k < i.args.size(); ++k) {
+                    os << (k == 0 && i.op != Op::Store && i.op != Op::Call ? " " : ", ") << '%' << i.args[k];
+                    if (i.op == Op::Phi) os << " b" << blk.preds[k];
+                }
+                for (BlockId t : i.target)
+                    if (t != None) os << (i.args.empty() ? " b" : ", b") << t;
+                os << '\n';
+            }
+    }
+}
+
+} // namespace ir
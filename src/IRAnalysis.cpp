@@ -0,0 +1,147 @@
+#include "IRAnalysis.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace ir {
+
+//---------------------------------------------------------------
+// dominators
+//---------------------------------------------------------------
+DominatorTree::DominatorTree(const Function& f) {
+    size_t n = f.blocks.size();
+    rank.assign(n, -1);
+    parent.assign(n, None);
+    kids.assign(n, {});
+    pre.assign(n, 0);
+    post.assign(n, 0);
+
+    // postorder by an explicit stack: (block, next successor to visit)
+    std::vector<char> seen(n, 0);
+    std::vector<std::pair<BlockId, int>> stack{{0, 0}};
+    seen[0] = 1;
+    while (!stack.empty()) {
+        auto& [b, next] = stack.back();
+        BlockId s[2];
+        int count = f.succs(b, s);
+        if (next < count) {
+            BlockId t = s[next++];
+            if (!seen[size_t(t)]) {
+                seen[size_t(t)] = 1;
+                stack.emplace_back(t, 0);
+            }
+            continue;
+        }
+        order.push_back(b);
+        stack.pop_back();
+    }
+    std::reverse(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); ++i) rank[size_t(order[i])] = int(i);
+
+    auto intersect = [&](BlockId a, BlockId b) {
+        while (a != b) {
+            while (rank[size_t(a)] > rank[size_t(b)]) a = parent[size_t(a)];
+            while (rank[size_t(b)] > rank[size_t(a)]) b = parent[size_t(b)];
+        }
+        return a;
+    };
+    parent[0] = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            BlockId b = order[i], idom = None;
+            for (BlockId p : f.blocks[size_t(b)].preds) {
+                if (rank[size_t(p)] < 0 || parent[size_t(p)] == None) continue;
+                idom = idom == None ? p : intersect(p, idom);
+            }
+            if (idom != parent[size_t(b)]) {
+                parent[size_t(b)] = idom;
+                changed = true;
+            }
+        }
+    }
+    parent[0] = None;
+    for (BlockId b : order)
+        if (parent[size_t(b)] != None) kids[size_t(parent[size_t(b)])].push_back(b);
+
+    int clock = 0;
+    std::vector<std::pair<BlockId, size_t>> walk{{0, 0}};
+    pre[0] = clock++;
+    while (!walk.empty()) {
+        auto& [b, next] = walk.back();
+        if (next < kids[size_t(b)].size()) {
+            BlockId c = kids[size_t(b)][next++];
+            pre[size_t(c)] = clock++;
+            walk.emplace_back(c, 0);
+            continue;
+        }
+        post[size_t(b)] = clock++;
+        walk.pop_back();
+    }
+}
+
+bool DominatorTree::dominates(BlockId a, BlockId b) const {
+    if (!reachable(a) || !reachable(b)) return false;
+    return pre[size_t(a)] <= pre[size_t(b)] && post[size_t(b)] <= post[size_t(a)];
+}
+
+//---------------------------------------------------------------
+// liveness
+//---------------------------------------------------------------
+Liveness::Liveness(const Function& f, const DominatorTree& dom, const std::vector<char>& tracked) {
+    size_t n = f.blocks.size();
+    words = (f.values.size() + 63) / 64;
+    in.assign(n * words, 0);
+    out.assign(n * words, 0);
+    auto bit = [&](std::vector<uint64_t>& set, BlockId b, ValueId v) -> uint64_t& {
+        return set[size_t(b) * words + size_t(v) / 64];
+    };
+    auto mask = [](ValueId v) { return uint64_t(1) << (size_t(v) % 64); };
+
+    // upward-exposed uses and definitions per block
+    std::vector<uint64_t> uses(n * words, 0), defs(n * words, 0);
+    for (BlockId b : dom.rpo()) {
+        const Block& blk = f.blocks[size_t(b)];
+        for (ValueId v : blk.phis) bit(defs, b, v) |= mask(v);
+        for (ValueId v : blk.insts) {
+            for (ValueId a : f.values[size_t(v)].args)
+                if (tracked[size_t(a)] && !(bit(defs, b, a) & mask(a))) bit(uses, b, a) |= mask(a);
+            bit(defs, b, v) |= mask(v);
+        }
+    }
+
+    const auto& order = dom.rpo();
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = order.size(); i-- > 0;) {
+            BlockId b = order[i];
+            uint64_t* o = &out[size_t(b) * words];
+            BlockId s[2];
+            int count = f.succs(b, s);
+            for (int k = 0; k < count; ++k) {
+                const Block& succ = f.blocks[size_t(s[k])];
+                const uint64_t* si = &in[size_t(s[k]) * words];
+                for (size_t w = 0; w < words; ++w) o[w] |= si[w];
+                for (size_t p = 0; p < succ.preds.size(); ++p) {
+                    if (succ.preds[p] != b) continue;
+                    for (ValueId phi : succ.phis) {
+                        ValueId a = f.values[size_t(phi)].args[p];
+                        if (tracked[size_t(a)]) bit(out, b, a) |= mask(a);
+                    }
+                }
+            }
+            uint64_t* li = &in[size_t(b) * words];
+            const uint64_t* u = &uses[size_t(b) * words];
+            const uint64_t* d = &defs[size_t(b) * words];
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t now = u[w] | (o[w] & ~d[w]);
+                if (now != li[w]) {
+                    li[w] = now;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+} // namespace ir
@@ -0,0 +1,575 @@
+#include "IRBuilder.hpp"
+#include "SymbolTable.hpp"
+
+#include <algorithm>
+
+using namespace ast;
+using ir::BlockId;
+using ir::None;
+using ir::ValueId;
+
+//---------------------------------------------------------------
+// entry point
+//---------------------------------------------------------------
+bool IRBuilder::build(FuncDecl& fn, ir::Function& out, bool selfTailCalls) {
+    f = &out;
+    self = nullptr;
+    bodyTop = None;
+    converted = 0;
+    ok = true;
+    size_t slots = size_t(std::max(fn.localSlots, int(fn.params.size())));
+    slotType.assign(slots, ir::Type::Int);
+    defs.clear();
+    sealed.clear();
+    incomplete.clear();
+    exits.clear();
+    undefs.assign(slots, None);
+
+    out.name = fn.name;
+    out.isMain = fn.name == "main";
+    out.returnType = type(fn.sym.returnType ? *fn.sym.returnType : fn.returnType);
+    cur = block();
+    seal(cur);
+    if (!out.isMain)
+        for (size_t i = 0; i < fn.params.size(); ++i) {
+            const VarDecl& p = *fn.params[i];
+            ir::Type t = type(p.varType);
+            out.params.push_back(t);
+            slotType[size_t(p.sym.slot)] = t;
+            ValueId v = emit(ir::Op::Param, t);
+            out.values[size_t(v)].imm = int(i);
+            write(p.sym.slot, cur, v);
+        }
+
+    // self tail calls jump back to `top`, so it is a loop header whose
+    // phis take the parameters from the entry and the arguments from
+    // every tail call
+    if (selfTailCalls && !out.isMain) {
+        self = &fn;
+        bodyTop = block();
+        jump(bodyTop);
+        cur = bodyTop;
+    }
+    if (fn.body) fn.body->accept(*this);
+    if (!f->terminated(cur)) {
+        ir::Inst ret;
+        ret.op = ir::Op::Return;
+        if (out.returnType != ir::Type::Void) ret.args.push_back(constant(out.returnType, 0));
+        f->add(cur, std::move(ret));
+    }
+    if (bodyTop != None) seal(bodyTop);
+    if (ok) removeTrivialPhis();
+    return ok;
+}
+
+//---------------------------------------------------------------
+// SSA construction
+//---------------------------------------------------------------
+BlockId IRBuilder::block() {
+    BlockId b = f->newBlock();
+    defs.emplace_back(slotType.size(), None);
+    sealed.push_back(0);
+    incomplete.emplace_back();
+    return b;
+}
+
+void IRBuilder::write(int slot, BlockId b, ValueId v) {
+    auto& d = defs[size_t(b)];
+    if (size_t(slot) >= d.size()) d.resize(size_t(slot) + 1, None);
+    d[size_t(slot)] = v;
+}
+
+ValueId IRBuilder::read(int slot, BlockId b) {
+    auto& d = defs[size_t(b)];
+    if (size_t(slot) < d.size() && d[size_t(slot)] != None) return d[size_t(slot)];
+    return readFromPreds(slot, b);
+}
+
+ValueId IRBuilder::readFromPreds(int slot, BlockId b) {
+    if (size_t(slot) >= slotType.size()) {
+        slotType.resize(size_t(slot) + 1, ir::Type::Int);
+        undefs.resize(size_t(slot) + 1, None);
+    }
+    const auto& preds = f->blocks[size_t(b)].preds;
+    ValueId v;
+    if (!sealed[size_t(b)]) {
+        v = f->addPhi(b, slotType[size_t(slot)]);
+        incomplete[size_t(b)].emplace_back(slot, v);
+    } else if (preds.size() == 1) {
+        v = read(slot, preds[0]);
+    } else if (preds.empty()) {
+        // entry, or code nothing jumps to: the local was never written
+        if (undefs[size_t(slot)] == None) {
+            ir::Inst u;
+            u.op = ir::Op::Undef;
+            u.type = slotType[size_t(slot)];
+            u.block = 0;
+            f->values.push_back(std::move(u));
+            undefs[size_t(slot)] = ValueId(f->values.size() - 1);
+            auto& entry = f->blocks[0].insts;
+            entry.insert(entry.begin(), undefs[size_t(slot)]);
+        }
+        v = undefs[size_t(slot)];
+    } else {
+        v = f->addPhi(b, slotType[size_t(slot)]);
+        write(slot, b, v);      // breaks the cycle through loops
+        fill(slot, v);
+    }
+    write(slot, b, v);
+    return v;
+}
+
+void IRBuilder::fill(int slot, ValueId phi) {
+    BlockId b = f->values[size_t(phi)].block;
+    // preds is not modified while reading, but read() may add values
+    size_t n = f->blocks[size_t(b)].preds.size();
+    for (size_t k = 0; k < n; ++k) {
+        ValueId v = read(slot, f->blocks[size_t(b)].preds[k]);
+        f->values[size_t(phi)].args.push_back(v);
+    }
+}
+
+void IRBuilder::seal(BlockId b) {
+    if (sealed[size_t(b)]) return;
+    sealed[size_t(b)] = 1;
+    auto pending = std::move(incomplete[size_t(b)]);
+    incomplete[size_t(b)].clear();
+    for (auto [slot, phi] : pending) fill(slot, phi);
+}
+
+// A phi whose operands are all one value (or itself) is that value;
+// a phi nothing uses is dropped. Both can make other phis trivial.
+void IRBuilder::removeTrivialPhis() {
+    std::vector<ValueId> to(f->values.size());
+    for (size_t v = 0; v < to.size(); ++v) to[v] = ValueId(v);
+    auto find = [&](ValueId v) {
+        while (to[size_t(v)] != v) v = to[size_t(v)] = to[size_t(to[size_t(v)])];
+        return v;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto& blk : f->blocks)
+            for (ValueId phi : blk.phis) {
+                ir::Inst& i = f->values[size_t(phi)];
+                if (i.dead) continue;
+                ValueId same = None;
+                bool trivial = true;
+                for (ValueId a : i.args) {
+                    a = find(a);
+                    if (a == phi || a == same) continue;
+                    if (same != None) {
+                        trivial = false;
+                        break;
+                    }
+                    same = a;
+                }
+                if (!trivial || same == None) continue;
+                i.dead = true;
+                to[size_t(phi)] = same;
+                changed = true;
+            }
+    }
+    for (auto& i : f->values)
+        if (!i.dead)
+            for (ValueId& a : i.args) a = find(a);
+
+    std::vector<int> uses(f->values.size(), 0);
+    for (auto& i : f->values)
+        if (!i.dead)
+            for (ValueId a : i.args)
+                if (a != ValueId(&i - f->values.data())) ++uses[size_t(a)];
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto& blk : f->blocks)
+            for (ValueId phi : blk.phis) {
+                ir::Inst& i = f->values[size_t(phi)];
+                if (i.dead || uses[size_t(phi)]) continue;
+                i.dead = true;
+                for (ValueId a : i.args)
+                    if (a != phi) --uses[size_t(a)];
+                changed = true;
+            }
+    }
+    for (auto& blk : f->blocks)
+        blk.phis.erase(std::remove_if(blk.phis.begin(), blk.phis.end(),
+                                      [&](ValueId v) { return f->values[size_t(v)].dead; }),
+                       blk.phis.end());
+}
+
+//---------------------------------------------------------------
+// helpers
+//---------------------------------------------------------------
+ir::Type IRBuilder::type(const ast::Type& t) {
+    if (!t.dims.empty()) unsupported();
+    switch (t.kind) {
+        case BasicType::Int:    return ir::Type::Int;
+        case BasicType::Bool:   return ir::Type::Bool;
+        case BasicType::String: return ir::Type::String;
+        case BasicType::Void:   return ir::Type::Void;
+        default:                unsupported(); return ir::Type::Int;
+    }
+}
+
+ValueId IRBuilder::emit(ir::Op op, ir::Type t, std::vector<ValueId> args) {
+    ir::Inst i;
+    i.op = op;
+    i.type = t;
+    i.args = std::move(args);
+    return f->add(cur, std::move(i));
+}
+
+ValueId IRBuilder::constant(ir::Type t, int v) {
+    if (t == ir::Type::String) return emit(ir::Op::Undef, t);
+    ValueId c = emit(ir::Op::Const, t);
+    f->values[size_t(c)].imm = v;
+    return c;
+}
+
+ValueId IRBuilder::value(Expr& e) {
+    last = None;
+    e.accept(*this);
+    if (last == None) {             // unsupported expression; keep the IR well formed
+        unsupported();
+        last = constant(ir::Type::Int, 0);
+    }
+    return last;
+}
+
+ValueId IRBuilder::load(const Var& v) {
+    if (!v.indices.empty()) unsupported();
+    if (!v.sym.isGlobal) return read(v.sym.slot, cur);
+    ValueId l = emit(ir::Op::Load, type(v.sym.type));
+    f->values[size_t(l)].sym = &v.sym;
+    return l;
+}
+
+void IRBuilder::store(const Var& v, ValueId value) {
+    if (!v.indices.empty()) unsupported();
+    if (!v.sym.isGlobal) {
+        write(v.sym.slot, cur, value);
+        return;
+    }
+    ValueId s = emit(ir::Op::Store, ir::Type::Void, {value});
+    f->values[size_t(s)].sym = &v.sym;
+}
+
+void IRBuilder::jump(BlockId to) {
+    if (f->terminated(cur)) return;
+    ir::Inst j;
+    j.op = ir::Op::Jump;
+    j.target[0] = to;
+    f->add(cur, std::move(j));
+    f->blocks[size_t(to)].preds.push_back(cur);
+}
+
+void IRBuilder::branch(ValueId c, BlockId t, BlockId e) {
+    if (t == e) {
+        jump(t);
+        return;
+    }
+    ir::Inst br;
+    br.op = ir::Op::Branch;
+    br.args.push_back(c);
+    br.target[0] = t;
+    br.target[1] = e;
+    f->add(cur, std::move(br));
+    f->blocks[size_t(t)].preds.push_back(cur);
+    f->blocks[size_t(e)].preds.push_back(cur);
+}
+
+// Jumps to t when `e` holds, to `other` when not; && / || / ! and
+// literals never materialize a bool
+void IRBuilder::cond(Expr& e, BlockId t, BlockId other) {
+    if (auto* b = dynamic_cast<Binary*>(&e); b && (b->op == Op::And || b->op == Op::Or)) {
+        BlockId mid = block();
+        if (b->op == Op::And) cond(*b->lhs, mid, other);
+        else cond(*b->lhs, t, mid);
+        seal(mid);
+        cur = mid;
+        cond(*b->rhs, t, other);
+        return;
+    }
+    if (auto* u = dynamic_cast<Unary*>(&e); u && u->op == Op::Not) {
+        cond(*u->rhs, other, t);
+        return;
+    }
+    if (auto* lit = dynamic_cast<BoolLit*>(&e)) {
+        jump(lit->value ? t : other);
+        return;
+    }
+    branch(value(e), t, other);
+}
+
+//---------------------------------------------------------------
+// expressions
+//---------------------------------------------------------------
+void IRBuilder::visit(IntLit& n)    { last = constant(ir::Type::Int, n.value); }
+void IRBuilder::visit(BoolLit& n)   { last = constant(ir::Type::Bool, n.value ? 1 : 0); }
+void IRBuilder::visit(RealLit&)     { unsupported(); }
+void IRBuilder::visit(CharLit&)     { unsupported(); }
+
+void IRBuilder::visit(StringLit& n) {
+    last = emit(ir::Op::Str, ir::Type::String);
+    f->values[size_t(last)].text = n.value;
+}
+
+void IRBuilder::visit(Var& v) { last = load(v); }
+
+void IRBuilder::visit(Unary& u) {
+    ValueId r = value(*u.rhs);
+    last = u.op == Op::Not ? emit(ir::Op::Not, ir::Type::Bool, {r}) : emit(ir::Op::Neg, ir::Type::Int, {r});
+}
+
+void IRBuilder::visit(Binary& b) {
+    if (b.op == Op::And || b.op == Op::Or) {
+        // value of a && b: the short cut edge carries the constant
+        BlockId rhs = block(), join = block();
+        ValueId shortcut = constant(ir::Type::Bool, b.op == Op::Or);
+        ValueId l = value(*b.lhs);
+        BlockId from = cur;
+        if (b.op == Op::And) branch(l, rhs, join);
+        else branch(l, join, rhs);
+        seal(rhs);
+        cur = rhs;
+        ValueId r = value(*b.rhs);
+        jump(join);
+        ValueId phi = f->addPhi(join, ir::Type::Bool);
+        for (BlockId p : f->blocks[size_t(join)].preds)
+            f->values[size_t(phi)].args.push_back(p == from ? shortcut : r);
+        seal(join);
+        cur = join;
+        last = phi;
+        return;
+    }
+    if (b.op == Op::Plus && b.ty.kind == BasicType::String) {
+        unsupported();          // concatenation stays on the tree path
+        return;
+    }
+    ValueId l = value(*b.lhs);
+    ValueId r = value(*b.rhs);
+    ir::Op op;
+    ir::Type t = ir::Type::Bool;
+    switch (b.op) {
+        case Op::Plus:      op = ir::Op::Add; t = ir::Type::Int; break;
+        case Op::Minus:     op = ir::Op::Sub; t = ir::Type::Int; break;
+        case Op::Mul:       op = ir::Op::Mul; t = ir::Type::Int; break;
+        case Op::Div:       op = ir::Op::Div; t = ir::Type::Int; break;
+        case Op::Mod:       op = ir::Op::Rem; t = ir::Type::Int; break;
+        case Op::Less:      op = ir::Op::Lt; break;
+        case Op::LessEq:    op = ir::Op::Le; break;
+        case Op::Greater:   op = ir::Op::Gt; break;
+        case Op::GreaterEq: op = ir::Op::Ge; break;
+        case Op::Equal:     op = ir::Op::Eq; break;
+        case Op::NotEqual:  op = ir::Op::Ne; break;
+        default:            unsupported(); return;
+    }
+    last = emit(op, t, {l, r});
+}
+
+void IRBuilder::visit(Postfix& p) {
+    ValueId old = load(*p.operand);
+    ValueId stepped = emit(p.op == Op::Inc ? ir::Op::Add : ir::Op::Sub, ir::Type::Int,
+                           {old, constant(ir::Type::Int, 1)});
+    store(*p.operand, stepped);
+    last = old;
+}
+
+void IRBuilder::visit(Call& c) {
+    std::vector<ValueId> args;
+    for (auto& a : c.args) args.push_back(value(*a));
+    ir::Type t = type(c.sym.returnType ? *c.sym.returnType : c.ty);
+    last = emit(ir::Op::Call, t, std::move(args));
+    f->values[size_t(last)].sym = &c.sym;
+}
+
+void IRBuilder::visit(Assign& a) {
+    ValueId v = value(*a.rhs);
+    store(*a.lhs, v);
+    last = v;
+}
+
+void IRBuilder::visit(RangeExpr&) { unsupported(); }
+
+//---------------------------------------------------------------
+// statements
+//---------------------------------------------------------------
+void IRBuilder::visit(Print& p)   { emit(ir::Op::Print, ir::Type::Void, {value(*p.expr)}); }
+void IRBuilder::visit(Println& p) { emit(ir::Op::Println, ir::Type::Void, {value(*p.expr)}); }
+void IRBuilder::visit(Read&)      { unsupported(); }
+void IRBuilder::visit(EmptyStmt&) {}
+
+void IRBuilder::visit(ExprStmt& s) {
+    if (s.expr) value(*s.expr);
+}
+
+void IRBuilder::visit(ast::Block& b) {
+    for (auto& s : b.stmts) s->accept(*this);
+}
+
+void IRBuilder::visit(ReturnStmt& s) {
+    if (tailCall(s)) return;
+    ir::Inst ret;
+    ret.op = ir::Op::Return;
+    if (s.expr) ret.args.push_back(value(*s.expr));
+    f->add(cur, std::move(ret));
+    cur = block();          // whatever follows is unreachable
+    seal(cur);
+}
+
+// `return f(...)` in f: every argument is evaluated, then the
+// parameters take them on the way back to the top of the body
+bool IRBuilder::tailCall(ReturnStmt& s) {
+    auto* c = dynamic_cast<Call*>(s.expr.get());
+    if (!c || !self || c->callee != self->name) return false;
+    std::vector<ValueId> args;
+    for (auto& a : c->args) args.push_back(value(*a));
+    for (size_t i = 0; i < args.size(); ++i) write(self->params[i]->sym.slot, cur, args[i]);
+    leave(bodyTop);
+    ++converted;
+    return true;
+}
+
+void IRBuilder::visit(BreakStmt&)    { leave(exits.back().brk); }
+void IRBuilder::visit(ContinueStmt&) { leave(exits.back().cont); }
+
+void IRBuilder::leave(BlockId to) {
+    jump(to);
+    cur = block();
+    seal(cur);
+}
+
+void IRBuilder::visit(IfStmt& s) {
+    BlockId then = block(), join = block();
+    BlockId other = s.elseStmt ? block() : join;
+    cond(*s.cond, then, other);
+    seal(then);
+    cur = then;
+    s.thenStmt->accept(*this);
+    jump(join);
+    if (s.elseStmt) {
+        seal(other);
+        cur = other;
+        s.elseStmt->accept(*this);
+        jump(join);
+    }
+    seal(join);
+    cur = join;
+}
+
+// A chain of eq tests, one per label, then a jump to the default arm
+// (or past the switch). The IR has no multi-way branch.
+void IRBuilder::visit(SwitchStmt& s) {
+    ValueId sel = value(*s.cond);
+    BlockId join = block(), other = join;
+    std::vector<BlockId> arms;
+    for (auto& c : s.cases) {
+        arms.push_back(block());
+        if (c.isDefault) other = arms.back();
+    }
+    for (size_t i = 0; i < s.cases.size(); ++i)
+        for (int v : s.cases[i].values) {
+            BlockId next = block();
+            branch(emit(ir::Op::Eq, ir::Type::Bool, {sel, constant(ir::Type::Int, v)}), arms[i], next);
+            seal(next);
+            cur = next;
+        }
+    jump(other);
+    exits.push_back({join, exits.empty() ? None : exits.back().cont});
+    for (size_t i = 0; i < s.cases.size(); ++i) {
+        seal(arms[i]);
+        cur = arms[i];
+        s.cases[i].body->accept(*this);
+        jump(join);
+    }
+    exits.pop_back();
+    seal(join);
+    cur = join;
+}
+
+// header: cond → body / exit; body; latch: step; → header
+void IRBuilder::loop(Expr* c, Stmt* body, Stmt* step) {
+    BlockId header = block(), inside = block(), latch = block(), exit = block();
+    jump(header);
+    cur = header;
+    if (c) cond(*c, inside, exit);
+    else jump(inside);
+    seal(inside);
+    cur = inside;
+    exits.push_back({exit, latch});
+    if (body) body->accept(*this);
+    exits.pop_back();
+    jump(latch);
+    seal(latch);
+    cur = latch;
+    if (step) step->accept(*this);
+    jump(header);
+    seal(header);
+    seal(exit);
+    cur = exit;
+}
+
+void IRBuilder::visit(WhileStmt& s) { loop(s.cond.get(), s.body.get(), nullptr); }
+
+void IRBuilder::visit(ForStmt& s) {
+    if (s.init) s.init->accept(*this);
+    loop(s.cond.get(), s.body.get(), s.step.get());
+}
+
+// i walks a → b inclusive in either direction, as CodeGenVisitor
+// does it: flip = a <= b ? 0 : -1, step = flip | 1, and the loop runs
+// while (i ^ flip) <= (b ^ flip). Constant bounds fold away.
+void IRBuilder::visit(ForEachStmt& s) {
+    auto* range = dynamic_cast<RangeExpr*>(s.collection.get());
+    if (!range) {
+        unsupported();
+        return;
+    }
+    ValueId lo = value(*range->start);
+    store(*s.var, lo);
+    ValueId hi = value(*range->end);
+    ValueId up = emit(ir::Op::Le, ir::Type::Bool, {lo, hi});
+    ValueId flip = emit(ir::Op::Sub, ir::Type::Int, {up, constant(ir::Type::Int, 1)});
+    ValueId step = emit(ir::Op::Or, ir::Type::Int, {flip, constant(ir::Type::Int, 1)});
+    ValueId bound = emit(ir::Op::Xor, ir::Type::Int, {hi, flip});
+
+    BlockId header = block(), inside = block(), latch = block(), exit = block();
+    jump(header);
+    cur = header;
+    ValueId i = emit(ir::Op::Xor, ir::Type::Int, {load(*s.var), flip});
+    branch(emit(ir::Op::Le, ir::Type::Bool, {i, bound}), inside, exit);
+    seal(inside);
+    cur = inside;
+    exits.push_back({exit, latch});
+    s.body->accept(*this);
+    exits.pop_back();
+    jump(latch);
+    seal(latch);
+    cur = latch;
+    store(*s.var, emit(ir::Op::Add, ir::Type::Int, {load(*s.var), step}));
+    jump(header);
+    seal(header);
+    seal(exit);
+    cur = exit;
+}
+
+void IRBuilder::visit(DeclList& dl) {
+    for (auto& d : dl.decls) d->accept(*this);
+}
+
+void IRBuilder::visit(VarDeclList& dl) {
+    for (auto& d : dl.decls) d->accept(*this);
+}
+
+void IRBuilder::visit(VarDecl& d) {
+    ir::Type t = type(d.varType);
+    if (size_t(d.sym.slot) >= slotType.size()) {
+        slotType.resize(size_t(d.sym.slot) + 1, ir::Type::Int);
+        undefs.resize(size_t(d.sym.slot) + 1, None);
+    }
+    slotType[size_t(d.sym.slot)] = t;
+    if (d.init) write(d.sym.slot, cur, value(*d.init));
+}
+
+void IRBuilder::visit(ConstDecl& d) { visit(static_cast<VarDecl&>(d)); }
+void IRBuilder::visit(FuncDecl&)    {}
+void IRBuilder::visit(Program&)     {}
@@ -0,0 +1,351 @@
+#include "IRLowering.hpp"
+#include "IRAnalysis.hpp"
+#include "SymbolTable.hpp"
+
+#include <algorithm>
+
+using ir::BlockId;
+using ir::None;
+using ir::Op;
+using ir::ValueId;
+
+namespace {
+
+std::string_view printRef(ir::Type t, bool newline) {
+    switch (t) {
+        case ir::Type::Bool:
+            return newline ? "void java.io.PrintStream.println(boolean)" : "void java.io.PrintStream.print(boolean)";
+        case ir::Type::String:
+            return newline ? "void java.io.PrintStream.println(java.lang.String)" : "void java.io.PrintStream.print(java.lang.String)";
+        default:
+            return newline ? "void java.io.PrintStream.println(int)" : "void java.io.PrintStream.print(int)";
+    }
+}
+
+void pushInt(MethodCode& code, int v) {
+    if (v >= -1 && v <= 5) code.emit(Opcode(int(Opcode::iconst_0) + v));
+    else if (v >= -128 && v <= 127) code.emit(Opcode::bipush, v);
+    else code.emit(Opcode::ldc, v);
+}
+
+// ifeq … if_acmpne come in complementary pairs: eq/ne, lt/ge, gt/le
+Opcode negate(Opcode op) {
+    return Opcode(((int(op) - int(Opcode::ifeq)) ^ 1) + int(Opcode::ifeq));
+}
+
+// if_icmp<c> → if<c>
+Opcode zeroBranch(Opcode cmp) {
+    return Opcode(int(cmp) - int(Opcode::if_icmpeq) + int(Opcode::ifeq));
+}
+
+// a <c> b  ≡  b <mirror(c)> a
+Opcode mirror(Opcode cmp) {
+    switch (cmp) {
+        case Opcode::if_icmplt: return Opcode::if_icmpgt;
+        case Opcode::if_icmpgt: return Opcode::if_icmplt;
+        case Opcode::if_icmple: return Opcode::if_icmpge;
+        case Opcode::if_icmpge: return Opcode::if_icmple;
+        default:                return cmp;
+    }
+}
+
+} // namespace
+
+void IRLowering::run(ir::Function& fn, MethodCode& out, CodeGenContext& context) {
+    f = &fn;
+    code = &out;
+    ctx = &context;
+    prepare();
+    ir::DominatorTree dom(fn);
+    schedule();
+    allocate(dom);
+
+    labels.clear();
+    for (size_t b = 0; b < fn.blocks.size(); ++b) labels.push_back(ctx->newLabel());
+    const auto& order = dom.rpo();
+    for (size_t k = 0; k < order.size(); ++k) {
+        BlockId next = k + 1 < order.size() ? order[k + 1] : None;
+        code->label(labels[size_t(order[k])]);
+        for (ValueId v : fn.blocks[size_t(order[k])].insts) emitInst(v, next);
+    }
+}
+
+//---------------------------------------------------------------
+// preparation: unreachable code out, copy blocks on the edges
+//---------------------------------------------------------------
+void IRLowering::prepare() {
+    f->removeUnreachable();
+    size_t n = f->blocks.size();
+    for (size_t b = 0; b < n; ++b) {
+        if (f->blocks[b].dead) continue;
+        BlockId s[2];
+        if (f->succs(BlockId(b), s) < 2) continue;
+        for (BlockId to : s)
+            if (!f->blocks[size_t(to)].phis.empty()) f->splitEdge(BlockId(b), to);
+    }
+    f->compact();
+}
+
+bool IRLowering::remat(ValueId v) const {
+    Op op = f->values[size_t(v)].op;
+    return op == Op::Const || op == Op::Str || op == Op::Undef;
+}
+
+bool IRLowering::silent(ValueId v) const {
+    return remat(v) || f->values[size_t(v)].op == Op::Param;
+}
+
+bool IRLowering::fused(ValueId v) const {
+    return ir::isCompare(f->values[size_t(v)].op) && stacked(v) && f->values[size_t(into[size_t(v)])].op == Op::Branch;
+}
+
+//---------------------------------------------------------------
+// stack scheduling
+//---------------------------------------------------------------
+void IRLowering::schedule() {
+    size_t n = f->values.size();
+    uses.assign(n, 0);
+    treeStart.assign(n, 0);
+    zeroArg.assign(n, -1);
+    into.assign(n, None);
+    before.assign(n, {});
+    for (auto& blk : f->blocks)
+        for (auto* list : {&blk.phis, &blk.insts})
+            for (ValueId v : *list)
+                for (ValueId a : f->values[size_t(v)].args) ++uses[size_t(a)];
+
+    auto isZero = [&](ValueId v) {
+        const ir::Inst& i = f->values[size_t(v)];
+        return i.op == Op::Const && i.imm == 0;
+    };
+    for (auto& blk : f->blocks) {
+        const auto& insts = blk.insts;
+        for (int p = 0; p < int(insts.size()); ++p) {
+            ValueId q = insts[size_t(p)];
+            const ir::Inst& i = f->values[size_t(q)];
+            const auto& args = i.args;
+            if (ir::isCompare(i.op) && f->values[size_t(args[0])].type != ir::Type::String) {
+                if (isZero(args[1])) zeroArg[size_t(q)] = 1;
+                else if (isZero(args[0])) zeroArg[size_t(q)] = 0;
+            }
+
+            // operands from the last: each may stay on the stack if its
+            // tree ends right where the previous one (or q) begins
+            onStack.assign(args.size(), 0);
+            int cursor = p - 1;
+            for (size_t j = args.size(); j-- > 0;) {
+                if (int(j) == zeroArg[size_t(q)]) continue;
+                while (cursor >= 0 && silent(insts[size_t(cursor)])) --cursor;
+                ValueId o = args[j];
+                const ir::Inst& d = f->values[size_t(o)];
+                if (cursor < 0 || insts[size_t(cursor)] != o || uses[size_t(o)] != 1 || d.type == ir::Type::Void ||
+                    d.op == Op::Phi)
+                    continue;
+                into[size_t(o)] = q;
+                onStack[j] = 1;
+                cursor = treeStart[size_t(o)] - 1;
+            }
+            treeStart[size_t(q)] = cursor + 1;
+
+            // the rest is pushed in front of the next stacked tree
+            pushAt.assign(args.size(), p);
+            for (int j = int(args.size()), at = p; j-- > 0;) {
+                if (onStack[size_t(j)]) at = treeStart[size_t(args[size_t(j)])];
+                else pushAt[size_t(j)] = at;
+            }
+            if (i.op == Op::Print || i.op == Op::Println)
+                before[size_t(insts[size_t(treeStart[size_t(q)])])].push_back({p, None});
+            for (size_t j = 0; j < args.size(); ++j)
+                if (!onStack[j] && int(j) != zeroArg[size_t(q)])
+                    before[size_t(insts[size_t(pushAt[j])])].push_back({p, args[j]});
+        }
+    }
+    for (auto& list : before)
+        if (list.size() > 1)
+            std::stable_sort(list.begin(), list.end(), [](const Push& a, const Push& b) { return a.priority > b.priority; });
+}
+
+//---------------------------------------------------------------
+// slots
+//---------------------------------------------------------------
+void IRLowering::allocate(const ir::DominatorTree& dom) {
+    size_t n = f->values.size();
+    needsSlot.assign(n, 0);
+    for (auto& blk : f->blocks)
+        for (auto* list : {&blk.phis, &blk.insts})
+            for (ValueId v : *list)
+                needsSlot[size_t(v)] = f->values[size_t(v)].type != ir::Type::Void && uses[size_t(v)] > 0 &&
+                                       !stacked(v) && !remat(v);
+    ir::Liveness live(*f, dom, needsSlot);
+    slot.assign(n, -1);
+    lastUse.assign(n, -1);
+    stamp.assign(n, -1);
+
+    std::vector<char> used;
+    auto occupy = [&](int s) {
+        if (size_t(s) >= used.size()) used.resize(size_t(s) + 1, 0);
+        used[size_t(s)] = 1;
+    };
+    auto lowest = [&] {
+        int s = 0;
+        while (size_t(s) < used.size() && used[size_t(s)]) ++s;
+        occupy(s);
+        return s;
+    };
+
+    // dominator tree preorder: every value live into a block already has its slot
+    std::vector<BlockId> work{0};
+    while (!work.empty()) {
+        BlockId b = work.back();
+        work.pop_back();
+        for (BlockId c : dom.children(b)) work.push_back(c);
+        const ir::Block& blk = f->blocks[size_t(b)];
+
+        std::fill(used.begin(), used.end(), 0);
+        live.forEachLiveIn(b, [&](ValueId v) { occupy(slot[size_t(v)]); });
+        if (b == 0)
+            for (ValueId v : blk.insts)
+                if (f->values[size_t(v)].op == Op::Param && needsSlot[size_t(v)])
+                    occupy(slot[size_t(v)] = f->values[size_t(v)].imm);
+        for (ValueId phi : blk.phis)
+            if (needsSlot[size_t(phi)]) slot[size_t(phi)] = lowest();
+
+        for (size_t p = blk.insts.size(); p-- > 0;)
+            for (ValueId a : f->values[size_t(blk.insts[p])].args)
+                if (needsSlot[size_t(a)] && stamp[size_t(a)] != b) {
+                    stamp[size_t(a)] = b;
+                    lastUse[size_t(a)] = int(p);
+                }
+        for (size_t p = 0; p < blk.insts.size(); ++p) {
+            ValueId q = blk.insts[p];
+            for (ValueId a : f->values[size_t(q)].args)
+                if (needsSlot[size_t(a)] && lastUse[size_t(a)] == int(p) && !live.liveOut(b, a))
+                    used[size_t(slot[size_t(a)])] = 0;
+            if (needsSlot[size_t(q)] && f->values[size_t(q)].op != Op::Param) slot[size_t(q)] = lowest();
+        }
+    }
+}
+
+//---------------------------------------------------------------
+// emission
+//---------------------------------------------------------------
+void IRLowering::push(ValueId v) {
+    const ir::Inst& i = f->values[size_t(v)];
+    switch (i.op) {
+        case Op::Const: pushInt(*code, i.imm); break;
+        case Op::Str:   code->emitString(Opcode::ldc, i.text); break;
+        case Op::Undef: code->emit(i.type == ir::Type::String ? Opcode::aconst_null : Opcode::iconst_0); break;
+        default:        load(v); break;
+    }
+}
+
+void IRLowering::load(ValueId v) {
+    bool ref = f->values[size_t(v)].type == ir::Type::String;
+    code->emit(ref ? Opcode::aload : Opcode::iload, slot[size_t(v)]);
+}
+
+void IRLowering::store(ValueId v) {
+    bool ref = f->values[size_t(v)].type == ir::Type::String;
+    code->emit(ref ? Opcode::astore : Opcode::istore, slot[size_t(v)]);
+}
+
+Opcode IRLowering::compare(ValueId cmp) const {
+    const ir::Inst& i = f->values[size_t(cmp)];
+    if (f->values[size_t(i.args[0])].type == ir::Type::String)
+        return i.op == Op::Ne ? Opcode::if_acmpne : Opcode::if_acmpeq;
+    Opcode op;
+    switch (i.op) {
+        case Op::Lt: op = Opcode::if_icmplt; break;
+        case Op::Le: op = Opcode::if_icmple; break;
+        case Op::Gt: op = Opcode::if_icmpgt; break;
+        case Op::Ge: op = Opcode::if_icmpge; break;
+        case Op::Ne: op = Opcode::if_icmpne; break;
+        default:     op = Opcode::if_icmpeq; break;
+    }
+    if (zeroArg[size_t(cmp)] == 1) return zeroBranch(op);
+    if (zeroArg[size_t(cmp)] == 0) return zeroBranch(mirror(op));
+    return op;
+}
+
+void IRLowering::branch(Opcode op, BlockId t, BlockId e, BlockId next) {
+    if (t == next) {
+        code->emit(negate(op), labels[size_t(e)]);
+        return;
+    }
+    code->emit(op, labels[size_t(t)]);
+    if (e != next) code->emit(Opcode::goto_, labels[size_t(e)]);
+}
+
+// The parallel copy into `to`'s phis at the end of `from`
+void IRLowering::copies(BlockId from, BlockId to) {
+    const ir::Block& dest = f->blocks[size_t(to)];
+    if (dest.phis.empty()) return;
+    size_t k = size_t(std::find(dest.preds.begin(), dest.preds.end(), from) - dest.preds.begin());
+    std::vector<ValueId> moved;
+    for (ValueId phi : dest.phis) {
+        if (!needsSlot[size_t(phi)]) continue;
+        ValueId src = f->values[size_t(phi)].args[k];
+        if (needsSlot[size_t(src)] && slot[size_t(src)] == slot[size_t(phi)]) continue;
+        push(src);
+        moved.push_back(phi);
+    }
+    for (size_t m = moved.size(); m-- > 0;) store(moved[m]);
+}
+
+void IRLowering::emitInst(ValueId v, BlockId next) {
+    for (const Push& p : before[size_t(v)]) {
+        if (p.value == None) code->emitRef(Opcode::getstatic, printStream);
+        else push(p.value);
+    }
+    const ir::Inst& i = f->values[size_t(v)];
+    switch (i.op) {
+        case Op::Const: case Op::Str: case Op::Undef: case Op::Param: case Op::Phi:
+            return;
+        case Op::Load:  code->emitRef(Opcode::getstatic, fieldRef(*i.sym)); break;
+        case Op::Add:   code->emit(Opcode::iadd); break;
+        case Op::Sub:   code->emit(Opcode::isub); break;
+        case Op::Mul:   code->emit(Opcode::imul); break;
+        case Op::Div:   code->emit(Opcode::idiv); break;
+        case Op::Rem:   code->emit(Opcode::irem); break;
+        case Op::Neg:   code->emit(Opcode::ineg); break;
+        case Op::Or:    code->emit(Opcode::ior); break;
+        case Op::Xor:   code->emit(Opcode::ixor); break;
+        case Op::Not:
+            code->emit(Opcode::iconst_1);
+            code->emit(Opcode::ixor);
+            break;
+        case Op::Eq: case Op::Ne: case Op::Lt: case Op::Le: case Op::Gt: case Op::Ge: {
+            if (fused(v)) return;       // the branch jumps on it
+            Label Ltrue = ctx->newLabel(), Lend = ctx->newLabel();
+            code->emit(compare(v), Ltrue);
+            code->emit(Opcode::iconst_0);
+            code->emit(Opcode::goto_, Lend);
+            code->label(Ltrue);
+            code->emit(Opcode::iconst_1);
+            code->label(Lend);
+            break;
+        }
+        case Op::Call:  code->emitRef(Opcode::invokestatic, methodRef(*i.sym)); break;
+        case Op::Store: code->emitRef(Opcode::putstatic, fieldRef(*i.sym)); return;
+        case Op::Print:
+        case Op::Println:
+            code->emitRef(Opcode::invokevirtual, printRef(f->values[size_t(i.args[0])].type, i.op == Op::Println));
+            return;
+        case Op::Jump:
+            copies(i.block, i.target[0]);
+            if (i.target[0] != next) code->emit(Opcode::goto_, labels[size_t(i.target[0])]);
+            return;
+        case Op::Branch: {
+            ValueId c = i.args[0];
+            branch(fused(c) ? compare(c) : Opcode::ifne, i.target[0], i.target[1], next);
+            return;
+        }
+        case Op::Return:
+            if (i.args.empty()) code->emit(Opcode::return_);
+            else code->emit(f->values[size_t(i.args[0])].type == ir::Type::String ? Opcode::areturn : Opcode::ireturn);
+            return;
+    }
+    if (i.type == ir::Type::Void || stacked(v)) return;
+    if (uses[size_t(v)] == 0) code->emit(Opcode::pop);
+    else store(v);
+}
@@ -0,0 +1,513 @@
+#include "IRPasses.hpp"
+#include "IRAnalysis.hpp"
+#include "OptReport.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace ir {
+
+namespace {
+
+void erase(std::vector<ValueId>& list, ValueId v) {
+    list.erase(std::find(list.begin(), list.end(), v));
+}
+
+// Java int semantics: wrapping, MIN / -1 == MIN, MIN % -1 == 0
+std::optional<int> fold(Op op, int a, int b) {
+    auto wrap = [](uint32_t v) { return int(v); };
+    switch (op) {
+        case Op::Add: return wrap(uint32_t(a) + uint32_t(b));
+        case Op::Sub: return wrap(uint32_t(a) - uint32_t(b));
+        case Op::Mul: return wrap(uint32_t(a) * uint32_t(b));
+        case Op::Div:
+            if (b == 0) return std::nullopt;
+            return b == -1 ? wrap(0u - uint32_t(a)) : a / b;
+        case Op::Rem:
+            if (b == 0) return std::nullopt;
+            return b == -1 ? 0 : a % b;
+        case Op::Neg: return wrap(0u - uint32_t(a));
+        case Op::Or:  return a | b;
+        case Op::Xor: return a ^ b;
+        case Op::Not: return a ^ 1;
+        case Op::Eq:  return a == b;
+        case Op::Ne:  return a != b;
+        case Op::Lt:  return a < b;
+        case Op::Le:  return a <= b;
+        case Op::Gt:  return a > b;
+        case Op::Ge:  return a >= b;
+        default:      return std::nullopt;
+    }
+}
+
+// Replaces phis and instructions by constants in place; a phi moves
+// to the front of its block's instructions
+void makeConst(Function& f, ValueId v, int value) {
+    Inst& i = f.values[size_t(v)];
+    if (i.op == Op::Phi) {
+        Block& b = f.blocks[size_t(i.block)];
+        erase(b.phis, v);
+        b.insts.insert(b.insts.begin(), v);
+    }
+    i.op = Op::Const;
+    i.imm = value;
+    i.args.clear();
+    i.sym = nullptr;
+}
+
+//---------------------------------------------------------------
+// ir.const-prop
+//---------------------------------------------------------------
+class ConstPropagation : public IRPass {
+public:
+    const char* name() const override { return "ir.const-prop"; }
+
+    bool run(Function& f, OptReport* report) override {
+        solve(f);
+
+        long branches = 0, folded = 0;
+        for (size_t b = 0; b < f.blocks.size(); ++b) {
+            if (!reached[b]) continue;
+            Inst& t = f.values[size_t(f.terminator(BlockId(b)))];
+            if (t.op != Op::Branch || state[size_t(t.args[0])] != Known) continue;
+            int taken = value[size_t(t.args[0])] ? 0 : 1;
+            f.removeEdge(BlockId(b), t.target[1 - taken]);
+            t.op = Op::Jump;
+            t.target[0] = t.target[taken];
+            t.target[1] = None;
+            t.args.clear();
+            ++branches;
+        }
+        long blocks = f.removeUnreachable();
+        for (auto& blk : f.blocks)
+            for (auto* list : {&blk.phis, &blk.insts})
+                for (size_t k = 0; k < list->size();) {
+                    ValueId v = (*list)[k];
+                    bool was = f.values[size_t(v)].op == Op::Const;
+                    if (state[size_t(v)] == Known && !was) {
+                        makeConst(f, v, value[size_t(v)]);
+                        ++folded;
+                        if (list == &blk.phis) continue;    // moved out of `phis`
+                    }
+                    ++k;
+                }
+        if (report) {
+            report->add(name(), "values folded", folded);
+            report->add(name(), "branches folded", branches);
+            report->add(name(), "blocks removed", blocks);
+        }
+        return folded + branches + blocks > 0;
+    }
+
+private:
+    enum State : char { Top, Known, Varying };
+    std::vector<State> state;
+    std::vector<int> value;
+    std::vector<char> reached;
+    std::vector<std::vector<char>> edge;        // [block][successor index] executable
+    std::vector<std::vector<ValueId>> users;
+    std::vector<BlockId> flow;
+    std::vector<ValueId> ssa;
+
+    void solve(Function& f) {
+        size_t n = f.values.size();
+        state.assign(n, Top);
+        value.assign(n, 0);
+        reached.assign(f.blocks.size(), 0);
+        edge.assign(f.blocks.size(), std::vector<char>(2, 0));
+        users.assign(n, {});
+        for (auto& blk : f.blocks)
+            for (auto* list : {&blk.phis, &blk.insts})
+                for (ValueId v : *list)
+                    for (ValueId a : f.values[size_t(v)].args) users[size_t(a)].push_back(v);
+
+        reached[0] = 1;
+        flow.assign(1, 0);
+        ssa.clear();
+        while (!flow.empty() || !ssa.empty()) {
+            if (!flow.empty()) {
+                BlockId b = flow.back();
+                flow.pop_back();
+                for (auto* list : {&f.blocks[size_t(b)].phis, &f.blocks[size_t(b)].insts})
+                    for (ValueId v : *list) visit(f, v);
+            } else {
+                ValueId v = ssa.back();
+                ssa.pop_back();
+                if (reached[size_t(f.values[size_t(v)].block)]) visit(f, v);
+            }
+        }
+    }
+
+    void lower(ValueId v, State s, int c = 0) {
+        State& now = state[size_t(v)];
+        if (s == now && (s != Known || value[size_t(v)] == c)) return;
+        if (now == Varying) return;
+        if (now == Known && s == Known) s = Varying;    // two different constants
+        now = s;
+        value[size_t(v)] = c;
+        for (ValueId u : users[size_t(v)]) ssa.push_back(u);
+    }
+
+    void follow(Function& f, BlockId b, int k) {
+        if (edge[size_t(b)][size_t(k)]) return;
+        edge[size_t(b)][size_t(k)] = 1;
+        BlockId s[2];
+        f.succs(b, s);
+        BlockId to = s[k];
+        if (!reached[size_t(to)]) {
+            reached[size_t(to)] = 1;
+            flow.push_back(to);
+        } else {
+            for (ValueId phi : f.blocks[size_t(to)].phis) ssa.push_back(phi);
+        }
+    }
+
+    bool executable(const Function& f, BlockId from, BlockId to) const {
+        BlockId s[2];
+        int count = f.succs(from, s);
+        for (int k = 0; k < count; ++k)
+            if (s[k] == to && edge[size_t(from)][size_t(k)]) return true;
+        return false;
+    }
+
+    void visit(Function& f, ValueId v) {
+        const Inst& i = f.values[size_t(v)];
+        switch (i.op) {
+            case Op::Const:
+                lower(v, Known, i.imm);
+                return;
+            case Op::Phi: {
+                const auto& preds = f.blocks[size_t(i.block)].preds;
+                State s = Top;
+                int c = 0;
+                for (size_t k = 0; k < preds.size(); ++k) {
+                    if (!executable(f, preds[k], i.block)) continue;
+                    ValueId a = i.args[k];
+                    if (state[size_t(a)] == Top) continue;
+                    if (state[size_t(a)] == Varying || (s == Known && value[size_t(a)] != c)) {
+                        s = Varying;
+                        break;
+                    }
+                    s = Known;
+                    c = value[size_t(a)];
+                }
+                if (s != Top) lower(v, s, c);
+                return;
+            }
+            case Op::Jump:
+                follow(f, i.block, 0);
+                return;
+            case Op::Branch: {
+                ValueId c = i.args[0];
+                if (state[size_t(c)] == Known) follow(f, i.block, value[size_t(c)] ? 0 : 1);
+                else if (state[size_t(c)] == Varying) {
+                    follow(f, i.block, 0);
+                    follow(f, i.block, 1);
+                }
+                return;
+            }
+            case Op::Return: case Op::Store: case Op::Print: case Op::Println:
+                return;
+            default:
+                break;
+        }
+        if (i.type == Type::Void) return;
+        if (i.args.empty() || i.type == Type::String || i.op == Op::Call || i.op == Op::Load) {
+            lower(v, Varying);
+            return;
+        }
+        for (ValueId a : i.args) {
+            if (state[size_t(a)] == Top) return;
+            if (state[size_t(a)] == Varying || f.values[size_t(a)].type == Type::String) {
+                lower(v, Varying);
+                return;
+            }
+        }
+        auto r = fold(i.op, value[size_t(i.args[0])], i.args.size() > 1 ? value[size_t(i.args[1])] : 0);
+        if (r) lower(v, Known, *r);
+        else lower(v, Varying);
+    }
+};
+
+//---------------------------------------------------------------
+// ir.cfg
+//---------------------------------------------------------------
+class CfgSimplification : public IRPass {
+public:
+    const char* name() const override { return "ir.cfg"; }
+
+    bool run(Function& f, OptReport* report) override {
+        long removed = f.removeUnreachable();
+        to.resize(f.values.size());
+        for (size_t v = 0; v < to.size(); ++v) to[v] = ValueId(v);
+
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t b = 0; b < f.blocks.size(); ++b) {
+                if (f.blocks[b].dead) continue;
+                Inst& t = f.values[size_t(f.terminator(BlockId(b)))];
+                if (t.op == Op::Branch && t.target[0] == t.target[1]) {
+                    if (!sameArgs(f, BlockId(b), t.target[0])) continue;
+                    f.removeEdge(BlockId(b), t.target[1]);
+                    t.op = Op::Jump;
+                    t.target[1] = None;
+                    t.args.clear();
+                    changed = true;
+                    continue;
+                }
+                if (t.op != Op::Jump || t.target[0] == BlockId(b)) continue;
+                BlockId s = t.target[0];
+                if (s != 0 && f.blocks[size_t(s)].preds.size() == 1) {
+                    merge(f, BlockId(b), s);
+                } else if (b != 0 && f.blocks[b].phis.empty() && f.blocks[b].insts.size() == 1 &&
+                           bypass(f, BlockId(b), s)) {
+                } else {
+                    continue;
+                }
+                ++removed;
+                changed = true;
+            }
+        }
+        for (auto& i : f.values)
+            if (!i.dead)
+                for (ValueId& a : i.args) a = find(a);
+        if (report) report->add(name(), "blocks removed", removed);
+        return removed > 0;
+    }
+
+private:
+    std::vector<ValueId> to;        // phis of merged blocks → their only operand
+
+    ValueId find(ValueId v) {
+        while (to[size_t(v)] != v) v = to[size_t(v)] = to[size_t(to[size_t(v)])];
+        return v;
+    }
+
+    // both edges from→to carry the same phi operands
+    bool sameArgs(const Function& f, BlockId from, BlockId to) {
+        const Block& b = f.blocks[size_t(to)];
+        size_t first = b.preds.size();
+        for (size_t k = 0; k < b.preds.size(); ++k) {
+            if (b.preds[k] != from) continue;
+            if (first == b.preds.size()) {
+                first = k;
+                continue;
+            }
+            for (ValueId phi : b.phis)
+                if (find(f.values[size_t(phi)].args[k]) != find(f.values[size_t(phi)].args[first])) return false;
+        }
+        return true;
+    }
+
+    // b jumps to s and is its only predecessor: s's code moves into b
+    void merge(Function& f, BlockId b, BlockId s) {
+        Block& from = f.blocks[size_t(s)];
+        for (ValueId phi : from.phis) {
+            to[size_t(phi)] = find(f.values[size_t(phi)].args[0]);
+            f.values[size_t(phi)].dead = true;
+        }
+        Block& into = f.blocks[size_t(b)];
+        f.values[size_t(into.insts.back())].dead = true;
+        into.insts.pop_back();
+        for (ValueId v : from.insts) {
+            f.values[size_t(v)].block = b;
+            into.insts.push_back(v);
+        }
+        BlockId succ[2];
+        for (int k = f.succs(b, succ); k-- > 0;)
+            for (BlockId& p : f.blocks[size_t(succ[k])].preds)
+                if (p == s) p = b;
+        from.phis.clear();
+        from.insts.clear();
+        from.preds.clear();
+        from.dead = true;
+    }
+
+    // b holds only `jump s`: its predecessors jump to s directly. Not
+    // when one of them already goes to s and s has phis — the two
+    // edges might need different operands.
+    bool bypass(Function& f, BlockId b, BlockId s) {
+        Block& mid = f.blocks[size_t(b)];
+        Block& dest = f.blocks[size_t(s)];
+        if (!dest.phis.empty())
+            for (BlockId p : mid.preds)
+                if (std::find(dest.preds.begin(), dest.preds.end(), p) != dest.preds.end()) return false;
+        size_t k = size_t(std::find(dest.preds.begin(), dest.preds.end(), b) - dest.preds.begin());
+        for (BlockId p : mid.preds) {
+            dest.preds.push_back(p);
+            for (ValueId phi : dest.phis) {
+                auto& args = f.values[size_t(phi)].args;
+                args.push_back(args[k]);
+            }
+            for (BlockId& t : f.values[size_t(f.terminator(p))].target)
+                if (t == b) t = s;
+        }
+        f.removeEdge(b, s);
+        f.values[size_t(mid.insts.back())].dead = true;
+        mid.insts.clear();
+        mid.preds.clear();
+        mid.dead = true;
+        return true;
+    }
+};
+
+//---------------------------------------------------------------
+// ir.gvn
+//---------------------------------------------------------------
+struct Key {
+    Op op;
+    Type type;
+    int imm;
+    ValueId a, b;
+    std::string_view text;
+    bool operator==(const Key& o) const {
+        return op == o.op && type == o.type && imm == o.imm && a == o.a && b == o.b && text == o.text;
+    }
+};
+
+struct KeyHash {
+    size_t operator()(const Key& k) const {
+        size_t h = size_t(k.op) * 31 + size_t(k.type);
+        h = h * 1000003 ^ size_t(uint32_t(k.imm));
+        h = h * 1000003 ^ size_t(uint32_t(k.a));
+        h = h * 1000003 ^ size_t(uint32_t(k.b));
+        return h ^ std::hash<std::string_view>{}(k.text);
+    }
+};
+
+bool commutative(Op op) {
+    return op == Op::Add || op == Op::Mul || op == Op::Or || op == Op::Xor || op == Op::Eq || op == Op::Ne;
+}
+
+class DominatorValueNumbering : public IRPass {
+public:
+    const char* name() const override { return "ir.gvn"; }
+
+    bool run(Function& f, OptReport* report) override {
+        DominatorTree dom(f);
+        to.resize(f.values.size());
+        for (size_t v = 0; v < to.size(); ++v) to[v] = ValueId(v);
+        table.clear();
+        undo.clear();
+
+        long shared = 0;
+        // preorder over the dominator tree; a block's entries are
+        // dropped again once its subtree is done
+        std::vector<std::pair<BlockId, size_t>> walk{{0, 0}};
+        std::vector<size_t> marks{enter(f, 0, shared)};
+        while (!walk.empty()) {
+            auto& [b, next] = walk.back();
+            const auto& kids = dom.children(b);
+            if (next < kids.size()) {
+                BlockId c = kids[next++];
+                walk.emplace_back(c, 0);
+                marks.push_back(enter(f, c, shared));
+                continue;
+            }
+            for (size_t k = undo.size(); k-- > marks.back();) table.erase(undo[k]);
+            undo.resize(marks.back());
+            marks.pop_back();
+            walk.pop_back();
+        }
+        f.rename(to);
+        if (report) report->add(name(), "values shared", shared);
+        return shared > 0;
+    }
+
+private:
+    std::vector<ValueId> to;
+    std::unordered_map<Key, ValueId, KeyHash> table;
+    std::vector<Key> undo;
+
+    size_t enter(Function& f, BlockId b, long& shared) {
+        size_t mark = undo.size();
+        auto& insts = f.blocks[size_t(b)].insts;
+        for (size_t k = 0; k < insts.size();) {
+            ValueId v = insts[k];
+            Inst& i = f.values[size_t(v)];
+            for (ValueId& a : i.args) a = to[size_t(a)];
+            bool candidate = (pure(i.op) || i.op == Op::Div || i.op == Op::Rem) &&
+                             i.op != Op::Phi && i.op != Op::Param && i.op != Op::Undef;
+            if (!candidate) {
+                ++k;
+                continue;
+            }
+            Key key{i.op, i.type, i.imm, i.args.size() > 0 ? i.args[0] : None,
+                    i.args.size() > 1 ? i.args[1] : None, i.text};
+            if (commutative(i.op) && key.a > key.b) std::swap(key.a, key.b);
+            auto [it, fresh] = table.emplace(key, v);
+            if (fresh) {
+                undo.push_back(key);
+                ++k;
+                continue;
+            }
+            to[size_t(v)] = it->second;
+            i.dead = true;
+            insts.erase(insts.begin() + std::ptrdiff_t(k));
+            ++shared;
+        }
+        return mark;
+    }
+};
+
+//---------------------------------------------------------------
+// ir.dce
+//---------------------------------------------------------------
+class DeadInstructions : public IRPass {
+public:
+    const char* name() const override { return "ir.dce"; }
+
+    bool run(Function& f, OptReport* report) override {
+        std::vector<char> live(f.values.size(), 0);
+        std::vector<ValueId> work;
+        for (auto& blk : f.blocks)
+            for (auto* list : {&blk.phis, &blk.insts})
+                for (ValueId v : *list)
+                    if (!removable(f, f.values[size_t(v)])) {
+                        live[size_t(v)] = 1;
+                        work.push_back(v);
+                    }
+        while (!work.empty()) {
+            ValueId v = work.back();
+            work.pop_back();
+            for (ValueId a : f.values[size_t(v)].args)
+                if (!live[size_t(a)]) {
+                    live[size_t(a)] = 1;
+                    work.push_back(a);
+                }
+        }
+        long removed = 0;
+        for (auto& blk : f.blocks)
+            for (auto* list : {&blk.phis, &blk.insts})
+                list->erase(std::remove_if(list->begin(), list->end(),
+                                           [&](ValueId v) {
+                                               if (live[size_t(v)]) return false;
+                                               f.values[size_t(v)].dead = true;
+                                               ++removed;
+                                               return true;
+                                           }),
+                            list->end());
+        if (report) report->add(name(), "instructions removed", removed);
+        return removed > 0;
+    }
+
+private:
+    static bool removable(const Function& f, const Inst& i) {
+        if (pure(i.op) || i.op == Op::Load) return true;
+        if (i.op != Op::Div && i.op != Op::Rem) return false;
+        const Inst& d = f.values[size_t(i.args[1])];
+        return d.op == Op::Const && d.imm != 0;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<IRPass> constPropagation()  { return std::make_unique<ConstPropagation>(); }
+std::unique_ptr<IRPass> cfgSimplification() { return std::make_unique<CfgSimplification>(); }
+std::unique_ptr<IRPass> valueNumbering()    { return std::make_unique<DominatorValueNumbering>(); }
+std::unique_ptr<IRPass> deadCode()          { return std::make_unique<DeadInstructions>(); }
+
+} // namespace ir
@@ -0,0 +1,105 @@
+#include "Inliner.hpp"
+
+using namespace ast;
+
+namespace {
+
+// Node count of a function body, and whether it rules inlining out
+struct Shape : Visitor {
+    const std::string& self;
+    int size = 0;
+    bool ok = true;
+
+    explicit Shape(const std::string& name) : self(name) {}
+
+    void walk(Node* n) {
+        if (!n || !ok) return;
+        ++size;
+        n->accept(*this);
+    }
+
+    void visit(IntLit&) override {}
+    void visit(RealLit&) override {}
+    void visit(StringLit&) override {}
+    void visit(BoolLit&) override {}
+    void visit(CharLit&) override {}
+    void visit(Var& v) override { ok = ok && v.indices.empty(); }
+    void visit(Unary& u) override { walk(u.rhs.get()); }
+    void visit(Binary& b) override { walk(b.lhs.get()); walk(b.rhs.get()); }
+    void visit(Postfix& p) override { walk(p.operand.get()); }
+    void visit(Assign& a) override { walk(a.lhs.get()); walk(a.rhs.get()); }
+    void visit(RangeExpr& r) override { walk(r.start.get()); walk(r.end.get()); }
+    void visit(Call& c) override {
+        ok = ok && c.callee != self;
+        for (auto& arg : c.args) walk(arg.get());
+    }
+    void visit(Print& p) override { walk(p.expr.get()); }
+    void visit(Println& p) override { walk(p.expr.get()); }
+    void visit(Read& r) override { walk(r.var.get()); }
+    void visit(Block& b) override {
+        --size;     // braces cost nothing
+        for (auto& s : b.stmts) walk(s.get());
+    }
+    void visit(IfStmt& s) override { walk(s.cond.get()); walk(s.thenStmt.get()); walk(s.elseStmt.get()); }
+    void visit(WhileStmt& s) override { walk(s.cond.get()); walk(s.body.get()); }
+    void visit(ForStmt& s) override {
+        walk(s.init.get()); walk(s.cond.get()); walk(s.step.get()); walk(s.body.get());
+    }
+    void visit(ForEachStmt& s) override { walk(s.var.get()); walk(s.collection.get()); walk(s.body.get()); }
+    void visit(SwitchStmt& s) override {
+        walk(s.cond.get());
+        for (auto& c : s.cases) walk(c.body.get());
+    }
+    void visit(ReturnStmt& s) override { walk(s.expr.get()); }
+    void visit(ExprStmt& s) override { walk(s.expr.get()); }
+    void visit(EmptyStmt&) override {}
+    void visit(BreakStmt&) override {}
+    void visit(ContinueStmt&) override {}
+    void visit(DeclList& dl) override { for (auto& d : dl.decls) walk(d.get()); }
+    void visit(VarDecl& d) override { ok = ok && d.dims.empty(); walk(d.init.get()); }
+    void visit(VarDeclList& dl) override { for (auto& d : dl.decls) walk(d.get()); }
+    void visit(ConstDecl& d) override { visit(static_cast<VarDecl&>(d)); }
+    void visit(FuncDecl&) override { ok = false; }
+    void visit(Program&) override { ok = false; }
+};
+
+// every path through `s` ends in a return (the expansion must leave a value)
+bool returns(const Stmt* s) {
+    if (dynamic_cast<const ReturnStmt*>(s)) return true;
+    if (auto* b = dynamic_cast<const Block*>(s)) return !b->stmts.empty() && returns(b->stmts.back().get());
+    if (auto* i = dynamic_cast<const IfStmt*>(s)) return i->elseStmt && returns(i->thenStmt.get()) && returns(i->elseStmt.get());
+    if (auto* sw = dynamic_cast<const SwitchStmt*>(s)) {
+        if (sw->hasBreak) return false;
+        bool dflt = false;
+        for (auto& c : sw->cases) {
+            if (!returns(c.body.get())) return false;
+            dflt = dflt || c.isDefault;
+        }
+        return dflt;
+    }
+    return false;
+}
+
+} // namespace
+
+Inliner::Inliner(Program& program) {
+    auto consider = [&](Node* n) {
+        auto* f = dynamic_cast<FuncDecl*>(n);
+        if (!f || f->name == "main" || !f->body) return;
+        for (auto& p : f->params)
+            if (!p->dims.empty()) return;
+        if (f->returnType.kind != BasicType::Void && !returns(f->body.get())) return;
+        Shape shape(f->name);
+        shape.walk(f->body.get());
+        if (shape.ok && shape.size <= kLoopSize) functions.emplace(f->name, Info{f, shape.size});
+    };
+    for (auto& d : program.globals) consider(d.get());
+    for (auto& s : program.stmts) consider(s.get());
+}
+
+const FuncDecl* Inliner::candidate(const std::string& callee, bool inLoop, int depth) const {
+    if (depth >= kMaxDepth) return nullptr;
+    auto it = functions.find(callee);
+    if (it == functions.end()) return nullptr;
+    return it->second.size <= (inLoop ? kLoopSize : kSmallSize) ? it->second.fn : nullptr;
+}
@@ -0,0 +1,72 @@
+#include "Liveness.hpp"
+
+#include <algorithm>
+
+void Liveness::run(const MethodCode& m, int slots) {
+    const std::vector<Instr>& v = m.instrs();
+    method = &m;
+    code = &v;
+    size = int(v.size());
+    words = size_t(std::max(slots, 1) + 63) / 64;
+
+    // ---- basic blocks: a label run, or the instruction after a jump, starts one
+    starts.clear();
+    labelBlock.clear();
+    owner.assign(v.size(), 0);
+    bool leader = true;
+    for (size_t i = 0; i < v.size(); ++i) {
+        if (v[i].isLabel && i > 0 && !v[i - 1].isLabel) leader = true;
+        if (leader) {
+            starts.push_back(int(i));
+            leader = false;
+        }
+        int b = int(starts.size()) - 1;
+        owner[i] = b;
+        if (v[i].isLabel) {
+            if (size_t(v[i].a) >= labelBlock.size()) labelBlock.resize(size_t(v[i].a) + 1, -1);
+            labelBlock[size_t(v[i].a)] = b;
+        } else if (v[i].isBranch() || endsFlow(v[i].op)) {
+            leader = true;
+        }
+    }
+    const int B = blocks();
+
+    // ---- per-block use (read before any write) and def sets
+    use.assign(size_t(B) * words, 0);
+    def.assign(size_t(B) * words, 0);
+    for (size_t i = 0; i < v.size(); ++i) {
+        int s;
+        if (!localSlot(v[i], s) || s >= slots) continue;
+        size_t b = size_t(owner[i]) * words;
+        if (reads(v[i]) && !test(&def[b], s)) put(&use[b], s);
+        if (writes(v[i])) put(&def[b], s);
+    }
+
+    // ---- liveness to a fixed point, blocks visited last to first
+    in.assign(size_t(B) * words, 0);
+    out.assign(size_t(B) * words, 0);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int b = B - 1; b >= 0; --b) {
+            uint64_t* o = &out[size_t(b) * words];
+            forEachSucc(b, [&](int succ) {
+                const uint64_t* si = &in[size_t(succ) * words];
+                for (size_t w = 0; w < words; ++w) o[w] |= si[w];
+            });
+            uint64_t* i = &in[size_t(b) * words];
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t next = use[size_t(b) * words + w] | (o[w] & ~def[size_t(b) * words + w]);
+                if (next != i[w]) {
+                    i[w] = next;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+int Liveness::fallThrough(int b) const {
+    const Instr& last = (*code)[size_t(end(b))];
+    if (b + 1 >= blocks() || (!last.isLabel && endsFlow(last.op))) return -1;
+    return b + 1;
+}
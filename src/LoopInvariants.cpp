@@ -0,0 +1,255 @@
+#include "LoopInvariants.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+using namespace ast;
+
+namespace {
+
+// Everything a loop may change on some trip
+struct Writes : Visitor {
+    std::vector<char>& locals;                  // per slot: 1 stepped by constants, 2 anything else
+    std::unordered_set<std::string>& globals;
+    bool calls = false;
+
+    Writes(std::vector<char>& l, std::unordered_set<std::string>& g) : locals(l), globals(g) {}
+
+    void walk(Node* n) { if (n) n->accept(*this); }
+    void local(int slot, char how = 2) {
+        if (size_t(slot) >= locals.size()) locals.resize(size_t(slot) + 1, 0);
+        locals[size_t(slot)] = std::max(locals[size_t(slot)], how);
+    }
+    bool counter(const Var& v) const {
+        return !v.sym.isGlobal && v.indices.empty() && v.ty.kind == BasicType::Int &&
+               size_t(v.sym.slot) < locals.size() && locals[size_t(v.sym.slot)] == 1;
+    }
+    bool changed(const Var& v) const {
+        if (v.sym.isGlobal) return calls || (!globals.empty() && globals.count(v.name));
+        return size_t(v.sym.slot) < locals.size() && locals[size_t(v.sym.slot)];
+    }
+    void wrote(const Var& v, bool step = false) {
+        if (v.sym.isGlobal) globals.insert(v.name);
+        else local(v.sym.slot, step && v.indices.empty() ? 1 : 2);
+        for (auto& idx : v.indices) walk(idx.get());
+    }
+
+    void visit(IntLit&) override {}
+    void visit(RealLit&) override {}
+    void visit(StringLit&) override {}
+    void visit(BoolLit&) override {}
+    void visit(CharLit&) override {}
+    void visit(Var& v) override { for (auto& idx : v.indices) walk(idx.get()); }
+    void visit(Unary& u) override { walk(u.rhs.get()); }
+    void visit(Binary& b) override { walk(b.lhs.get()); walk(b.rhs.get()); }
+    void visit(Postfix& p) override { wrote(*p.operand, true); }
+    void visit(Assign& a) override { wrote(*a.lhs, LoopInvariants::step(a).has_value()); walk(a.rhs.get()); }
+    void visit(RangeExpr& r) override { walk(r.start.get()); walk(r.end.get()); }
+    void visit(Call& c) override {
+        calls = true;
+        for (auto& arg : c.args) walk(arg.get());
+    }
+    void visit(Print& p) override { walk(p.expr.get()); }
+    void visit(Println& p) override { walk(p.expr.get()); }
+    void visit(Read& r) override { if (r.var) wrote(*r.var); }
+    void visit(Block& b) override { for (auto& s : b.stmts) walk(s.get()); }
+    void visit(IfStmt& s) override { walk(s.cond.get()); walk(s.thenStmt.get()); walk(s.elseStmt.get()); }
+    void visit(WhileStmt& s) override { walk(s.cond.get()); walk(s.body.get()); }
+    void visit(ForStmt& s) override {
+        walk(s.init.get()); walk(s.cond.get()); walk(s.step.get()); walk(s.body.get());
+    }
+    void visit(ForEachStmt& s) override { wrote(*s.var); walk(s.collection.get()); walk(s.body.get()); }
+    void visit(SwitchStmt& s) override {
+        walk(s.cond.get());
+        for (auto& c : s.cases) walk(c.body.get());
+    }
+    void visit(ReturnStmt& s) override { walk(s.expr.get()); }
+    void visit(ExprStmt& s) override { walk(s.expr.get()); }
+    void visit(EmptyStmt&) override {}
+    void visit(BreakStmt&) override {}
+    void visit(ContinueStmt&) override {}
+    void visit(DeclList& dl) override { for (auto& d : dl.decls) walk(d.get()); }
+    void visit(VarDecl& d) override { local(d.sym.slot); walk(d.init.get()); }
+    void visit(VarDeclList& dl) override { for (auto& d : dl.decls) walk(d.get()); }
+    void visit(ConstDecl& d) override { visit(static_cast<VarDecl&>(d)); }
+    void visit(FuncDecl&) override {}
+    void visit(Program&) override {}
+};
+
+bool arithmetic(Op op) {
+    return op == Op::Plus || op == Op::Minus || op == Op::Mul || op == Op::Div || op == Op::Mod;
+}
+
+bool nonZeroConstant(const Expr& e) {
+    auto* lit = dynamic_cast<const IntLit*>(&e);
+    return lit && lit->value != 0;
+}
+
+// Walks the loop bottom-up; every expression reports whether it is
+// invariant, whether it reads a variable and whether a temp would save
+// anything (literals and local reads are as cheap as the iload)
+struct Finder : Visitor {
+    struct Value {
+        bool invariant = false;
+        bool reads = false;
+        bool worth = false;
+    };
+
+    const Writes& writes;
+    const std::unordered_set<const Expr*>& hoisted;
+    std::vector<Expr*> found;
+    std::vector<LoopInvariants::Product> products;
+    Value last;
+
+    Finder(const Writes& w, const std::unordered_set<const Expr*>& h) : writes(w), hoisted(h) {}
+
+    bool done(const Expr& e) const { return !hoisted.empty() && hoisted.count(&e); }
+
+    void walk(Node* n) { if (n) n->accept(*this); }
+    Value check(Expr& e) {
+        last = Value{};
+        e.accept(*this);
+        return last;
+    }
+    // a complete expression: its own value is what may be hoisted
+    void root(Expr* e) {
+        if (!e) return;
+        Value v = check(*e);
+        if (v.invariant) take(*e, v);
+    }
+    void take(Expr& e, Value v) {
+        if (v.worth && !done(e)) found.push_back(&e);
+    }
+    bool intOrBool(const Expr& e) {
+        return e.ty.kind == BasicType::Int || e.ty.kind == BasicType::Bool;
+    }
+
+    void visit(IntLit&) override { last = {true, false, false}; }
+    void visit(BoolLit&) override { last = {true, false, false}; }
+    void visit(RealLit&) override {}
+    void visit(StringLit&) override {}
+    void visit(CharLit&) override {}
+    void visit(Var& v) override {
+        if (!v.indices.empty()) {
+            for (auto& idx : v.indices) root(idx.get());
+            last = Value{};
+            return;
+        }
+        last = {!writes.changed(v) && intOrBool(v), true, v.sym.isGlobal};
+    }
+    void visit(Unary& u) override {
+        Value rhs = check(*u.rhs);
+        if (rhs.invariant && u.op == Op::Minus && u.ty.kind == BasicType::Int) {
+            last = {true, rhs.reads, rhs.reads};
+            return;
+        }
+        if (rhs.invariant) take(*u.rhs, rhs);
+        last = Value{};
+    }
+    void visit(Binary& b) override {
+        Value lhs = check(*b.lhs);
+        Value rhs = check(*b.rhs);
+        bool safe = (b.op != Op::Div && b.op != Op::Mod) || nonZeroConstant(*b.rhs);
+        if (lhs.invariant && rhs.invariant && arithmetic(b.op) && safe && b.ty.kind == BasicType::Int) {
+            bool reads = lhs.reads || rhs.reads;
+            last = {true, reads, reads};
+            return;
+        }
+        if (lhs.invariant) take(*b.lhs, lhs);
+        if (rhs.invariant) take(*b.rhs, rhs);
+        last = Value{};
+        if (b.op == Op::Mul && b.ty.kind == BasicType::Int && !done(b)) product(b);
+    }
+    // counter * k or k * counter
+    void product(Binary& b) {
+        auto* var = dynamic_cast<Var*>(b.lhs.get());
+        auto* lit = dynamic_cast<IntLit*>(b.rhs.get());
+        if (!var || !lit) {
+            var = dynamic_cast<Var*>(b.rhs.get());
+            lit = dynamic_cast<IntLit*>(b.lhs.get());
+        }
+        if (var && lit && lit->value != 0 && lit->value != 1 && lit->value != -1 && writes.counter(*var))
+            products.push_back({&b, var->sym.slot, lit->value});
+    }
+    void visit(Postfix& p) override {
+        for (auto& idx : p.operand->indices) root(idx.get());
+        last = Value{};
+    }
+    void visit(Assign& a) override {
+        for (auto& idx : a.lhs->indices) root(idx.get());
+        root(a.rhs.get());
+        last = Value{};
+    }
+    void visit(RangeExpr& r) override {
+        root(r.start.get());
+        root(r.end.get());
+        last = Value{};
+    }
+    void visit(Call& c) override {
+        for (auto& arg : c.args) root(arg.get());
+        last = Value{};
+    }
+
+    void visit(Print& p) override { root(p.expr.get()); }
+    void visit(Println& p) override { root(p.expr.get()); }
+    void visit(Read&) override {}
+    void visit(Block& b) override { for (auto& s : b.stmts) walk(s.get()); }
+    void visit(IfStmt& s) override { root(s.cond.get()); walk(s.thenStmt.get()); walk(s.elseStmt.get()); }
+    void visit(WhileStmt& s) override { root(s.cond.get()); walk(s.body.get()); }
+    void visit(ForStmt& s) override {
+        walk(s.init.get()); root(s.cond.get()); walk(s.step.get()); walk(s.body.get());
+    }
+    void visit(ForEachStmt& s) override { root(s.collection.get()); walk(s.body.get()); }
+    void visit(SwitchStmt& s) override {
+        root(s.cond.get());
+        for (auto& c : s.cases) walk(c.body.get());
+    }
+    void visit(ReturnStmt& s) override { root(s.expr.get()); }
+    void visit(ExprStmt& s) override { root(s.expr.get()); }
+    void visit(EmptyStmt&) override {}
+    void visit(BreakStmt&) override {}
+    void visit(ContinueStmt&) override {}
+    void visit(DeclList& dl) override { for (auto& d : dl.decls) walk(d.get()); }
+    void visit(VarDecl& d) override { root(d.init.get()); }
+    void visit(VarDeclList& dl) override { for (auto& d : dl.decls) walk(d.get()); }
+    void visit(ConstDecl& d) override { root(d.init.get()); }
+    void visit(FuncDecl&) override {}
+    void visit(Program&) override {}
+};
+
+} // namespace
+
+void LoopInvariants::run(std::initializer_list<Node*> parts, const Var* index,
+                         const std::unordered_set<const Expr*>& hoisted) {
+    localWritten.clear();
+    globalWritten.clear();
+    Writes writes(localWritten, globalWritten);
+    if (index) writes.wrote(*index, true);
+    for (Node* n : parts) writes.walk(n);
+
+    Finder finder(writes, hoisted);
+    for (Node* n : parts) {
+        if (auto* e = dynamic_cast<Expr*>(n)) finder.root(e);
+        else finder.walk(n);
+    }
+    found = std::move(finder.found);
+    stepped = std::move(finder.products);
+}
+
+std::optional<int> LoopInvariants::step(const Assign& a) {
+    auto* b = dynamic_cast<const Binary*>(a.rhs.get());
+    if (!b || !a.lhs->indices.empty() || (b->op != Op::Plus && b->op != Op::Minus)) return std::nullopt;
+    auto counter = [&](const Expr& e) {
+        auto* v = dynamic_cast<const Var*>(&e);
+        return v && v->indices.empty() && v->sym.isGlobal == a.lhs->sym.isGlobal &&
+               (v->sym.isGlobal ? v->name == a.lhs->name : v->sym.slot == a.lhs->sym.slot);
+    };
+    auto* k = dynamic_cast<const IntLit*>(b->rhs.get());
+    if (k && counter(*b->lhs))
+        return b->op == Op::Plus ? k->value : int(0u - uint32_t(k->value));
+    k = dynamic_cast<const IntLit*>(b->lhs.get());
+    if (k && b->op == Op::Plus && counter(*b->rhs)) return k->value;
+    return std::nullopt;
+}
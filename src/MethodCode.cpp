@@ -0,0 +1,132 @@
+#include "MethodCode.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// "int cls.f(int, int)" → argument count and whether a value is returned
+void callShape(std::string_view ref, int& args, bool& returns) {
+    returns = ref.substr(0, ref.find(' ')) != "void";
+    size_t open = ref.find('('), close = ref.rfind(')');
+    args = 0;
+    if (open == std::string_view::npos || close == std::string_view::npos || close == open + 1) return;
+    args = 1 + int(std::count(ref.begin() + long(open), ref.begin() + long(close), ','));
+}
+
+// Net change of the operand stack depth
+int stackEffect(const Instr& i) {
+    switch (i.op) {
+        case Opcode::aconst_null: case Opcode::iconst_m1: case Opcode::iconst_0: case Opcode::iconst_1:
+        case Opcode::iconst_2: case Opcode::iconst_3: case Opcode::iconst_4: case Opcode::iconst_5:
+        case Opcode::bipush: case Opcode::sipush: case Opcode::ldc: case Opcode::iload: case Opcode::aload:
+        case Opcode::getstatic: case Opcode::dup: case Opcode::dup_x1: case Opcode::new_:
+            return 1;
+        case Opcode::ldc2_w: case Opcode::dup2:
+            return 2;
+        case Opcode::istore: case Opcode::astore: case Opcode::putstatic: case Opcode::pop:
+        case Opcode::iadd: case Opcode::isub: case Opcode::imul: case Opcode::idiv: case Opcode::irem:
+        case Opcode::ishl: case Opcode::ishr: case Opcode::iushr: case Opcode::iand: case Opcode::ior:
+        case Opcode::ixor: case Opcode::iaload: case Opcode::aaload: case Opcode::baload:
+        case Opcode::ifeq: case Opcode::ifne: case Opcode::iflt: case Opcode::ifge: case Opcode::ifgt:
+        case Opcode::ifle: case Opcode::tableswitch: case Opcode::lookupswitch:
+        case Opcode::ireturn: case Opcode::areturn: case Opcode::athrow:
+            return -1;
+        case Opcode::if_icmpeq: case Opcode::if_icmpne: case Opcode::if_icmplt:
+        case Opcode::if_icmpge: case Opcode::if_icmpgt: case Opcode::if_icmple:
+        case Opcode::if_acmpeq: case Opcode::if_acmpne:
+            return -2;
+        case Opcode::iastore: case Opcode::aastore: case Opcode::bastore: case Opcode::castore:
+            return -3;
+        case Opcode::invokestatic: case Opcode::invokevirtual: case Opcode::invokespecial: {
+            int args;
+            bool returns;
+            callShape(i.text, args, returns);
+            return -args - (i.op == Opcode::invokestatic ? 0 : 1) + (returns ? 1 : 0);
+        }
+        default:   // nop, swap, ineg, i2c, iinc, goto, return, newarray, anewarray, arraylength
+            return 0;
+    }
+}
+
+} // namespace
+
+void MethodCode::print(CodeEmitter& em) const {
+    for (const Instr& i : code) {
+        if (i.isLabel) {
+            em.label(i.target());
+            continue;
+        }
+        switch (i.kind) {
+            case OperandKind::None:   em.emit(i.op); break;
+            case OperandKind::Int:    em.emit(i.op, i.a); break;
+            case OperandKind::Target: em.emit(i.op, i.target()); break;
+            case OperandKind::Ref:    em.emit(i.op, i.text); break;
+            case OperandKind::String: em.emit(i.op, '"', i.text, '"'); break;
+            case OperandKind::Iinc:   em.emit(i.op, i.a, ' ', i.b); break;
+            case OperandKind::Switch: printSwitch(em, i); break;
+        }
+    }
+}
+
+// Jasmin layout: the table one entry per line, then the default
+//     tableswitch 3 5          lookupswitch
+//         L1                       -7 : L1
+//         ...                      ...
+//         default : L9             default : L9
+void MethodCode::printSwitch(CodeEmitter& em, const Instr& i) const {
+    const SwitchTable& t = tables[size_t(i.a)];
+    if (i.op == Opcode::tableswitch) em.emit(i.op, t.low, ' ', t.low + int(t.targets.size()) - 1);
+    else em.emit(i.op);
+    em.push();
+    for (size_t k = 0; k < t.targets.size(); ++k) {
+        if (i.op == Opcode::tableswitch) em.line(t.targets[k]);
+        else em.line(t.keys[k], " : ", t.targets[k]);
+    }
+    em.line("default : ", t.dflt);
+    em.pop();
+}
+
+int MethodCode::maxStack() const {
+    labelAt.clear();
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!code[i].isLabel) continue;
+        if (size_t(code[i].a) >= labelAt.size()) labelAt.resize(size_t(code[i].a) + 1, -1);
+        labelAt[size_t(code[i].a)] = int(i);
+    }
+
+    depthAt.assign(code.size(), -1);   // stack depth on entry, -1 = not reached yet
+    work.clear();
+    int maxDepth = 0;
+    auto reach = [&](int at, int depth) {
+        if (at < 0 || size_t(at) >= code.size() || depth > 0xFFFF) return;
+        // join: paths meeting at a label must agree; keep the deeper one if not
+        if (depthAt[size_t(at)] >= depth) return;
+        depthAt[size_t(at)] = depth;
+        work.push_back(at);
+    };
+    reach(0, 0);
+    while (!work.empty()) {
+        size_t i = size_t(work.back());
+        work.pop_back();
+        int depth = depthAt[i];
+        const Instr& in = code[i];
+        if (!in.isLabel) {
+            depth = std::max(0, depth + stackEffect(in));
+            maxDepth = std::max(maxDepth, depth);
+            forEachTarget(in, [&](Label l) {
+                if (size_t(l.id) < labelAt.size()) reach(labelAt[size_t(l.id)], depth);
+            });
+            if (endsFlow(in.op)) continue;
+        }
+        reach(int(i) + 1, depth);
+    }
+    return maxDepth;
+}
+
+int MethodCode::maxLocals(int minimum) const {
+    int locals = minimum;
+    int slot;
+    for (const Instr& i : code)
+        if (localSlot(i, slot)) locals = std::max(locals, slot + 1);
+    return locals;
+}
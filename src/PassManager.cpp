@@ -0,0 +1,27 @@
+#include "PassManager.hpp"
+#include "CompilerOptions.hpp"
+#include "IRPasses.hpp"
+
+#include <utility>
+
+PassManager PassManager::standard(const CompilerOptions* opts, OptReport* report) {
+    PassManager pm(opts, report);
+    pm.add(ir::constPropagation());
+    pm.add(ir::cfgSimplification());
+    pm.add(ir::valueNumbering());
+    pm.add(ir::deadCode());
+    return pm;
+}
+
+void PassManager::add(std::unique_ptr<IRPass> pass) {
+    if (!options || options->enabled(pass->name())) passes.push_back(std::move(pass));
+}
+
+void PassManager::run(ir::Function& f) {
+    for (int round = 0; round < kRounds; ++round) {
+        bool changed = false;
+        for (auto& p : passes) changed |= p->run(f, report);
+        if (!changed) break;
+    }
+    f.compact();
+}
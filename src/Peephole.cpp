@@ -0,0 +1,197 @@
+#include "Peephole.hpp"
+#include "CompilerOptions.hpp"
+#include "OptReport.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+bool isCondBranch(Opcode op) {
+    return op >= Opcode::ifeq && op <= Opcode::if_acmpne;
+}
+
+// iconst_m1..iconst_5, bipush, sipush
+bool intConst(const Instr& i, int& value) {
+    if (i.isLabel) return false;
+    if (i.op >= Opcode::iconst_m1 && i.op <= Opcode::iconst_5) {
+        value = int(i.op) - int(Opcode::iconst_0);
+        return true;
+    }
+    if (i.op == Opcode::bipush || i.op == Opcode::sipush) {
+        value = i.a;
+        return true;
+    }
+    return false;
+}
+
+bool is(const std::vector<Instr>& v, size_t i, Opcode op) {
+    return i < v.size() && !v[i].isLabel && v[i].op == op;
+}
+
+bool isLabelDef(const std::vector<Instr>& v, size_t i, int id) {
+    return i < v.size() && v[i].isLabel && v[i].a == id;
+}
+
+const char* const kNames[Peephole::kPatterns] = {
+    "peephole.bool-branch", "peephole.label-nop", "peephole.goto-next", "peephole.dup-pop",
+    "peephole.iinc",        "peephole.sipush",    "peephole.branch-goto",
+};
+
+} // namespace
+
+const char* Peephole::name(Pattern p) { return kNames[p]; }
+
+Peephole::Peephole(const CompilerOptions* opts) {
+    for (int p = 0; p < kPatterns; ++p)
+        enabled[p] = !opts || (opts->enabled("peephole") && opts->enabled(kNames[p]));
+}
+
+bool Peephole::any() const {
+    return std::find(std::begin(enabled), std::end(enabled), true) != std::end(enabled);
+}
+
+void Peephole::run(MethodCode& code, OptReport* report) {
+    if (!any()) return;
+    std::fill(std::begin(hits), std::end(hits), 0);
+    std::fill(std::begin(removed), std::end(removed), 0);
+
+    std::vector<Instr>& v = code.instrs();
+    while (rewrite(code, v, scratch)) v.swap(scratch);
+
+    if (report)
+        for (int p = 0; p < kPatterns; ++p) {
+            report->add(kNames[p], "hits", hits[p]);
+            report->add(kNames[p], "removed", removed[p]);
+        }
+}
+
+// One left-to-right sweep; returns false when nothing changed
+bool Peephole::rewrite(const MethodCode& code, std::vector<Instr>& v, std::vector<Instr>& out) {
+    uses.assign(uses.size(), 0);
+    for (const Instr& i : v)
+        code.forEachTarget(i, [&](Label l) {
+            if (size_t(l.id) >= uses.size()) uses.resize(size_t(l.id) + 1, 0);
+            ++uses[size_t(l.id)];
+        });
+    auto used = [&](int id) { return size_t(id) < uses.size() && uses[size_t(id)] > 0; };
+
+    out.clear();
+    bool changed = false;
+    for (size_t i = 0; i < v.size();) {
+        const Instr& cur = v[i];
+
+        if (cur.isLabel) {
+            if (!used(cur.a)) {
+                changed = true;     // unreferenced label
+            } else {
+                out.push_back(cur);
+            }
+            ++i;
+            continue;
+        }
+
+        // if<c> Lt; iconst_0; goto Le; Lt: iconst_1; Le: ifeq/ifne L
+        if (enabled[BoolBranch] && isCondBranch(cur.op) && is(v, i + 1, Opcode::iconst_0) &&
+            is(v, i + 2, Opcode::goto_) && isLabelDef(v, i + 3, cur.a) && is(v, i + 4, Opcode::iconst_1) &&
+            isLabelDef(v, i + 5, v[i + 2].a) && (is(v, i + 6, Opcode::ifeq) || is(v, i + 6, Opcode::ifne)) &&
+            uses[size_t(cur.a)] == 1 && uses[size_t(v[i + 2].a)] == 1) {
+            Instr br = v[i + 6];
+            br.op = v[i + 6].op == Opcode::ifne ? cur.op : negateBranch(cur.op);
+            out.push_back(br);
+            hit(BoolBranch, 4);
+            i += 7;
+            changed = true;
+            continue;
+        }
+
+        // if<c> La; goto Lb; La:
+        if (enabled[BranchOverGoto] && isCondBranch(cur.op) && is(v, i + 1, Opcode::goto_) &&
+            isLabelDef(v, i + 2, cur.a) && uses[size_t(cur.a)] == 1) {
+            Instr br = v[i + 1];
+            br.op = negateBranch(cur.op);
+            out.push_back(br);
+            hit(BranchOverGoto, 1);
+            i += 3;
+            changed = true;
+            continue;
+        }
+
+        // nop is only needed to give a referenced trailing label an instruction
+        if (enabled[LabelNop] && cur.op == Opcode::nop) {
+            bool followed = false;
+            for (size_t j = i + 1; j < v.size() && !followed; ++j) followed = !v[j].isLabel;
+            bool anchors = false;
+            for (size_t j = i; j-- > 0 && v[j].isLabel;) anchors = anchors || used(v[j].a);
+            if (followed || !anchors) {
+                hit(LabelNop, 1);
+                ++i;
+                changed = true;
+                continue;
+            }
+        }
+
+        // goto L; [labels...] L:
+        if (enabled[GotoNext] && cur.op == Opcode::goto_) {
+            bool next = false;
+            for (size_t j = i + 1; j < v.size() && v[j].isLabel && !next; ++j) next = v[j].a == cur.a;
+            if (next) {
+                hit(GotoNext, 1);
+                ++i;
+                changed = true;
+                continue;
+            }
+        }
+
+        int k = 0;
+        // dup; <k>; iadd/isub; istore/putstatic; pop
+        if (enabled[DupPop] && cur.op == Opcode::dup && i + 4 < v.size() && intConst(v[i + 1], k) &&
+            (is(v, i + 2, Opcode::iadd) || is(v, i + 2, Opcode::isub)) &&
+            (is(v, i + 3, Opcode::istore) || is(v, i + 3, Opcode::putstatic)) && is(v, i + 4, Opcode::pop)) {
+            out.insert(out.end(), v.begin() + long(i + 1), v.begin() + long(i + 4));
+            hit(DupPop, 2);
+            i += 5;
+            changed = true;
+            continue;
+        }
+
+        // iload n; <k>; iadd/isub; istore n   (or <k>; iload n; iadd; istore n)
+        if (enabled[Iinc] && i + 3 < v.size() && is(v, i + 3, Opcode::istore)) {
+            const Instr *load = nullptr, *konst = nullptr;
+            if (cur.op == Opcode::iload) load = &cur, konst = &v[i + 1];
+            else if (is(v, i + 1, Opcode::iload) && is(v, i + 2, Opcode::iadd)) load = &v[i + 1], konst = &cur;
+            if (load && load->a == v[i + 3].a && intConst(*konst, k) &&
+                (is(v, i + 2, Opcode::iadd) || is(v, i + 2, Opcode::isub))) {
+                long delta = v[i + 2].op == Opcode::iadd ? long(k) : -long(k);
+                if (delta >= -128 && delta <= 127) {
+                    Instr inc;
+                    inc.op = Opcode::iinc;
+                    inc.kind = OperandKind::Iinc;
+                    inc.a = load->a;
+                    inc.b = int(delta);
+                    out.push_back(inc);
+                    hit(Iinc, 3);
+                    i += 4;
+                    changed = true;
+                    continue;
+                }
+            }
+        }
+
+        // ldc k → sipush k
+        if (enabled[Sipush] && cur.op == Opcode::ldc && cur.kind == OperandKind::Int &&
+            cur.a >= -32768 && cur.a <= 32767) {
+            Instr s = cur;
+            s.op = Opcode::sipush;
+            out.push_back(s);
+            hit(Sipush, 0);
+            ++i;
+            changed = true;
+            continue;
+        }
+
+        out.push_back(cur);
+        ++i;
+    }
+    return changed;
+}
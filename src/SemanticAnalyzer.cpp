@@ -1,7 +1,10 @@
 #include "SemanticAnalyzer.hpp"
+#include "WorkStealingPool.hpp"
 
 #include <iostream>
+#include <cstdint>
 #include <cstdlib>
+#include <unordered_map>
 
 // full-path return analysis helpers
 bool SemanticAnalyzer::stmtReturns(ast::Stmt* s) {
@@ -11,6 +14,16 @@ bool SemanticAnalyzer::stmtReturns(ast::Stmt* s) {
         if (!iff->elseStmt) return false;
         return stmtReturns(iff->thenStmt.get()) && stmtReturns(iff->elseStmt.get());
     }
+    if (auto sw = dynamic_cast<ast::SwitchStmt*>(s)) {
+        // every value reaches an arm only with a default, and no arm breaks out
+        if (sw->hasBreak) return false;
+        bool dflt = false;
+        for (auto& c : sw->cases) {
+            if (!stmtReturns(c.body.get())) return false;
+            dflt = dflt || c.isDefault;
+        }
+        return dflt;
+    }
     return false;
 }
 
@@ -24,7 +37,52 @@ bool SemanticAnalyzer::allPathsReturn(const std::vector<std::unique_ptr<ast::Stm
 // Entry point: analyze program and report errors
 void SemanticAnalyzer::analyze(ast::Program& prog) {
     prog.accept(*this);
-    // Report errors and warnings
+    report();
+}
+
+// Parallel entry point: same diagnostics, in the same order, as analyze()
+void SemanticAnalyzer::analyzeParallel(ast::Program& prog, WorkStealingPool& pool) {
+    struct Diagnostics {
+        std::vector<std::string> errors, warnings;
+    };
+    struct BodyJob {
+        ast::FuncDecl* fn;
+        size_t visibleGlobals;  // globals declared up to and including fn
+        size_t item;            // index of fn among the top-level items
+    };
+
+    // One bucket per top-level item; concatenating them reproduces source order
+    std::vector<Diagnostics> buckets;
+    std::vector<BodyJob> jobs;
+    auto topLevel = [&](ast::Stmt& item) {
+        if (auto* fn = dynamic_cast<ast::FuncDecl*>(&item)) {
+            if (declareFunction(*fn)) jobs.push_back({fn, symtab.globalCount(), buckets.size()});
+        } else {
+            item.accept(*this);
+        }
+        buckets.push_back({std::move(errors), std::move(warnings)});
+        errors.clear();
+        warnings.clear();
+    };
+    for (auto& declPtr : prog.globals) topLevel(*declPtr);
+    for (auto& stmtPtr : prog.stmts) topLevel(*stmtPtr);
+
+    pool.parallelFor(jobs.size(), [&](size_t i) {
+        SymbolTable local(symtab, jobs[i].visibleGlobals);
+        SemanticAnalyzer worker(local);
+        worker.analyzeFunctionBody(*jobs[i].fn);
+        buckets[jobs[i].item] = {std::move(worker.errors), std::move(worker.warnings)};
+    });
+
+    for (auto& b : buckets) {
+        errors.insert(errors.end(), b.errors.begin(), b.errors.end());
+        warnings.insert(warnings.end(), b.warnings.begin(), b.warnings.end());
+    }
+    report();
+}
+
+// Report errors and warnings
+void SemanticAnalyzer::report() {
     if (!errors.empty()) {
         for (auto& err : errors)
             std::cerr << err << std::endl;
@@ -74,11 +132,12 @@ void SemanticAnalyzer::visit(ast::VarDecl& d) {
         entry.arrayValues = std::vector<ConstValue>(total);
     }
     auto* ent = symtab.insert(entry);
-    d.sym = *ent;
     if (!ent) {
         error(d.line, "Redefinition of variable '" + d.name + "'");
         entry.type = ast::Type(ast::BasicType::ERROR);  // Set to ERROR for error handling
+        return;
     }
+    d.sym = *ent;
 }
 
 // Visit const declaration
@@ -108,11 +167,12 @@ void SemanticAnalyzer::visit(ast::ConstDecl& d) {
             entry.value = *cv;
     }
     auto* ent = symtab.insert(entry);
-    d.sym = *ent;
     if (!ent) {
         error(d.line, "Redefinition of const '" + d.name + "'");
         entry.type = ast::Type(ast::BasicType::ERROR);  // Set to ERROR for error handling
+        return;
     }
+    d.sym = *ent;
 }
 
 // Visit a list of declarations
@@ -256,7 +316,7 @@ void SemanticAnalyzer::visit(ast::WhileStmt& s) {
     }
     
     // Check body
-    s.body->accept(*this);
+    loopBody(*s.body);
 }
 
 // Visit for statement
@@ -276,7 +336,7 @@ void SemanticAnalyzer::visit(ast::ForStmt& s) {
     
     // Check body
     ++skipBlockScopeOnce;
-    s.body->accept(*this);
+    loopBody(*s.body);
 
     symtab.exitScope();
 }
@@ -304,7 +364,71 @@ void SemanticAnalyzer::visit(ast::ForEachStmt& s) {
     }
     
     // Check body
-    s.body->accept(*this);
+    loopBody(*s.body);
+}
+
+void SemanticAnalyzer::loopBody(ast::Stmt& body) {
+    breakTargets.push_back(nullptr);
+    ++loopDepth;
+    body.accept(*this);
+    --loopDepth;
+    breakTargets.pop_back();
+}
+
+// Visit switch statement
+void SemanticAnalyzer::visit(ast::SwitchStmt& s) {
+    s.cond->accept(*this);
+    ast::BasicType kind = s.cond->ty.kind;
+    bool scalar = s.cond->ty.dims.empty() && (kind == ast::BasicType::Int || kind == ast::BasicType::Char);
+    if (kind != ast::BasicType::ERROR && !scalar)
+        error(s.line, "Switch expression must be int or char, got " + s.cond->ty.toString());
+
+    std::unordered_map<int, int> seen;      // label value -> line of its first case
+    int defaults = 0;
+    for (auto& c : s.cases) {
+        c.values.clear();
+        defaults += c.isDefault;
+        for (auto& label : c.labels) {
+            label->accept(*this);
+            if (label->ty.kind == ast::BasicType::ERROR || !scalar) continue;
+            if (!(label->ty == s.cond->ty)) {
+                error(c.line, "Case label type mismatch, expected " + s.cond->ty.toString() + " but got " + label->ty.toString());
+                continue;
+            }
+            auto cv = evalConstExpr(label.get());
+            std::optional<int> v;
+            if (cv && std::holds_alternative<int>(*cv)) v = std::get<int>(*cv);
+            if (cv && std::holds_alternative<char>(*cv)) v = int(std::get<char>(*cv));
+            if (!v) {
+                error(c.line, "Case label must be a constant expression");
+                continue;
+            }
+            auto [first, fresh] = seen.emplace(*v, c.line);
+            if (!fresh) {
+                error(c.line, "Duplicate case label " + std::to_string(*v) + " (first used at line " + std::to_string(first->second) + ")");
+                continue;
+            }
+            c.values.push_back(*v);
+        }
+        breakTargets.push_back(&s);
+        c.body->accept(*this);
+        breakTargets.pop_back();
+    }
+    if (defaults > 1)
+        error(s.line, "Multiple default labels in switch");
+}
+
+// break leaves the innermost loop or switch, continue the innermost loop
+void SemanticAnalyzer::visit(ast::BreakStmt& s) {
+    if (breakTargets.empty()) {
+        error(s.line, "break statement not within a loop or switch");
+        return;
+    }
+    if (ast::SwitchStmt* sw = breakTargets.back()) sw->hasBreak = true;
+}
+
+void SemanticAnalyzer::visit(ast::ContinueStmt& s) {
+    if (loopDepth == 0) error(s.line, "continue statement not within a loop");
 }
 
 // Visit return statement
@@ -698,7 +822,13 @@ void SemanticAnalyzer::visit(ast::DeclList& dl) {
 
 // Visit function declaration
 void SemanticAnalyzer::visit(ast::FuncDecl& fd) {
-    // Add function to symbol table first so recursion works
+    // Don't proceed with analyzing the body if redefinition error
+    if (declareFunction(fd))
+        analyzeFunctionBody(fd);
+}
+
+// Add function to symbol table first so recursion works
+SymEntry* SemanticAnalyzer::declareFunction(ast::FuncDecl& fd) {
     SymEntry funcEntry;
     funcEntry.name = fd.name;
     funcEntry.isFunc = true;
@@ -713,13 +843,16 @@ void SemanticAnalyzer::visit(ast::FuncDecl& fd) {
     funcEntry.paramTypes = paramTypes;
     
     auto* ent = symtab.insert(funcEntry);
-    fd.sym = *ent;
     if (!ent) {
         error(fd.line, "Redefinition of function '" + fd.name + "'");
-        // Don't proceed with analyzing the body if redefinition error
-        return; 
+        return nullptr;
     }
-    
+    fd.sym = *ent;
+    return ent;
+}
+
+// Analyze parameters and body; only touches the function's own scopes
+void SemanticAnalyzer::analyzeFunctionBody(ast::FuncDecl& fd) {
     // --- Start analyzing function body ---
     currentFunctionReturnType = fd.returnType;
 
@@ -749,6 +882,7 @@ void SemanticAnalyzer::visit(ast::FuncDecl& fd) {
         }
     }
 
+    fd.localSlots = symtab.localHighWater();
     symtab.exitScope();
 
     // Restore outer context
@@ -779,7 +913,70 @@ void SemanticAnalyzer::warning(int line, const std::string& msg) {
     warnings.push_back("line " + std::to_string(line) + ": " + msg);
 }
 
-// Basic constant evaluator
+// Java int arithmetic: wraps on overflow, division truncates toward zero
+static std::optional<int> foldInt(ast::Op op, int a, int b) {
+    uint32_t x = uint32_t(a), y = uint32_t(b);
+    switch (op) {
+        case ast::Op::Plus:  return int(x + y);
+        case ast::Op::Minus: return int(x - y);
+        case ast::Op::Mul:   return int(x * y);
+        case ast::Op::Div:
+        case ast::Op::Mod:
+            if (b == 0) return std::nullopt;   // ArithmeticException at run time
+            if (a == INT32_MIN && b == -1) return op == ast::Op::Div ? a : 0;
+            return op == ast::Op::Div ? a / b : a % b;
+        default:
+            return std::nullopt;
+    }
+}
+
+static std::optional<bool> foldCompare(ast::Op op, int a, int b) {
+    switch (op) {
+        case ast::Op::Less:      return a < b;
+        case ast::Op::LessEq:    return a <= b;
+        case ast::Op::Greater:   return a > b;
+        case ast::Op::GreaterEq: return a >= b;
+        case ast::Op::Equal:     return a == b;
+        case ast::Op::NotEqual:  return a != b;
+        default:                 return std::nullopt;
+    }
+}
+
+std::optional<ConstValue> foldUnary(ast::Op op, const ConstValue& v) {
+    if (op == ast::Op::Minus || op == ast::Op::Neg)
+        if (auto* i = std::get_if<int>(&v)) return int(0u - uint32_t(*i));
+    if (op == ast::Op::Not)
+        if (auto* b = std::get_if<bool>(&v)) return !*b;
+    return std::nullopt;
+}
+
+std::optional<ConstValue> foldBinary(ast::Op op, const ConstValue& lhs, const ConstValue& rhs) {
+    auto* x = std::get_if<int>(&lhs);
+    auto* y = std::get_if<int>(&rhs);
+    if (x && y) {
+        if (auto r = foldInt(op, *x, *y)) return *r;
+        if (auto r = foldCompare(op, *x, *y)) return *r;
+        return std::nullopt;
+    }
+    auto* p = std::get_if<bool>(&lhs);
+    auto* q = std::get_if<bool>(&rhs);
+    if (p && q) {
+        switch (op) {
+            case ast::Op::Equal:    return *p == *q;
+            case ast::Op::NotEqual: return *p != *q;
+            case ast::Op::And:      return *p && *q;
+            case ast::Op::Or:       return *p || *q;
+            default:                return std::nullopt;
+        }
+    }
+    auto* s = std::get_if<std::string>(&lhs);
+    auto* t = std::get_if<std::string>(&rhs);
+    if (s && t && op == ast::Op::Plus) return *s + *t;
+    return std::nullopt;
+}
+
+// Constant evaluator: literals, const variables, and unary and binary
+// operators over them
 std::optional<ConstValue> evalConstExpr(ast::Expr* e) {
     if (auto lit = dynamic_cast<ast::IntLit*>(e))
         return lit->value;
@@ -791,5 +988,24 @@ std::optional<ConstValue> evalConstExpr(ast::Expr* e) {
         return lit->value;
     if (auto lit = dynamic_cast<ast::CharLit*>(e))
         return lit->value;
+    if (auto v = dynamic_cast<ast::Var*>(e)) {
+        if (v->indices.empty() && v->sym.isConst && !v->sym.isFunc)
+            return v->sym.value;
+        return std::nullopt;
+    }
+    if (auto u = dynamic_cast<ast::Unary*>(e)) {
+        auto cv = evalConstExpr(u->rhs.get());
+        return cv ? foldUnary(u->op, *cv) : std::nullopt;
+    }
+    if (auto b = dynamic_cast<ast::Binary*>(e)) {
+        auto lhs = evalConstExpr(b->lhs.get());
+        // && / || only need the left side when it decides the result
+        if (lhs && (b->op == ast::Op::And || b->op == ast::Op::Or)) {
+            auto* l = std::get_if<bool>(&*lhs);
+            if (l && *l == (b->op == ast::Op::Or)) return *l;
+        }
+        auto rhs = lhs ? evalConstExpr(b->rhs.get()) : std::nullopt;
+        return rhs ? foldBinary(b->op, *lhs, *rhs) : std::nullopt;
+    }
     return std::nullopt;
 }
@@ -0,0 +1,276 @@
+#include "Simplifier.hpp"
+#include "OptReport.hpp"
+
+#include <cstdint>
+#include <utility>
+
+using namespace ast;
+
+namespace {
+
+bool isInt(const Expr& e) { return e.ty.kind == BasicType::Int; }
+
+const IntLit* intLit(const Expr& e) { return dynamic_cast<const IntLit*>(&e); }
+
+bool negation(const Expr& e) {
+    auto* u = dynamic_cast<const Unary*>(&e);
+    return u && (u->op == Op::Minus || u->op == Op::Neg) && isInt(e);
+}
+
+// wrapping int arithmetic, as the JVM does it
+int wrapAdd(int a, int b) { return int(uint32_t(a) + uint32_t(b)); }
+int wrapMul(int a, int b) { return int(uint32_t(a) * uint32_t(b)); }
+
+// No side effects and no exception: dropping it changes nothing
+bool pure(const Expr& e) {
+    if (dynamic_cast<const IntLit*>(&e) || dynamic_cast<const BoolLit*>(&e)) return true;
+    if (auto* v = dynamic_cast<const Var*>(&e)) return v->indices.empty();
+    if (auto* u = dynamic_cast<const Unary*>(&e)) return pure(*u->rhs);
+    if (auto* b = dynamic_cast<const Binary*>(&e)) {
+        if (b->op == Op::Div || b->op == Op::Mod) {
+            auto* k = intLit(*b->rhs);
+            if (!k || k->value == 0) return false;
+        }
+        return pure(*b->lhs) && pure(*b->rhs);
+    }
+    return false;
+}
+
+// Same value for sure (both pure, structurally equal)
+bool same(const Expr& a, const Expr& b) {
+    if (auto* x = dynamic_cast<const IntLit*>(&a)) {
+        auto* y = dynamic_cast<const IntLit*>(&b);
+        return y && x->value == y->value;
+    }
+    if (auto* x = dynamic_cast<const Var*>(&a)) {
+        auto* y = dynamic_cast<const Var*>(&b);
+        return y && x->indices.empty() && y->indices.empty() && x->sym.isGlobal == y->sym.isGlobal &&
+               (x->sym.isGlobal ? x->name == y->name : x->sym.slot == y->sym.slot);
+    }
+    if (auto* x = dynamic_cast<const Unary*>(&a)) {
+        auto* y = dynamic_cast<const Unary*>(&b);
+        return y && x->op == y->op && same(*x->rhs, *y->rhs);
+    }
+    if (auto* x = dynamic_cast<const Binary*>(&a)) {
+        auto* y = dynamic_cast<const Binary*>(&b);
+        return y && x->op == y->op && same(*x->lhs, *y->lhs) && same(*x->rhs, *y->rhs);
+    }
+    return false;
+}
+
+std::unique_ptr<Expr> intNode(int value, const Expr& was) {
+    auto lit = std::make_unique<IntLit>(value, was.line);
+    lit->ty = was.ty;
+    return lit;
+}
+
+std::unique_ptr<Expr> negated(std::unique_ptr<Expr> e, const Expr& was) {
+    auto u = std::make_unique<Unary>(Op::Minus, std::move(e), was.line);
+    u->ty = was.ty;
+    return u;
+}
+
+// a + k, written a - |k| when k is negative
+std::unique_ptr<Expr> plus(std::unique_ptr<Expr> a, int k, const Expr& was) {
+    if (k == 0) return a;
+    bool minus = k < 0 && k != INT32_MIN;
+    auto b = std::make_unique<Binary>(minus ? Op::Minus : Op::Plus, std::move(a), intNode(minus ? -k : k, was), was.line);
+    b->ty = was.ty;
+    return b;
+}
+
+std::unique_ptr<Expr> times(std::unique_ptr<Expr> a, int k, const Expr& was) {
+    if (k == 1) return a;
+    if (k == -1) return negated(std::move(a), was);
+    auto b = std::make_unique<Binary>(Op::Mul, std::move(a), intNode(k, was), was.line);
+    b->ty = was.ty;
+    return b;
+}
+
+// `a + k` / `a - k` → (a, ±k)
+bool addend(Expr& e, std::unique_ptr<Expr>*& a, int& k) {
+    auto* b = dynamic_cast<Binary*>(&e);
+    if (!b || !isInt(*b) || (b->op != Op::Plus && b->op != Op::Minus)) return false;
+    auto* lit = intLit(*b->rhs);
+    if (!lit) return false;
+    a = &b->lhs;
+    k = b->op == Op::Plus ? lit->value : wrapMul(lit->value, -1);
+    return true;
+}
+
+} // namespace
+
+//---------------------------------------------------------------
+// entry points
+//---------------------------------------------------------------
+void Simplifier::run(std::unique_ptr<Expr>& e) {
+    if (!e) return;
+    replacement.reset();
+    e->accept(*this);
+    if (replacement) e = std::move(replacement);
+}
+
+void Simplifier::run(std::unique_ptr<Stmt>& s) {
+    if (s) s->accept(*this);
+}
+
+void Simplifier::run(Program& program) {
+    for (auto& d : program.globals) d->accept(*this);
+    for (auto& s : program.stmts)
+        if (auto* f = dynamic_cast<FuncDecl*>(s.get())) run(f->body);
+}
+
+void Simplifier::simplified(std::unique_ptr<Expr> e) {
+    replacement = std::move(e);
+    if (report) report->add("simplify", "expressions simplified");
+}
+
+//---------------------------------------------------------------
+// expressions: children first
+//---------------------------------------------------------------
+void Simplifier::visit(IntLit&)    {}
+void Simplifier::visit(RealLit&)   {}
+void Simplifier::visit(StringLit&) {}
+void Simplifier::visit(BoolLit&)   {}
+void Simplifier::visit(CharLit&)   {}
+
+void Simplifier::visit(Var& v) {
+    for (auto& idx : v.indices) run(idx);
+}
+
+void Simplifier::visit(Unary& u) {
+    run(u.rhs);
+    if (negation(u) && negation(*u.rhs))
+        simplified(std::move(static_cast<Unary&>(*u.rhs).rhs));
+}
+
+void Simplifier::visit(Binary& b) {
+    run(b.lhs);
+    run(b.rhs);
+    if (!isInt(b) || !isInt(*b.lhs) || !isInt(*b.rhs)) return;
+    if ((b.op == Op::Plus || b.op == Op::Mul) && intLit(*b.lhs) && !intLit(*b.rhs))
+        std::swap(b.lhs, b.rhs);        // literals have no side effects to reorder
+
+    auto* lit = intLit(*b.rhs);
+    switch (b.op) {
+        case Op::Plus:
+        case Op::Minus: {
+            if (b.op == Op::Minus && pure(*b.lhs) && same(*b.lhs, *b.rhs)) {
+                simplified(intNode(0, b));
+                return;
+            }
+            if (b.op == Op::Minus && !lit) {
+                if (auto* zero = intLit(*b.lhs); zero && zero->value == 0) simplified(negated(std::move(b.rhs), b));
+                return;
+            }
+            if (!lit) return;
+            int k = b.op == Op::Plus ? lit->value : wrapMul(lit->value, -1);
+            std::unique_ptr<Expr>* inner;
+            int k0;
+            if (addend(*b.lhs, inner, k0))
+                simplified(plus(std::move(*inner), wrapAdd(k0, k), b));
+            else if (k == 0)
+                simplified(std::move(b.lhs));
+            return;
+        }
+        case Op::Mul: {
+            if (!lit) return;
+            if (lit->value == 0) {
+                if (pure(*b.lhs)) simplified(intNode(0, b));
+                return;
+            }
+            auto* inner = dynamic_cast<Binary*>(b.lhs.get());
+            const IntLit* k0 = inner && inner->op == Op::Mul && isInt(*inner) ? intLit(*inner->rhs) : nullptr;
+            if (k0)
+                simplified(times(std::move(inner->lhs), wrapMul(k0->value, lit->value), b));
+            else if (lit->value == 1 || lit->value == -1)
+                simplified(times(std::move(b.lhs), lit->value, b));
+            return;
+        }
+        case Op::Div:
+            if (lit && (lit->value == 1 || lit->value == -1))
+                simplified(times(std::move(b.lhs), lit->value, b));   // MIN / -1 == -MIN == MIN
+            return;
+        case Op::Mod:
+            if (lit && (lit->value == 1 || lit->value == -1) && pure(*b.lhs)) simplified(intNode(0, b));
+            return;
+        default:
+            return;
+    }
+}
+
+void Simplifier::visit(Postfix& p) {
+    for (auto& idx : p.operand->indices) run(idx);
+}
+
+void Simplifier::visit(Call& c) {
+    for (auto& arg : c.args) run(arg);
+}
+
+void Simplifier::visit(Assign& a) {
+    for (auto& idx : a.lhs->indices) run(idx);
+    run(a.rhs);
+}
+
+void Simplifier::visit(RangeExpr& r) {
+    run(r.start);
+    run(r.end);
+}
+
+//---------------------------------------------------------------
+// statements
+//---------------------------------------------------------------
+void Simplifier::visit(Print& p)      { run(p.expr); }
+void Simplifier::visit(Println& p)    { run(p.expr); }
+void Simplifier::visit(Read&)         {}
+void Simplifier::visit(ExprStmt& s)   { run(s.expr); }
+void Simplifier::visit(ReturnStmt& s) { run(s.expr); }
+void Simplifier::visit(EmptyStmt&)    {}
+void Simplifier::visit(BreakStmt&)    {}
+void Simplifier::visit(ContinueStmt&) {}
+
+void Simplifier::visit(Block& b) {
+    for (auto& s : b.stmts) run(s);
+}
+
+void Simplifier::visit(IfStmt& s) {
+    run(s.cond);
+    run(s.thenStmt);
+    run(s.elseStmt);
+}
+
+void Simplifier::visit(WhileStmt& s) {
+    run(s.cond);
+    run(s.body);
+}
+
+void Simplifier::visit(ForStmt& s) {
+    run(s.init);
+    run(s.cond);
+    run(s.step);
+    run(s.body);
+}
+
+void Simplifier::visit(ForEachStmt& s) {
+    run(s.collection);
+    run(s.body);
+}
+
+void Simplifier::visit(SwitchStmt& s) {
+    run(s.cond);
+    for (auto& c : s.cases) run(c.body);
+}
+
+void Simplifier::visit(DeclList& dl) {
+    for (auto& d : dl.decls) d->accept(*this);
+}
+
+void Simplifier::visit(VarDecl& d)   { run(d.init); }
+void Simplifier::visit(ConstDecl& d) { run(d.init); }
+
+void Simplifier::visit(VarDeclList& dl) {
+    for (auto& d : dl.decls) run(d->init);
+}
+
+void Simplifier::visit(FuncDecl& f) { run(f.body); }
+void Simplifier::visit(Program& p)  { run(p); }
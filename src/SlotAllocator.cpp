@@ -0,0 +1,64 @@
+#include "SlotAllocator.hpp"
+#include "OptReport.hpp"
+
+#include <algorithm>
+#include <climits>
+
+void SlotAllocator::run(MethodCode& code, int argSlots, OptReport* report) {
+    std::vector<Instr>& v = code.instrs();
+    const int slots = code.maxLocals(0);
+    if (slots == 0) return;
+    live.run(code, slots);
+    const int B = live.blocks();
+
+    // ---- one interval per slot: every access plus the block edges it is live across
+    intervals.assign(size_t(slots), Interval{0, INT_MAX, -1});
+    auto cover = [&](int s, int at) {
+        Interval& iv = intervals[size_t(s)];
+        iv.slot = s;
+        iv.start = std::min(iv.start, at);
+        iv.end = std::max(iv.end, at);
+    };
+    for (int b = 0; b < B; ++b)
+        for (int s = 0; s < slots; ++s) {
+            if (live.liveIn(b, s)) cover(s, live.start(b));
+            if (live.liveOut(b, s)) cover(s, live.end(b));
+        }
+    for (size_t i = 0; i < v.size(); ++i) {
+        int s;
+        if (localSlot(v[i], s)) cover(s, int(i));
+    }
+
+    // ---- linear scan; arguments still live on entry keep their slot
+    auto pinned = [&](const Interval& iv) { return iv.slot < argSlots && B > 0 && live.liveIn(0, iv.slot); };
+    intervals.erase(std::remove_if(intervals.begin(), intervals.end(), [](const Interval& iv) { return iv.end < 0; }),
+                    intervals.end());
+    std::sort(intervals.begin(), intervals.end(), [&](const Interval& a, const Interval& b) {
+        if (pinned(a) != pinned(b)) return pinned(a);
+        return a.start != b.start ? a.start < b.start : a.slot < b.slot;
+    });
+
+    slotEnd.assign(size_t(argSlots), -1);   // last instruction that still needs the slot
+    remap.assign(size_t(slots), -1);
+    for (const Interval& iv : intervals) {
+        int to = -1;
+        if (pinned(iv)) {
+            to = iv.slot;
+        } else {
+            for (size_t s = 0; s < slotEnd.size() && to < 0; ++s)
+                if (slotEnd[s] < iv.start) to = int(s);
+            if (to < 0) {
+                to = int(slotEnd.size());
+                slotEnd.push_back(-1);
+            }
+        }
+        slotEnd[size_t(to)] = iv.end;
+        remap[size_t(iv.slot)] = to;
+    }
+
+    for (Instr& i : v) {
+        int s;
+        if (localSlot(i, s)) i.a = remap[size_t(s)];
+    }
+    if (report) report->add("slot-reuse", "slots saved", std::max(slots, argSlots) - code.maxLocals(argSlots));
+}
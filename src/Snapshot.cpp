@@ -0,0 +1,876 @@
+/**
+ * @file Snapshot.cpp
+ * @brief Snapshot writer (AST visitor) and memory-mapped reader
+ */
+#include "Snapshot.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char     kMagic[8] = {'S', 'D', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t kNull     = 0xFFFFFFFFu;   // absent child (else branch, return value, ...)
+
+// header: magic, version, reserved, file size, section table, function count, root node
+constexpr size_t kSectionTable = 24;
+constexpr size_t kHeaderSize   = kSectionTable + SnapshotReader::kSections * 16 + 8;
+
+enum class NodeKind : uint8_t {
+    IntLit = 1, RealLit, StringLit, BoolLit, CharLit,
+    Var, Unary, Binary, Postfix, Call, Assign, RangeExpr,
+    Print, Println, Read,
+    Block, IfStmt, WhileStmt, ForStmt, ForEachStmt, ReturnStmt, ExprStmt, EmptyStmt,
+    DeclList, VarDecl, VarDeclList, ConstDecl, FuncDecl,
+    Program, SwitchStmt, BreakStmt, ContinueStmt
+};
+
+// ------------------------------------------------------------------
+// Little-endian byte buffer used for every section
+// ------------------------------------------------------------------
+struct ByteBuffer {
+    std::vector<uint8_t> bytes;
+
+    size_t size() const { return bytes.size(); }
+    void u8(uint8_t v) { bytes.push_back(v); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) bytes.push_back(uint8_t(v >> (8 * i)));
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i) bytes.push_back(uint8_t(v >> (8 * i)));
+    }
+    void i32(int32_t v) { u32(uint32_t(v)); }
+    void f64(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof bits);
+        u64(bits);
+    }
+};
+
+// Deduplicated string pool; strings are referenced as (offset, length)
+struct StringPool {
+    ByteBuffer buf;
+    std::unordered_map<std::string, uint32_t> offsets;
+
+    void put(ByteBuffer& out, const std::string& s) {
+        auto it = offsets.find(s);
+        uint32_t off;
+        if (it != offsets.end()) {
+            off = it->second;
+        } else {
+            off = uint32_t(buf.size());
+            buf.bytes.insert(buf.bytes.end(), s.begin(), s.end());
+            offsets.emplace(s, off);
+        }
+        out.u32(off);
+        out.u32(uint32_t(s.size()));
+    }
+};
+
+// ------------------------------------------------------------------
+// Writer: post-order traversal, so every child offset is already known
+// when its parent record is written
+// ------------------------------------------------------------------
+class NodeWriter : public ast::Visitor {
+public:
+    ByteBuffer  nodes;
+    ByteBuffer  symbols;                  // interned SymEntry records
+    std::vector<uint32_t> symbolOffsets;  // record offset per symbol index
+    std::vector<uint32_t> globals;        // symbol indices of global variables and functions
+    StringPool  strings;
+    std::vector<std::pair<std::string, uint32_t>> functions;
+
+    uint32_t put(ast::Node* n) {
+        if (!n) return kNull;
+        n->accept(*this);
+        return last;
+    }
+
+    template <typename Vec>
+    std::vector<uint32_t> putAll(Vec& v) {
+        std::vector<uint32_t> offs;
+        offs.reserve(v.size());
+        for (auto& p : v) offs.push_back(put(p.get()));
+        return offs;
+    }
+
+    // -------- Expr --------
+    void visit(ast::IntLit& n) override    { begin(NodeKind::IntLit, n); type(n.ty); nodes.i32(n.value); }
+    void visit(ast::RealLit& n) override   { begin(NodeKind::RealLit, n); type(n.ty); nodes.f64(n.value); }
+    void visit(ast::StringLit& n) override { begin(NodeKind::StringLit, n); type(n.ty); strings.put(nodes, n.value); }
+    void visit(ast::BoolLit& n) override   { begin(NodeKind::BoolLit, n); type(n.ty); nodes.u8(n.value); }
+    void visit(ast::CharLit& n) override   { begin(NodeKind::CharLit, n); type(n.ty); nodes.u8(uint8_t(n.value)); }
+
+    void visit(ast::Var& n) override {
+        auto idx = putAll(n.indices);
+        begin(NodeKind::Var, n);
+        type(n.ty);
+        strings.put(nodes, n.name);
+        list(idx);
+        nodes.u32(symRef(n.sym));
+    }
+    void visit(ast::Unary& n) override {
+        uint32_t rhs = put(n.rhs.get());
+        begin(NodeKind::Unary, n);
+        type(n.ty);
+        nodes.u8(uint8_t(n.op));
+        nodes.u32(rhs);
+    }
+    void visit(ast::Binary& n) override {
+        uint32_t lhs = put(n.lhs.get()), rhs = put(n.rhs.get());
+        begin(NodeKind::Binary, n);
+        type(n.ty);
+        nodes.u8(uint8_t(n.op));
+        nodes.u32(lhs);
+        nodes.u32(rhs);
+    }
+    void visit(ast::Postfix& n) override {
+        uint32_t operand = put(n.operand.get());
+        begin(NodeKind::Postfix, n);
+        type(n.ty);
+        nodes.u8(uint8_t(n.op));
+        nodes.u32(operand);
+    }
+    void visit(ast::Call& n) override {
+        auto args = putAll(n.args);
+        begin(NodeKind::Call, n);
+        type(n.ty);
+        strings.put(nodes, n.callee);
+        list(args);
+        nodes.u32(symRef(n.sym));
+    }
+    void visit(ast::Assign& n) override {
+        uint32_t lhs = put(n.lhs.get()), rhs = put(n.rhs.get());
+        begin(NodeKind::Assign, n);
+        type(n.ty);
+        nodes.u32(lhs);
+        nodes.u32(rhs);
+    }
+    void visit(ast::RangeExpr& n) override {
+        uint32_t s = put(n.start.get()), e = put(n.end.get());
+        begin(NodeKind::RangeExpr, n);
+        type(n.ty);
+        nodes.u32(s);
+        nodes.u32(e);
+    }
+
+    // -------- Stmt --------
+    void visit(ast::Print& n) override   { single(NodeKind::Print, n, n.expr.get()); }
+    void visit(ast::Println& n) override { single(NodeKind::Println, n, n.expr.get()); }
+    void visit(ast::Read& n) override    { single(NodeKind::Read, n, n.var.get()); }
+    void visit(ast::ReturnStmt& n) override { single(NodeKind::ReturnStmt, n, n.expr.get()); }
+    void visit(ast::ExprStmt& n) override   { single(NodeKind::ExprStmt, n, n.expr.get()); }
+    void visit(ast::EmptyStmt& n) override  { begin(NodeKind::EmptyStmt, n); }
+    void visit(ast::BreakStmt& n) override  { begin(NodeKind::BreakStmt, n); }
+    void visit(ast::ContinueStmt& n) override { begin(NodeKind::ContinueStmt, n); }
+
+    void visit(ast::Block& n) override {
+        auto stmts = putAll(n.stmts);
+        begin(NodeKind::Block, n);
+        list(stmts);
+    }
+    void visit(ast::IfStmt& n) override {
+        uint32_t c = put(n.cond.get()), t = put(n.thenStmt.get()), e = put(n.elseStmt.get());
+        begin(NodeKind::IfStmt, n);
+        nodes.u32(c);
+        nodes.u32(t);
+        nodes.u32(e);
+    }
+    void visit(ast::WhileStmt& n) override {
+        uint32_t c = put(n.cond.get()), b = put(n.body.get());
+        begin(NodeKind::WhileStmt, n);
+        nodes.u32(c);
+        nodes.u32(b);
+    }
+    void visit(ast::ForStmt& n) override {
+        uint32_t i = put(n.init.get()), c = put(n.cond.get());
+        uint32_t s = put(n.step.get()), b = put(n.body.get());
+        begin(NodeKind::ForStmt, n);
+        nodes.u32(i);
+        nodes.u32(c);
+        nodes.u32(s);
+        nodes.u32(b);
+    }
+    void visit(ast::ForEachStmt& n) override {
+        uint32_t v = put(n.var.get()), c = put(n.collection.get()), b = put(n.body.get());
+        begin(NodeKind::ForEachStmt, n);
+        nodes.u32(v);
+        nodes.u32(c);
+        nodes.u32(b);
+    }
+    void visit(ast::SwitchStmt& n) override {
+        uint32_t c = put(n.cond.get());
+        std::vector<std::vector<uint32_t>> labels;
+        std::vector<uint32_t> bodies;
+        for (auto& k : n.cases) {
+            labels.push_back(putAll(k.labels));
+            bodies.push_back(put(k.body.get()));
+        }
+        begin(NodeKind::SwitchStmt, n);
+        nodes.u8(n.hasBreak);
+        nodes.u32(c);
+        nodes.u32(uint32_t(n.cases.size()));
+        for (size_t i = 0; i < n.cases.size(); ++i) {
+            const auto& k = n.cases[i];
+            nodes.u8(k.isDefault);
+            nodes.i32(k.line);
+            list(labels[i]);
+            nodes.u32(uint32_t(k.values.size()));
+            for (int v : k.values) nodes.i32(v);
+            nodes.u32(bodies[i]);
+        }
+    }
+
+    // -------- Decl --------
+    void visit(ast::DeclList& n) override {
+        auto decls = putAll(n.decls);
+        begin(NodeKind::DeclList, n);
+        nodes.u8(n.isConst);
+        list(decls);
+    }
+    void visit(ast::VarDecl& n) override {
+        uint32_t init = put(n.init.get());
+        begin(NodeKind::VarDecl, n);
+        varDecl(n, init);
+        if (n.sym.isGlobal) globals.push_back(symRef(n.sym));
+    }
+    void visit(ast::VarDeclList& n) override {
+        uint32_t init = put(n.init.get());
+        auto decls = putAll(n.decls);
+        begin(NodeKind::VarDeclList, n);
+        varDecl(n, init);
+        list(decls);
+    }
+    void visit(ast::ConstDecl& n) override {
+        uint32_t init = put(n.init.get());
+        begin(NodeKind::ConstDecl, n);
+        varDecl(n, init);
+        if (n.sym.isGlobal) globals.push_back(symRef(n.sym));
+    }
+    void visit(ast::FuncDecl& n) override {
+        auto params = putAll(n.params);
+        uint32_t body = put(n.body.get());
+        uint32_t off = begin(NodeKind::FuncDecl, n);
+        nodes.u8(n.isConst);
+        type(n.returnType);
+        strings.put(nodes, n.name);
+        list(params);
+        nodes.u32(body);
+        uint32_t ref = symRef(n.sym);
+        nodes.u32(ref);
+        nodes.u32(uint32_t(n.localSlots));
+        functions.emplace_back(n.name, off);
+        globals.push_back(ref);
+    }
+    void visit(ast::Program& n) override {
+        auto globals = putAll(n.globals);
+        auto stmts = putAll(n.stmts);
+        begin(NodeKind::Program, n);
+        list(globals);
+        list(stmts);
+    }
+
+private:
+    uint32_t last = kNull;
+    std::unordered_map<std::string, uint32_t> symbolIds;   // record bytes -> symbol index
+
+    uint32_t begin(NodeKind k, const ast::Node& n) {
+        last = uint32_t(nodes.size());
+        nodes.u8(uint8_t(k));
+        nodes.i32(n.line);
+        return last;
+    }
+    void single(NodeKind k, const ast::Node& n, ast::Node* child) {
+        uint32_t c = put(child);
+        begin(k, n);
+        nodes.u32(c);
+    }
+    void list(const std::vector<uint32_t>& offs) {
+        nodes.u32(uint32_t(offs.size()));
+        for (uint32_t o : offs) nodes.u32(o);
+    }
+    void type(const ast::Type& t) { typeTo(nodes, t); }
+    void typeTo(ByteBuffer& out, const ast::Type& t) {
+        out.u8(uint8_t(t.kind));
+        out.u32(uint32_t(t.dims.size()));
+        for (int d : t.dims) out.i32(d);
+    }
+    void value(ByteBuffer& out, const ConstValue& v) {
+        out.u8(uint8_t(v.index()));
+        switch (v.index()) {
+            case 0: out.i32(std::get<int>(v)); break;
+            case 1: out.f64(std::get<double>(v)); break;
+            case 2: strings.put(out, std::get<std::string>(v)); break;
+            case 3: out.u8(std::get<bool>(v)); break;
+            case 4: out.u8(uint8_t(std::get<char>(v))); break;
+        }
+    }
+    // arrayValues is analysis-time element tracking only and is not stored
+    void sym(ByteBuffer& out, const SymEntry& e) {
+        strings.put(out, e.name);
+        typeTo(out, e.type);
+        uint8_t flags = (e.isConst ? 1 : 0) | (e.isFunc ? 2 : 0) | (e.isGlobal ? 4 : 0) |
+                        (e.value ? 8 : 0) | (e.paramTypes ? 16 : 0) | (e.returnType ? 32 : 0);
+        out.u8(flags);
+        out.i32(e.slot);
+        if (e.value) value(out, *e.value);
+        if (e.paramTypes) {
+            out.u32(uint32_t(e.paramTypes->size()));
+            for (const auto& t : *e.paramTypes) typeTo(out, t);
+        }
+        if (e.returnType) typeTo(out, *e.returnType);
+    }
+    // Interns `e`; every use of a resolved symbol shares one record
+    uint32_t symRef(const SymEntry& e) {
+        ByteBuffer rec;
+        sym(rec, e);
+        std::string key(rec.bytes.begin(), rec.bytes.end());
+        auto it = symbolIds.find(key);
+        if (it != symbolIds.end()) return it->second;
+        uint32_t id = uint32_t(symbolOffsets.size());
+        symbolOffsets.push_back(uint32_t(symbols.size()));
+        symbols.bytes.insert(symbols.bytes.end(), rec.bytes.begin(), rec.bytes.end());
+        symbolIds.emplace(std::move(key), id);
+        return id;
+    }
+    void varDecl(ast::VarDecl& n, uint32_t init) {
+        nodes.u8(n.isConst);
+        type(n.varType);
+        strings.put(nodes, n.name);
+        nodes.u32(init);
+        nodes.u32(uint32_t(n.dims.size()));
+        for (int d : n.dims) nodes.i32(d);
+        nodes.u32(symRef(n.sym));
+    }
+};
+
+// ------------------------------------------------------------------
+// Reader side: bounds-checked cursor over the mapped bytes
+// ------------------------------------------------------------------
+uint32_t loadU32(const uint8_t* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+uint64_t loadU64(const uint8_t* p) { return uint64_t(loadU32(p)) | uint64_t(loadU32(p + 4)) << 32; }
+
+struct Cursor {
+    const uint8_t* base;
+    size_t size;
+    size_t pos;
+    bool& ok;
+
+    bool need(size_t n) {
+        if (!ok || pos + n > size) {
+            ok = false;
+            return false;
+        }
+        return true;
+    }
+    uint8_t u8() { return need(1) ? base[pos++] : 0; }
+    uint32_t u32() {
+        if (!need(4)) return 0;
+        uint32_t v = loadU32(base + pos);
+        pos += 4;
+        return v;
+    }
+    int32_t i32() { return int32_t(u32()); }
+    double f64() {
+        if (!need(8)) return 0.0;
+        uint64_t bits = loadU64(base + pos);
+        pos += 8;
+        double v;
+        std::memcpy(&v, &bits, sizeof v);
+        return v;
+    }
+};
+
+class NodeDecoder {
+public:
+    using Span = SnapshotReader::Span;
+
+    explicit NodeDecoder(const Span* sections)
+        : nodes(sections[SnapshotReader::Nodes]),
+          strs(sections[SnapshotReader::Strings]),
+          symbols(sections[SnapshotReader::Symbols]),
+          symbolIndex(sections[SnapshotReader::SymbolIndex]),
+          symbolCache(symbolIndex.size / 4) {}
+
+    bool ok = true;
+
+    std::string str(Cursor& c) {
+        uint32_t off = c.u32(), len = c.u32();
+        if (!ok || size_t(off) + len > strs.size) {
+            ok = false;
+            return {};
+        }
+        return std::string(reinterpret_cast<const char*>(strs.data + off), len);
+    }
+
+    ast::Type type(Cursor& c) {
+        uint8_t kind = c.u8();
+        uint32_t n = c.u32();
+        if (kind > uint8_t(ast::BasicType::ERROR) || n > c.size - c.pos) {
+            ok = false;
+            return {};
+        }
+        ast::Type t(static_cast<ast::BasicType>(kind));
+        for (uint32_t i = 0; i < n; ++i) t.dims.push_back(c.i32());
+        return t;
+    }
+
+    std::optional<ConstValue> value(Cursor& c) {
+        switch (c.u8()) {
+            case 0: return ConstValue(int(c.i32()));
+            case 1: return ConstValue(c.f64());
+            case 2: return ConstValue(str(c));
+            case 3: return ConstValue(bool(c.u8()));
+            case 4: return ConstValue(char(c.u8()));
+        }
+        ok = false;
+        return std::nullopt;
+    }
+
+    SymEntry sym(Cursor& c) {
+        SymEntry e;
+        e.name = str(c);
+        e.type = type(c);
+        uint8_t flags = c.u8();
+        e.isConst = flags & 1;
+        e.isFunc = flags & 2;
+        e.isGlobal = flags & 4;
+        e.slot = c.i32();
+        if (flags & 8) e.value = value(c);
+        if (flags & 16) {
+            uint32_t n = c.u32();
+            std::vector<ast::Type> params;
+            for (uint32_t i = 0; i < n && ok; ++i) params.push_back(type(c));
+            e.paramTypes = std::move(params);
+        }
+        if (flags & 32) e.returnType = type(c);
+        return e;
+    }
+
+    // Symbols are decoded once and then copied into each referencing node
+    const SymEntry& symbol(uint32_t id) {
+        static const SymEntry empty;
+        if (id >= symbolCache.size()) {
+            ok = false;
+            return empty;
+        }
+        if (!symbolCache[id]) {
+            Cursor c{symbols.data, symbols.size, loadU32(symbolIndex.data + size_t(id) * 4), ok};
+            symbolCache[id] = std::make_unique<SymEntry>(sym(c));
+        }
+        return *symbolCache[id];
+    }
+
+    // Decodes the record at `off`; children must precede their parent,
+    // which also rules out cycles in a corrupted file.
+    std::unique_ptr<ast::Node> node(uint32_t off, uint32_t limit) {
+        if (off == kNull || !ok) return nullptr;
+        if (off >= limit) {
+            ok = false;
+            return nullptr;
+        }
+        Cursor c{nodes.data, nodes.size, off, ok};
+        auto kind = static_cast<NodeKind>(c.u8());
+        int line = c.i32();
+
+        switch (kind) {
+            case NodeKind::IntLit: {
+                auto t = type(c);
+                auto n = std::make_unique<ast::IntLit>(c.i32(), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::RealLit: {
+                auto t = type(c);
+                auto n = std::make_unique<ast::RealLit>(c.f64(), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::StringLit: {
+                auto t = type(c);
+                auto n = std::make_unique<ast::StringLit>(str(c), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::BoolLit: {
+                auto t = type(c);
+                auto n = std::make_unique<ast::BoolLit>(c.u8() != 0, line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::CharLit: {
+                auto t = type(c);
+                auto n = std::make_unique<ast::CharLit>(char(c.u8()), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::Var: {
+                auto t = type(c);
+                auto n = std::make_unique<ast::Var>(str(c), line);
+                n->ty = t;
+                n->indices = list<ast::Expr>(c, off);
+                n->sym = symbol(c.u32());
+                return n;
+            }
+            case NodeKind::Unary: {
+                auto t = type(c);
+                auto op = static_cast<ast::Op>(c.u8());
+                auto n = std::make_unique<ast::Unary>(op, child<ast::Expr>(c, off), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::Binary: {
+                auto t = type(c);
+                auto op = static_cast<ast::Op>(c.u8());
+                auto lhs = child<ast::Expr>(c, off);
+                auto rhs = child<ast::Expr>(c, off);
+                auto n = std::make_unique<ast::Binary>(op, std::move(lhs), std::move(rhs), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::Postfix: {
+                auto t = type(c);
+                auto op = static_cast<ast::Op>(c.u8());
+                auto n = std::make_unique<ast::Postfix>(op, child<ast::Var>(c, off), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::Call: {
+                auto t = type(c);
+                auto callee = str(c);
+                auto args = list<ast::Expr>(c, off);
+                auto n = std::make_unique<ast::Call>(callee, std::move(args), line);
+                n->ty = t;
+                n->sym = symbol(c.u32());
+                return n;
+            }
+            case NodeKind::Assign: {
+                auto t = type(c);
+                auto lhs = child<ast::Var>(c, off);
+                auto rhs = child<ast::Expr>(c, off);
+                auto n = std::make_unique<ast::Assign>(std::move(lhs), std::move(rhs), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::RangeExpr: {
+                auto t = type(c);
+                auto s = child<ast::Expr>(c, off);
+                auto e = child<ast::Expr>(c, off);
+                auto n = std::make_unique<ast::RangeExpr>(std::move(s), std::move(e), line);
+                n->ty = t;
+                return n;
+            }
+            case NodeKind::Print:
+                return std::make_unique<ast::Print>(child<ast::Expr>(c, off), line);
+            case NodeKind::Println:
+                return std::make_unique<ast::Println>(child<ast::Expr>(c, off), line);
+            case NodeKind::Read:
+                return std::make_unique<ast::Read>(child<ast::Var>(c, off), line);
+            case NodeKind::ReturnStmt:
+                return std::make_unique<ast::ReturnStmt>(child<ast::Expr>(c, off, true), line);
+            case NodeKind::ExprStmt:
+                return std::make_unique<ast::ExprStmt>(child<ast::Expr>(c, off, true), line);
+            case NodeKind::EmptyStmt:
+                return std::make_unique<ast::EmptyStmt>(line);
+            case NodeKind::BreakStmt:
+                return std::make_unique<ast::BreakStmt>(line);
+            case NodeKind::ContinueStmt:
+                return std::make_unique<ast::ContinueStmt>(line);
+            case NodeKind::Block:
+                return std::make_unique<ast::Block>(list<ast::Stmt>(c, off), line);
+            case NodeKind::IfStmt: {
+                auto cond = child<ast::Expr>(c, off);
+                auto t = child<ast::Stmt>(c, off);
+                auto e = child<ast::Stmt>(c, off, true);
+                return std::make_unique<ast::IfStmt>(std::move(cond), std::move(t), std::move(e), line);
+            }
+            case NodeKind::WhileStmt: {
+                auto cond = child<ast::Expr>(c, off);
+                auto body = child<ast::Stmt>(c, off);
+                return std::make_unique<ast::WhileStmt>(std::move(cond), std::move(body), line);
+            }
+            case NodeKind::ForStmt: {
+                auto init = child<ast::Stmt>(c, off, true);
+                auto cond = child<ast::Expr>(c, off, true);
+                auto step = child<ast::Stmt>(c, off, true);
+                auto body = child<ast::Stmt>(c, off, true);
+                return std::make_unique<ast::ForStmt>(std::move(init), std::move(cond), std::move(step),
+                                                      std::move(body), line);
+            }
+            case NodeKind::ForEachStmt: {
+                auto var = child<ast::Var>(c, off);
+                auto coll = child<ast::Expr>(c, off);
+                auto body = child<ast::Stmt>(c, off);
+                return std::make_unique<ast::ForEachStmt>(std::move(var), std::move(coll), std::move(body), line);
+            }
+            case NodeKind::SwitchStmt: {
+                bool hasBreak = c.u8() != 0;
+                auto cond = child<ast::Expr>(c, off);
+                uint32_t count = c.u32();
+                std::vector<ast::SwitchCase> cases;
+                for (uint32_t i = 0; i < count && ok; ++i) {
+                    ast::SwitchCase k;
+                    k.isDefault = c.u8() != 0;
+                    k.line = c.i32();
+                    k.labels = list<ast::Expr>(c, off);
+                    uint32_t values = c.u32();
+                    for (uint32_t j = 0; j < values && ok; ++j) k.values.push_back(c.i32());
+                    k.body = child<ast::Stmt>(c, off);
+                    cases.push_back(std::move(k));
+                }
+                auto n = std::make_unique<ast::SwitchStmt>(std::move(cond), std::move(cases), line);
+                n->hasBreak = hasBreak;
+                return n;
+            }
+            case NodeKind::DeclList: {
+                bool isConst = c.u8() != 0;
+                auto n = std::make_unique<ast::DeclList>(list<ast::Decl>(c, off), line);
+                n->isConst = isConst;
+                return n;
+            }
+            case NodeKind::VarDecl: {
+                auto n = std::make_unique<ast::VarDecl>(ast::Type(), "", nullptr, false, line);
+                varDecl(c, off, *n);
+                return n;
+            }
+            case NodeKind::VarDeclList: {
+                auto n = std::make_unique<ast::VarDeclList>(ast::Type(), std::vector<std::unique_ptr<ast::VarDecl>>{}, line);
+                varDecl(c, off, *n);
+                n->decls = list<ast::VarDecl>(c, off);
+                return n;
+            }
+            case NodeKind::ConstDecl: {
+                auto n = std::make_unique<ast::ConstDecl>(ast::Type(), "", nullptr, line);
+                varDecl(c, off, *n);
+                return n;
+            }
+            case NodeKind::FuncDecl: {
+                bool isConst = c.u8() != 0;
+                auto ret = type(c);
+                auto name = str(c);
+                auto params = list<ast::VarDecl>(c, off);
+                auto body = child<ast::Stmt>(c, off, true);
+                auto n = std::make_unique<ast::FuncDecl>(ret, name, std::move(params), std::move(body), line);
+                n->isConst = isConst;
+                n->sym = symbol(c.u32());
+                n->localSlots = int(c.u32());
+                return n;
+            }
+            case NodeKind::Program: {
+                auto globals = list<ast::Decl>(c, off);
+                auto stmts = list<ast::Stmt>(c, off);
+                return std::make_unique<ast::Program>(std::move(globals), std::move(stmts), line);
+            }
+        }
+        ok = false;
+        return nullptr;
+    }
+
+    template <typename T>
+    std::unique_ptr<T> as(std::unique_ptr<ast::Node> n) {
+        if (!n) return nullptr;
+        auto* t = dynamic_cast<T*>(n.get());
+        if (!t) {
+            ok = false;
+            return nullptr;
+        }
+        n.release();
+        return std::unique_ptr<T>(t);
+    }
+
+private:
+    Span nodes, strs, symbols, symbolIndex;
+    std::vector<std::unique_ptr<SymEntry>> symbolCache;
+
+    template <typename T>
+    std::unique_ptr<T> child(Cursor& c, uint32_t parent, bool optional = false) {
+        uint32_t off = c.u32();
+        if (off == kNull) {
+            if (!optional) ok = false;
+            return nullptr;
+        }
+        return as<T>(node(off, parent));
+    }
+
+    template <typename T>
+    std::vector<std::unique_ptr<T>> list(Cursor& c, uint32_t parent) {
+        std::vector<std::unique_ptr<T>> out;
+        uint32_t n = c.u32();
+        if (!ok || size_t(n) * 4 > c.size - c.pos) {
+            ok = false;
+            return out;
+        }
+        out.reserve(n);
+        for (uint32_t i = 0; i < n && ok; ++i) out.push_back(child<T>(c, parent));
+        return out;
+    }
+
+    void varDecl(Cursor& c, uint32_t off, ast::VarDecl& n) {
+        n.isConst = c.u8() != 0;
+        n.varType = type(c);
+        n.name = str(c);
+        n.init = child<ast::Expr>(c, off, true);
+        uint32_t dims = c.u32();
+        for (uint32_t i = 0; i < dims && ok; ++i) n.dims.push_back(c.i32());
+        n.sym = symbol(c.u32());
+    }
+};
+
+}  // namespace
+
+// ------------------------------------------------------------------
+// SnapshotWriter
+// ------------------------------------------------------------------
+bool SnapshotWriter::write(ast::Program& prog, const std::string& path, std::string& err) {
+    NodeWriter w;
+    uint32_t root = w.put(&prog);
+
+    ByteBuffer index, globals, funcs;
+    for (uint32_t off : w.symbolOffsets) index.u32(off);
+    for (uint32_t id : w.globals) globals.u32(id);
+    for (const auto& [name, off] : w.functions) {
+        w.strings.put(funcs, name);
+        funcs.u32(off);
+    }
+
+    // Same order as SnapshotReader::Section
+    const ByteBuffer* sections[SnapshotReader::kSections] = {
+        &w.strings.buf, &w.nodes, &w.symbols, &index, &globals, &funcs};
+
+    ByteBuffer header;
+    header.bytes.insert(header.bytes.end(), kMagic, kMagic + sizeof kMagic);
+    header.u32(kSnapshotVersion);
+    header.u32(0);  // reserved
+    uint64_t total = kHeaderSize;
+    for (const ByteBuffer* b : sections) total += b->size();
+    header.u64(total);
+    uint64_t off = kHeaderSize;
+    for (const ByteBuffer* b : sections) {
+        header.u64(off);
+        header.u64(b->size());
+        off += b->size();
+    }
+    header.u32(uint32_t(w.functions.size()));
+    header.u32(root);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        err = "cannot open '" + path + "' for writing";
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(header.bytes.data()), std::streamsize(header.size()));
+    for (const ByteBuffer* b : sections)
+        out.write(reinterpret_cast<const char*>(b->bytes.data()), std::streamsize(b->size()));
+    if (!out) {
+        err = "write to '" + path + "' failed";
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------
+// SnapshotReader
+// ------------------------------------------------------------------
+SnapshotReader::~SnapshotReader() { unmap(); }
+
+void SnapshotReader::unmap() {
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    data = nullptr;
+    size = 0;
+}
+
+bool SnapshotReader::open(const std::string& path, std::string& err) {
+    unmap();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        err = "cannot open '" + path + "'";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < kHeaderSize) {
+        ::close(fd);
+        err = "'" + path + "' is not a snapshot (too small)";
+        return false;
+    }
+    void* m = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        err = "cannot map '" + path + "'";
+        return false;
+    }
+    data = static_cast<const uint8_t*>(m);
+    size = size_t(st.st_size);
+
+    if (std::memcmp(data, kMagic, sizeof kMagic) != 0) {
+        unmap();
+        err = "'" + path + "' is not a snapshot (bad magic)";
+        return false;
+    }
+    uint32_t version = loadU32(data + 8);
+    if (version != kSnapshotVersion) {
+        unmap();
+        err = "snapshot version " + std::to_string(version) + " is not supported (expected " +
+              std::to_string(kSnapshotVersion) + ")";
+        return false;
+    }
+
+    bool valid = loadU64(data + 16) == size;
+    for (size_t i = 0; i < kSections; ++i) {
+        uint64_t off = loadU64(data + kSectionTable + i * 16);
+        uint64_t len = loadU64(data + kSectionTable + i * 16 + 8);
+        valid = valid && off <= size && len <= size - off;
+        sections[i] = valid ? Span{data + off, size_t(len)} : Span{};
+    }
+    funcCount = loadU32(data + kHeaderSize - 8);
+    rootNode  = loadU32(data + kHeaderSize - 4);
+    valid = valid && sections[Functions].size == size_t(funcCount) * 12 &&
+            sections[SymbolIndex].size % 4 == 0 && sections[Globals].size % 4 == 0;
+    if (!valid) {
+        unmap();
+        err = "'" + path + "' is truncated or corrupt";
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<ast::Program> SnapshotReader::program() {
+    if (!data) return nullptr;
+    NodeDecoder dec(sections);
+    auto prog = dec.as<ast::Program>(dec.node(rootNode, uint32_t(sections[Nodes].size)));
+    return dec.ok ? std::move(prog) : nullptr;
+}
+
+std::string SnapshotReader::functionName(size_t i) const {
+    if (!data || i >= funcCount) return {};
+    const uint8_t* rec = sections[Functions].data + i * 12;
+    uint32_t off = loadU32(rec), len = loadU32(rec + 4);
+    if (size_t(off) + len > sections[Strings].size) return {};
+    return std::string(reinterpret_cast<const char*>(sections[Strings].data + off), len);
+}
+
+std::unique_ptr<ast::FuncDecl> SnapshotReader::function(size_t i) {
+    if (!data || i >= funcCount) return nullptr;
+    uint32_t off = loadU32(sections[Functions].data + i * 12 + 8);
+    NodeDecoder dec(sections);
+    auto fn = dec.as<ast::FuncDecl>(dec.node(off, uint32_t(sections[Nodes].size)));
+    return dec.ok ? std::move(fn) : nullptr;
+}
+
+std::vector<SymEntry> SnapshotReader::globals() {
+    std::vector<SymEntry> out;
+    if (!data) return out;
+    NodeDecoder dec(sections);
+    const Span& ids = sections[Globals];
+    for (size_t i = 0; i + 4 <= ids.size && dec.ok; i += 4)
+        out.push_back(dec.symbol(loadU32(ids.data + i)));
+    if (!dec.ok) out.clear();
+    return out;
+}
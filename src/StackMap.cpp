@@ -0,0 +1,332 @@
+#include "StackMap.hpp"
+#include "ClassWriter.hpp"
+
+#include <algorithm>
+
+namespace {
+
+bool isReference(const VType& t) {
+    return t.tag == VType::Object || t.tag == VType::Null || t.tag == VType::Uninitialized ||
+           t.tag == VType::UninitializedThis;
+}
+
+} // namespace
+
+VType StackMap::object(std::string_view internalName) {
+    return VType{VType::Object, *names.emplace(internalName).first};
+}
+
+VType StackMap::parseType(std::string_view& d) {
+    if (d.empty()) return VType{};
+    char c = d[0];
+    d.remove_prefix(1);
+    switch (c) {
+        case 'I': case 'Z': case 'C': case 'B': case 'S': return VType{VType::Integer};
+        case 'F': return VType{VType::Float};
+        case 'D': return VType{VType::Double};
+        case 'J': return VType{VType::Long};
+        case 'L': {
+            size_t end = d.find(';');
+            std::string_view name = d.substr(0, end);
+            d.remove_prefix(end == std::string_view::npos ? d.size() : end + 1);
+            return object(name);
+        }
+        case '[': {
+            std::string_view rest = d;
+            parseType(d);                       // the element type, only to skip it
+            return object(std::string("[") + std::string(rest.substr(0, rest.size() - d.size())));
+        }
+        default:  return VType{};
+    }
+}
+
+VType StackMap::join(const VType& a, const VType& b) {
+    if (a == b) return a;
+    if (a.tag == VType::Null && b.tag == VType::Object) return b;
+    if (b.tag == VType::Null && a.tag == VType::Object) return a;
+    if (a.tag == VType::Object && b.tag == VType::Object) return object("java/lang/Object");
+    return VType{};
+}
+
+bool StackMap::run(const std::vector<Instr>& code, const std::vector<SwitchTable>& tables,
+                   std::string_view descriptor, int maxLocals, std::string& err) {
+    labelAt.clear();
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!code[i].isLabel) continue;
+        if (size_t(code[i].a) >= labelAt.size()) labelAt.resize(size_t(code[i].a) + 1, -1);
+        labelAt[size_t(code[i].a)] = int(i);
+    }
+
+    start.locals.assign(size_t(std::max(maxLocals, 0)), VType{});
+    start.stack.clear();
+    std::string_view d = descriptor.substr(1);
+    size_t slot = 0;
+    while (!d.empty() && d[0] != ')') {
+        VType t = parseType(d);
+        if (slot < start.locals.size()) start.locals[slot] = t;
+        slot += t.tag == VType::Double || t.tag == VType::Long ? 2 : 1;
+    }
+    if (slot > start.locals.size()) {
+        err = "max_locals is smaller than the parameters";
+        return false;
+    }
+
+    frames.assign(code.size(), Frame{});
+    reached.assign(code.size(), 0);
+    work.clear();
+    if (code.empty()) return true;
+    if (!flow(0, start, err)) return false;
+    while (!work.empty()) {
+        size_t i = work.back();
+        work.pop_back();
+        Frame f = frames[i];
+        const Instr& in = code[i];
+        if (!in.isLabel) {
+            if (!step(in, i, f, err)) return false;
+            auto target = [&](Label l) {
+                if (size_t(l.id) >= labelAt.size() || labelAt[size_t(l.id)] < 0) {
+                    err = "jump to undefined label L" + std::to_string(l.id);
+                    return false;
+                }
+                return flow(size_t(labelAt[size_t(l.id)]), f, err);
+            };
+            if (in.isBranch() && !target(in.target())) return false;
+            if (in.kind == OperandKind::Switch) {
+                const SwitchTable& t = tables[size_t(in.a)];
+                if (!target(t.dflt)) return false;
+                for (Label l : t.targets)
+                    if (!target(l)) return false;
+            }
+            if (endsFlow(in.op)) continue;
+        }
+        if (i + 1 >= code.size()) {
+            err = "control falls off the end of the code";
+            return false;
+        }
+        if (!flow(i + 1, f, err)) return false;
+    }
+    return true;
+}
+
+bool StackMap::flow(size_t to, const Frame& f, std::string& err) {
+    if (!reached[to]) {
+        reached[to] = 1;
+        frames[to] = f;
+        work.push_back(to);
+        return true;
+    }
+    Frame& old = frames[to];
+    if (old.stack.size() != f.stack.size()) {
+        err = "stack depths " + std::to_string(old.stack.size()) + " and " + std::to_string(f.stack.size()) +
+              " meet at one instruction";
+        return false;
+    }
+    bool changed = false;
+    for (size_t k = 0; k < old.stack.size(); ++k) {
+        VType t = join(old.stack[k], f.stack[k]);
+        if (t.tag == VType::Top) {
+            err = "operand stack types disagree where paths meet";
+            return false;
+        }
+        if (t != old.stack[k]) old.stack[k] = t, changed = true;
+    }
+    for (size_t k = 0; k < old.locals.size(); ++k) {
+        VType t = join(old.locals[k], f.locals[k]);
+        if (t != old.locals[k]) old.locals[k] = t, changed = true;
+    }
+    if (changed) work.push_back(to);
+    return true;
+}
+
+// `f` goes from the entry state of code[i] to its exit state
+bool StackMap::step(const Instr& in, size_t i, Frame& f, std::string& err) {
+    auto& stack = f.stack;
+    bool ok = true;
+    auto pop = [&]() {
+        if (stack.empty()) {
+            ok = false;
+            return VType{};
+        }
+        VType t = stack.back();
+        stack.pop_back();
+        return t;
+    };
+    auto push = [&](VType t) { stack.push_back(t); };
+    auto popN = [&](int n) { while (n-- > 0) pop(); };
+    auto local = [&](int slot) -> VType* {
+        if (slot < 0 || size_t(slot) >= f.locals.size()) {
+            err = "local " + std::to_string(slot) + " is beyond max_locals";
+            return nullptr;
+        }
+        return &f.locals[size_t(slot)];
+    };
+    const VType integer{VType::Integer};
+
+    switch (in.op) {
+        case Opcode::nop: case Opcode::goto_: case Opcode::return_:
+            break;
+        case Opcode::aconst_null:
+            push(VType{VType::Null});
+            break;
+        case Opcode::iconst_m1: case Opcode::iconst_0: case Opcode::iconst_1: case Opcode::iconst_2:
+        case Opcode::iconst_3: case Opcode::iconst_4: case Opcode::iconst_5:
+        case Opcode::bipush: case Opcode::sipush:
+            push(integer);
+            break;
+        case Opcode::ldc:
+            if (in.kind == OperandKind::String) push(object("java/lang/String"));
+            else push(integer);                 // int, or a 'c' char literal
+            break;
+        case Opcode::ldc2_w:
+            push(VType{VType::Double});
+            break;
+        case Opcode::iload: case Opcode::aload: {
+            VType* t = local(in.a);
+            if (!t) return false;
+            bool wantInt = in.op == Opcode::iload;
+            if (wantInt ? t->tag != VType::Integer : !isReference(*t)) {
+                err = "local " + std::to_string(in.a) + " is read before it holds " + (wantInt ? "an int" : "a reference");
+                return false;
+            }
+            push(*t);
+            break;
+        }
+        case Opcode::istore: case Opcode::astore: {
+            VType v = pop();
+            VType* t = local(in.a);
+            if (!t) return false;
+            *t = v;
+            break;
+        }
+        case Opcode::iinc: {
+            VType* t = local(in.a);
+            if (!t) return false;
+            if (t->tag != VType::Integer) {
+                err = "iinc of local " + std::to_string(in.a) + ", which holds no int";
+                return false;
+            }
+            break;
+        }
+        case Opcode::iaload: case Opcode::baload:
+            popN(2);
+            push(integer);
+            break;
+        case Opcode::aaload: {
+            pop();
+            VType arr = pop();
+            if (arr.tag == VType::Object && arr.name.size() > 1 && arr.name[0] == '[') {
+                std::string_view elem = arr.name.substr(1);
+                push(parseType(elem));
+            } else {
+                push(VType{VType::Null});
+            }
+            break;
+        }
+        case Opcode::iastore: case Opcode::aastore: case Opcode::bastore: case Opcode::castore:
+            popN(3);
+            break;
+        case Opcode::pop:
+            pop();
+            break;
+        case Opcode::dup: {
+            VType t = pop();
+            push(t);
+            push(t);
+            break;
+        }
+        case Opcode::dup_x1: {
+            VType a = pop(), b = pop();
+            push(a);
+            push(b);
+            push(a);
+            break;
+        }
+        case Opcode::dup2: {
+            VType a = pop(), b = pop();
+            push(b);
+            push(a);
+            push(b);
+            push(a);
+            break;
+        }
+        case Opcode::swap: {
+            VType a = pop(), b = pop();
+            push(a);
+            push(b);
+            break;
+        }
+        case Opcode::iadd: case Opcode::isub: case Opcode::imul: case Opcode::idiv: case Opcode::irem:
+        case Opcode::ishl: case Opcode::ishr: case Opcode::iushr: case Opcode::iand: case Opcode::ior:
+        case Opcode::ixor:
+            popN(2);
+            push(integer);
+            break;
+        case Opcode::ineg: case Opcode::i2c: case Opcode::arraylength:
+            pop();
+            push(integer);
+            break;
+        case Opcode::ifeq: case Opcode::ifne: case Opcode::iflt: case Opcode::ifge: case Opcode::ifgt:
+        case Opcode::ifle: case Opcode::tableswitch: case Opcode::lookupswitch:
+        case Opcode::ireturn: case Opcode::areturn: case Opcode::athrow: case Opcode::putstatic:
+            pop();
+            break;
+        case Opcode::if_icmpeq: case Opcode::if_icmpne: case Opcode::if_icmplt: case Opcode::if_icmpge:
+        case Opcode::if_icmpgt: case Opcode::if_icmple: case Opcode::if_acmpeq: case Opcode::if_acmpne:
+            popN(2);
+            break;
+        case Opcode::getstatic: {
+            classfile::MemberRef ref;
+            if (!classfile::parseMember(in.text, ref)) break;
+            std::string_view d = ref.descriptor;
+            push(parseType(d));
+            break;
+        }
+        case Opcode::invokestatic: case Opcode::invokevirtual: case Opcode::invokespecial: {
+            classfile::MemberRef ref;
+            if (!classfile::parseMember(in.text, ref)) break;
+            std::string_view d = std::string_view(ref.descriptor).substr(1);
+            int args = 0;
+            while (!d.empty() && d[0] != ')') {
+                parseType(d);
+                ++args;
+            }
+            popN(args);
+            if (in.op != Opcode::invokestatic) {
+                VType self = pop();
+                if (in.op == Opcode::invokespecial && ref.name == "<init>") {
+                    VType made = object(ref.owner);
+                    for (auto* list : {&f.locals, &stack})
+                        std::replace(list->begin(), list->end(), self, made);
+                }
+            }
+            d.remove_prefix(std::min<size_t>(1, d.size()));     // ')'
+            if (d != "V") push(parseType(d));
+            break;
+        }
+        case Opcode::new_:
+            push(VType{VType::Uninitialized, {}, int(i)});
+            break;
+        case Opcode::newarray: {
+            pop();
+            static constexpr std::pair<std::string_view, std::string_view> kinds[] = {
+                {"boolean", "[Z"}, {"char", "[C"}, {"float", "[F"}, {"double", "[D"},
+                {"byte", "[B"}, {"short", "[S"}, {"int", "[I"}, {"long", "[J"}};
+            auto it = std::find_if(std::begin(kinds), std::end(kinds), [&](const auto& k) { return k.first == in.text; });
+            if (it == std::end(kinds)) {
+                err = "newarray of unknown type '" + std::string(in.text) + "'";
+                return false;
+            }
+            push(object(it->second));
+            break;
+        }
+        case Opcode::anewarray:
+            pop();
+            push(object("[" + classfile::descriptor(in.text)));
+            break;
+        default:
+            err = "no verification rule for " + std::string(opcodeName(in.op));
+            return false;
+    }
+    if (!ok) err = std::string(opcodeName(in.op)) + " pops an empty stack";
+    return ok;
+}
@@ -0,0 +1,52 @@
+#include "StreamingCompiler.hpp"
+
+#include <cstdio>
+
+StreamingCompiler::StreamingCompiler(const std::string& className, const std::string& outputFile,
+                                     const CompilerOptions* opts, OptReport* report)
+    : spoolPath(outputFile + ".tmp"),
+      spool(spoolPath, std::ios::in | std::ios::out | std::ios::trunc),
+      spoolEmitter(spool),
+      analyzer(symtab),
+      ctx(className),
+      options(opts),
+      report(report),
+      codegen(spoolEmitter, ctx, symtab, opts, report) {
+    spoolEmitter.push();   // methods sit one level inside the class body
+}
+
+void StreamingCompiler::topLevel(ast::Decl* item) {
+    std::unique_ptr<ast::Decl> owned(item);
+    analyzer.analyzeItem(*owned);
+
+    auto* fn = dynamic_cast<ast::FuncDecl*>(owned.get());
+    if (!fn) {
+        globals.push_back(std::move(owned));
+        return;
+    }
+    ++functions;
+    // After the first error only analysis continues; nothing will be written
+    if (analyzer.hasErrors()) return;
+    fn->accept(codegen);
+    spoolEmitter.flush();
+    // `owned` goes out of scope here: the function's subtree is freed
+}
+
+void StreamingCompiler::finish(std::ostream& out) {
+    if (analyzer.hasErrors()) {
+        spool.close();
+        std::remove(spoolPath.c_str());
+    }
+    analyzer.report();
+
+    ast::Program root(std::move(globals), {});
+    CodeEmitter emitter(out);
+    CodeGenVisitor classgen(emitter, ctx, symtab, options, report);
+    spool.flush();
+    spool.seekg(0);
+    classgen.generateStreamed(root, spool, codegen.readsInput());
+    emitter.flush();
+
+    spool.close();
+    std::remove(spoolPath.c_str());
+}
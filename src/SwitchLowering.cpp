@@ -0,0 +1,120 @@
+#include "SwitchLowering.hpp"
+#include "OptReport.hpp"
+
+#include <algorithm>
+
+namespace {
+
+void pushInt(MethodCode& code, int v) {
+    if (v >= -1 && v <= 5) code.emit(Opcode(int(Opcode::iconst_0) + v));
+    else if (v >= -128 && v <= 127) code.emit(Opcode::bipush, v);
+    else code.emit(Opcode::ldc, v);
+}
+
+// javac: table space + 3 · table time ≤ lookup space + 3 · lookup time
+bool tableWorthy(long long range, long long n) {
+    return 4 + range + 3 * 3 <= 3 + 2 * n + 3 * n;
+}
+
+} // namespace
+
+void SwitchLowering::run(std::vector<Case> cs, Label d, MethodCode& c, CodeGenContext& cx, OptReport* r) {
+    cases = std::move(cs);
+    dflt = d;
+    code = &c;
+    ctx = &cx;
+    report = r;
+    selector = -1;
+    std::sort(cases.begin(), cases.end(), [](const Case& a, const Case& b) { return a.value < b.value; });
+
+    if (cases.empty()) {
+        code->emit(Opcode::pop);
+        code->emit(Opcode::goto_, dflt);
+        return;
+    }
+    split();
+    if (segments.size() > 1 || (!segments[0].table && cases.size() <= size_t(kMaxCompares))) {
+        selector = ctx->allocLocal();
+        code->emit(Opcode::istore, selector);
+    }
+    search(0, segments.size());
+    if (report && segments.size() > 1) report->add("switch", "search trees");
+}
+
+// From each value, the longest cluster still worth a table (at least
+// three values); values that start none join the sparse run before them
+void SwitchLowering::split() {
+    segments.clear();
+    const size_t n = cases.size();
+    for (size_t i = 0; i < n;) {
+        size_t end = i;
+        for (size_t j = i + 2; j < n; ++j) {
+            long long range = (long long)cases[j].value - cases[i].value + 1;
+            if (range > 5 * (long long)(n - i)) break;     // no longer cluster can pay for it
+            if (tableWorthy(range, (long long)(j - i + 1))) end = j;
+        }
+        if (end > i) {
+            segments.push_back({i, end, true});
+            i = end + 1;
+            continue;
+        }
+        if (!segments.empty() && !segments.back().table) segments.back().last = i;
+        else segments.push_back({i, i, false});
+        ++i;
+    }
+}
+
+void SwitchLowering::search(size_t from, size_t to) {
+    if (to - from == 1) {
+        leaf(segments[from]);
+        return;
+    }
+    size_t mid = from + (to - from) / 2;
+    Label lower = ctx->newLabel();
+    load();
+    pushInt(*code, cases[segments[mid].first].value);
+    code->emit(Opcode::if_icmplt, lower);
+    search(mid, to);
+    code->label(lower);
+    search(from, mid);
+}
+
+void SwitchLowering::leaf(const Segment& s) {
+    const size_t n = s.last - s.first + 1;
+    if (s.table) {
+        SwitchTable t;
+        t.dflt = dflt;
+        t.low = cases[s.first].value;
+        t.targets.assign(size_t(cases[s.last].value - t.low) + 1, dflt);
+        for (size_t k = s.first; k <= s.last; ++k) t.targets[size_t(cases[k].value - t.low)] = cases[k].target;
+        load();
+        code->emitSwitch(Opcode::tableswitch, std::move(t));
+        if (report) report->add("switch", "tableswitches");
+    } else if (n <= size_t(kMaxCompares) && selector >= 0) {
+        for (size_t k = s.first; k <= s.last; ++k) {
+            load();
+            if (cases[k].value == 0) {
+                code->emit(Opcode::ifeq, cases[k].target);
+            } else {
+                pushInt(*code, cases[k].value);
+                code->emit(Opcode::if_icmpeq, cases[k].target);
+            }
+        }
+        code->emit(Opcode::goto_, dflt);
+        if (report) report->add("switch", "compare chains");
+    } else {
+        SwitchTable t;
+        t.dflt = dflt;
+        for (size_t k = s.first; k <= s.last; ++k) {
+            t.keys.push_back(cases[k].value);
+            t.targets.push_back(cases[k].target);
+        }
+        load();
+        code->emitSwitch(Opcode::lookupswitch, std::move(t));
+        if (report) report->add("switch", "lookupswitches");
+    }
+}
+
+void SwitchLowering::load() {
+    if (selector >= 0) code->emit(Opcode::iload, selector);
+}
@@ -6,6 +6,7 @@
  * for managing symbol scopes and lookup.
  */
 #include "SymbolTable.hpp"
+#include <algorithm>
 #include <cassert>
 
 /**
@@ -15,6 +16,17 @@ SymbolTable::SymbolTable() {
     scopes.emplace_back();   // Create global scope
 }
 
+/**
+ * @brief Creates a worker table whose global scope is a view of `frozen`
+ *
+ * @param frozen Fully populated table that is no longer modified
+ * @param visibleGlobals Number of leading global symbols (in declaration order) in scope
+ */
+SymbolTable::SymbolTable(const SymbolTable& frozen, size_t visibleGlobals)
+    : frozen(&frozen), visibleGlobals(visibleGlobals) {
+    scopes.emplace_back();   // Local overlay for globals touched by this worker
+}
+
 /**
  * @brief Creates a new scope for variables and symbols
  * 
@@ -23,8 +35,9 @@ SymbolTable::SymbolTable() {
 void SymbolTable::enterScope(bool isFunctionScope) {
     scopes.emplace_back();  // Create new scope
     if (isFunctionScope) {
-        savedNextLocal.push(nextLocal);  // Save outer scope's slot counter
+        savedNextLocal.push({scopes.size(), nextLocal});  // Save outer scope's slot counter
         nextLocal = 0;                   // Reset for new function's parameters and locals
+        highWater = 0;
     }
 }
 
@@ -32,14 +45,15 @@ void SymbolTable::enterScope(bool isFunctionScope) {
  * @brief Removes the current scope and restores previous scope's state
  * 
  * When exiting a function scope, restores the outer scope's slot counter.
+ * Block scopes keep the counter, so later locals never reuse a slot.
  */
 void SymbolTable::exitScope() {
     assert(scopes.size() > 1 && "cannot pop global scope");
-    scopes.pop_back();  // Remove current scope
-    if (!savedNextLocal.empty()) {  // If leaving a function scope
-        nextLocal = savedNextLocal.top();  // Restore outer scope's slot counter
+    if (!savedNextLocal.empty() && savedNextLocal.top().first == scopes.size()) {  // If leaving a function scope
+        nextLocal = savedNextLocal.top().second;  // Restore outer scope's slot counter
         savedNextLocal.pop();
     }
+    scopes.pop_back();  // Remove current scope
 }
 
 /**
@@ -57,6 +71,7 @@ SymEntry* SymbolTable::insert(const SymEntry& inEntry) {
     if (atGlobalScope()) {
         entry.isGlobal = true;
         entry.slot = -1;
+        globalSeq.emplace(entry.name, globalSeq.size());
     } else if (!entry.isFunc) {
         entry.isGlobal = false;
         entry.slot = allocateSlot();
@@ -82,6 +97,9 @@ SymEntry* SymbolTable::lookup(const std::string& name) {
         auto f = it->find(name);
         if (f != it->end()) return &f->second;
     }
+    // Copy-on-write: callers may update the entry (e.g. tracked values)
+    if (const SymEntry* g = lookupFrozen(name))
+        return &scopes.front().emplace(name, *g).first->second;
     return nullptr;  // Symbol not found
 }
 
@@ -97,7 +115,21 @@ const SymEntry* SymbolTable::lookup(const std::string& name) const {
         auto f = it->find(name);
         if (f != it->end()) return &f->second;
     }
-    return nullptr;  // Symbol not found
+    return lookupFrozen(name);
+}
+
+/**
+ * @brief Looks a name up in the frozen global scope, honouring the visibility limit
+ *
+ * @param name Symbol name to look up
+ * @return Const pointer into the frozen table, or nullptr
+ */
+const SymEntry* SymbolTable::lookupFrozen(const std::string& name) const {
+    if (!frozen) return nullptr;
+    auto seq = frozen->globalSeq.find(name);
+    if (seq == frozen->globalSeq.end() || seq->second >= visibleGlobals) return nullptr;
+    auto f = frozen->scopes.front().find(name);
+    return f != frozen->scopes.front().end() ? &f->second : nullptr;
 }
 
 /**
@@ -109,6 +141,7 @@ const SymEntry* SymbolTable::lookup(const std::string& name) const {
  * @return The allocated slot number
  */
 int SymbolTable::allocateSlot() { 
+    highWater = std::max(highWater, nextLocal + 1);
     return nextLocal++; 
 }
 
@@ -0,0 +1,173 @@
+#include "TreeShaker.hpp"
+#include "Inliner.hpp"
+#include "OptReport.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace ast;
+
+namespace {
+
+// Functions a piece of code may invoke and globals it touches, with
+// calls the inliner expands followed into the callee's body
+struct Uses : Visitor {
+    const Inliner* inliner;
+    std::vector<std::string> calls;
+    std::vector<std::string> globals;
+    bool effects = false;       // calls, assignments, ++ / --
+    int depth = 0;              // inlined bodies we are inside of
+
+    explicit Uses(const Inliner* in) : inliner(in) {}
+
+    void walk(Node* n) { if (n) n->accept(*this); }
+
+    void visit(IntLit&) override {}
+    void visit(RealLit&) override {}
+    void visit(StringLit&) override {}
+    void visit(BoolLit&) override {}
+    void visit(CharLit&) override {}
+    void visit(Var& v) override {
+        if (v.sym.isGlobal) globals.push_back(v.name);
+        for (auto& idx : v.indices) walk(idx.get());
+    }
+    void visit(Unary& u) override { walk(u.rhs.get()); }
+    void visit(Binary& b) override { walk(b.lhs.get()); walk(b.rhs.get()); }
+    void visit(Postfix& p) override { effects = true; walk(p.operand.get()); }
+    void visit(Assign& a) override { effects = true; walk(a.lhs.get()); walk(a.rhs.get()); }
+    void visit(RangeExpr& r) override { walk(r.start.get()); walk(r.end.get()); }
+    void visit(Call& c) override {
+        effects = true;
+        for (auto& arg : c.args) walk(arg.get());
+        if (inliner) {
+            // inlined everywhere at this depth → no invokestatic; inlined
+            // only in loops → maybe either, so walk the body and keep the edge
+            bool always = inliner->candidate(c.callee, false, depth) != nullptr;
+            if (const FuncDecl* fn = inliner->candidate(c.callee, true, depth)) {
+                ++depth;
+                walk(fn->body.get());
+                --depth;
+            }
+            if (always) return;
+        }
+        calls.push_back(c.callee);
+    }
+    void visit(Print& p) override { walk(p.expr.get()); }
+    void visit(Println& p) override { walk(p.expr.get()); }
+    void visit(Read& r) override { effects = true; walk(r.var.get()); }
+    void visit(Block& b) override { for (auto& s : b.stmts) walk(s.get()); }
+    void visit(IfStmt& s) override { walk(s.cond.get()); walk(s.thenStmt.get()); walk(s.elseStmt.get()); }
+    void visit(WhileStmt& s) override { walk(s.cond.get()); walk(s.body.get()); }
+    void visit(ForStmt& s) override {
+        walk(s.init.get()); walk(s.cond.get()); walk(s.step.get()); walk(s.body.get());
+    }
+    void visit(ForEachStmt& s) override { walk(s.var.get()); walk(s.collection.get()); walk(s.body.get()); }
+    void visit(SwitchStmt& s) override {
+        walk(s.cond.get());
+        for (auto& c : s.cases) walk(c.body.get());
+    }
+    void visit(ReturnStmt& s) override { walk(s.expr.get()); }
+    void visit(ExprStmt& s) override { walk(s.expr.get()); }
+    void visit(EmptyStmt&) override {}
+    void visit(BreakStmt&) override {}
+    void visit(ContinueStmt&) override {}
+    void visit(DeclList& dl) override { for (auto& d : dl.decls) walk(d.get()); }
+    void visit(VarDecl& d) override { walk(d.init.get()); }
+    void visit(VarDeclList& dl) override { for (auto& d : dl.decls) walk(d.get()); }
+    void visit(ConstDecl& d) override { walk(d.init.get()); }
+    void visit(FuncDecl& f) override { walk(f.body.get()); }
+    void visit(Program&) override {}
+};
+
+} // namespace
+
+void TreeShaker::run(Program& program) {
+    std::unordered_map<std::string, FuncDecl*> functions;
+    std::unordered_map<std::string, VarDecl*> globals;
+    for (auto& d : program.globals) {
+        if (auto* f = dynamic_cast<FuncDecl*>(d.get())) {
+            functions.emplace(f->name, f);
+        } else if (auto* list = dynamic_cast<VarDeclList*>(d.get())) {
+            for (auto& inner : list->decls) globals.emplace(inner->name, inner.get());
+        } else if (auto* vd = dynamic_cast<VarDecl*>(d.get())) {
+            globals.emplace(vd->name, vd);
+        }
+    }
+    for (auto& s : program.stmts)
+        if (auto* f = dynamic_cast<FuncDecl*>(s.get())) functions.emplace(f->name, f);
+    if (!functions.count("main")) return;
+
+    std::unordered_set<std::string> reached, used;
+    std::vector<std::string> work;
+    auto follow = [&](Uses& u) {
+        for (auto& f : u.calls)
+            if (reached.insert(f).second) work.push_back(f);
+        for (auto& g : u.globals)
+            if (used.insert(g).second) work.push_back(g);
+    };
+
+    // roots: main, and initializers <clinit> has to run anyway
+    reached.insert("main");
+    work.push_back("main");
+    for (auto& [name, vd] : globals) {
+        Uses u(inliner);
+        u.walk(vd->init.get());
+        if (u.effects && used.insert(name).second) work.push_back(name);
+    }
+    while (!work.empty()) {
+        std::string name = std::move(work.back());
+        work.pop_back();
+        if (auto f = functions.find(name); f != functions.end() && reached.count(name)) {
+            Uses u(inliner);
+            u.walk(f->second->body.get());
+            follow(u);
+        }
+        if (auto g = globals.find(name); g != globals.end() && used.count(name)) {
+            Uses u(inliner);
+            u.walk(g->second->init.get());
+            follow(u);
+        }
+    }
+
+    // ---- drop the rest, keeping declaration order; dropped functions may
+    // still be expanded inline, so they are parked rather than destroyed
+    long deadFunctions = 0, deadGlobals = 0;
+    for (auto& d : program.globals)
+        if (auto* list = dynamic_cast<VarDeclList*>(d.get())) {
+            auto& decls = list->decls;
+            size_t before = decls.size();
+            decls.erase(std::remove_if(decls.begin(), decls.end(),
+                                       [&](const std::unique_ptr<VarDecl>& vd) { return !used.count(vd->name); }),
+                        decls.end());
+            deadGlobals += long(before - decls.size());
+        }
+    auto park = [&](auto& nodes, bool global) {
+        auto dropped = [&](const auto& n) {
+            if (auto* f = dynamic_cast<const FuncDecl*>(n.get())) return !reached.count(f->name);
+            if (!global) return false;
+            if (auto* list = dynamic_cast<const VarDeclList*>(n.get())) return list->decls.empty();
+            auto* vd = dynamic_cast<const VarDecl*>(n.get());
+            return vd && !used.count(vd->name);
+        };
+        auto end = std::stable_partition(nodes.begin(), nodes.end(), [&](const auto& n) { return !dropped(n); });
+        for (auto it = end; it != nodes.end(); ++it) {
+            if (dynamic_cast<FuncDecl*>(it->get())) {
+                ++deadFunctions;
+                removed.emplace_back(it->release());
+            } else if (!dynamic_cast<VarDeclList*>(it->get())) {
+                ++deadGlobals;
+            }
+        }
+        nodes.erase(end, nodes.end());
+    };
+    park(program.globals, true);
+    park(program.stmts, false);
+
+    if (report) {
+        report->add("tree-shake", "functions removed", deadFunctions);
+        report->add("tree-shake", "globals removed", deadGlobals);
+    }
+}
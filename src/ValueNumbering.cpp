@@ -0,0 +1,214 @@
+#include "ValueNumbering.hpp"
+
+#include <utility>
+
+using namespace ast;
+
+namespace {
+
+enum Kind { kInt, kBool, kUnary, kBinary };
+
+bool arithmetic(Op op) {
+    return op == Op::Plus || op == Op::Minus || op == Op::Mul || op == Op::Div || op == Op::Mod;
+}
+
+} // namespace
+
+size_t ValueNumbering::run(std::vector<std::unique_ptr<Stmt>>& stmts, size_t begin,
+                           const std::unordered_set<const Expr*>& loops) {
+    clear();
+    hoisted = &loops;
+    size_t end = begin;
+    for (; end < stmts.size(); ++end) {
+        simple = false;
+        stmts[end]->accept(*this);
+        if (!simple) break;
+    }
+
+    // values evaluated twice or more are shared, the first use keeps it
+    count.assign(seen.size(), 0);
+    temp.assign(seen.size(), -1);
+    for (const Use& u : uses) ++count[size_t(u.vn)];
+    for (const Use& u : uses) {
+        if (count[size_t(u.vn)] < 2) continue;
+        int& t = temp[size_t(u.vn)];
+        bool first = t < 0;
+        if (first) t = nTemps++;
+        out.push_back({u.expr, t, first});
+    }
+    return end;
+}
+
+void ValueNumbering::clear() {
+    if (!numbers.empty()) numbers.clear();
+    uses.clear();
+    seen.clear();
+    localValue.clear();
+    for (auto& [name, g] : globals) g.value = -1;
+    callEpoch = 0;
+    conditional = false;
+    out.clear();
+    nTemps = 0;
+}
+
+std::optional<int> ValueNumbering::number(Expr* e) {
+    vn.reset();
+    if (e) e->accept(*this);
+    return std::exchange(vn, std::nullopt);
+}
+
+int ValueNumbering::valueOf(const Key& key) {
+    auto [it, added] = numbers.emplace(key, int(seen.size()));
+    if (added) seen.push_back(0);
+    return it->second;
+}
+
+int ValueNumbering::fresh() {
+    seen.push_back(0);
+    return int(seen.size()) - 1;
+}
+
+int& ValueNumbering::local(int slot) {
+    if (size_t(slot) >= localValue.size()) localValue.resize(size_t(slot) + 1, -1);
+    return localValue[size_t(slot)];
+}
+
+bool ValueNumbering::loaded(const Expr& e) {
+    if (hoisted->empty() || !hoisted->count(&e)) return false;
+    vn = fresh();
+    return true;
+}
+
+void ValueNumbering::wrote(const Var& v) {
+    if (v.sym.isGlobal) globals[v.name].value = -1;
+    else local(v.sym.slot) = -1;
+}
+
+//---------------------------------------------------------------
+// expressions
+//---------------------------------------------------------------
+void ValueNumbering::visit(IntLit& n)  { vn = valueOf({kInt, 0, n.value, 0}); }
+void ValueNumbering::visit(BoolLit& n) { vn = valueOf({kBool, 0, n.value, 0}); }
+void ValueNumbering::visit(RealLit&)   {}
+void ValueNumbering::visit(StringLit&) {}
+void ValueNumbering::visit(CharLit&)   {}
+
+void ValueNumbering::visit(Var& v) {
+    if (loaded(v)) return;
+    if (!v.indices.empty()) {
+        for (auto& idx : v.indices) number(idx.get());
+        return;
+    }
+    if (!v.sym.isGlobal) {
+        int& value = local(v.sym.slot);
+        if (value < 0) value = fresh();
+        vn = value;
+        return;
+    }
+    if (v.ty.kind != BasicType::Int && v.ty.kind != BasicType::Bool) return;
+    // getstatic is worth sharing
+    Global& g = globals[v.name];
+    if (g.value < 0 || g.epoch != callEpoch) g = {fresh(), callEpoch};
+    int value = g.value;
+    if (!conditional || seen[size_t(value)]) uses.push_back({&v, value});
+    if (!conditional) seen[size_t(value)] = 1;
+    vn = value;
+}
+
+void ValueNumbering::visit(Unary& u) {
+    if (loaded(u)) return;
+    size_t mark = uses.size();
+    auto operand = number(u.rhs.get());
+    if (!operand || u.ty.kind != BasicType::Int || (u.op != Op::Minus && u.op != Op::Neg)) return;
+    int value = valueOf({kUnary, int(Op::Minus), *operand, 0});
+    if (seen[size_t(value)]) uses.resize(mark);   // operands are not evaluated again
+    if (!conditional || seen[size_t(value)]) uses.push_back({&u, value});
+    if (!conditional) seen[size_t(value)] = 1;
+    vn = value;
+}
+
+void ValueNumbering::visit(Binary& b) {
+    if (b.op == Op::And || b.op == Op::Or) {
+        number(b.lhs.get());
+        bool outer = std::exchange(conditional, true);
+        number(b.rhs.get());
+        conditional = outer;
+        return;
+    }
+    if (loaded(b)) return;
+    size_t mark = uses.size();
+    auto lhs = number(b.lhs.get());
+    auto rhs = number(b.rhs.get());
+    if (!lhs || !rhs || !arithmetic(b.op) || b.ty.kind != BasicType::Int) return;
+    if ((b.op == Op::Plus || b.op == Op::Mul) && *rhs < *lhs) std::swap(lhs, rhs);
+    int value = valueOf({kBinary, int(b.op), *lhs, *rhs});
+    if (seen[size_t(value)]) uses.resize(mark);
+    if (!conditional || seen[size_t(value)]) uses.push_back({&b, value});
+    if (!conditional) seen[size_t(value)] = 1;
+    vn = value;
+}
+
+// the operand is read by the ++ / -- itself, never shared
+void ValueNumbering::visit(Postfix& p) {
+    for (auto& idx : p.operand->indices) number(idx.get());
+    wrote(*p.operand);
+}
+
+void ValueNumbering::visit(Call& c) {
+    for (auto& arg : c.args) number(arg.get());
+    ++callEpoch;        // the callee may write any global
+}
+
+void ValueNumbering::visit(Assign& a) {
+    for (auto& idx : a.lhs->indices) number(idx.get());
+    number(a.rhs.get());
+    wrote(*a.lhs);
+}
+
+void ValueNumbering::visit(RangeExpr& r) {
+    number(r.start.get());
+    number(r.end.get());
+}
+
+//---------------------------------------------------------------
+// statements: the simple ones continue the run
+//---------------------------------------------------------------
+void ValueNumbering::visit(Print& p)      { number(p.expr.get()); simple = true; }
+void ValueNumbering::visit(Println& p)    { number(p.expr.get()); simple = true; }
+void ValueNumbering::visit(ExprStmt& s)   { number(s.expr.get()); simple = true; }
+void ValueNumbering::visit(ReturnStmt& s) { number(s.expr.get()); simple = true; }
+void ValueNumbering::visit(EmptyStmt&)    { simple = true; }
+
+void ValueNumbering::visit(VarDecl& d) {
+    number(d.init.get());
+    local(d.sym.slot) = -1;
+    simple = true;
+}
+
+void ValueNumbering::visit(ConstDecl& d) { visit(static_cast<VarDecl&>(d)); }
+
+void ValueNumbering::visit(VarDeclList& dl) {
+    for (auto& d : dl.decls) visit(*d);
+    simple = true;
+}
+
+void ValueNumbering::visit(DeclList& dl) {
+    for (auto& d : dl.decls) {
+        simple = false;
+        d->accept(*this);
+        if (!simple) return;
+    }
+    simple = true;
+}
+
+void ValueNumbering::visit(Read&)        {}
+void ValueNumbering::visit(Block&)       {}
+void ValueNumbering::visit(IfStmt&)      {}
+void ValueNumbering::visit(WhileStmt&)   {}
+void ValueNumbering::visit(ForStmt&)     {}
+void ValueNumbering::visit(ForEachStmt&) {}
+void ValueNumbering::visit(SwitchStmt&)  {}
+void ValueNumbering::visit(BreakStmt&)   {}
+void ValueNumbering::visit(ContinueStmt&) {}
+void ValueNumbering::visit(FuncDecl&)    {}
+void ValueNumbering::visit(Program&)     {}
@@ -0,0 +1,420 @@
+#include "VirtualMachine.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <unistd.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SD_VM_THREADED 1            // labels as values
+#else
+#define SD_VM_THREADED 0
+#endif
+
+namespace {
+
+// int arithmetic of the JVM: 32-bit, wrapping
+inline int64_t wrap(uint32_t v) { return int32_t(v); }
+inline uint32_t u32(int64_t v) { return uint32_t(v); }
+
+} // namespace
+
+VirtualMachine::VirtualMachine(const bc::Module& m)
+    : module(m), outBuf(size_t(1) << 16), inBuf(size_t(1) << 16) {
+    // calloc: the pages are only touched as the stacks grow
+    stack = static_cast<Value*>(std::calloc(kRegisters, sizeof(Value)));
+    frames = static_cast<Frame*>(std::calloc(kFrames, sizeof(Frame)));
+    if (!stack || !frames) throw std::bad_alloc();
+
+    for (const std::string& s : module.strings) {
+        literals.push_back(make(s));
+        if (s.empty()) empty = literals.back();
+    }
+    if (!empty) {
+        literals.push_back(make(std::string()));
+        empty = literals.back();
+    }
+    globals.resize(module.globals.size());
+    for (size_t k = 0; k < globals.size(); ++k) {
+        const bc::Global& g = module.globals[k];
+        if (g.string) globals[k].s = g.text >= 0 ? literals[size_t(g.text)] : nullptr;
+        else globals[k].i = g.value;
+    }
+}
+
+VirtualMachine::~VirtualMachine() {
+    for (Str* s : literals) std::free(s);
+    for (Str* s : objects) std::free(s);
+    std::free(stack);
+    std::free(frames);
+}
+
+int VirtualMachine::run(std::FILE* input, std::FILE* output) {
+    in = input;
+    out = output;
+    const char* fault = nullptr;
+    bool init = module.init >= 0;
+    if (init) fault = execute(module.init);
+    if (!fault) {
+        init = false;
+        fault = execute(module.main);
+    }
+    flush();
+    if (!fault) return 0;
+    if (init) std::fprintf(stderr, "Exception in thread \"main\" java.lang.ExceptionInInitializerError\nCaused by: %s\n", fault);
+    else std::fprintf(stderr, "Exception in thread \"main\" %s\n", fault);
+    return 1;
+}
+
+//---------------------------------------------------------------
+// Strings
+//---------------------------------------------------------------
+VirtualMachine::Str* VirtualMachine::make(const std::string& s) {
+    Str* str = static_cast<Str*>(std::malloc(sizeof(Str) + s.size()));
+    if (!str) throw std::bad_alloc();
+    str->length = s.size();
+    str->marked = false;
+    std::memcpy(str->text(), s.data(), s.size());
+    return str;
+}
+
+VirtualMachine::Str* VirtualMachine::allocate(size_t length, const Value* top) {
+    if (allocated > threshold) collect(top);
+    Str* s = static_cast<Str*>(std::malloc(sizeof(Str) + length));
+    if (!s) throw std::bad_alloc();
+    s->length = length;
+    s->marked = false;
+    objects.push_back(s);
+    allocated += sizeof(Str) + length;
+    return s;
+}
+
+// Registers are untyped, so every value below `top` and every global
+// is looked up among the objects; only exact hits are marked
+void VirtualMachine::collect(const Value* top) {
+    std::sort(objects.begin(), objects.end(), std::less<Str*>());
+    auto mark = [&](Value v) {
+        auto it = std::lower_bound(objects.begin(), objects.end(), v.s, std::less<Str*>());
+        if (it != objects.end() && *it == v.s) (*it)->marked = true;
+    };
+    for (const Value* v = stack; v < top; ++v) mark(*v);
+    for (Value v : globals) mark(v);
+
+    size_t live = 0;
+    auto kept = objects.begin();
+    for (Str* s : objects) {
+        if (!s->marked) {
+            std::free(s);
+            continue;
+        }
+        s->marked = false;
+        live += sizeof(Str) + s->length;
+        *kept++ = s;
+    }
+    objects.erase(kept, objects.end());
+    allocated = live;
+    threshold = std::max(kMinHeap, 2 * live);
+}
+
+VirtualMachine::Str* VirtualMachine::concat(const Value* parts, int n, const Value* top) {
+    size_t length = 0;
+    for (int k = 0; k < n; ++k) length += parts[k].s ? parts[k].s->length : 4;
+    Str* s = allocate(length, top);
+    char* p = s->text();
+    for (int k = 0; k < n; ++k) {
+        if (Str* part = parts[k].s) {
+            std::memcpy(p, part->text(), part->length);
+            p += part->length;
+        } else {
+            std::memcpy(p, "null", 4);
+            p += 4;
+        }
+    }
+    return s;
+}
+
+//---------------------------------------------------------------
+// Input / output
+//---------------------------------------------------------------
+void VirtualMachine::write(const char* s, size_t n) {
+    if (outLen + n > outBuf.size()) {
+        flush();
+        if (n > outBuf.size()) {
+            std::fwrite(s, 1, n, out);
+            return;
+        }
+    }
+    std::memcpy(outBuf.data() + outLen, s, n);
+    outLen += n;
+}
+
+void VirtualMachine::flush() {
+    if (outLen) std::fwrite(outBuf.data(), 1, outLen, out);
+    outLen = 0;
+    std::fflush(out);
+}
+
+void VirtualMachine::printInt(int32_t v) {
+    char buf[12];
+    char* p = buf + sizeof buf;
+    uint32_t u = v < 0 ? 0u - uint32_t(v) : uint32_t(v);
+    do {
+        *--p = char('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0) *--p = '-';
+    write(p, size_t(buf + sizeof buf - p));
+}
+
+// one read() per 64 KiB, returning whatever is there (a terminal gives
+// a line at a time)
+int VirtualMachine::readByte() {
+    if (inPos == inLen) {
+        flush();                    // whatever was printed shows before the program waits
+        ssize_t n = ::read(fileno(in), inBuf.data(), inBuf.size());
+        if (n <= 0) return -1;
+        inLen = size_t(n);
+        inPos = 0;
+    }
+    return static_cast<unsigned char>(inBuf[inPos++]);
+}
+
+// [-]digits after blanks, 0 at the end of the input; the byte after
+// the digits is consumed, as by the JVM's _readInt
+int32_t VirtualMachine::readInt() {
+    int c;
+    do c = readByte();
+    while (c >= 0 && c <= ' ');
+    if (c < 0) return 0;
+    bool negative = c == '-';
+    if (negative) c = readByte();
+    uint32_t n = 0;
+    for (; c >= '0' && c <= '9'; c = readByte()) n = n * 10 + uint32_t(c - '0');
+    return int32_t(negative ? 0u - n : n);
+}
+
+// the next run of bytes above ' '; empty at the end of the input
+void VirtualMachine::readToken() {
+    token.clear();
+    int c;
+    do c = readByte();
+    while (c >= 0 && c <= ' ');
+    for (; c > ' '; c = readByte()) token.push_back(char(c));
+}
+
+//---------------------------------------------------------------
+// The interpreter
+//---------------------------------------------------------------
+void VirtualMachine::thread(const void* const* handlers) {
+    program.reserve(module.code.size());
+    for (const bc::Insn& in : module.code)
+        program.push_back(Slot{handlers ? handlers[size_t(in.op)] : nullptr, in.op, in.a, in.b, in.c, in.d});
+    for (const bc::Function& f : module.functions)
+        callees.push_back(Callee{program.data() + f.entry, f.params, f.locals, f.registers});
+}
+
+const char* VirtualMachine::execute(int function) {
+#if SD_VM_THREADED
+#define SD_VM_LABEL(name) &&L_##name,
+    static const void* const handlers[] = {SD_BYTECODE_OPS(SD_VM_LABEL)};
+#undef SD_VM_LABEL
+    if (callees.empty()) thread(handlers);
+#define CASE(name) L_##name:
+#define DISPATCH() goto *pc->handler
+#else
+    if (callees.empty()) thread(nullptr);
+#define CASE(name) case bc::Op::name:
+#define DISPATCH() goto dispatch
+#endif
+#define NEXT() do { ++pc; DISPATCH(); } while (0)
+#define JUMP(to) do { pc = code + (to); DISPATCH(); } while (0)
+#define THROW(what) do { fault = what; goto thrown; } while (0)
+#define R(x) base[pc->x]
+
+    const Slot* const code = program.data();
+    Value* const g = globals.data();
+    Value* const stackEnd = stack + kRegisters;
+    Frame* const framesEnd = frames + kFrames;
+    const Callee& entry = callees[size_t(function)];
+    Value* base = stack;
+    Value* top = stack + entry.registers;
+    Frame* fp = frames;
+    const Slot* pc = entry.entry;
+    const char* fault = nullptr;
+    for (Value* v = base + entry.params; v < base + entry.locals; ++v) v->i = 0;
+
+#if SD_VM_THREADED
+    DISPATCH();
+#else
+dispatch:
+    switch (pc->op) {
+#endif
+    CASE(Move)      R(a) = R(b); NEXT();
+    CASE(Int)       R(a).i = pc->b; NEXT();
+    CASE(Str)       R(a).s = literals[size_t(pc->b)]; NEXT();
+    CASE(GetGlobal) R(a) = g[pc->b]; NEXT();
+    CASE(PutGlobal) g[pc->a] = R(b); NEXT();
+
+    CASE(Add)    R(a).i = wrap(u32(R(b).i) + u32(R(c).i)); NEXT();
+    CASE(Sub)    R(a).i = wrap(u32(R(b).i) - u32(R(c).i)); NEXT();
+    CASE(Mul)    R(a).i = wrap(u32(R(b).i) * u32(R(c).i)); NEXT();
+    CASE(Div) {
+        int64_t x = R(b).i, y = R(c).i;
+        if (y == 0) THROW("java.lang.ArithmeticException: / by zero");
+        R(a).i = wrap(u32(x / y));              // 64-bit: MIN_VALUE / -1 wraps back to MIN_VALUE
+        NEXT();
+    }
+    CASE(Rem) {
+        int64_t x = R(b).i, y = R(c).i;
+        if (y == 0) THROW("java.lang.ArithmeticException: / by zero");
+        R(a).i = x % y;
+        NEXT();
+    }
+    CASE(Xor)    R(a).i = R(b).i ^ R(c).i; NEXT();
+    CASE(AddImm) R(a).i = wrap(u32(R(b).i) + uint32_t(pc->c)); NEXT();
+    CASE(Neg)    R(a).i = wrap(0u - u32(R(b).i)); NEXT();
+    CASE(Not)    R(a).i = R(b).i ^ 1; NEXT();
+
+    // ints are sign-extended and strings are pointers: one 64-bit compare fits both
+#define SD_VM_COMPARE(name, op)                                              \
+    CASE(name)          R(a).i = R(b).i op R(c).i; NEXT();                   \
+    CASE(Jump##name)    if (R(b).i op R(c).i) JUMP(pc->a); NEXT();           \
+    CASE(Jump##name##Imm) if (R(b).i op pc->c) JUMP(pc->a); NEXT();
+    SD_VM_COMPARE(Eq, ==)
+    SD_VM_COMPARE(Ne, !=)
+    SD_VM_COMPARE(Lt, <)
+    SD_VM_COMPARE(Ge, >=)
+    SD_VM_COMPARE(Gt, >)
+    SD_VM_COMPARE(Le, <=)
+#undef SD_VM_COMPARE
+#define SD_VM_INC_JUMP(name, op)                                             \
+    CASE(IncJump##name) {                                                    \
+        int64_t v = R(b).i = wrap(u32(R(b).i) + uint32_t(pc->c));            \
+        if (v op R(d).i) JUMP(pc->a);                                        \
+        NEXT();                                                              \
+    }                                                                        \
+    CASE(IncJump##name##Imm) {                                               \
+        int64_t v = R(b).i = wrap(u32(R(b).i) + uint32_t(pc->c));            \
+        if (v op pc->d) JUMP(pc->a);                                         \
+        NEXT();                                                              \
+    }
+    SD_VM_INC_JUMP(Lt, <)
+    SD_VM_INC_JUMP(Ge, >=)
+    SD_VM_INC_JUMP(Gt, >)
+    SD_VM_INC_JUMP(Le, <=)
+#undef SD_VM_INC_JUMP
+
+    CASE(Concat) {
+        Str* s = concat(&R(b), pc->c, top);
+        R(a).s = s;
+        NEXT();
+    }
+
+    CASE(Jump)      JUMP(pc->a);
+    CASE(JumpTrue)  if (R(b).i) JUMP(pc->a); NEXT();
+    CASE(JumpFalse) if (!R(b).i) JUMP(pc->a); NEXT();
+    CASE(Switch) {
+        const bc::SwitchTable& t = module.switches[size_t(pc->a)];
+        int64_t v = R(b).i;
+        if (t.dense) {
+            uint64_t k = uint64_t(v - t.low);
+            JUMP(k < t.targets.size() ? t.targets[k] : t.dflt);
+        }
+        auto it = std::lower_bound(t.cases.begin(), t.cases.end(), v,
+                                   [](const auto& c, int64_t x) { return c.first < x; });
+        JUMP(it != t.cases.end() && it->first == v ? it->second : t.dflt);
+    }
+
+    CASE(Call) {
+        const Callee& f = callees[size_t(pc->b)];
+        Value* window = base + pc->c;
+        if (fp == framesEnd || window + f.registers > stackEnd) THROW("java.lang.StackOverflowError");
+        *fp++ = Frame{pc + 1, base, top, pc->a};
+        base = window;
+        top = window + f.registers;
+        for (Value* v = base + f.params; v < base + f.locals; ++v) v->i = 0;
+        pc = f.entry;
+        DISPATCH();
+    }
+    CASE(Return) {
+        Value v = R(a);
+        if (fp == frames) return nullptr;
+        const Frame& f = *--fp;
+        base = f.base;
+        top = f.top;
+        base[f.dest] = v;
+        pc = f.ret;
+        DISPATCH();
+    }
+    CASE(ReturnVoid) {
+        if (fp == frames) return nullptr;
+        const Frame& f = *--fp;
+        base = f.base;
+        top = f.top;
+        pc = f.ret;
+        DISPATCH();
+    }
+
+    CASE(PrintInt) {
+        printInt(int32_t(R(a).i));
+        if (pc->b) write("\n", 1);
+        NEXT();
+    }
+    CASE(PrintBool) {
+        if (R(a).i) write("true", 4);
+        else write("false", 5);
+        if (pc->b) write("\n", 1);
+        NEXT();
+    }
+    CASE(PrintStr) {
+        if (Str* s = R(a).s) write(s->text(), s->length);
+        else write("null", 4);
+        if (pc->b) write("\n", 1);
+        NEXT();
+    }
+    CASE(PrintConst) {
+        Str* s = literals[size_t(pc->a)];
+        write(s->text(), s->length);
+        if (pc->b) write("\n", 1);
+        NEXT();
+    }
+
+    CASE(ReadInt) R(a).i = readInt(); NEXT();
+    CASE(ReadBool) {                            // Boolean.parseBoolean
+        readToken();
+        R(a).i = token.size() == 4 && (token[0] | 0x20) == 't' && (token[1] | 0x20) == 'r' &&
+                 (token[2] | 0x20) == 'u' && (token[3] | 0x20) == 'e';
+        NEXT();
+    }
+    CASE(ReadChar) {                            // charAt(0)
+        readToken();
+        if (token.empty()) THROW("java.lang.StringIndexOutOfBoundsException: index 0, length 0");
+        R(a).i = static_cast<unsigned char>(token[0]);
+        NEXT();
+    }
+    CASE(ReadStr) {
+        readToken();
+        Str* s = empty;
+        if (!token.empty()) {
+            s = allocate(token.size(), top);
+            std::memcpy(s->text(), token.data(), token.size());
+        }
+        R(a).s = s;
+        NEXT();
+    }
+#if !SD_VM_THREADED
+    }
+#endif
+
+thrown:
+    return fault;
+
+#undef CASE
+#undef DISPATCH
+#undef NEXT
+#undef JUMP
+#undef THROW
+#undef R
+}
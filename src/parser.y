@@ -19,8 +19,10 @@
         struct VarDeclList;
         struct Block;
         struct EmptyStmt;
+        struct SwitchCase;
         using StmtList = std::vector<std::unique_ptr<Stmt>>;
         using ExprList = std::vector<std::unique_ptr<Expr>>;
+        using CaseList = std::vector<SwitchCase>;
     }
 }
 
@@ -33,8 +35,24 @@
 #include <fstream>
 #include <filesystem>
 #include <string>
+#include <optional>
 #include "../include/SemanticAnalyzer.hpp"
+#include "../include/BytecodeCompiler.hpp"
+#include "../include/ClassWriter.hpp"
 #include "../include/CodeGenVisitor.hpp"
+#include "../include/CompilerOptions.hpp"
+#include "../include/ConstFolder.hpp"
+#include "../include/ConstInterpreter.hpp"
+#include "../include/Inliner.hpp"
+#include "../include/IRBuilder.hpp"
+#include "../include/PassManager.hpp"
+#include "../include/TreeShaker.hpp"
+#include "../include/VirtualMachine.hpp"
+#include "../include/Simplifier.hpp"
+#include "../include/PhaseTimer.hpp"
+#include "../include/Snapshot.hpp"
+#include "../include/StreamingCompiler.hpp"
+#include "../include/WorkStealingPool.hpp"
 using namespace std;
 namespace fs = std::filesystem;
 
@@ -46,6 +64,7 @@ void yywarning(std::string s);
 ast::Program* parse();
 
 ast::Program* root = nullptr;
+StreamingCompiler* streamSink = nullptr;   // --stream: top-level items go here instead of into root
 std::ofstream outStream;
 %}
 
@@ -74,6 +93,8 @@ std::ofstream outStream;
     ast::Println*     println;
     ast::Read*        read;
     ast::EmptyStmt*   empty_stmt;
+    ast::SwitchCase*  switch_case;
+    ast::CaseList*    case_list;
 }
 
 %token BAD_CHARACTER
@@ -134,6 +155,10 @@ std::ofstream outStream;
 %type <stmt_list> main
 %type <stmt_list> statement_list
 %type <block> block
+%type <case_list> switch_body
+%type <case_list> switch_arms
+%type <switch_case> switch_arm
+%type <switch_case> case_labels
 //========Statement unit=========
 
 //========Expression unit=========
@@ -197,21 +222,25 @@ program:
 
 global_declaration:
       global_declaration declaration SEMICOLON {
-        $1->decls.push_back(std::unique_ptr<ast::Decl>($2));
+        if (streamSink) streamSink->topLevel($2);
+        else $1->decls.push_back(std::unique_ptr<ast::Decl>($2));
         $$ = $1;
       }
     | declaration SEMICOLON {
         auto tmp = new ast::DeclList();
-        tmp->decls.push_back(std::unique_ptr<ast::Decl>($1));
+        if (streamSink) streamSink->topLevel($1);
+        else tmp->decls.push_back(std::unique_ptr<ast::Decl>($1));
         $$ = tmp;
       }
     | global_declaration function_declaration {
-        $1->decls.push_back(std::unique_ptr<ast::FuncDecl>($2));
+        if (streamSink) streamSink->topLevel($2);
+        else $1->decls.push_back(std::unique_ptr<ast::FuncDecl>($2));
         $$ = $1;
       }
     | function_declaration {
         auto tmp = new ast::DeclList();
-        tmp->decls.push_back(std::unique_ptr<ast::FuncDecl>($1));
+        if (streamSink) streamSink->topLevel($1);
+        else tmp->decls.push_back(std::unique_ptr<ast::FuncDecl>($1));
         $$ = tmp;
       }
     ;
@@ -222,7 +251,8 @@ main:
             yywarning("Main function not found!");
         }
         auto tmp = new std::vector<std::unique_ptr<ast::Stmt>>();
-        tmp->push_back(std::unique_ptr<ast::Stmt>($1));
+        if (streamSink) streamSink->topLevel($1);
+        else tmp->push_back(std::unique_ptr<ast::Stmt>($1));
         $$ = tmp;
     }
     ;
@@ -328,8 +358,64 @@ statement:
             
         delete $3;
       }
+    | SWITCH LEFT_PARENTHESIS expression RIGHT_PARENTHESIS LEFT_CURLY_BRACKET switch_body RIGHT_CURLY_BRACKET {
+        $$ = new ast::SwitchStmt(std::unique_ptr<ast::Expr>($3), std::move(*$6), @1.first_line);
+        delete $6;
+      }
     | RETURN SEMICOLON { $$ = new ast::ReturnStmt(nullptr, @$.first_line); }
     | RETURN expression SEMICOLON { $$ = new ast::ReturnStmt(std::unique_ptr<ast::Expr>($2), @$.first_line); }
+    | BREAK SEMICOLON { $$ = new ast::BreakStmt(@$.first_line); }
+    | CONTINUE SEMICOLON { $$ = new ast::ContinueStmt(@$.first_line); }
+    ;
+
+switch_body:
+      switch_arms { $$ = $1; }
+    | switch_arms case_labels {
+        // labels with no statements after them: the switch just ends
+        $2->body = std::make_unique<ast::Block>(ast::StmtList{}, $2->line);
+        $1->push_back(std::move(*$2));
+        $$ = $1;
+        delete $2;
+      }
+    | case_labels {
+        $1->body = std::make_unique<ast::Block>(ast::StmtList{}, $1->line);
+        $$ = new ast::CaseList();
+        $$->push_back(std::move(*$1));
+        delete $1;
+      }
+    | /* no arms */ { $$ = new ast::CaseList(); }
+    ;
+
+switch_arms:
+      switch_arms switch_arm { $1->push_back(std::move(*$2)); $$ = $1; delete $2; }
+    | switch_arm { $$ = new ast::CaseList(); $$->push_back(std::move(*$1)); delete $1; }
+    ;
+
+switch_arm:
+      case_labels statement_list {
+        $1->body = std::make_unique<ast::Block>(std::move(*$2), @2.first_line);
+        $$ = $1;
+        delete $2;
+      }
+    ;
+
+case_labels:
+      case_labels CASE expression COLON { $1->labels.push_back(std::unique_ptr<ast::Expr>($3)); $$ = $1; }
+    | case_labels DEFAULT COLON {
+        if ($1->isDefault) yyerror("Duplicate default label in switch");
+        $1->isDefault = true;
+        $$ = $1;
+      }
+    | CASE expression COLON {
+        $$ = new ast::SwitchCase();
+        $$->line = @1.first_line;
+        $$->labels.push_back(std::unique_ptr<ast::Expr>($2));
+      }
+    | DEFAULT COLON {
+        $$ = new ast::SwitchCase();
+        $$->line = @1.first_line;
+        $$->isDefault = true;
+      }
     ;
 
 lvalue
@@ -557,43 +643,206 @@ ast::Program* parse() {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        printf ("Usage: parser <FILE_NAME>\n");
+    CompilerOptions opts;
+    if (!parseOptions(argc, argv, opts)) {
         return EXIT_FAILURE;
     }
 
-    fs::path inputPath(argv[1]);
-    yyin = fopen(inputPath.string().c_str(), "r");
-    if (!yyin) {
-        std::perror("fopen");
+    fs::path inputPath(opts.inputFile);
+    std::string program_name = inputPath.stem().string();
+    std::string outputFilename = program_name + (opts.emitClass ? ".class" : ".jasm");
+    bool fromSnapshot = inputPath.extension() == ".sdsnap";
+    PhaseTimer timer(opts.timePhases);
+
+    if (opts.stream && fromSnapshot) {
+        std::cerr << "Error: --stream needs a .sd source file\n";
         return EXIT_FAILURE;
     }
 
-    std::string program_name = inputPath.stem().string();
-    std::string outputFilename = program_name + ".jasm";
+    if (!fromSnapshot) {
+        yyin = fopen(inputPath.string().c_str(), "r");
+        if (!yyin) {
+            std::perror("fopen");
+            return EXIT_FAILURE;
+        }
+    }
 
-    std::ofstream outStream(outputFilename);
-    if (!outStream.is_open()) {
-        std::cerr << "Error opening output file: " << outputFilename << '\n';
-        return EXIT_FAILURE;
+    std::ofstream outStream;
+    if (!opts.run) {
+        outStream.open(outputFilename, opts.emitClass ? std::ios::binary : std::ios::out);
+        if (!outStream.is_open()) {
+            std::cerr << "Error opening output file: " << outputFilename << '\n';
+            return EXIT_FAILURE;
+        }
     }
 
-    // Parse the input file and generate the AST
-    auto AbstractSyntaxTree = parse();
+    OptReport optReport;
+    if (opts.stream) {
+        // Parse, analysis and code generation are interleaved per top-level item
+        StreamingCompiler streaming(program_name, outputFilename, &opts, &optReport);
+        if (!streaming.isOpen()) {
+            std::cerr << "Error opening temporary file: " << outputFilename << ".tmp\n";
+            return EXIT_FAILURE;
+        }
+        streamSink = &streaming;
+        timer.start("streaming compile");
+        std::unique_ptr<ast::Program> globalsOnly(parse());
+        streaming.finish(outStream);
+        outStream.close();
+        timer.stop();
+        streamSink = nullptr;
+
+        cout << "Parsing completed successfully!" << endl;
+        timer.report(std::cerr);
+        if (opts.optReport) optReport.print(std::cerr);
+        return 0;
+    }
+
+    std::unique_ptr<WorkStealingPool> pool;
+    if (opts.jobs > 0) pool = std::make_unique<WorkStealingPool>(opts.jobs);
 
-    // Parse the AST and do the semantic analysis
+    std::unique_ptr<ast::Program> AbstractSyntaxTree;
     SymbolTable symtab;
-    SemanticAnalyzer semanticAnalyzer(symtab);
-    semanticAnalyzer.analyze(*AbstractSyntaxTree);
+    SnapshotReader snapshot;
+    std::string err;
+
+    if (fromSnapshot) {
+        // An analysed snapshot skips scanning, parsing and semantic analysis
+        timer.start("snapshot load");
+        if (snapshot.open(inputPath.string(), err))
+            AbstractSyntaxTree = snapshot.program();
+        timer.stop();
+        if (!AbstractSyntaxTree) {
+            std::cerr << "Error: " << (err.empty() ? "corrupt snapshot '" + inputPath.string() + "'" : err) << '\n';
+            return EXIT_FAILURE;
+        }
+    } else {
+        // Parse the input file and generate the AST
+        timer.start("parse");
+        AbstractSyntaxTree.reset(parse());
+        timer.stop();
+
+        // Parse the AST and do the semantic analysis
+        timer.start("semantic analysis");
+        SemanticAnalyzer semanticAnalyzer(symtab);
+        if (pool)
+            semanticAnalyzer.analyzeParallel(*AbstractSyntaxTree, *pool);
+        else
+            semanticAnalyzer.analyze(*AbstractSyntaxTree);
+        timer.stop();
+
+        if (opts.emitSnapshot) {
+            timer.start("snapshot write");
+            if (!SnapshotWriter::write(*AbstractSyntaxTree, program_name + ".sdsnap", err)) {
+                std::cerr << "Error: " << err << '\n';
+                return EXIT_FAILURE;
+            }
+            timer.stop();
+        }
+    }
+
+    // Whole-program pass: every body is folded before code generation
+    // (the inliner sizes and copies folded bodies); pure calls with
+    // constant arguments and global initializers are evaluated too
+    if (opts.enabled("const-fold")) {
+        timer.start("const fold");
+        std::optional<ConstInterpreter> interpreter;
+        if (opts.enabled("const-eval")) interpreter.emplace(*AbstractSyntaxTree);
+        ConstFolder(&optReport, interpreter ? &*interpreter : nullptr).fold(*AbstractSyntaxTree);
+        timer.stop();
+    }
+    if (opts.enabled("simplify")) {
+        timer.start("simplify");
+        Simplifier(&optReport).run(*AbstractSyntaxTree);
+        timer.stop();
+    }
+
+    // Calls to small functions are expanded in place (not on the IR
+    // path, which keeps every call, nor for --run); functions main never
+    // reaches and globals nobody touches are not emitted
+    std::optional<Inliner> inliner;
+    if (opts.enabled("inline") && !opts.viaIR && !opts.run) inliner.emplace(*AbstractSyntaxTree);
+    TreeShaker shaker(inliner ? &*inliner : nullptr, &optReport);
+    if (opts.enabled("tree-shake")) {
+        timer.start("tree shake");
+        shaker.run(*AbstractSyntaxTree);
+        timer.stop();
+    }
+
+    // --dump-ir: every function as the IR backend sees it, after the IR passes
+    if (opts.dumpIR) {
+        IRBuilder builder;
+        auto dump = [&](ast::Node* n) {
+            auto* fn = dynamic_cast<ast::FuncDecl*>(n);
+            if (!fn) return;
+            ir::Function f;
+            if (!builder.build(*fn, f, opts.enabled("tail-rec"))) {
+                std::cout << "; " << fn->name << ": not expressible in the IR\n\n";
+                return;
+            }
+            PassManager::standard(&opts, nullptr).run(f);
+            f.print(std::cout);
+            std::cout << '\n';
+        };
+        for (auto& d : AbstractSyntaxTree->globals) dump(d.get());
+        for (auto& s : AbstractSyntaxTree->stmts) dump(s.get());
+    }
+
+    // --run: lower to register bytecode and execute it in-process; the
+    // program's own output is all that goes to stdout
+    if (opts.run) {
+        timer.start("bytecode");
+        bc::Module module;
+        BytecodeCompiler compiler(&opts);
+        bool compiled = compiler.compile(*AbstractSyntaxTree, module);
+        timer.stop();
+        if (!compiled) {
+            std::cerr << "Error: " << compiler.error() << '\n';
+            return EXIT_FAILURE;
+        }
+        timer.start("run");
+        int status = VirtualMachine(module).run(stdin, stdout);
+        timer.stop();
+        if (timer.isEnabled())
+            std::cerr << "[bytecode] " << module.code.size() << " instructions\n";
+        timer.report(std::cerr);
+        if (opts.optReport) optReport.print(std::cerr);
+        return status;
+    }
 
     // Generate code from the AST
+    timer.start("code generation");
     CodeEmitter emitter(outStream);
     CodeGenContext ctx(program_name);
-    CodeGenVisitor codegen(emitter, ctx, symtab); 
-    codegen.generate(*AbstractSyntaxTree);
+    CodeGenVisitor codegen(emitter, ctx, symtab, &opts, &optReport); 
+    codegen.setInliner(inliner ? &*inliner : nullptr);
+    // --emit=class: the methods are assembled here instead of printed
+    std::optional<ClassWriter> classFile;
+    if (opts.emitClass) {
+        classFile.emplace(program_name);
+        codegen.setClassWriter(&*classFile);
+    }
+    if (pool)
+        codegen.generateParallel(*AbstractSyntaxTree, *pool);
+    else
+        codegen.generate(*AbstractSyntaxTree);
+    emitter.flush();
+    if (classFile && !classFile->write(outStream, err)) {
+        std::cerr << "Error: " << outputFilename << ": " << err << '\n';
+        outStream.close();
+        fs::remove(outputFilename);
+        return EXIT_FAILURE;
+    }
+    outStream.close();
+    double codegenMs = timer.stop();
+    size_t instructions = classFile ? classFile->instructions() : emitter.instructionCount();
+    if (timer.isEnabled() && codegenMs > 0)
+        std::cerr << "[codegen] " << instructions << " instructions, "
+                  << size_t(instructions / (codegenMs / 1000.0)) << " instructions/s\n";
 
     cout << "Parsing completed successfully!" << endl;   
+    timer.report(std::cerr);
+    if (opts.optReport) optReport.print(std::cerr);
 
-    outStream.close();
     return 0;
-}
\ No newline at end of file
+}
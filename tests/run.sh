@@ -0,0 +1,88 @@
+#!/usr/bin/env bash
+set -uo pipefail
+
+# ---------- 回歸測試 ----------
+# Usage: tests/run.sh [PARSER]        (make test)
+#   每個 tests/<NAME>.sd 在每個後端、-O0 / -O1 下編譯並執行，輸出必須與
+#   <NAME>.out 完全相同；有 <NAME>.in 時當作 stdin
+#   --run 一定會跑；.jasm 需要 javaa 與 java，.class 只需要 java，
+#   找不到就略過並說明（可用 JAVAA / JAVA 環境變數指定）
+#   程式裡有 "// needs: NAME" 時，-O0 與 --disable=NAME 不跑
+#   （例如深度遞迴只在 tail-rec 開著時才不會 StackOverflowError）
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+ROOT="$(dirname "$DIR")"
+PARSER="${1:-$ROOT/parser}"
+PARSER="$(cd "$(dirname "$PARSER")" && pwd)/$(basename "$PARSER")"
+
+if [[ ! -x "$PARSER" ]]; then
+    echo "Error: '$PARSER' not found, run make first."
+    exit 1
+fi
+
+# javaa：先找專案目錄（run.sh 用 ./javaa），再找 PATH
+if [[ -z "${JAVAA:-}" ]]; then
+    if [[ -x "$ROOT/javaa" ]]; then JAVAA="$ROOT/javaa"
+    else JAVAA="$(command -v javaa || true)"; fi
+fi
+JAVA="${JAVA:-$(command -v java || true)}"
+
+VM_MODES=("--run -O0" "--run -O1" "--run --disable=run.fuse")
+JASM_MODES=("-O0" "-O1" "-j 2" "--stream" "--ir" "--ir -O0" "--buffered-output")
+CLASS_MODES=("--emit=class -O0" "--emit=class -O1")
+
+MODES=("${VM_MODES[@]}")
+if [[ -n "$JAVA" && -n "$JAVAA" ]]; then MODES+=("${JASM_MODES[@]}")
+else echo "note: javaa / java not found, .jasm back ends skipped"; fi
+if [[ -n "$JAVA" ]]; then MODES+=("${CLASS_MODES[@]}")
+else echo "note: java not found, --emit=class skipped"; fi
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+pass=0
+fail=0
+
+# 編譯並執行一次，程式輸出寫到 $WORK/got；失敗時回傳非 0
+run() {    # run <src> <name> <input> <mode...>
+    local src="$1" name="$2" input="$3"; shift 3
+    rm -f "$WORK/$name.jasm" "$WORK/$name.class"
+    case " $* " in
+        *" --run "*)
+            (cd "$WORK" && "$PARSER" "$@" "$src" < "$input" > got 2> err)
+            return ;;
+    esac
+    (cd "$WORK" && "$PARSER" "$@" "$src" > /dev/null 2> err) || return 1
+    case " $* " in
+        *" --emit=class "*) ;;
+        *) (cd "$WORK" && "$JAVAA" "$name.jasm" > /dev/null 2> err) || return 1 ;;
+    esac
+    (cd "$WORK" && "$JAVA" -cp . "$name" < "$input" > got 2> err)
+}
+
+for src in "$DIR"/*.sd; do
+    name="$(basename "$src" .sd)"
+    expect="$DIR/$name.out"
+    [[ -f "$expect" ]] || continue
+    input="$DIR/$name.in"
+    [[ -f "$input" ]] || input=/dev/null
+    needs="$(sed -n 's|^// needs: *||p' "$src")"
+
+    for mode in "${MODES[@]}"; do
+        if [[ -n "$needs" ]] && [[ " $mode " == *" -O0 "* || " $mode " == *"--disable=$needs"* ]]; then
+            continue
+        fi
+        # shellcheck disable=SC2086  # mode 是多個參數
+        if run "$src" "$name" "$input" $mode && cmp -s "$WORK/got" "$expect"; then
+            pass=$((pass + 1))
+        else
+            fail=$((fail + 1))
+            echo "FAIL $name [$mode]"
+            head -5 "$WORK/err"
+            diff "$WORK/got" "$expect" 2> /dev/null | head -10
+        fi
+    done
+done
+
+echo "$pass passed, $fail failed"
+(( fail == 0 ))